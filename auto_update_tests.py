@@ -6,6 +6,7 @@ from scripts.test.support import run_command, split_wast
 from scripts.test.shared import (
     ASM2WASM, MOZJS, S2WASM, WASM_SHELL, WASM_OPT, WASM_AS, WASM_DIS,
     WASM_CTOR_EVAL, WASM_MERGE, WASM_REDUCE, WASM2ASM, WASM_METADCE,
+    WASM_SUPEROPT,
     BINARYEN_INSTALL_DIR, has_shell_timeout)
 from scripts.test.wasm2asm import tests, spec_tests, extra_tests, assert_tests
 
@@ -86,6 +87,14 @@ for t in sorted(os.listdir(os.path.join('test', 'print'))):
     actual = subprocess.check_output(cmd)
     with open(os.path.join('test', 'print', wasm + '.minified.txt'), 'w') as o: o.write(actual)
 
+for t in sorted(os.listdir(os.path.join('test', 'inlining-profile'))):
+  if t.endswith('.wast'):
+    print '..', t
+    t = os.path.join('test', 'inlining-profile', t)
+    cmd = WASM_OPT + [t, '--inlining', '--optimize-level=3', '--pass-arg=inlining-profile@' + t + '.profile', '--print']
+    actual = run_command(cmd)
+    with open(t + '.txt', 'w') as o: o.write(actual)
+
 for t in sorted(os.listdir(os.path.join('test', 'passes'))):
   if t.endswith(('.wast', '.wasm')):
     print '..', t
@@ -307,6 +316,15 @@ for t in os.listdir(os.path.join('test', 'metadce')):
     with open(out, 'w') as o: o.write(actual)
     with open(out + '.stdout', 'w') as o: o.write(stdout)
 
+print '\n[ checking wasm-superopt... ]\n'
+
+for t in os.listdir(os.path.join('test', 'superopt')):
+  if t.endswith(('.wast', '.wasm')):
+    print '..', t
+    t = os.path.join('test', 'superopt', t)
+    actual = run_command(WASM_SUPEROPT + [t])
+    with open(t + '.patterns', 'w') as o: o.write(actual)
+
 if has_shell_timeout():
   print '\n[ checking wasm-reduce ]\n'
 
@@ -24,7 +24,7 @@ from scripts.test.support import run_command, split_wast
 from scripts.test.shared import (
     BIN_DIR, EMCC, MOZJS, NATIVECC, NATIVEXX, NODEJS, S2WASM_EXE,
     WASM_AS, WASM_CTOR_EVAL, WASM_OPT, WASM_SHELL, WASM_MERGE, WASM_SHELL_EXE, WASM_METADCE,
-    WASM_DIS, WASM_REDUCE, binary_format_check, delete_from_orbit, fail, fail_with_error,
+    WASM_DIS, WASM_REDUCE, WASM_SUPEROPT, binary_format_check, delete_from_orbit, fail, fail_with_error,
     fail_if_not_identical, fail_if_not_contained, has_vanilla_emcc,
     has_vanilla_llvm, minify_check, num_failures, options, tests,
     requested, warnings, has_shell_timeout
@@ -33,6 +33,7 @@ from scripts.test.shared import (
 import scripts.test.asm2wasm as asm2wasm
 import scripts.test.s2wasm as s2wasm
 import scripts.test.wasm2asm as wasm2asm
+import scripts.test.wasm2c as wasm2c
 
 if options.interpreter:
   print '[ using wasm interpreter at "%s" ]' % options.interpreter
@@ -118,6 +119,16 @@ def run_wasm_opt_tests():
           with open(t + '.wat') as expected:
             fail_if_not_identical(actual.read(), expected.read())
 
+  print '\n[ checking wasm-opt inlining with a profile... ]\n'
+
+  for t in sorted(os.listdir(os.path.join(options.binaryen_test, 'inlining-profile'))):
+    if t.endswith('.wast'):
+      print '..', t
+      t = os.path.join(options.binaryen_test, 'inlining-profile', t)
+      cmd = WASM_OPT + [t, '--inlining', '--optimize-level=3', '--pass-arg=inlining-profile@' + t + '.profile', '--print']
+      actual = run_command(cmd)
+      fail_if_not_identical(actual, open(t + '.txt').read())
+
   print '\n[ checking wasm-opt parsing & printing... ]\n'
 
   for t in sorted(os.listdir(os.path.join(options.binaryen_test, 'print'))):
@@ -237,6 +248,17 @@ def run_wasm_metadce_tests():
       with open(expected + '.stdout') as correct:
         fail_if_not_identical(stdout, correct.read())
 
+def run_wasm_superopt_tests():
+  print '\n[ checking wasm-superopt ]\n'
+
+  for t in os.listdir(os.path.join('test', 'superopt')):
+    if t.endswith(('.wast', '.wasm')):
+      print '..', t
+      t = os.path.join('test', 'superopt', t)
+      actual = run_command(WASM_SUPEROPT + [t])
+      with open(t + '.patterns') as expected:
+        fail_if_not_identical(actual, expected.read())
+
 def run_wasm_reduce_tests():
   print '\n[ checking wasm-reduce ]\n'
 
@@ -272,8 +294,8 @@ def run_spec_tests():
       if os.path.basename(wast) in ['linking.wast', 'nop.wast', 'stack.wast', 'typecheck.wast', 'unwind.wast']: # FIXME
         continue
 
-      def run_spec_test(wast):
-        cmd = WASM_SHELL + [wast]
+      def run_spec_test(wast, extra_args=[]):
+        cmd = WASM_SHELL + [wast] + extra_args
         # we must skip the stack machine portions of spec tests or apply other extra args
         extra = {
         }
@@ -316,6 +338,11 @@ def run_spec_tests():
 
       check_expected(actual, expected)
 
+      # the jit must behave exactly like the interpreter
+      jit_actual = run_spec_test(wast, ['--jit'])
+      if jit_actual != actual:
+        fail(jit_actual, actual)
+
       # skip binary checks for tests that reuse previous modules by name, as that's a wast-only feature
       if os.path.basename(wast) in ['exports.wast']: # FIXME
         continue
@@ -348,6 +375,19 @@ def run_spec_tests():
         # compare all the outputs to the expected output
         check_expected(actual, os.path.join(options.binaryen_test, 'spec', 'expected-output', os.path.basename(wast) + '.log'))
 
+def run_jit_tests():
+  print '\n[ checking wasm-shell --jit... ]\n'
+
+  for t in sorted(os.listdir(os.path.join('test', 'jit'))):
+    if t.endswith('.wast'):
+      print '..', t
+      t = os.path.join('test', 'jit', t)
+      # the asserts check the interpreter, and the jit must behave exactly
+      # like it
+      actual = run_command(WASM_SHELL + [t], stderr=subprocess.STDOUT)
+      jit_actual = run_command(WASM_SHELL + [t, '--jit'], stderr=subprocess.STDOUT)
+      fail_if_not_identical(jit_actual, actual)
+
 def run_binaryen_js_tests():
   if not MOZJS and not NODEJS:
     return
@@ -589,14 +629,17 @@ def main():
   run_crash_tests()
   run_ctor_eval_tests()
   run_wasm_metadce_tests()
+  run_wasm_superopt_tests()
   if has_shell_timeout():
     run_wasm_reduce_tests()
 
   run_spec_tests()
+  run_jit_tests()
   run_binaryen_js_tests()
   s2wasm.test_s2wasm()
   s2wasm.test_linker()
   wasm2asm.test_wasm2asm()
+  wasm2c.test_wasm2c()
   run_validator_tests()
   if options.torture and options.test_waterfall:
     run_torture_tests()
@@ -0,0 +1,223 @@
+/*
+ * Copyright 2017 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// Benchmarks the analyses in src/cfg/domtree.h on large generated CFGs.
+//
+// The CFGs have the shapes that the CFGWalker builds for structured code:
+//
+//  * structured: random nesting of ifs, loops, and blocks with branches
+//                out of them, like typical compiled code.
+//  * relooped:   a loop around a br_table dispatching to many cases, each
+//                of which branches back to the loop, like what emscripten
+//                emits for irreducible control flow.
+//  * nested:     loops nested 1000 deep, each with an if, in sequence.
+//  * diamonds:   a long sequence of if-elses.
+//
+// Build and run from the repository root with
+//
+//   c++ -O2 -std=c++11 -Isrc scripts/benchmark_cfg.cpp -o benchmark_cfg
+//   ./benchmark_cfg [NUM_BLOCKS...]
+//
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <random>
+
+#include "cfg/domtree.h"
+
+using namespace wasm;
+
+struct BasicBlock {
+  std::vector<BasicBlock*> out, in;
+};
+
+struct CFG {
+  std::vector<std::unique_ptr<BasicBlock>> blocks;
+
+  Index add() {
+    blocks.emplace_back(new BasicBlock());
+    return blocks.size() - 1;
+  }
+
+  void link(Index from, Index to) {
+    blocks[from]->out.push_back(blocks[to].get());
+    blocks[to]->in.push_back(blocks[from].get());
+  }
+};
+
+struct StructuredGenerator {
+  CFG& cfg;
+  Index budget;
+  std::mt19937 random;
+  std::vector<Index> targets; // the blocks that branches can go to
+  Index current;
+
+  StructuredGenerator(CFG& cfg, Index budget) : cfg(cfg), budget(budget), random(42) {
+    current = cfg.add();
+  }
+
+  Index next() {
+    auto block = cfg.add();
+    cfg.link(current, block);
+    return current = block;
+  }
+
+  void generate(Index depth) {
+    while (cfg.blocks.size() < budget) {
+      auto choice = random() % 8;
+      if (depth > 30 || choice < 2) {
+        // leave this scope, maybe conditionally branching somewhere first
+        if (!targets.empty() && random() % 2) {
+          cfg.link(current, targets[random() % targets.size()]);
+          next();
+        }
+        return;
+      } else if (choice < 4) {
+        auto before = current;
+        next();
+        generate(depth + 1);
+        auto ifTrueEnd = current;
+        current = before;
+        next();
+        generate(depth + 1);
+        auto join = cfg.add();
+        cfg.link(ifTrueEnd, join);
+        cfg.link(current, join);
+        current = join;
+      } else if (choice < 6) {
+        auto top = next();
+        targets.push_back(top);
+        generate(depth + 1);
+        targets.pop_back();
+        cfg.link(current, top);
+        next();
+      } else {
+        auto end = cfg.add();
+        targets.push_back(end);
+        generate(depth + 1);
+        targets.pop_back();
+        cfg.link(current, end);
+        current = end;
+      }
+    }
+  }
+};
+
+void generateStructured(CFG& cfg, Index size) {
+  StructuredGenerator generator(cfg, size);
+  while (cfg.blocks.size() < size) {
+    generator.generate(0);
+  }
+}
+
+void generateRelooped(CFG& cfg, Index size) {
+  auto entry = cfg.add();
+  auto dispatch = cfg.add();
+  cfg.link(entry, dispatch);
+  auto exit = cfg.add();
+  std::mt19937 random(42);
+  while (cfg.blocks.size() < size) {
+    auto start = cfg.add();
+    cfg.link(dispatch, start);
+    auto end = cfg.add();
+    cfg.link(start, end);
+    cfg.link(start, exit);
+    cfg.link(end, dispatch);
+  }
+}
+
+void generateNested(CFG& cfg, Index size) {
+  auto current = cfg.add();
+  while (cfg.blocks.size() < size) {
+    std::vector<Index> tops;
+    for (Index i = 0; i < 1000; i++) {
+      auto top = cfg.add();
+      cfg.link(current, top);
+      tops.push_back(top);
+      auto arm = cfg.add();
+      cfg.link(top, arm);
+      current = cfg.add();
+      cfg.link(top, current);
+      cfg.link(arm, current);
+    }
+    while (!tops.empty()) {
+      cfg.link(current, tops.back());
+      tops.pop_back();
+      auto after = cfg.add();
+      cfg.link(current, after);
+      current = after;
+    }
+  }
+}
+
+void generateDiamonds(CFG& cfg, Index size) {
+  auto current = cfg.add();
+  while (cfg.blocks.size() < size) {
+    auto left = cfg.add(), right = cfg.add(), join = cfg.add();
+    cfg.link(current, left);
+    cfg.link(current, right);
+    cfg.link(left, join);
+    cfg.link(right, join);
+    current = join;
+  }
+}
+
+double now() {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void benchmark(const char* name, std::function<void (CFG&, Index)> generate, Index size) {
+  CFG cfg;
+  generate(cfg, size);
+  auto start = now();
+  BlockGraph<BasicBlock> graph(cfg.blocks[0].get());
+  auto graphTime = now() - start;
+  start = now();
+  DominatorTree dominators(graph.preds);
+  auto dominatorsTime = now() - start;
+  start = now();
+  auto frontiers = dominators.getFrontiers(graph.preds);
+  auto frontiersTime = now() - start;
+  start = now();
+  PostDominatorTree postDominators(graph.succs);
+  auto postDominatorsTime = now() - start;
+  start = now();
+  LoopForest loops(graph.preds, dominators);
+  auto loopsTime = now() - start;
+  Index maxDepth = 0;
+  for (Index i = 0; i < graph.blocks.size(); i++) {
+    maxDepth = std::max(maxDepth, loops.getDepth(i));
+  }
+  printf("%-10s %9u blocks %8u loops (depth %5u): graph %.3f, dominators %.3f, frontiers %.3f, post-dominators %.3f, loops %.3f seconds\n",
+         name, unsigned(graph.blocks.size()), unsigned(loops.loops.size()), unsigned(maxDepth),
+         graphTime, dominatorsTime, frontiersTime, postDominatorsTime, loopsTime);
+}
+
+int main(int argc, char** argv) {
+  std::vector<Index> sizes;
+  for (int i = 1; i < argc; i++) sizes.push_back(atoi(argv[i]));
+  if (sizes.empty()) sizes = { 10000, 100000, 1000000 };
+  for (auto size : sizes) {
+    benchmark("structured", generateStructured, size);
+    benchmark("relooped", generateRelooped, size);
+    benchmark("nested", generateNested, size);
+    benchmark("diamonds", generateDiamonds, size);
+  }
+}
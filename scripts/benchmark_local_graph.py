@@ -0,0 +1,99 @@
+#! /usr/bin/env python
+
+#   Copyright 2017 WebAssembly Community Group participants
+#
+#   Licensed under the Apache License, Version 2.0 (the "License");
+#   you may not use this file except in compliance with the License.
+#   You may obtain a copy of the License at
+#
+#       http://www.apache.org/licenses/LICENSE-2.0
+#
+#   Unless required by applicable law or agreed to in writing, software
+#   distributed under the License is distributed on an "AS IS" BASIS,
+#   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#   See the License for the specific language governing permissions and
+#   limitations under the License.
+
+'''
+Benchmarks the passes built on LocalGraph (ssa, precompute-propagate,
+merge-locals) on large functions.
+
+By default this generates a function shaped like what emscripten emits for
+big relooped C functions: thousands of locals, and a loop around a br_table
+dispatching on a label local to many cases, each of which reads and writes
+a few locals and then picks the next label. Alternatively, provide wast or
+wasm files (for example, real emscripten output) to measure those.
+
+Usage: benchmark_local_graph.py [--wasm-opt=PATH] [--locals=N] [--cases=N]
+                                [FILE...]
+'''
+
+import os
+import random
+import subprocess
+import sys
+import tempfile
+import time
+
+PASSES = ['ssa', 'precompute-propagate', 'merge-locals']
+
+
+def generate(num_locals, num_cases):
+  r = random.Random(42)
+  out = ['(module\n (func $big (param $p i32) (result i32)\n']
+  for i in range(num_locals):
+    out.append('  (local $%d i32)\n' % i)
+  out.append('  (set_local $0 (get_local $p))\n')
+  out.append('  (loop $dispatch\n')
+  for i in range(num_cases):
+    out.append('   (block $case%d\n' % i)
+  out.append('    (br_table %s (get_local $0))\n' % ' '.join('$case%d' % i for i in range(num_cases)))
+  for i in range(num_cases):
+    out.append('   )\n')
+    for j in range(4):
+      dest = r.randint(1, num_locals - 1)
+      left = r.randint(0, num_locals - 1)
+      right = r.randint(0, num_locals - 1)
+      out.append('   (set_local $%d (i32.add (get_local $%d) (get_local $%d)))\n' % (dest, left, right))
+    out.append('   (if (get_local $%d) (return (get_local $%d)))\n' % (r.randint(0, num_locals - 1), r.randint(0, num_locals - 1)))
+    out.append('   (set_local $0 (i32.const %d))\n' % r.randint(0, num_cases - 1))
+    out.append('   (br $dispatch)\n')
+  out.append('  )\n )\n)\n')
+  return ''.join(out)
+
+
+def main():
+  wasm_opt = os.path.join('bin', 'wasm-opt')
+  num_locals = 2000
+  num_cases = 500
+  files = []
+  for arg in sys.argv[1:]:
+    if arg.startswith('--wasm-opt='):
+      wasm_opt = arg.split('=', 1)[1]
+    elif arg.startswith('--locals='):
+      num_locals = int(arg.split('=', 1)[1])
+    elif arg.startswith('--cases='):
+      num_cases = int(arg.split('=', 1)[1])
+    else:
+      files.append(arg)
+  temp = None
+  if not files:
+    temp = tempfile.NamedTemporaryFile(suffix='.wast', delete=False)
+    temp.write(generate(num_locals, num_cases))
+    temp.close()
+    files = [temp.name]
+    print('generated a function with %d locals and %d cases' % (num_locals, num_cases))
+  try:
+    for f in files:
+      print(os.path.basename(f) if temp is None else 'generated')
+      for p in PASSES:
+        start = time.time()
+        subprocess.check_call([wasm_opt, f, '--' + p, '-o', os.devnull])
+        print('  %-22s %.3f seconds' % (p, time.time() - start))
+  finally:
+    if temp:
+      os.unlink(temp.name)
+
+
+if __name__ == '__main__':
+  main()
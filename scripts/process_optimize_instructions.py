@@ -1,16 +1,294 @@
 #!/usr/bin/python
 
+'''
+Compiles the patterns in src/passes/OptimizeInstructions.wast into C++ code
+that matches them, src/passes/OptimizeInstructions.wast.processed, which
+OptimizeInstructions.cpp includes.
+
+The matcher dispatches on the root expression's id and op, and then checks
+the patterns for that op as a decision tree: patterns that begin with the
+same checks share them, and a check is never repeated. Checks of the op or
+constant value of the same expression are done in a switch. Comparing
+repeated expressions and then checking for side effects is done last,
+after everything else in a pattern matched.
+
+Run this after modifying the patterns, and commit both files.
+'''
+
 import os
+import re
+import sys
 
-root = os.path.dirname(os.path.dirname(__file__))
+root = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
 
 infile = os.path.join(root, 'src', 'passes', 'OptimizeInstructions.wast')
 outfile = os.path.join(root, 'src', 'passes',
                        'OptimizeInstructions.wast.processed')
 
-out = open(outfile, 'w')
+TYPES = {'i32': 'Int32', 'i64': 'Int64', 'f32': 'Float32', 'f64': 'Float64'}
+
+# op names that are not just their capitalized parts
+SPECIAL_OPS = {
+  'eqz': 'EqZ',
+  'rotl': 'RotL',
+  'rotr': 'RotR',
+  'copysign': 'CopySign',
+  'i32.wrap/i64': 'WrapInt64',
+  'i64.extend_s/i32': 'ExtendSInt32',
+  'i64.extend_u/i32': 'ExtendUInt32',
+}
+
+
+def fail(message):
+  sys.stderr.write('error: %s\n' % message)
+  sys.exit(1)
+
+
+def parse(text):
+  text = re.sub(r'\(;.*?;\)', ' ', text, flags=re.S)
+  text = re.sub(r';;[^\n]*', ' ', text)
+  stack = [[]]
+  for token in re.findall(r'\(|\)|[^\s()]+', text):
+    if token == '(':
+      stack.append([])
+    elif token == ')':
+      item = stack.pop()
+      stack[-1].append(item)
+    else:
+      stack[-1].append(token)
+  return stack[0][0]
+
+
+def get_op(name):
+  if name in SPECIAL_OPS:
+    return SPECIAL_OPS[name]
+  type_, op = name.split('.')
+  if type_ not in TYPES or '/' in op:
+    fail('unsupported operation ' + name)
+  op = SPECIAL_OPS.get(op, ''.join(part.capitalize() for part in op.split('_')))
+  return op + TYPES[type_]
+
+
+# returns a C++ constant for an integer, and its type
+def make_integer(type_, value):
+  value = int(value, 0)
+  if type_ == 'i32':
+    if -2 ** 31 <= value < 2 ** 31:
+      return 'int32_t(%d)' % value
+    return 'int32_t(0x%xU)' % value
+  if type_ == 'i64':
+    if -2 ** 63 < value < 2 ** 63:
+      return 'int64_t(%dLL)' % value
+    return 'int64_t(0x%xULL)' % value
+  fail('unsupported constant type ' + type_)
+
+
+# A condition in the matcher. Checks with a subject compare it to a key, so
+# checks of the same subject with different keys cannot both be true.
+class Check(object):
+  def __init__(self, code, subject=None, key=None):
+    self.code = code
+    self.subject = subject
+    self.key = key
+
+  def __eq__(self, other):
+    return self.code == other.code
+
+  def __ne__(self, other):
+    return not self == other
+
+
+class Node(object):
+  # kind is 'unary', 'binary', 'const', or 'wildcard'
+  def __init__(self, item):
+    head = item[0]
+    self.children = []
+    if head == 'call':
+      match = re.match(r'\$(i32|i64|f32|f64|any)\.(expr|pure)$', item[1])
+      if not match or len(item) != 3 or item[2][0] != 'i32.const':
+        fail('bad DSL call ' + str(item))
+      self.kind = 'wildcard'
+      self.type = match.group(1)
+      self.pure = match.group(2) == 'pure'
+      self.index = int(item[2][1])
+    elif head.endswith('.const'):
+      self.kind = 'const'
+      self.type = head.split('.')[0]
+      self.integer = make_integer(self.type, item[1])
+    else:
+      self.children = [Node(child) for child in item[1:]]
+      if len(self.children) == 1:
+        self.kind = 'unary'
+      elif len(self.children) == 2:
+        self.kind = 'binary'
+      else:
+        fail('unsupported expression ' + head)
+      self.op = get_op(head)
+
+  def wildcards(self):
+    if self.kind == 'wildcard':
+      return [self]
+    return sum([child.wildcards() for child in self.children], [])
+
+
+FIELDS = {'unary': ['value'], 'binary': ['left', 'right']}
+CLASSES = {'unary': 'Unary', 'binary': 'Binary', 'const': 'Const'}
+
+
+class Pattern(object):
+  def __init__(self, item):
+    self.input = Node(item[1])
+    self.output = Node(item[2])
+    if self.input.kind not in ('unary', 'binary'):
+      fail('the input must be a unary or binary operation: ' + str(item))
+    # check what happens to the wildcards
+    inputs = self.input.wildcards()
+    outputs = self.output.wildcards()
+    first = {}
+    for wildcard in inputs:
+      if wildcard.index in first:
+        if not wildcard.pure:
+          fail('expressions that appear twice must be pure: ' + str(item))
+      else:
+        first[wildcard.index] = wildcard
+    used = [wildcard.index for wildcard in outputs]
+    for index in used:
+      if index not in first:
+        fail('output uses an expression not in the input: ' + str(item))
+    if len(set(used)) != len(used):
+      fail('output uses an expression more than once: ' + str(item))
+    for index, wildcard in first.items():
+      if index not in used and not wildcard.pure:
+        fail('expressions that are removed must be pure: ' + str(item))
+    order = [index for index in sorted(first, key=lambda i: inputs.index(first[i])) if index in used]
+    if order != used:
+      fail('output reorders expressions: ' + str(item))
+    self.checks = []
+    self.equal_checks = []
+    self.pure_checks = []
+    self.paths = {}
+    self.add_checks(self.input, CLASSES[self.input.kind].lower(), top=True)
+    self.checks += self.equal_checks + self.pure_checks
+
+  def add_checks(self, node, path, top=False):
+    if node.kind == 'wildcard':
+      if node.index in self.paths:
+        self.equal_checks.append(Check('if (ExpressionAnalyzer::equal(%s, %s)) {' % (path, self.paths[node.index])))
+        return
+      self.paths[node.index] = path
+      if node.type != 'any':
+        self.checks.append(Check('if (%s->type == %s) {' % (path, node.type)))
+      if node.pure:
+        self.pure_checks.append(Check('if (!EffectAnalyzer(getPassOptions(), %s).hasSideEffects()) {' % path))
+      return
+    name = path.replace('->', '_')
+    if not top:
+      self.checks.append(Check('if (auto* %s = %s->dynCast<%s>()) {' % (name, path, CLASSES[node.kind])))
+      if node.kind == 'const':
+        self.checks.append(Check('if (%s->type == %s) {' % (name, node.type)))
+        subject = '%s->value.get%s()' % (name, node.type)
+        self.checks.append(Check('if (%s == %s) {' % (subject, node.integer), subject, node.integer))
+      else:
+        subject = '%s->op' % name
+        self.checks.append(Check('if (%s == %s) {' % (subject, node.op), subject, node.op))
+    for field, child in zip(FIELDS.get(node.kind, []), node.children):
+      self.add_checks(child, '%s->%s' % (name, field))
+
+  def make_output(self, node):
+    if node.kind == 'wildcard':
+      return self.paths[node.index]
+    if node.kind == 'const':
+      return 'builder.makeConst(Literal(%s))' % node.integer
+    children = ', '.join(self.make_output(child) for child in node.children)
+    return 'builder.make%s(%s, %s)' % (CLASSES[node.kind], node.op, children)
+
+
+# emits the checks of patterns from a depth on, and returns whether the code
+# always returns
+def emit_tree(out, patterns, depth, indent):
+  i = 0
+  while i < len(patterns):
+    pattern = patterns[i]
+    if depth == len(pattern.checks):
+      if i + 1 < len(patterns):
+        fail('pattern can never match: ' + str(patterns[i + 1].checks))
+      out.append(indent + 'return %s;' % pattern.make_output(pattern.output))
+      return True
+    # group the patterns that share the next check. if it has a subject, we
+    # also group the following patterns that check the same subject, as at
+    # most one key can match, so the order among different keys does not
+    # matter
+    check = pattern.checks[depth]
+    j = i + 1
+    while j < len(patterns) and len(patterns[j].checks) > depth:
+      other = patterns[j].checks[depth]
+      if not (other == check or (check.subject and other.subject == check.subject)):
+        break
+      j += 1
+    group = patterns[i:j]
+    keys = []
+    for other in group:
+      if other.checks[depth].key not in keys:
+        keys.append(other.checks[depth].key)
+    if len(keys) > 1:
+      out.append(indent + 'switch (%s) {' % check.subject)
+      for key in keys:
+        out.append(indent + '  case %s: {' % key)
+        if not emit_tree(out, [other for other in group if other.checks[depth].key == key], depth + 1, indent + '    '):
+          out.append(indent + '    break;')
+        out.append(indent + '  }')
+      out.append(indent + '  default: {}')
+      out.append(indent + '}')
+    else:
+      out.append(indent + check.code)
+      emit_tree(out, group, depth + 1, indent + '  ')
+      out.append(indent + '}')
+    i = j
+  return False
+
+
+def main():
+  module = parse(open(infile).read())
+  func = [item for item in module if isinstance(item, list) and item[:2] == ['func', '$patterns']][0]
+  body = func[2]
+  patterns = [Pattern(item) for item in body[1:]]
+  out = [
+    '// Generated by scripts/process_optimize_instructions.py from',
+    '// OptimizeInstructions.wast. DO NOT EDIT.',
+    '',
+    '// Applies the first pattern that matches, returning the replacement, or',
+    '// nullptr if none match.',
+    'Expression* applyPatterns(Expression* curr) {',
+    '  Builder builder(*getModule());',
+    '  switch (curr->_id) {',
+  ]
+  for kind in ('unary', 'binary'):
+    ops = []
+    for pattern in patterns:
+      if pattern.input.kind == kind and pattern.input.op not in ops:
+        ops.append(pattern.input.op)
+    if not ops:
+      continue
+    out.append('    case Expression::%sId: {' % CLASSES[kind])
+    out.append('      auto* %s = curr->cast<%s>();' % (CLASSES[kind].lower(), CLASSES[kind]))
+    out.append('      switch (%s->op) {' % CLASSES[kind].lower())
+    for op in ops:
+      out.append('        case %s: {' % op)
+      if not emit_tree(out, [pattern for pattern in patterns if pattern.input.kind == kind and pattern.input.op == op], 0, '          '):
+        out.append('          break;')
+      out.append('        }')
+    out.append('        default: {}')
+    out.append('      }')
+    out.append('      break;')
+    out.append('    }')
+  out += [
+    '    default: {}',
+    '  }',
+    '  return nullptr;',
+    '}',
+  ]
+  open(outfile, 'w').write('\n'.join(out) + '\n')
 
-for line in open(infile):
-  out.write('"' + line.strip().replace('"', '\\"') + '\\n"\n')
 
-out.close()
+if __name__ == '__main__':
+  main()
@@ -0,0 +1,73 @@
+#!/usr/bin/env python2
+
+import os
+import subprocess
+
+from support import run_command, split_wast
+from shared import (WASM2C, NATIVECC, fail_if_not_identical)
+
+
+spec_tests = [os.path.join('spec', t)
+              for t in sorted(os.listdir(os.path.join('test', 'spec')))
+              if t.endswith('.wast') and '.fail' not in t]
+extra_tests = [os.path.join('wasm2c', t) for t in
+               sorted(os.listdir(os.path.join('test', 'wasm2c')))
+               if t.endswith('.wast')]
+
+
+def compile_and_run(c):
+  # build the C with the asserts, and check that they all pass
+  open('a.2c.c', 'w').write(c)
+  run_command([NATIVECC, '-std=c99', '-O1', '-w', 'a.2c.c', '-o', 'a.2c.out',
+               '-lm'])
+  run_command([os.path.abspath('a.2c.out')])
+
+
+def test_wasm2c_output():
+  for wasm in extra_tests:
+    print '..', wasm
+
+    expected_file = os.path.join('test', wasm.replace('.wast', '.2c.c'))
+    cmd = WASM2C + [os.path.join('test', wasm)]
+    if os.path.exists(expected_file):
+      out = run_command(cmd)
+      fail_if_not_identical(out, open(expected_file).read())
+
+    if not NATIVECC:
+      print 'No C compiler. Skipping execution.'
+      continue
+
+    compile_and_run(run_command(cmd + ['--allow-asserts']))
+
+
+def test_wasm2c_spec():
+  if not NATIVECC:
+    print 'No C compiler. Skipping spec tests.'
+    return
+
+  for wast in spec_tests:
+    print '..', wast
+    for module, asserts in split_wast(os.path.join('test', wast)):
+      if not asserts:
+        continue
+      with open('split.wast', 'w') as o:
+        o.write(module + '\n' + '\n'.join(asserts))
+      # not all modules can be translated, for example ones that use
+      # features of the spec interpreter, like imports from other modules
+      proc = subprocess.Popen(WASM2C + ['split.wast', '--allow-asserts'],
+                              stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+      out, err = proc.communicate()
+      if proc.returncode != 0:
+        print '    skipping untranslatable module'
+        continue
+      compile_and_run(out)
+
+
+def test_wasm2c():
+  print '\n[ checking wasm2c testcases... ]\n'
+  test_wasm2c_output()
+  test_wasm2c_spec()
+
+
+if __name__ == "__main__":
+  test_wasm2c()
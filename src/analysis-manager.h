@@ -0,0 +1,225 @@
+/*
+ * Copyright 2017 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// Caching of per-function analyses across passes.
+//
+// A pass asks the PassRunner's AnalysisManager for an analysis of a
+// function, such as its LocalGraph, and gets a cached result if one is
+// still valid, or a freshly computed one (which is then cached). After a
+// pass runs on a function, every analysis of that function is thrown away
+// except for those the pass says it preserves (see
+// Pass::getPreservedAnalyses), which is loosely modeled on LLVM's new pass
+// manager. A pass that does not change a function can preserve everything,
+// letting later passes reuse what was computed before it.
+//
+// An analysis is identified by its result type. By default a result is
+// computed by constructing it from (Function*, Module*); types that need
+// something else can specialize FunctionAnalysisTraits.
+//
+// Results are only valid until the function is modified, so a pass that
+// requests an analysis and then changes the function must not use the
+// result afterwards (or must invalidate it and request it again).
+//
+
+#ifndef wasm_analysis_manager_h
+#define wasm_analysis_manager_h
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "wasm.h"
+#include "support/utilities.h"
+
+namespace wasm {
+
+struct PassOptions;
+
+// A unique id for each analysis type
+typedef const void* AnalysisID;
+
+template<typename T>
+AnalysisID getAnalysisID() {
+  static const char id = 0;
+  return &id;
+}
+
+// How an analysis result is computed
+template<typename T>
+struct FunctionAnalysisTraits {
+  static T* compute(Function* func, Module* module, PassOptions& options) {
+    return new T(func, module);
+  }
+};
+
+// The set of analyses that are still valid after a pass ran
+class PreservedAnalyses {
+public:
+  static PreservedAnalyses all() {
+    PreservedAnalyses ret;
+    ret.everything = true;
+    return ret;
+  }
+
+  static PreservedAnalyses none() {
+    return PreservedAnalyses();
+  }
+
+  template<typename T>
+  PreservedAnalyses& preserve() {
+    ids.insert(getAnalysisID<T>());
+    return *this;
+  }
+
+  bool isPreserved(AnalysisID id) const {
+    return everything || ids.count(id);
+  }
+
+  bool areAllPreserved() const { return everything; }
+
+  bool isNonePreserved() const { return !everything && ids.empty(); }
+
+private:
+  bool everything = false;
+  std::set<AnalysisID> ids;
+};
+
+class AnalysisManager {
+public:
+  AnalysisManager(Module* module, PassOptions& options) : module(module), options(options) {}
+
+  // Gets an analysis of a function, computing it if it is not cached. This
+  // is safe to call from function-parallel passes, as long as each function
+  // is only worked on by one thread at a time.
+  template<typename T>
+  T& getFunctionAnalysis(Function* func) {
+    auto& results = getResults(func);
+    auto id = getAnalysisID<T>();
+    auto iter = results.find(id);
+    if (iter != results.end()) {
+      reused++;
+      return *static_cast<Result<T>*>(iter->second.get())->value;
+    }
+    computed++;
+    auto* result = new Result<T>(FunctionAnalysisTraits<T>::compute(func, module, options));
+    results[id] = std::unique_ptr<ResultBase>(result);
+    return *result->value;
+  }
+
+  // Gets an analysis of a function only if it is already cached
+  template<typename T>
+  T* getCachedFunctionAnalysis(Function* func) {
+    auto& results = getResults(func);
+    auto iter = results.find(getAnalysisID<T>());
+    if (iter == results.end()) return nullptr;
+    reused++;
+    return static_cast<Result<T>*>(iter->second.get())->value.get();
+  }
+
+  // Drops an analysis of a function, for a pass that modified the function
+  // and wants to request the analysis again.
+  template<typename T>
+  void invalidate(Function* func) {
+    getResults(func).erase(getAnalysisID<T>());
+  }
+
+  // Drops the analyses of a function that are not preserved
+  void invalidate(Function* func, const PreservedAnalyses& preserved) {
+    if (preserved.areAllPreserved()) return;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto iter = functions.find(func);
+    if (iter == functions.end()) return;
+    invalidate(*iter->second, preserved);
+  }
+
+  // Drops the analyses of all functions that are not preserved, after a
+  // pass on the entire module. Functions no longer in the module are
+  // forgotten entirely (a pass that adds functions must not preserve
+  // anything, as a new function may reuse the address of a removed one).
+  void invalidate(const PreservedAnalyses& preserved) {
+    if (preserved.isNonePreserved()) {
+      clear();
+      return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    std::unordered_set<Function*> existing;
+    for (auto& func : module->functions) {
+      existing.insert(func.get());
+    }
+    for (auto iter = functions.begin(); iter != functions.end();) {
+      if (!existing.count(iter->first)) {
+        iter = functions.erase(iter);
+      } else {
+        invalidate(*iter->second, preserved);
+        iter++;
+      }
+    }
+  }
+
+  void clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    functions.clear();
+  }
+
+  // statistics, for debugging
+  std::atomic<size_t> computed{0}, reused{0};
+
+private:
+  Module* module;
+  PassOptions& options;
+
+  struct ResultBase {
+    virtual ~ResultBase() {}
+  };
+
+  template<typename T>
+  struct Result : public ResultBase {
+    std::unique_ptr<T> value;
+    Result(T* value) : value(value) {}
+  };
+
+  typedef std::unordered_map<AnalysisID, std::unique_ptr<ResultBase>> Results;
+
+  // the map of functions is shared between threads, but each function's
+  // results are only accessed by the thread working on it
+  std::mutex mutex;
+  std::unordered_map<Function*, std::unique_ptr<Results>> functions;
+
+  Results& getResults(Function* func) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& results = functions[func];
+    if (!results) results = make_unique<Results>();
+    return *results;
+  }
+
+  static void invalidate(Results& results, const PreservedAnalyses& preserved) {
+    for (auto iter = results.begin(); iter != results.end();) {
+      if (!preserved.isPreserved(iter->first)) {
+        iter = results.erase(iter);
+      } else {
+        iter++;
+      }
+    }
+  }
+};
+
+} // namespace wasm
+
+#endif // wasm_analysis_manager_h
@@ -2086,6 +2086,21 @@ void BinaryenModuleInterpret(BinaryenModuleRef module) {
   ModuleInstance instance(*wasm, &interface);
 }
 
+int BinaryenModuleInterpretWithLimits(BinaryenModuleRef module, uint64_t fuel, double timeout) {
+  if (tracing) {
+    std::cout << "  BinaryenModuleInterpretWithLimits(the_module, " << fuel << ", " << timeout << ");\n";
+  }
+
+  Module* wasm = (Module*)module;
+  ShellExternalInterface interface;
+  try {
+    ModuleInstance instance(*wasm, &interface, ExecutionLimits(fuel, timeout));
+  } catch (const OutOfFuelException&) {
+    return 0;
+  }
+  return 1;
+}
+
 //
 // ======== FunctionType Operations ========
 //
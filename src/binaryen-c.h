@@ -679,6 +679,12 @@ BinaryenModuleRef BinaryenModuleRead(char* input, size_t inputSize);
 // and then destroying the instance.
 void BinaryenModuleInterpret(BinaryenModuleRef module);
 
+// Execute a module in the Binaryen interpreter, like BinaryenModuleInterpret, but
+// stop once `fuel` expressions have been executed, or `timeout` seconds have
+// passed (a value of 0 means no limit). Returns 1 if execution completed, and 0 if
+// it was stopped by one of the limits.
+int BinaryenModuleInterpretWithLimits(BinaryenModuleRef module, uint64_t fuel, double timeout);
+
 //
 // ======== FunctionType Operations ========
 //
@@ -0,0 +1,401 @@
+/*
+ * Copyright 2017 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// Dominator trees, post-dominator trees, dominance frontiers and loop
+// forests on a CFG.
+//
+// These work on dense node numbers and compact adjacency lists, which makes
+// them fast on huge functions. BlockGraph numbers the reachable basic blocks
+// of a CFGWalker (or anything with the same out/in vectors) in reverse
+// postorder from the entry, which is the numbering everything here expects:
+//
+//   BlockGraph<BasicBlock> graph(entry);
+//   DominatorTree dominators(graph.preds);
+//   if (dominators.dominates(graph.getIndex(a), graph.getIndex(b))) ..
+//   LoopForest loops(graph.preds, dominators);
+//   auto depth = loops.getDepth(graph.getIndex(a));
+//
+// Dominators are computed with the Cooper-Harvey-Kennedy algorithm, which
+// is simple, and fast on the shallow dominator trees of structured code.
+// scripts/benchmark_cfg.cpp measures all of this on large generated CFGs.
+//
+
+#ifndef cfg_domtree_h
+#define cfg_domtree_h
+
+#include <algorithm>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "wasm.h"
+#include "support/utilities.h"
+
+namespace wasm {
+
+static const Index NoBlock = Index(-1);
+
+// A compact adjacency list: the edges of node i are
+// list[start[i]] .. list[start[i + 1]]
+struct Adjacency {
+  std::vector<Index> start, list;
+
+  // builds from a list of (from, to) edges, ignoring duplicates. the edges
+  // of each node are sorted
+  void build(Index size, const std::vector<std::pair<Index, Index>>& edges) {
+    start.assign(size + 1, 0);
+    for (auto& edge : edges) start[edge.first + 1]++;
+    for (Index i = 0; i < size; i++) start[i + 1] += start[i];
+    list.resize(edges.size());
+    std::vector<Index> next(start.begin(), start.end() - 1);
+    for (auto& edge : edges) list[next[edge.first]++] = edge.second;
+    // sort each node's edges, and compact the list without duplicates
+    Index used = 0;
+    for (Index i = 0; i < size; i++) {
+      auto begin = list.begin() + start[i], end = list.begin() + start[i + 1];
+      std::sort(begin, end);
+      end = std::unique(begin, end);
+      start[i] = used;
+      for (auto iter = begin; iter != end; iter++) list[used++] = *iter;
+    }
+    start[size] = used;
+    list.resize(used);
+  }
+
+  Index size() const { return start.empty() ? 0 : start.size() - 1; }
+  Index begin(Index i) const { return start[i]; }
+  Index end(Index i) const { return start[i + 1]; }
+  Index count(Index i) const { return end(i) - begin(i); }
+
+  // the nodes reachable from root, in reverse postorder
+  std::vector<Index> getReversePostOrder(Index root) const {
+    std::vector<Index> order;
+    std::vector<bool> visited(size());
+    std::vector<std::pair<Index, Index>> stack; // node, next edge
+    visited[root] = true;
+    stack.emplace_back(root, begin(root));
+    while (!stack.empty()) {
+      auto node = stack.back().first;
+      auto& next = stack.back().second;
+      if (next < end(node)) {
+        auto to = list[next++];
+        if (!visited[to]) {
+          visited[to] = true;
+          stack.emplace_back(to, begin(to));
+        }
+        continue;
+      }
+      order.push_back(node);
+      stack.pop_back();
+    }
+    std::reverse(order.begin(), order.end());
+    return order;
+  }
+};
+
+// The reachable blocks of a CFG, numbered in reverse postorder from the
+// entry, and the edges between them. Unreachable blocks are ignored.
+template<typename BasicBlock>
+struct BlockGraph {
+  std::vector<BasicBlock*> blocks; // in reverse postorder
+  Adjacency succs, preds;
+
+  BlockGraph(BasicBlock* entry) {
+    std::vector<std::pair<BasicBlock*, Index>> stack; // block, next out
+    indexes[entry] = 0;
+    stack.emplace_back(entry, 0);
+    while (!stack.empty()) {
+      auto* block = stack.back().first;
+      auto& next = stack.back().second;
+      if (next < block->out.size()) {
+        auto* out = block->out[next++];
+        if (indexes.emplace(out, 0).second) {
+          stack.emplace_back(out, 0);
+        }
+        continue;
+      }
+      blocks.push_back(block);
+      stack.pop_back();
+    }
+    std::reverse(blocks.begin(), blocks.end());
+    for (Index i = 0; i < blocks.size(); i++) {
+      indexes[blocks[i]] = i;
+    }
+    std::vector<std::pair<Index, Index>> edges;
+    for (Index i = 0; i < blocks.size(); i++) {
+      for (auto* out : blocks[i]->out) {
+        edges.emplace_back(i, indexes[out]);
+      }
+    }
+    succs.build(blocks.size(), edges);
+    for (auto& edge : edges) std::swap(edge.first, edge.second);
+    preds.build(blocks.size(), edges);
+  }
+
+  // the number of a block, or NoBlock if it is unreachable
+  Index getIndex(BasicBlock* block) const {
+    auto iter = indexes.find(block);
+    return iter == indexes.end() ? NoBlock : iter->second;
+  }
+
+private:
+  std::unordered_map<BasicBlock*, Index> indexes;
+};
+
+// The dominator tree of a graph whose nodes are numbered in reverse
+// postorder, with the entry as node 0.
+struct DominatorTree {
+  std::vector<Index> idom; // the immediate dominator of each node (the entry's is itself)
+  Adjacency children; // the nodes each one immediately dominates
+
+  DominatorTree(const Adjacency& preds) {
+    Index size = preds.size();
+    idom.assign(size, NoBlock);
+    if (size == 0) return;
+    idom[0] = 0;
+    // in reverse postorder, a node's dominators have lower numbers, so we
+    // can walk up towards the common dominator by always moving the higher
+    bool changed = true;
+    while (changed) {
+      changed = false;
+      for (Index i = 1; i < size; i++) {
+        Index dom = NoBlock;
+        for (Index j = preds.begin(i); j < preds.end(i); j++) {
+          auto pred = preds.list[j];
+          if (idom[pred] == NoBlock) continue; // not processed yet
+          if (dom == NoBlock) {
+            dom = pred;
+            continue;
+          }
+          auto a = pred, b = dom;
+          while (a != b) {
+            while (a > b) a = idom[a];
+            while (b > a) b = idom[b];
+          }
+          dom = a;
+        }
+        if (idom[i] != dom) {
+          idom[i] = dom;
+          changed = true;
+        }
+      }
+    }
+    std::vector<std::pair<Index, Index>> edges;
+    for (Index i = 1; i < size; i++) edges.emplace_back(idom[i], i);
+    children.build(size, edges);
+    // number the tree in preorder, noting where each subtree ends, so that
+    // dominance is a constant time interval check
+    first.resize(size);
+    last.resize(size);
+    Index counter = 0;
+    std::vector<std::pair<Index, Index>> stack; // node, next child
+    first[0] = counter++;
+    stack.emplace_back(0, children.begin(0));
+    while (!stack.empty()) {
+      auto node = stack.back().first;
+      auto& next = stack.back().second;
+      if (next < children.end(node)) {
+        auto child = children.list[next++];
+        first[child] = counter++;
+        stack.emplace_back(child, children.begin(child));
+        continue;
+      }
+      last[node] = counter;
+      stack.pop_back();
+    }
+  }
+
+  // whether every path from the entry to b goes through a (which is the
+  // case if they are the same)
+  bool dominates(Index a, Index b) const {
+    return first[a] <= first[b] && first[b] < last[a];
+  }
+
+  // the dominance frontier of each node: the nodes it does not strictly
+  // dominate, but does dominate a predecessor of. note that the total size
+  // grows quadratically with the depth of nested loops
+  Adjacency getFrontiers(const Adjacency& preds) const {
+    std::vector<std::pair<Index, Index>> edges;
+    // walking up from each predecessor, we can stop where another walk
+    // already went, as the rest of the way is the same
+    std::vector<Index> seen(idom.size(), NoBlock);
+    for (Index i = 1; i < idom.size(); i++) {
+      if (preds.count(i) < 2) continue;
+      for (Index j = preds.begin(i); j < preds.end(i); j++) {
+        auto runner = preds.list[j];
+        while (runner != idom[i] && seen[runner] != i) {
+          seen[runner] = i;
+          edges.emplace_back(runner, i);
+          runner = idom[runner];
+        }
+      }
+    }
+    Adjacency frontiers;
+    frontiers.build(idom.size(), edges);
+    return frontiers;
+  }
+
+private:
+  std::vector<Index> first, last; // the range of preorder numbers in each subtree
+};
+
+// The post-dominator tree: the dominator tree of the reversed graph, whose
+// entry is a virtual exit node that the nodes without successors lead to.
+// Nodes that cannot reach an exit (that are stuck in an infinite loop) are
+// not in the tree.
+struct PostDominatorTree {
+  std::vector<Index> ipdom; // the immediate post-dominator of each node: Exit, or NoBlock if not in the tree
+
+  static const Index Exit = Index(-2);
+
+  PostDominatorTree(const Adjacency& succs) {
+    Index size = succs.size();
+    ipdom.assign(size, NoBlock);
+    // the reversed graph, with the exit as node size
+    Adjacency reversed;
+    {
+      std::vector<std::pair<Index, Index>> edges;
+      for (Index i = 0; i < size; i++) {
+        if (succs.count(i) == 0) edges.emplace_back(size, i);
+        for (Index j = succs.begin(i); j < succs.end(i); j++) {
+          edges.emplace_back(succs.list[j], i);
+        }
+      }
+      reversed.build(size + 1, edges);
+    }
+    // renumber it in reverse postorder, and compute its dominators
+    order = reversed.getReversePostOrder(size);
+    numbers.assign(size + 1, NoBlock);
+    for (Index i = 0; i < order.size(); i++) numbers[order[i]] = i;
+    std::vector<std::pair<Index, Index>> edges;
+    for (Index i = 0; i < order.size(); i++) {
+      auto node = order[i];
+      for (Index j = reversed.begin(node); j < reversed.end(node); j++) {
+        edges.emplace_back(numbers[reversed.list[j]], i);
+      }
+    }
+    Adjacency preds;
+    preds.build(order.size(), edges);
+    tree = make_unique<DominatorTree>(preds);
+    for (Index i = 1; i < order.size(); i++) {
+      auto dom = order[tree->idom[i]];
+      ipdom[order[i]] = dom == size ? Index(Exit) : dom;
+    }
+  }
+
+  // whether every path from b to an exit goes through a
+  bool postDominates(Index a, Index b) const {
+    if (numbers[a] == NoBlock || numbers[b] == NoBlock) return a == b;
+    return tree->dominates(numbers[a], numbers[b]);
+  }
+
+private:
+  std::vector<Index> order, numbers; // the reversed graph's reverse postorder, and the inverse
+  std::unique_ptr<DominatorTree> tree;
+};
+
+// The natural loops of a graph whose nodes are numbered in reverse
+// postorder, as a forest: a loop is a header that dominates the sources of
+// the backedges to it, and the nodes that reach them without going through
+// the header. Loops with the same header are merged, and each loop's parent
+// is the innermost loop containing it. Retreating edges to nodes that do not
+// dominate their sources (irreducible control flow, which structured code
+// does not have) are ignored.
+struct LoopForest {
+  struct Loop {
+    Index header;
+    Index parent = NoBlock; // the loop containing this one, if any
+    Index depth; // 1 for outermost loops
+  };
+
+  std::vector<Loop> loops; // inner loops before the loops containing them
+  std::vector<Index> loopOf; // for each node, the innermost loop containing it, or NoBlock
+
+  LoopForest(const Adjacency& preds, const DominatorTree& dominators) {
+    Index size = preds.size();
+    loopOf.assign(size, NoBlock);
+    // inner headers come later in reverse postorder, so going backwards we
+    // find inner loops first, and outer loops then adopt them. outermost
+    // points from each loop to the outermost loop found so far containing
+    // it, with path compression
+    std::vector<Index> outermost, work;
+    auto findOutermost = [&](Index loop) {
+      auto root = loop;
+      while (outermost[root] != root) root = outermost[root];
+      while (outermost[loop] != root) {
+        auto next = outermost[loop];
+        outermost[loop] = root;
+        loop = next;
+      }
+      return root;
+    };
+    for (Index header = size; header-- > 0;) {
+      for (Index j = preds.begin(header); j < preds.end(header); j++) {
+        auto pred = preds.list[j];
+        if (dominators.dominates(header, pred)) work.push_back(pred);
+      }
+      if (work.empty()) continue;
+      Index loop = loops.size();
+      loops.emplace_back();
+      loops.back().header = header;
+      outermost.push_back(loop);
+      loopOf[header] = loop;
+      while (!work.empty()) {
+        auto node = work.back();
+        work.pop_back();
+        if (!dominators.dominates(header, node)) continue; // irreducible
+        Index next;
+        if (loopOf[node] == NoBlock) {
+          loopOf[node] = loop;
+          next = node;
+        } else {
+          auto inner = findOutermost(loopOf[node]);
+          if (inner == loop) continue;
+          loops[inner].parent = loop;
+          outermost[inner] = loop;
+          next = loops[inner].header;
+        }
+        for (Index j = preds.begin(next); j < preds.end(next); j++) {
+          work.push_back(preds.list[j]);
+        }
+      }
+    }
+    // parents come after their children
+    for (Index i = loops.size(); i-- > 0;) {
+      auto parent = loops[i].parent;
+      loops[i].depth = parent == NoBlock ? 1 : loops[parent].depth + 1;
+    }
+  }
+
+  // the number of loops containing a node
+  Index getDepth(Index node) const {
+    auto loop = loopOf[node];
+    return loop == NoBlock ? 0 : loops[loop].depth;
+  }
+
+  // whether a loop contains a node, directly or in an inner loop
+  bool contains(Index loop, Index node) const {
+    for (auto curr = loopOf[node]; curr != NoBlock; curr = loops[curr].parent) {
+      if (curr == loop) return true;
+    }
+    return false;
+  }
+};
+
+} // namespace wasm
+
+#endif // cfg_domtree_h
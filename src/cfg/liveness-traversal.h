@@ -31,7 +31,8 @@
 #ifndef liveness_traversal_h
 #define liveness_traversal_h
 
-#include "support/sorted_vector.h"
+#include "support/sparse_bitset.h"
+#include "support/sparse_square_matrix.h"
 #include "wasm.h"
 #include "wasm-builder.h"
 #include "wasm-traversal.h"
@@ -42,9 +43,9 @@ namespace wasm {
 // A set of locals. This is optimized for comparisons,
 // mergings, and iteration on elements, assuming that there
 // may be a great many potential elements but actual sets
-// may be fairly small. Specifically, we use a sorted
-// vector.
-typedef SortedVector LocalSet;
+// may be fairly small. Specifically, we use a bitset that
+// only stores its non-zero words.
+typedef SparseBitSet LocalSet;
 
 // A liveness-relevant action. Supports a get, a set, or an
 // "other" which can be used for other purposes, to mark
@@ -92,7 +93,8 @@ struct LivenessWalker : public CFGWalker<SubType, VisitorType, Liveness> {
 
   Index numLocals;
   std::unordered_set<BasicBlock*> liveBlocks;
-  std::vector<uint8_t> copies; // canonicalized - accesses should check (low, high) TODO: use a map for high N, as this tends to be sparse? or don't look at copies at all for big N?
+  SparseSquareMatrix<uint8_t> copies; // canonicalized - accesses should check (low, high)
+  std::vector<std::pair<Index, Index>> copyPairs; // each (low, high) pair that has copies, once
   std::vector<Index> totalCopies; // total # of copies for each local, with all others
 
   // cfg traversal work
@@ -148,8 +150,8 @@ struct LivenessWalker : public CFGWalker<SubType, VisitorType, Liveness> {
 
   void doWalkFunction(Function* func) {
     numLocals = func->getNumLocals();
-    copies.resize(numLocals * numLocals);
-    std::fill(copies.begin(), copies.end(), 0);
+    copies.recreate(numLocals);
+    copyPairs.clear();
     totalCopies.resize(numLocals);
     std::fill(totalCopies.begin(), totalCopies.end(), 0);
     // create the CFG by walking the IR
@@ -199,7 +201,7 @@ struct LivenessWalker : public CFGWalker<SubType, VisitorType, Liveness> {
     if (blocks.size() > 1) {
       // more than one, so we must merge
       for (Index i = 1; i < blocks.size(); i++) {
-        ret = ret.merge(blocks[i]->contents.start);
+        ret.merge(blocks[i]->contents.start);
       }
     }
     return old != ret;
@@ -218,14 +220,16 @@ struct LivenessWalker : public CFGWalker<SubType, VisitorType, Liveness> {
   }
 
   void addCopy(Index i, Index j) {
-    auto k = std::min(i, j) * numLocals + std::max(i, j);
-    copies[k] = std::min(copies[k], uint8_t(254)) + 1;
+    auto low = std::min(i, j), high = std::max(i, j);
+    auto old = copies.get(low, high);
+    if (old == 0) copyPairs.emplace_back(low, high);
+    copies.set(low, high, std::min(old, uint8_t(254)) + 1);
     totalCopies[i]++;
     totalCopies[j]++;
   }
 
   uint8_t getCopies(Index i, Index j) {
-    return copies[std::min(i, j) * numLocals + std::max(i, j)];
+    return copies.get(std::min(i, j), std::max(i, j));
   }
 };
 
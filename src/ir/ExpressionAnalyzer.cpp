@@ -310,53 +310,153 @@ bool ExpressionAnalyzer::flexibleEqual(Expression* left, Expression* right, Expr
 }
 
 
-// hash an expression, ignoring superficial details like specific internal names
-uint32_t ExpressionAnalyzer::hash(Expression* curr) {
-  uint32_t digest = 0;
+namespace {
 
-  auto hash = [&digest](uint32_t hash) {
-    digest = rehash(digest, hash);
-  };
-  auto hash64 = [&digest](uint64_t hash) {
-    digest = rehash(rehash(digest, uint32_t(hash >> 32)), uint32_t(hash));
+// Hashes expressions, bottom-up. Each node's hash mixes its kind, type and
+// immediates with the hashes of its children. Branches to a label inside
+// the tree being hashed are hashed by how many labels out they go, which
+// ignores the label names; branches to labels outside of it (which the
+// tree is not "closed" over) can't be, so they use the name. The hash of a
+// closed subtree is therefore the same wherever it appears, which is what
+// lets us reuse known ones.
+struct TreeHasher {
+  typedef ExpressionAnalyzer::SubtreeHashes SubtreeHashes;
+
+  // hashes of closed subtrees we can reuse, and where to note new ones
+  SubtreeHashes* known;
+  // whether to hash only the types of constants, and not their values
+  bool ignoreConstValues;
+
+  TreeHasher(SubtreeHashes* known, bool ignoreConstValues = false) : known(known), ignoreConstValues(ignoreConstValues) {}
+
+  // the position of a label in labels that a subtree refers to, if it
+  // refers to one outside of it, or a special value
+  typedef int64_t LabelRef;
+  static const LabelRef NoRef = INT64_MAX; // all references are inside
+  static const LabelRef FreeRef = -1; // refers to a label outside the tree
+
+  struct Task {
+    Expression* curr;
+    bool exit;
+    Index depth; // the number of labels outside of curr
+    Index numChildren;
   };
 
-  std::vector<Name> nameStack;
-  Index internalCounter = 0;
-  std::map<Name, std::vector<Index>> internalNames; // for each internal name, a vector if unique ids
-  Nop popNameMarker;
-  std::vector<Expression*> stack;
+  std::vector<Name> labels; // the labels in scope, innermost last
+  std::vector<Task> tasks;
+  std::vector<std::pair<uint64_t, LabelRef>> values; // hash, outermost reference
 
-  auto noteName = [&](Name curr) {
-    if (curr.is()) {
-      nameStack.push_back(curr);
-      internalNames[curr].push_back(internalCounter++);
-      stack.push_back(&popNameMarker);
+  uint64_t hash(Expression* root) {
+    tasks.push_back(Task{ root, false, 0, 0 });
+    while (!tasks.empty()) {
+      auto task = tasks.back();
+      tasks.pop_back();
+      auto* curr = task.curr;
+      if (!task.exit) {
+        if (known) {
+          auto iter = known->find(curr);
+          if (iter != known->end() && iter->second.closed) {
+            values.emplace_back(iter->second.hash, NoRef);
+            continue;
+          }
+        }
+        Index depth = labels.size();
+        auto name = getLabel(curr);
+        if (name.is()) labels.push_back(name);
+        auto exitIndex = tasks.size();
+        tasks.push_back(Task{ curr, true, depth, 0 });
+        auto firstChild = tasks.size();
+        pushChildren(curr);
+        tasks[exitIndex].numChildren = tasks.size() - firstChild;
+        // the children were added in order, but will be popped in reverse
+        std::reverse(tasks.begin() + firstChild, tasks.end());
+        continue;
+      }
+      if (getLabel(curr).is()) labels.pop_back();
+      Hasher64 hasher;
+      LabelRef ref = NoRef;
+      hashImmediates(curr, hasher, ref);
+      auto first = values.size() - task.numChildren;
+      for (auto i = first; i < values.size(); i++) {
+        hasher.add(values[i].first);
+        ref = std::min(ref, values[i].second);
+      }
+      values.resize(first);
+      auto value = hasher.finish();
+      if (known) {
+        (*known)[curr] = ExpressionAnalyzer::SubtreeHash{ value, ref != FreeRef && ref >= LabelRef(task.depth) };
+      }
+      values.emplace_back(value, ref);
     }
-    return true;
-  };
-  auto hashName = [&](Name curr) {
-    auto iter = internalNames.find(curr);
-    if (iter == internalNames.end()) hash64(uint64_t(curr.str));
-    else hash(iter->second.back());
-  };
-  auto popName = [&]() {
-    auto curr = nameStack.back();
-    nameStack.pop_back();
-    internalNames[curr].pop_back();
-  };
+    assert(values.size() == 1);
+    return values.back().first;
+  }
+
+  static Name getLabel(Expression* curr) {
+    if (auto* block = curr->dynCast<Block>()) return block->name;
+    if (auto* loop = curr->dynCast<Loop>()) return loop->name;
+    return Name();
+  }
 
-  stack.push_back(curr);
+  void pushChild(Expression* child) {
+    if (child) tasks.push_back(Task{ child, false, 0, 0 });
+  }
 
-  while (stack.size() > 0) {
-    curr = stack.back();
-    stack.pop_back();
-    if (!curr) continue;
-    if (curr == &popNameMarker) {
-      popName();
-      continue;
+  void pushChildren(Expression* curr) {
+    #define PUSH(clazz, what) \
+      pushChild(curr->cast<clazz>()->what);
+    #define PUSH_LIST(clazz, what) \
+      for (auto* child : curr->cast<clazz>()->what) pushChild(child);
+    switch (curr->_id) {
+      case Expression::Id::BlockId: PUSH_LIST(Block, list); break;
+      case Expression::Id::IfId: PUSH(If, condition); PUSH(If, ifTrue); PUSH(If, ifFalse); break;
+      case Expression::Id::LoopId: PUSH(Loop, body); break;
+      case Expression::Id::BreakId: PUSH(Break, condition); PUSH(Break, value); break;
+      case Expression::Id::SwitchId: PUSH(Switch, condition); PUSH(Switch, value); break;
+      case Expression::Id::CallId: PUSH_LIST(Call, operands); break;
+      case Expression::Id::CallImportId: PUSH_LIST(CallImport, operands); break;
+      case Expression::Id::CallIndirectId: PUSH(CallIndirect, target); PUSH_LIST(CallIndirect, operands); break;
+      case Expression::Id::GetLocalId: break;
+      case Expression::Id::SetLocalId: PUSH(SetLocal, value); break;
+      case Expression::Id::GetGlobalId: break;
+      case Expression::Id::SetGlobalId: PUSH(SetGlobal, value); break;
+      case Expression::Id::LoadId: PUSH(Load, ptr); break;
+      case Expression::Id::StoreId: PUSH(Store, ptr); PUSH(Store, value); break;
+      case Expression::Id::AtomicCmpxchgId: PUSH(AtomicCmpxchg, ptr); PUSH(AtomicCmpxchg, expected); PUSH(AtomicCmpxchg, replacement); break;
+      case Expression::Id::AtomicRMWId: PUSH(AtomicRMW, ptr); PUSH(AtomicRMW, value); break;
+      case Expression::Id::AtomicWaitId: PUSH(AtomicWait, ptr); PUSH(AtomicWait, expected); PUSH(AtomicWait, timeout); break;
+      case Expression::Id::AtomicWakeId: PUSH(AtomicWake, ptr); PUSH(AtomicWake, wakeCount); break;
+      case Expression::Id::ConstId: break;
+      case Expression::Id::UnaryId: PUSH(Unary, value); break;
+      case Expression::Id::BinaryId: PUSH(Binary, left); PUSH(Binary, right); break;
+      case Expression::Id::SelectId: PUSH(Select, ifTrue); PUSH(Select, ifFalse); PUSH(Select, condition); break;
+      case Expression::Id::DropId: PUSH(Drop, value); break;
+      case Expression::Id::ReturnId: PUSH(Return, value); break;
+      case Expression::Id::HostId: PUSH_LIST(Host, operands); break;
+      case Expression::Id::NopId: break;
+      case Expression::Id::UnreachableId: break;
+      default: WASM_UNREACHABLE();
+    }
+    #undef PUSH
+    #undef PUSH_LIST
+  }
+
+  void hashLabelRef(Name name, Hasher64& hasher, LabelRef& ref) {
+    for (Index i = labels.size(); i > 0; i--) {
+      if (labels[i - 1] == name) {
+        hasher.add(0);
+        hasher.add(labels.size() - i);
+        ref = std::min(ref, LabelRef(i - 1));
+        return;
+      }
     }
-    hash(curr->_id);
+    hasher.add(1);
+    hasher.addString(name.str);
+    ref = FreeRef;
+  }
+
+  void hashImmediates(Expression* curr, Hasher64& hasher, LabelRef& ref) {
+    hasher.add(curr->_id);
     // we often don't need to hash the type, as it is tied to other values
     // we are hashing anyhow, but there are exceptions: for example, a
     // get_local's type is determined by the function, so if we are
@@ -365,77 +465,54 @@ uint32_t ExpressionAnalyzer::hash(Expression* curr) {
     // if we hash between modules, then we need to take int account
     // call_imports type, etc. The simplest thing is just to hash the
     // type for all of them.
-    hash(curr->type);
+    hasher.add(curr->type);
 
-    #define PUSH(clazz, what) \
-      stack.push_back(curr->cast<clazz>()->what);
     #define HASH(clazz, what) \
-      hash(curr->cast<clazz>()->what);
-    #define HASH64(clazz, what) \
-      hash64(curr->cast<clazz>()->what);
+      hasher.add(curr->cast<clazz>()->what);
     #define HASH_NAME(clazz, what) \
-      hash64(uint64_t(curr->cast<clazz>()->what.str));
-    #define HASH_PTR(clazz, what) \
-      hash64(uint64_t(curr->cast<clazz>()->what));
+      hasher.addString(curr->cast<clazz>()->what.str);
     switch (curr->_id) {
       case Expression::Id::BlockId: {
-        noteName(curr->cast<Block>()->name);
+        hasher.add(curr->cast<Block>()->name.is());
         HASH(Block, list.size());
-        for (Index i = 0; i < curr->cast<Block>()->list.size(); i++) {
-          PUSH(Block, list[i]);
-        }
         break;
       }
       case Expression::Id::IfId: {
-        PUSH(If, condition);
-        PUSH(If, ifTrue);
-        PUSH(If, ifFalse);
+        hasher.add(curr->cast<If>()->ifFalse != nullptr);
         break;
       }
       case Expression::Id::LoopId: {
-        noteName(curr->cast<Loop>()->name);
-        PUSH(Loop, body);
+        hasher.add(curr->cast<Loop>()->name.is());
         break;
       }
       case Expression::Id::BreakId: {
-        hashName(curr->cast<Break>()->name);
-        PUSH(Break, condition);
-        PUSH(Break, value);
+        hashLabelRef(curr->cast<Break>()->name, hasher, ref);
+        hasher.add(curr->cast<Break>()->condition != nullptr);
+        hasher.add(curr->cast<Break>()->value != nullptr);
         break;
       }
       case Expression::Id::SwitchId: {
         HASH(Switch, targets.size());
         for (Index i = 0; i < curr->cast<Switch>()->targets.size(); i++) {
-          hashName(curr->cast<Switch>()->targets[i]);
+          hashLabelRef(curr->cast<Switch>()->targets[i], hasher, ref);
         }
-        hashName(curr->cast<Switch>()->default_);
-        PUSH(Switch, condition);
-        PUSH(Switch, value);
+        hashLabelRef(curr->cast<Switch>()->default_, hasher, ref);
+        hasher.add(curr->cast<Switch>()->value != nullptr);
         break;
       }
       case Expression::Id::CallId: {
         HASH_NAME(Call, target);
         HASH(Call, operands.size());
-        for (Index i = 0; i < curr->cast<Call>()->operands.size(); i++) {
-          PUSH(Call, operands[i]);
-        }
         break;
       }
       case Expression::Id::CallImportId: {
         HASH_NAME(CallImport, target);
         HASH(CallImport, operands.size());
-        for (Index i = 0; i < curr->cast<CallImport>()->operands.size(); i++) {
-          PUSH(CallImport, operands[i]);
-        }
         break;
       }
       case Expression::Id::CallIndirectId: {
-        PUSH(CallIndirect, target);
         HASH_NAME(CallIndirect, fullType);
         HASH(CallIndirect, operands.size());
-        for (Index i = 0; i < curr->cast<CallIndirect>()->operands.size(); i++) {
-          PUSH(CallIndirect, operands[i]);
-        }
         break;
       }
       case Expression::Id::GetLocalId: {
@@ -444,7 +521,6 @@ uint32_t ExpressionAnalyzer::hash(Expression* curr) {
       }
       case Expression::Id::SetLocalId: {
         HASH(SetLocal, index);
-        PUSH(SetLocal, value);
         break;
       }
       case Expression::Id::GetGlobalId: {
@@ -453,7 +529,6 @@ uint32_t ExpressionAnalyzer::hash(Expression* curr) {
       }
       case Expression::Id::SetGlobalId: {
         HASH_NAME(SetGlobal, name);
-        PUSH(SetGlobal, value);
         break;
       }
       case Expression::Id::LoadId: {
@@ -463,7 +538,6 @@ uint32_t ExpressionAnalyzer::hash(Expression* curr) {
         }
         HASH(Load, offset);
         HASH(Load, align);
-        PUSH(Load, ptr);
         break;
       }
       case Expression::Id::StoreId: {
@@ -471,75 +545,55 @@ uint32_t ExpressionAnalyzer::hash(Expression* curr) {
         HASH(Store, offset);
         HASH(Store, align);
         HASH(Store, valueType);
-        PUSH(Store, ptr);
-        PUSH(Store, value);
         break;
       }
       case Expression::Id::AtomicCmpxchgId: {
         HASH(AtomicCmpxchg, bytes);
         HASH(AtomicCmpxchg, offset);
-        PUSH(AtomicCmpxchg, ptr);
-        PUSH(AtomicCmpxchg, expected);
-        PUSH(AtomicCmpxchg, replacement);
         break;
       }
       case Expression::Id::AtomicRMWId: {
         HASH(AtomicRMW, op);
         HASH(AtomicRMW, bytes);
         HASH(AtomicRMW, offset);
-        PUSH(AtomicRMW, ptr);
-        PUSH(AtomicRMW, value);
         break;
       }
       case Expression::Id::AtomicWaitId: {
         HASH(AtomicWait, expectedType);
-        PUSH(AtomicWait, ptr);
-        PUSH(AtomicWait, expected);
-        PUSH(AtomicWait, timeout);
         break;
       }
       case Expression::Id::AtomicWakeId: {
-        PUSH(AtomicWake, ptr);
-        PUSH(AtomicWake, wakeCount);
         break;
       }
       case Expression::Id::ConstId: {
         HASH(Const, value.type);
-        HASH64(Const, value.getBits());
+        if (!ignoreConstValues) {
+          HASH(Const, value.getBits());
+        }
         break;
       }
       case Expression::Id::UnaryId: {
         HASH(Unary, op);
-        PUSH(Unary, value);
         break;
       }
       case Expression::Id::BinaryId: {
         HASH(Binary, op);
-        PUSH(Binary, left);
-        PUSH(Binary, right);
         break;
       }
       case Expression::Id::SelectId: {
-        PUSH(Select, ifTrue);
-        PUSH(Select, ifFalse);
-        PUSH(Select, condition);
         break;
       }
       case Expression::Id::DropId: {
-        PUSH(Drop, value);
         break;
       }
       case Expression::Id::ReturnId: {
-        PUSH(Return, value);
+        hasher.add(curr->cast<Return>()->value != nullptr);
         break;
       }
       case Expression::Id::HostId: {
         HASH(Host, op);
         HASH_NAME(Host, nameOperand);
         HASH(Host, operands.size());
-        for (Index i = 0; i < curr->cast<Host>()->operands.size(); i++) {
-          PUSH(Host, operands[i]);
-        }
         break;
       }
       case Expression::Id::NopId: {
@@ -551,8 +605,22 @@ uint32_t ExpressionAnalyzer::hash(Expression* curr) {
       default: WASM_UNREACHABLE();
     }
     #undef HASH
-    #undef PUSH
+    #undef HASH_NAME
   }
-  return digest;
+};
+
+} // anonymous namespace
+
+uint64_t ExpressionAnalyzer::hash(Expression* curr) {
+  return TreeHasher(nullptr).hash(curr);
 }
+
+uint64_t ExpressionAnalyzer::hash(Expression* curr, SubtreeHashes& known) {
+  return TreeHasher(&known).hash(curr);
+}
+
+uint64_t ExpressionAnalyzer::shapeHash(Expression* curr) {
+  return TreeHasher(nullptr, true).hash(curr);
+}
+
 } // namespace wasm
@@ -14,10 +14,12 @@
  * limitations under the License.
  */
 
+#include <algorithm>
 #include <iterator>
 
 #include <wasm-builder.h>
 #include <wasm-printing.h>
+#include <cfg/domtree.h>
 #include <ir/find_all.h>
 #include <ir/local-graph.h>
 
@@ -40,6 +42,8 @@ LocalGraph::LocalGraph(Function* func, Module* module) {
 }
 
 void LocalGraph::computeInfluences() {
+  if (influencesComputed) return;
+  influencesComputed = true;
   for (auto& pair : locations) {
     auto* curr = pair.first;
     if (auto* set = curr->dynCast<SetLocal>()) {
@@ -56,215 +60,365 @@ void LocalGraph::computeInfluences() {
   }
 }
 
+// cfg traversal
+
+void LocalGraph::visitGetLocal(GetLocal* curr) {
+  assert(curr->index < numLocals);
+  // unreachable code still gets a (dead) block, so that it is numbered
+  // like everything else
+  if (!currBasicBlock) startBasicBlock();
+  currBasicBlock->contents.actions.push_back({ false, Index(gets.size()), curr->index });
+  gets.push_back(curr);
+  seen.emplace_back(curr, getCurrentPointer());
+}
+
+void LocalGraph::visitSetLocal(SetLocal* curr) {
+  assert(curr->index < numLocals);
+  if (!currBasicBlock) startBasicBlock();
+  currBasicBlock->contents.actions.push_back({ true, Index(sets.size()), curr->index });
+  sets.push_back(curr);
+  seen.emplace_back(curr, getCurrentPointer());
+}
+
 void LocalGraph::doWalkFunction(Function* func) {
   numLocals = func->getNumLocals();
-  if (numLocals == 0) return; // nothing to do
-  // We begin with each param being assigned from the incoming value, and the zero-init for the locals,
-  // so the initial state is the identity permutation
-  currMapping.resize(numLocals);
-  for (auto& set : currMapping) {
-    set = { nullptr };
+  // set 0 is the incoming value of a param, or the zero-init of a var
+  sets.push_back(nullptr);
+  CFGWalker<LocalGraph, Visitor<LocalGraph>, LocalGraphBlockInfo>::doWalkFunction(func);
+  flow();
+  // fill in the external API. sorting first lets the maps be built in
+  // linear time
+  std::sort(seen.begin(), seen.end());
+  for (auto& pair : seen) {
+    locations.emplace_hint(locations.end(), pair.first, pair.second);
+  }
+  std::vector<Index> order(gets.size());
+  for (Index i = 0; i < order.size(); i++) order[i] = i;
+  std::sort(order.begin(), order.end(), [&](Index a, Index b) {
+    return gets[a] < gets[b];
+  });
+  for (auto i : order) {
+    auto& sets = getSetses.emplace_hint(getSetses.end(), gets[i], Sets())->second;
+    for (auto id : values[getValues[i]]) {
+      sets.insert(this->sets[id]);
+    }
   }
-  PostWalker<LocalGraph>::walk(func->body);
 }
 
-// control flow
+namespace {
 
-void LocalGraph::visitBlock(Block* curr) {
-  if (curr->name.is() && breakMappings.find(curr->name) != breakMappings.end()) {
-    auto& infos = breakMappings[curr->name];
-    infos.emplace_back(std::move(currMapping));
-    currMapping = std::move(merge(infos));
-    breakMappings.erase(curr->name);
-  }
-}
+const Index NONE = Index(-1);
 
-void LocalGraph::finishIf() {
-  // that's it for this if, merge
-  std::vector<Mapping> breaks;
-  breaks.emplace_back(std::move(currMapping));
-  breaks.emplace_back(std::move(mappingStack.back()));
-  mappingStack.pop_back();
-  currMapping = std::move(merge(breaks));
-}
+} // anonymous namespace
 
-void LocalGraph::afterIfCondition(LocalGraph* self, Expression** currp) {
-  self->mappingStack.push_back(self->currMapping);
-}
-void LocalGraph::afterIfTrue(LocalGraph* self, Expression** currp) {
-  auto* curr = (*currp)->cast<If>();
-  if (curr->ifFalse) {
-    auto afterCondition = std::move(self->mappingStack.back());
-    self->mappingStack.back() = std::move(self->currMapping);
-    self->currMapping = std::move(afterCondition);
-  } else {
-    self->finishIf();
+// The sets arriving at each get are found the way SSA construction would
+// find them: gets preceded by a set in their basic block are trivial, and
+// for the others we place phis at the iterated dominance frontiers of the
+// blocks that set the local (only for locals that need it), and then a
+// single walk on the dominator tree finds the definition - a set or a phi -
+// reaching each of them. A phi means all the sets its web of phis leads to.
+void LocalGraph::flow() {
+  Index numBlocks = basicBlocks.size();
+  for (Index i = 0; i < numBlocks; i++) {
+    basicBlocks[i]->contents.index = i;
   }
-}
-void LocalGraph::afterIfFalse(LocalGraph* self, Expression** currp) {
-  self->finishIf();
-}
-void LocalGraph::beforeLoop(LocalGraph* self, Expression** currp) {
-  // save the state before entering the loop, for calculation later of the merge at the loop top
-  self->mappingStack.push_back(self->currMapping);
-  self->loopGetStack.push_back({});
-}
-void LocalGraph::visitLoop(Loop* curr) {
-  if (curr->name.is() && breakMappings.find(curr->name) != breakMappings.end()) {
-    auto& infos = breakMappings[curr->name];
-    infos.emplace_back(std::move(mappingStack.back()));
-    auto before = infos.back();
-    auto& merged = merge(infos);
-    // every local we created a phi for requires us to update get_local operations in
-    // the loop - the branch back has means that gets in the loop have potentially
-    // more sets reaching them.
-    // we can detect this as follows: if a get of oldIndex has the same sets
-    // as the sets at the entrance to the loop, then it is affected by the loop
-    // header sets, and we can add to there sets that looped back
-    auto linkLoopTop = [&](Index i, Sets& getSets) {
-      auto& beforeSets = before[i];
-      if (getSets.size() < beforeSets.size()) {
-        // the get trivially has fewer sets, so it overrode the loop entry sets
-        return;
+  // number the reachable blocks in reverse postorder, which is what we use
+  // from here on. the other blocks are dead, and ignored
+  std::vector<Index> rpo(numBlocks, NONE);
+  std::vector<BasicBlock*> live;
+  {
+    std::vector<std::pair<BasicBlock*, Index>> stack; // block, next out
+    std::vector<bool> visited(numBlocks);
+    visited[entry->contents.index] = true;
+    stack.emplace_back(entry, 0);
+    while (!stack.empty()) {
+      auto* block = stack.back().first;
+      auto& next = stack.back().second;
+      if (next < block->out.size()) {
+        auto* out = block->out[next++];
+        if (!visited[out->contents.index]) {
+          visited[out->contents.index] = true;
+          stack.emplace_back(out, 0);
+        }
+        continue;
       }
-      if (!std::includes(getSets.begin(), getSets.end(),
-                         beforeSets.begin(), beforeSets.end())) {
-        // the get has not the same sets as in the loop entry
-        return;
+      live.push_back(block);
+      stack.pop_back();
+    }
+    std::reverse(live.begin(), live.end());
+    for (Index i = 0; i < live.size(); i++) {
+      rpo[live[i]->contents.index] = i;
+    }
+  }
+  Index numLive = live.size();
+  Adjacency preds, succs;
+  {
+    std::vector<std::pair<Index, Index>> edges;
+    for (Index i = 0; i < numLive; i++) {
+      for (auto* out : live[i]->out) {
+        edges.emplace_back(i, rpo[out->contents.index]);
       }
-      // the get has the entry sets, so add any new ones
-      for (auto* set : merged[i]) {
-        getSets.insert(set);
+    }
+    succs.build(numLive, edges);
+    for (auto& edge : edges) std::swap(edge.first, edge.second);
+    preds.build(numLive, edges);
+  }
+  DominatorTree dominators(preds);
+  auto frontiers = dominators.getFrontiers(preds);
+  // scan inside each block. a get preceded by a set of its local is
+  // resolved right away, the others need to know what arrives at the
+  // block, and for that we note the last set of each local in each block.
+  struct Pending {
+    Index local, block, get;
+    bool operator<(const Pending& other) const {
+      return local < other.local || (local == other.local && block < other.block);
+    }
+  };
+  struct BlockSet {
+    Index local, block;
+    SetId set;
+    bool operator<(const BlockSet& other) const {
+      return local < other.local || (local == other.local && block < other.block);
+    }
+  };
+  std::vector<Pending> pending;
+  std::vector<BlockSet> blockSets;
+  std::vector<SetId> lastSet(numLocals);
+  std::vector<Index> lastSetBlock(numLocals, NONE), noted(numLocals, NONE);
+  std::vector<Index> singleValues(sets.size(), NONE);
+  auto getSingleValue = [&](SetId set) {
+    if (singleValues[set] == NONE) {
+      singleValues[set] = values.size();
+      values.push_back({ set });
+    }
+    return singleValues[set];
+  };
+  values.resize(1); // the empty value
+  getValues.resize(gets.size());
+  for (Index i = 0; i < numBlocks; i++) {
+    auto block = rpo[i];
+    auto& actions = basicBlocks[i]->contents.actions;
+    for (auto& action : actions) {
+      if (action.isSet) {
+        lastSet[action.local] = action.id;
+        lastSetBlock[action.local] = i;
+      } else if (lastSetBlock[action.local] == i) {
+        getValues[action.id] = getSingleValue(lastSet[action.local]);
+      } else if (block != NONE) {
+        pending.push_back({ action.local, block, action.id });
       }
-    };
-    auto& gets = loopGetStack.back();
-    for (auto* get : gets) {
-      linkLoopTop(get->index, getSetses[get]);
+      // otherwise, this is dead code and nothing arrives here
     }
-    // and the same for the loop fallthrough: any local that still has the
-    // entry sets should also have the loop-back sets as well
-    for (Index i = 0; i < numLocals; i++) {
-      linkLoopTop(i, currMapping[i]);
+    if (block == NONE) continue;
+    for (auto& action : actions) {
+      if (action.isSet && noted[action.local] != i) {
+        noted[action.local] = i;
+        blockSets.push_back({ action.local, block, lastSet[action.local] });
+      }
     }
-    // finally, breaks still in flight must be updated too
-    for (auto& iter : breakMappings) {
-      auto name = iter.first;
-      if (name == curr->name) continue; // skip our own (which is still in use)
-      auto& mappings = iter.second;
-      for (auto& mapping : mappings) {
-        for (Index i = 0; i < numLocals; i++) {
-          linkLoopTop(i, mapping[i]);
+  }
+  // place the phis, for each local that has pending gets
+  std::sort(pending.begin(), pending.end());
+  std::sort(blockSets.begin(), blockSets.end());
+  struct Phi {
+    Index block, local;
+  };
+  std::vector<Phi> phis;
+  {
+    std::vector<Index> phiStamp(numLive, NONE), workStamp(numLive, NONE), work;
+    Index nextBlockSet = 0;
+    for (Index i = 0; i < pending.size(); i++) {
+      auto local = pending[i].local;
+      if (i > 0 && pending[i - 1].local == local) continue;
+      while (nextBlockSet < blockSets.size() && blockSets[nextBlockSet].local < local) {
+        nextBlockSet++;
+      }
+      for (; nextBlockSet < blockSets.size() && blockSets[nextBlockSet].local == local; nextBlockSet++) {
+        auto block = blockSets[nextBlockSet].block;
+        workStamp[block] = local;
+        work.push_back(block);
+      }
+      while (!work.empty()) {
+        auto block = work.back();
+        work.pop_back();
+        for (Index j = frontiers.begin(block); j < frontiers.end(block); j++) {
+          auto frontier = frontiers.list[j];
+          if (phiStamp[frontier] == local) continue;
+          phiStamp[frontier] = local;
+          phis.push_back({ frontier, local });
+          // a phi is a new definition, whose frontier needs phis too
+          if (workStamp[frontier] != local) {
+            workStamp[frontier] = local;
+            work.push_back(frontier);
+          }
         }
       }
     }
-    // now that we are done with using the mappings, erase our own
-    breakMappings.erase(curr->name);
   }
-  mappingStack.pop_back();
-  loopGetStack.pop_back();
-}
-void LocalGraph::visitBreak(Break* curr) {
-  if (curr->condition) {
-    breakMappings[curr->name].emplace_back(currMapping);
-  } else {
-    breakMappings[curr->name].emplace_back(std::move(currMapping));
-    setUnreachable(currMapping);
-  }
-}
-void LocalGraph::visitSwitch(Switch* curr) {
-  std::set<Name> all;
-  for (auto target : curr->targets) {
-    all.insert(target);
-  }
-  all.insert(curr->default_);
-  for (auto target : all) {
-    breakMappings[target].emplace_back(currMapping);
-  }
-  setUnreachable(currMapping);
-}
-void LocalGraph::visitReturn(Return *curr) {
-  setUnreachable(currMapping);
-}
-void LocalGraph::visitUnreachable(Unreachable *curr) {
-  setUnreachable(currMapping);
-}
-
-// local usage
-
-void LocalGraph::visitGetLocal(GetLocal* curr) {
-  assert(currMapping.size() == numLocals);
-  assert(curr->index < numLocals);
-  for (auto& loopGets : loopGetStack) {
-    loopGets.push_back(curr);
-  }
-  // current sets are our sets
-  getSetses[curr] = currMapping[curr->index];
-  locations[curr] = getCurrentPointer();
-}
-void LocalGraph::visitSetLocal(SetLocal* curr) {
-  assert(currMapping.size() == numLocals);
-  assert(curr->index < numLocals);
-  // current sets are just this set
-  currMapping[curr->index] = { curr }; // TODO optimize?
-  locations[curr] = getCurrentPointer();
-}
-
-// traversal
-
-void LocalGraph::scan(LocalGraph* self, Expression** currp) {
-  if (auto* iff = (*currp)->dynCast<If>()) {
-    // if needs special handling
-    if (iff->ifFalse) {
-      self->pushTask(LocalGraph::afterIfFalse, currp);
-      self->pushTask(LocalGraph::scan, &iff->ifFalse);
+  // walk the dominator tree, keeping a stack of the reaching definitions of
+  // each local. a definition is a SetId, or a phi, numbered after the sets
+  Index numSets = sets.size();
+  std::vector<Index> pendingDefs(pending.size());
+  std::vector<std::pair<Index, Index>> phiOperandEdges; // phi, definition
+  {
+    auto& children = dominators.children;
+    Adjacency phisInBlock, setsInBlock, pendingInBlock;
+    std::vector<std::pair<Index, Index>> edges;
+    for (Index i = 0; i < phis.size(); i++) edges.emplace_back(phis[i].block, i);
+    phisInBlock.build(numLive, edges);
+    edges.clear();
+    for (Index i = 0; i < blockSets.size(); i++) edges.emplace_back(blockSets[i].block, i);
+    setsInBlock.build(numLive, edges);
+    edges.clear();
+    for (Index i = 0; i < pending.size(); i++) edges.emplace_back(pending[i].block, i);
+    pendingInBlock.build(numLive, edges);
+    std::vector<std::vector<Index>> stacks(numLocals);
+    auto top = [&](Index local) -> Index {
+      auto& stack = stacks[local];
+      return stack.empty() ? 0 : stack.back();
+    };
+    std::vector<std::pair<Index, Index>> walkStack; // block, next child
+    walkStack.emplace_back(0, NONE);
+    while (!walkStack.empty()) {
+      auto block = walkStack.back().first;
+      auto& next = walkStack.back().second;
+      if (next == NONE) {
+        // entering the block
+        next = children.begin(block);
+        for (Index j = phisInBlock.begin(block); j < phisInBlock.end(block); j++) {
+          auto phi = phisInBlock.list[j];
+          stacks[phis[phi].local].push_back(numSets + phi);
+        }
+        for (Index j = pendingInBlock.begin(block); j < pendingInBlock.end(block); j++) {
+          auto index = pendingInBlock.list[j];
+          pendingDefs[index] = top(pending[index].local);
+        }
+        for (Index j = setsInBlock.begin(block); j < setsInBlock.end(block); j++) {
+          auto& blockSet = blockSets[setsInBlock.list[j]];
+          stacks[blockSet.local].push_back(blockSet.set);
+        }
+        for (Index j = succs.begin(block); j < succs.end(block); j++) {
+          auto succ = succs.list[j];
+          for (Index k = phisInBlock.begin(succ); k < phisInBlock.end(succ); k++) {
+            auto phi = phisInBlock.list[k];
+            auto def = top(phis[phi].local);
+            // a phi reaching itself (through a loop that does not set the
+            // local) adds nothing, and at loop tops with many backedges
+            // that is the common case
+            if (def != numSets + phi) {
+              phiOperandEdges.emplace_back(phi, def);
+            }
+          }
+        }
+      }
+      if (next < children.end(block)) {
+        walkStack.emplace_back(children.list[next++], NONE);
+        continue;
+      }
+      // leaving the block
+      for (Index j = phisInBlock.begin(block); j < phisInBlock.end(block); j++) {
+        stacks[phis[phisInBlock.list[j]].local].pop_back();
+      }
+      for (Index j = setsInBlock.begin(block); j < setsInBlock.end(block); j++) {
+        stacks[blockSets[setsInBlock.list[j]].local].pop_back();
+      }
+      walkStack.pop_back();
     }
-    self->pushTask(LocalGraph::afterIfTrue, currp);
-    self->pushTask(LocalGraph::scan, &iff->ifTrue);
-    self->pushTask(LocalGraph::afterIfCondition, currp);
-    self->pushTask(LocalGraph::scan, &iff->condition);
-  } else {
-    PostWalker<LocalGraph>::scan(self, currp);
   }
-
-  // loops need pre-order visiting too
-  if ((*currp)->is<Loop>()) {
-    self->pushTask(LocalGraph::beforeLoop, currp);
-  }
-}
-
-// helpers
-
-void LocalGraph::setUnreachable(Mapping& mapping) {
-  mapping.resize(numLocals); // may have been emptied by a move
-  mapping[0].clear();
-}
-
-bool LocalGraph::isUnreachable(Mapping& mapping) {
-  // we must have some set for each index, if only the zero init, so empty means we emptied it for unreachable code
-  return mapping[0].empty();
-}
-
-// merges a bunch of infos into one.
-// if we need phis, writes them into the provided vector. the caller should
-// ensure those are placed in the right location
-LocalGraph::Mapping& LocalGraph::merge(std::vector<Mapping>& mappings) {
-  assert(mappings.size() > 0);
-  auto& out = mappings[0];
-  if (mappings.size() == 1) {
-    return out;
-  }
-  // merge into the first
-  for (Index j = 1; j < mappings.size(); j++) {
-    auto& other = mappings[j];
-    for (Index i = 0; i < numLocals; i++) {
-      auto& outSets = out[i];
-      for (auto* set : other[i]) {
-        outSets.insert(set);
+  // a phi means the union of the sets its operands lead to. phis that are
+  // strongly connected have the same value, so we find them with Tarjan's
+  // algorithm, which conveniently completes a component only after all those
+  // it depends on.
+  Index numPhis = phis.size();
+  Adjacency operands;
+  operands.build(numPhis, phiOperandEdges);
+  std::vector<Index> phiValues(numPhis);
+  {
+    std::vector<Index> order(numPhis, NONE), low(numPhis), component(numPhis);
+    std::vector<Index> componentValues, sccStack, members, externals;
+    std::vector<std::pair<Index, Index>> callStack; // phi, next operand
+    Index counter = 0;
+    auto start = [&](Index phi) {
+      order[phi] = low[phi] = counter++;
+      component[phi] = NONE;
+      sccStack.push_back(phi);
+      callStack.emplace_back(phi, operands.begin(phi));
+    };
+    auto finishComponent = [&](Index root) {
+      Index id = componentValues.size();
+      members.clear();
+      while (1) {
+        auto member = sccStack.back();
+        sccStack.pop_back();
+        component[member] = id;
+        members.push_back(member);
+        if (member == root) break;
+      }
+      SetIds ids;
+      externals.clear();
+      for (auto member : members) {
+        for (Index j = operands.begin(member); j < operands.end(member); j++) {
+          auto def = operands.list[j];
+          if (def < numSets) {
+            ids.push_back(def);
+          } else if (component[def - numSets] != id) {
+            externals.push_back(componentValues[component[def - numSets]]);
+          }
+        }
+      }
+      std::sort(externals.begin(), externals.end());
+      externals.erase(std::unique(externals.begin(), externals.end()), externals.end());
+      Index value;
+      if (ids.empty() && externals.size() <= 1) {
+        // nothing new here, share the value we depend on
+        value = externals.empty() ? 0 : externals[0];
+      } else {
+        for (auto external : externals) {
+          auto& other = values[external];
+          ids.insert(ids.end(), other.begin(), other.end());
+        }
+        std::sort(ids.begin(), ids.end());
+        ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+        value = values.size();
+        values.emplace_back(std::move(ids));
+      }
+      componentValues.push_back(value);
+      for (auto member : members) {
+        phiValues[member] = value;
+      }
+    };
+    for (Index i = 0; i < numPhis; i++) {
+      if (order[i] != NONE) continue;
+      start(i);
+      while (!callStack.empty()) {
+        auto curr = callStack.back().first;
+        auto& next = callStack.back().second;
+        if (next < operands.end(curr)) {
+          auto def = operands.list[next++];
+          if (def < numSets) continue; // a set, not part of the search
+          auto phi = def - numSets;
+          if (order[phi] == NONE) {
+            start(phi);
+          } else if (component[phi] == NONE) {
+            low[curr] = std::min(low[curr], order[phi]); // still on the stack
+          }
+          continue;
+        }
+        callStack.pop_back();
+        if (!callStack.empty()) {
+          auto parent = callStack.back().first;
+          low[parent] = std::min(low[parent], low[curr]);
+        }
+        if (low[curr] == order[curr]) {
+          finishComponent(curr);
+        }
       }
     }
   }
-  return out;
+  for (Index i = 0; i < pending.size(); i++) {
+    auto def = pendingDefs[i];
+    getValues[pending[i].get] = def < numSets ? getSingleValue(def) : phiValues[def - numSets];
+  }
 }
 
 } // namespace wasm
-
@@ -0,0 +1,262 @@
+/*
+ * Copyright 2017 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef wasm_ir_call_graph_h
+#define wasm_ir_call_graph_h
+
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+
+#include "wasm.h"
+#include "pass.h"
+#include "support/threads.h"
+
+namespace wasm {
+
+//
+// The graph of direct calls between the functions of a module, and its
+// strongly connected components (SCCs), that is, the sets of mutually
+// recursive functions.
+//
+// The SCCs are sorted bottom-up: each comes after all the SCCs it calls.
+// forEachSCCBottomUp() processes them in that order on the thread pool,
+// running SCCs in parallel when neither calls the other, which lets
+// module-level passes handle callees before their callers (for example,
+// to propagate facts about functions, or to copy code out of callees that
+// are already final) without serializing on the whole module.
+//
+// Only direct calls are edges. Calls to imports and indirect calls are
+// noted on the caller; users that care about them must be conservative,
+// as an indirect call may reach any function in the table.
+//
+
+struct CallGraph {
+  struct Node {
+    Function* func;
+    std::vector<Index> callees; // the functions it calls, without duplicates, sorted
+    std::vector<Index> callers; // the functions calling it, without duplicates, sorted
+    bool callsImports = false;
+    bool hasIndirectCalls = false;
+    Index scc;
+  };
+
+  struct SCC {
+    std::vector<Index> functions; // the nodes in this SCC
+    std::vector<Index> callees; // the other SCCs it calls, without duplicates
+    std::vector<Index> callers; // the other SCCs calling it, without duplicates
+    bool recursive = false; // whether it contains a cycle (including a function calling itself)
+  };
+
+  std::vector<Node> nodes; // in the order of the module's functions
+  std::vector<SCC> sccs; // bottom-up
+
+  CallGraph(Module& module) {
+    nodes.resize(module.functions.size());
+    for (Index i = 0; i < nodes.size(); i++) {
+      auto* func = module.functions[i].get();
+      nodes[i].func = func;
+      indexes[func->name] = i;
+    }
+    scanCalls(module);
+    for (Index i = 0; i < nodes.size(); i++) {
+      for (auto callee : nodes[i].callees) {
+        nodes[callee].callers.push_back(i);
+      }
+    }
+    computeSCCs();
+  }
+
+  Index getIndex(Name name) {
+    return indexes.at(name);
+  }
+
+  Node& getNode(Name name) {
+    return nodes[getIndex(name)];
+  }
+
+  // Calls work on each SCC, after it was called on all the SCCs that SCC
+  // calls. This runs in parallel, and work is never called on an SCC at
+  // the same time as on one it calls, or one calling it.
+  void forEachSCCBottomUp(std::function<void (SCC&)> work) {
+    if (sccs.empty()) return;
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::vector<Index> waiting; // for each SCC, how many of its callees are not done yet
+    std::vector<Index> ready;
+    size_t remaining = sccs.size();
+    for (Index i = 0; i < sccs.size(); i++) {
+      waiting.push_back(sccs[i].callees.size());
+      if (waiting.back() == 0) ready.push_back(i);
+    }
+    // sccs are bottom-up, and we take from the back, so start with the first
+    std::reverse(ready.begin(), ready.end());
+    size_t num = ThreadPool::get()->size();
+    std::vector<std::function<ThreadWorkState ()>> doWorkers;
+    for (size_t i = 0; i < num; i++) {
+      doWorkers.push_back([&]() {
+        Index index;
+        {
+          std::unique_lock<std::mutex> lock(mutex);
+          // wait for an SCC whose callees are all done, unless everything
+          // is done (if nothing is ready, another thread is still working)
+          condition.wait(lock, [&]() { return !ready.empty() || remaining == 0; });
+          if (ready.empty()) return ThreadWorkState::Finished;
+          index = ready.back();
+          ready.pop_back();
+        }
+        work(sccs[index]);
+        bool finished;
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          remaining--;
+          for (auto caller : sccs[index].callers) {
+            if (--waiting[caller] == 0) ready.push_back(caller);
+          }
+          finished = remaining == 0;
+        }
+        condition.notify_all();
+        return finished ? ThreadWorkState::Finished : ThreadWorkState::More;
+      });
+    }
+    ThreadPool::get()->work(doWorkers);
+  }
+
+private:
+  std::unordered_map<Name, Index> indexes;
+
+  void scanCalls(Module& module) {
+    struct Scanner : public WalkerPass<PostWalker<Scanner>> {
+      bool isFunctionParallel() override { return true; }
+
+      CallGraph* graph;
+
+      Scanner(CallGraph* graph) : graph(graph) {}
+
+      Scanner* create() override {
+        return new Scanner(graph);
+      }
+
+      Node* node;
+
+      void doWalkFunction(Function* func) {
+        // each function is only written to by the thread scanning it
+        node = &graph->getNode(func->name);
+        walk(func->body);
+        auto& callees = node->callees;
+        std::sort(callees.begin(), callees.end());
+        callees.erase(std::unique(callees.begin(), callees.end()), callees.end());
+      }
+
+      void visitCall(Call* curr) {
+        node->callees.push_back(graph->getIndex(curr->target));
+      }
+      void visitCallImport(CallImport* curr) {
+        node->callsImports = true;
+      }
+      void visitCallIndirect(CallIndirect* curr) {
+        node->hasIndirectCalls = true;
+      }
+    };
+    PassRunner runner(&module);
+    runner.setIsNested(true);
+    runner.add<Scanner>(this);
+    runner.run();
+  }
+
+  // Tarjan's algorithm, which emits an SCC only after all the SCCs
+  // reachable from it, that is, bottom-up. This is iterative, as call
+  // chains can be very deep.
+  void computeSCCs() {
+    const Index Unvisited = Index(-1);
+    std::vector<Index> number(nodes.size(), Unvisited), lowLink(nodes.size());
+    std::vector<bool> onStack(nodes.size());
+    std::vector<Index> stack;
+    std::vector<std::pair<Index, Index>> work; // node, next callee to look at
+    Index next = 0;
+    for (Index root = 0; root < nodes.size(); root++) {
+      if (number[root] != Unvisited) continue;
+      work.emplace_back(root, 0);
+      while (!work.empty()) {
+        auto i = work.back().first;
+        auto& pos = work.back().second;
+        if (pos == 0) {
+          number[i] = lowLink[i] = next++;
+          stack.push_back(i);
+          onStack[i] = true;
+        }
+        auto& callees = nodes[i].callees;
+        bool descended = false;
+        while (pos < callees.size()) {
+          auto callee = callees[pos++];
+          if (number[callee] == Unvisited) {
+            work.emplace_back(callee, 0);
+            descended = true;
+            break;
+          }
+          if (onStack[callee]) {
+            lowLink[i] = std::min(lowLink[i], number[callee]);
+          }
+        }
+        if (descended) continue;
+        work.pop_back();
+        if (!work.empty()) {
+          auto parent = work.back().first;
+          lowLink[parent] = std::min(lowLink[parent], lowLink[i]);
+        }
+        if (lowLink[i] != number[i]) continue;
+        // i is the root of an SCC, which is everything above it on the stack
+        Index index = sccs.size();
+        sccs.emplace_back();
+        auto& scc = sccs.back();
+        Index member;
+        do {
+          member = stack.back();
+          stack.pop_back();
+          onStack[member] = false;
+          nodes[member].scc = index;
+          scc.functions.push_back(member);
+        } while (member != i);
+        std::sort(scc.functions.begin(), scc.functions.end());
+      }
+    }
+    // connect the SCCs
+    for (Index index = 0; index < sccs.size(); index++) {
+      auto& scc = sccs[index];
+      scc.recursive = scc.functions.size() > 1;
+      for (auto i : scc.functions) {
+        for (auto callee : nodes[i].callees) {
+          auto calleeSCC = nodes[callee].scc;
+          if (calleeSCC == index) {
+            scc.recursive = true;
+          } else {
+            scc.callees.push_back(calleeSCC);
+          }
+        }
+      }
+      std::sort(scc.callees.begin(), scc.callees.end());
+      scc.callees.erase(std::unique(scc.callees.begin(), scc.callees.end()), scc.callees.end());
+      for (auto callee : scc.callees) {
+        sccs[callee].callers.push_back(index);
+      }
+    }
+  }
+};
+
+} // namespace wasm
+
+#endif // wasm_ir_call_graph_h
@@ -139,7 +139,12 @@ struct CostAnalyzer : public Visitor<CostAnalyzer, Index> {
       case ConvertSInt32ToFloat64:
       case ConvertUInt32ToFloat64:
       case ConvertSInt64ToFloat64:
-      case ConvertUInt64ToFloat64: ret = 1; break;
+      case ConvertUInt64ToFloat64:
+      case ExtendS8Int32:
+      case ExtendS16Int32:
+      case ExtendS8Int64:
+      case ExtendS16Int64:
+      case ExtendS32Int64: ret = 1; break;
       case SqrtFloat32:
       case SqrtFloat64: ret = 2; break;
       default: WASM_UNREACHABLE();
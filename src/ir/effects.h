@@ -17,34 +17,60 @@
 #ifndef wasm_ir_effects_h
 #define wasm_ir_effects_h
 
-namespace wasm {
+#include "analysis-manager.h"
+#include "support/small_bitset.h"
 
-// Look for side effects, including control flow
-// TODO: optimize
+namespace wasm {
 
-struct EffectAnalyzer : public PostWalker<EffectAnalyzer> {
-  EffectAnalyzer(PassOptions& passOptions, Expression *ast = nullptr) {
-    ignoreImplicitTraps = passOptions.ignoreImplicitTraps;
-    debugInfo = passOptions.debugInfo;
-    if (ast) analyze(ast);
-  }
+// A summary of the side effects of some code, including control flow.
+// Locals are kept in bitsets and names in small sorted vectors, which
+// makes summaries cheap to build, merge and compare.
 
-  bool ignoreImplicitTraps;
-  bool debugInfo;
+struct EffectSummary {
+  // A small set of names. Names are interned, so we sort them by pointer.
+  struct NameSet : public std::vector<Name> {
+    static bool less(const Name& a, const Name& b) { return a.str < b.str; }
 
-  void analyze(Expression *ast) {
-    breakNames.clear();
-    walk(ast);
-    // if we are left with breaks, they are external
-    if (breakNames.size() > 0) branches = true;
-  }
+    void insert(Name name) {
+      auto iter = std::lower_bound(begin(), end(), name, less);
+      if (iter == end() || *iter != name) std::vector<Name>::insert(iter, name);
+    }
+    size_t count(Name name) const {
+      auto iter = std::lower_bound(begin(), end(), name, less);
+      return iter != end() && *iter == name;
+    }
+    void erase(Name name) {
+      auto iter = std::lower_bound(begin(), end(), name, less);
+      if (iter != end() && *iter == name) std::vector<Name>::erase(iter);
+    }
+    bool intersects(const NameSet& other) const {
+      auto a = begin(), b = other.begin();
+      while (a != end() && b != other.end()) {
+        if (less(*a, *b)) {
+          a++;
+        } else if (less(*b, *a)) {
+          b++;
+        } else {
+          return true;
+        }
+      }
+      return false;
+    }
+    void merge(const NameSet& other) {
+      if (other.empty()) return;
+      NameSet merged;
+      merged.reserve(size() + other.size());
+      std::set_union(begin(), end(), other.begin(), other.end(), std::back_inserter(merged), less);
+      swap(merged);
+    }
+  };
 
   bool branches = false; // branches out of this expression, returns, infinite loops, etc
   bool calls = false;
-  std::set<Index> localsRead;
-  std::set<Index> localsWritten;
-  std::set<Name> globalsRead;
-  std::set<Name> globalsWritten;
+  SmallBitSet localsRead;
+  SmallBitSet localsWritten;
+  NameSet globalsRead;
+  NameSet globalsWritten;
   bool readsMemory = false;
   bool writesMemory = false;
   bool implicitTrap = false; // a load or div/rem, which may trap. we ignore trap
@@ -55,18 +81,21 @@ struct EffectAnalyzer : public PostWalker<EffectAnalyzer> {
   bool isAtomic = false; // An atomic load/store/RMW/Cmpxchg or an operator that
                          // has a defined ordering wrt atomics (e.g. grow_memory)
 
-  bool accessesLocal() { return localsRead.size() + localsWritten.size() > 0; }
-  bool accessesGlobal() { return globalsRead.size() + globalsWritten.size() > 0; }
+  // the targets of breaks that were not (yet) found to be internal
+  NameSet breakNames;
+
+  bool accessesLocal() { return !localsRead.empty() || !localsWritten.empty(); }
+  bool accessesGlobal() { return !globalsRead.empty() || !globalsWritten.empty(); }
   bool accessesMemory() { return calls || readsMemory || writesMemory; }
-  bool hasGlobalSideEffects() { return calls || globalsWritten.size() > 0 || writesMemory || isAtomic; }
-  bool hasSideEffects() { return hasGlobalSideEffects() || localsWritten.size() > 0 || branches || implicitTrap; }
+  bool hasGlobalSideEffects() { return calls || !globalsWritten.empty() || writesMemory || isAtomic; }
+  bool hasSideEffects() { return hasGlobalSideEffects() || !localsWritten.empty() || branches || implicitTrap; }
   bool hasAnything() { return branches || calls || accessesLocal() || readsMemory || writesMemory || accessesGlobal() || implicitTrap || isAtomic; }
 
   // check if we break to anything external from ourselves
   bool hasExternalBreakTargets() { return !breakNames.empty(); }
 
   // checks if these effects would invalidate another set (e.g., if we write, we invalidate someone that reads, they can't be moved past us)
-  bool invalidates(EffectAnalyzer& other) {
+  bool invalidates(EffectSummary& other) {
     if (branches || other.branches
                  || ((writesMemory || calls) && other.accessesMemory())
                  || (accessesMemory() && (other.writesMemory || other.calls))) {
@@ -78,24 +107,18 @@ struct EffectAnalyzer : public PostWalker<EffectAnalyzer> {
         (other.isAtomic && accessesMemory())) {
       return true;
     }
-    for (auto local : localsWritten) {
-      if (other.localsWritten.count(local) || other.localsRead.count(local)) {
-        return true;
-      }
-    }
-    for (auto local : localsRead) {
-      if (other.localsWritten.count(local)) return true;
+    if (localsWritten.intersects(other.localsWritten) ||
+        localsWritten.intersects(other.localsRead) ||
+        localsRead.intersects(other.localsWritten)) {
+      return true;
     }
     if ((accessesGlobal() && other.calls) || (other.accessesGlobal() && calls)) {
       return true;
     }
-    for (auto global : globalsWritten) {
-      if (other.globalsWritten.count(global) || other.globalsRead.count(global)) {
-        return true;
-      }
-    }
-    for (auto global : globalsRead) {
-      if (other.globalsWritten.count(global)) return true;
+    if (globalsWritten.intersects(other.globalsWritten) ||
+        globalsWritten.intersects(other.globalsRead) ||
+        globalsRead.intersects(other.globalsWritten)) {
+      return true;
     }
     // we are ok to reorder implicit traps, but not conditionalize them
     if ((implicitTrap && other.branches) || (other.implicitTrap && branches)) {
@@ -108,17 +131,44 @@ struct EffectAnalyzer : public PostWalker<EffectAnalyzer> {
     return false;
   }
 
-  void mergeIn(EffectAnalyzer& other) {
+  void mergeIn(EffectSummary& other) {
     branches = branches || other.branches;
     calls = calls || other.calls;
     readsMemory = readsMemory || other.readsMemory;
     writesMemory = writesMemory || other.writesMemory;
-    for (auto i : other.localsRead) localsRead.insert(i);
-    for (auto i : other.localsWritten) localsWritten.insert(i);
-    for (auto i : other.globalsRead) globalsRead.insert(i);
-    for (auto i : other.globalsWritten) globalsWritten.insert(i);
+    implicitTrap = implicitTrap || other.implicitTrap;
+    isAtomic = isAtomic || other.isAtomic;
+    localsRead.merge(other.localsRead);
+    localsWritten.merge(other.localsWritten);
+    globalsRead.merge(other.globalsRead);
+    globalsWritten.merge(other.globalsWritten);
+  }
+};
+
+struct EffectCache;
+
+// Look for side effects, including control flow.
+//
+// Analyzing a subtree walks all of it. When the same subtrees are analyzed
+// over and over - for example, first a child and later its parent - an
+// EffectCache can be provided, so that the walk stops at subtrees whose
+// summary is already known.
+
+struct EffectAnalyzer : public PostWalker<EffectAnalyzer>, public EffectSummary {
+  EffectAnalyzer(PassOptions& passOptions, Expression *ast = nullptr, EffectCache* cache = nullptr) : cache(cache) {
+    ignoreImplicitTraps = passOptions.ignoreImplicitTraps;
+    debugInfo = passOptions.debugInfo;
+    if (ast) analyze(ast);
   }
 
+  bool ignoreImplicitTraps;
+  bool debugInfo;
+  EffectCache* cache;
+
+  void analyze(Expression *ast);
+
+  static void scan(EffectAnalyzer* self, Expression** currp);
+
   // the checks above happen after the node's children were processed, in the order of execution
   // we must also check for control flow that happens before the children, i.e., loops
   bool checkPre(Expression* curr) {
@@ -137,8 +187,6 @@ struct EffectAnalyzer : public PostWalker<EffectAnalyzer> {
     return hasAnything();
   }
 
-  std::set<Name> breakNames;
-
   void visitBreak(Break *curr) {
     breakNames.insert(curr->name);
   }
@@ -276,6 +324,80 @@ struct EffectAnalyzer : public PostWalker<EffectAnalyzer> {
   void visitUnreachable(Unreachable *curr) { branches = true; }
 };
 
+// A cache of the effects of subtrees, for the EffectAnalyzers of one
+// function. Summaries are computed when first needed, and reused by any
+// later analysis that contains the same subtree. Nothing notices when the
+// IR changes, so whoever modifies an expression must invalidate() it and
+// everything above it that may be cached (or clear() everything). Note that
+// effects do not depend on order, so just reordering children is fine.
+
+struct EffectCache {
+  EffectCache(PassOptions& passOptions) : passOptions(passOptions) {}
+
+  // the summary for a subtree, computing it if necessary
+  EffectSummary& get(Expression* curr) {
+    auto iter = summaries.find(curr);
+    if (iter != summaries.end()) return iter->second;
+    EffectAnalyzer analyzer(passOptions, nullptr, this);
+    analyzer.breakNames.clear();
+    analyzer.walk(curr);
+    // note that branches out of the subtree are kept as breakNames, as an
+    // enclosing expression may be their target
+    return summaries[curr] = analyzer;
+  }
+
+  // the summary for a subtree, if we have it
+  EffectSummary* find(Expression* curr) {
+    auto iter = summaries.find(curr);
+    return iter != summaries.end() ? &iter->second : nullptr;
+  }
+
+  void invalidate(Expression* curr) {
+    summaries.erase(curr);
+  }
+
+  void clear() {
+    summaries.clear();
+  }
+
+private:
+  PassOptions& passOptions;
+  std::unordered_map<Expression*, EffectSummary> summaries;
+};
+
+// An EffectCache can be kept in the AnalysisManager, to share it between
+// passes that do not invalidate it.
+template<>
+struct FunctionAnalysisTraits<EffectCache> {
+  static EffectCache* compute(Function* func, Module* module, PassOptions& options) {
+    return new EffectCache(options);
+  }
+};
+
+inline void EffectAnalyzer::analyze(Expression *ast) {
+  breakNames.clear();
+  if (cache) {
+    auto& summary = cache->get(ast);
+    mergeIn(summary);
+    breakNames = summary.breakNames;
+  } else {
+    walk(ast);
+  }
+  // if we are left with breaks, they are external
+  if (breakNames.size() > 0) branches = true;
+}
+
+inline void EffectAnalyzer::scan(EffectAnalyzer* self, Expression** currp) {
+  if (self->cache) {
+    if (auto* summary = self->cache->find(*currp)) {
+      self->mergeIn(*summary);
+      self->breakNames.merge(summary->breakNames);
+      return;
+    }
+  }
+  PostWalker<EffectAnalyzer>::scan(self, currp);
+}
+
 } // namespace wasm
 
 #endif // wasm_ir_effects_h
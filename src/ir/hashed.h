@@ -33,6 +33,8 @@ struct HashedExpression {
     }
   }
 
+  HashedExpression(Expression* expr, size_t hash) : expr(expr), hash(hash) {}
+
   HashedExpression(const HashedExpression& other) : expr(other.expr), hash(other.hash) {}
 };
 
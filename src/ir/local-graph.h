@@ -17,6 +17,8 @@
 #ifndef wasm_ir_local_graph_h
 #define wasm_ir_local_graph_h
 
+#include "cfg/cfg-traversal.h"
+
 namespace wasm {
 
 //
@@ -27,9 +29,32 @@ namespace wasm {
 // (see the SSA pass for actually creating new local indexes based
 // on this).
 //
-// TODO: the algorithm here is pretty simple, but also pretty slow,
-//       we should optimize it.
-struct LocalGraph : public PostWalker<LocalGraph> {
+// The gets and sets are numbered densely as the CFG is built, and each
+// basic block just records the order of the ones inside it. Gets whose
+// sets are not in their own block are resolved SSA-style, with phis at
+// the dominance frontiers of the blocks setting their local, so the work
+// is proportional to the size of the CFG and the number of phis actually
+// needed, and no per-local state is copied around at control flow merges
+// (see LocalGraph.cpp).
+//
+// Code that is not reachable from the function entry does not
+// influence anything; a get there has no sets, unless a set precedes
+// it in the same unreachable block.
+//
+
+struct LocalGraphBlockInfo {
+  struct Action {
+    bool isSet;
+    Index id; // the dense number of the get or set
+    Index local;
+  };
+  std::vector<Action> actions; // the gets and sets, in order
+  Index index; // the position of the block in basicBlocks
+
+  void dump(Function* func) {}
+};
+
+struct LocalGraph : public CFGWalker<LocalGraph, Visitor<LocalGraph>, LocalGraphBlockInfo> {
   // main API
 
   // the constructor computes getSetses, the sets affecting each get
@@ -49,62 +74,39 @@ struct LocalGraph : public PostWalker<LocalGraph> {
   std::unordered_map<GetLocal*, std::unordered_set<SetLocal*>> getInfluences; // for each get, the sets whose values are influenced by that get
   std::unordered_map<SetLocal*, std::unordered_set<GetLocal*>> setInfluences; // for each set, the gets whose values are influenced by that set
 
-  void computeInfluences();
+  void computeInfluences(); // does nothing if already computed
 
-private:
-  // we map local index => the set_locals for that index.
-  // a nullptr set means there is a virtual set, from a param
-  // initial value or the zero init initial value.
-  typedef std::vector<Sets> Mapping;
+  // cfg traversal
 
-  // internal state
-  Index numLocals;
-  Mapping currMapping;
-  std::vector<Mapping> mappingStack; // used in ifs, loops
-  std::map<Name, std::vector<Mapping>> breakMappings; // break target => infos that reach it
-  std::vector<std::vector<GetLocal*>> loopGetStack; //  stack of loops, all the gets in each, so we can update them for back branches
+  void visitGetLocal(GetLocal* curr);
+  void visitSetLocal(SetLocal* curr);
 
-public:
   void doWalkFunction(Function* func);
 
-  // control flow
-
-  void visitBlock(Block* curr);
-
-  void finishIf();
-
-  static void afterIfCondition(LocalGraph* self, Expression** currp);
-  static void afterIfTrue(LocalGraph* self, Expression** currp);
-  static void afterIfFalse(LocalGraph* self, Expression** currp);
-  static void beforeLoop(LocalGraph* self, Expression** currp);
-  void visitLoop(Loop* curr);
-  void visitBreak(Break* curr);
-  void visitSwitch(Switch* curr);
-  void visitReturn(Return *curr);
-  void visitUnreachable(Unreachable *curr);
-
-  // local usage
+private:
+  // an index in sets, where 0 is the virtual initial set, nullptr
+  typedef Index SetId;
 
-  void visitGetLocal(GetLocal* curr);
-  void visitSetLocal(SetLocal* curr);
+  Index numLocals;
 
-  // traversal
+  // dense numbering of the gets and sets, in the order they were seen
+  std::vector<GetLocal*> gets;
+  std::vector<SetLocal*> sets;
+  std::vector<std::pair<Expression*, Expression**>> seen;
 
-  static void scan(LocalGraph* self, Expression** currp);
+  // the sets arriving at each get, as an index in values
+  std::vector<Index> getValues;
 
-  // helpers
+  // sorted vectors of SetIds, the possible sets arriving somewhere
+  typedef std::vector<SetId> SetIds;
 
-  void setUnreachable(Mapping& mapping);
+  std::vector<SetIds> values; // 0 is the empty value, meaning unreachable
 
-  bool isUnreachable(Mapping& mapping);
+  bool influencesComputed = false;
 
-  // merges a bunch of infos into one.
-  // if we need phis, writes them into the provided vector. the caller should
-  // ensure those are placed in the right location
-  Mapping& merge(std::vector<Mapping>& mappings);
+  void flow();
 };
 
 } // namespace wasm
 
 #endif // wasm_ir_local_graph_h
-
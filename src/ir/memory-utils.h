@@ -22,6 +22,8 @@
 
 #include "literal.h"
 #include "wasm.h"
+#include "ir/effects.h"
+#include "ir/utils.h"
 
 namespace wasm {
 
@@ -48,6 +50,72 @@ namespace MemoryUtils {
     memory.segments[0].data.swap(data);
     return true;
   }
+
+  // The bytes that a load or store accesses, which start at the constant
+  // offset after the value of the pointer. This is a simple base+offset
+  // alias analysis: two accesses whose pointers are constants, or are
+  // equal expressions that have the same value, can be compared exactly,
+  // while anything else may overlap. Checking that the pointers have the
+  // same value (for example, that no local they read was written in
+  // between) is up to the user. An access without a pointer is unknown.
+  struct Access {
+    Expression* ptr = nullptr;
+    uint64_t offset = 0;
+    Index bytes = 0;
+
+    Access() {}
+    Access(Load* load) : ptr(load->ptr), offset(load->offset), bytes(load->bytes) {}
+    Access(Store* store) : ptr(store->ptr), offset(store->offset), bytes(store->bytes) {}
+
+    bool isKnown() const { return ptr != nullptr; }
+
+    // Whether a pointer with these effects has the same value wherever the
+    // locals and globals it reads do, so that accesses using it can be
+    // compared (it may trap, as then the access would not happen anyhow).
+    static bool isComparable(const EffectSummary& ptrEffects) {
+      return !ptrEffects.calls && !ptrEffects.readsMemory && !ptrEffects.writesMemory &&
+             !ptrEffects.isAtomic && !ptrEffects.branches && ptrEffects.breakNames.empty() &&
+             ptrEffects.localsWritten.empty() && ptrEffects.globalsWritten.empty();
+    }
+
+    static bool mayOverlap(const Access& a, const Access& b) {
+      uint64_t aStart, bStart;
+      if (!getStarts(a, b, aStart, bStart)) return true;
+      return aStart < bStart + b.bytes && bStart < aStart + a.bytes;
+    }
+
+    static bool isSame(const Access& a, const Access& b) {
+      uint64_t aStart, bStart;
+      if (!getStarts(a, b, aStart, bStart)) return false;
+      return aStart == bStart && a.bytes == b.bytes;
+    }
+
+    // whether b may trap when a did not, that is, may end later
+    static bool mayTrapAfter(const Access& a, const Access& b) {
+      uint64_t aStart, bStart;
+      if (!getStarts(a, b, aStart, bStart)) return true;
+      return bStart + b.bytes > aStart + a.bytes;
+    }
+
+  private:
+    // gets the starts of two accesses relative to a common base, if we can
+    static bool getStarts(const Access& a, const Access& b, uint64_t& aStart, uint64_t& bStart) {
+      if (!a.isKnown() || !b.isKnown()) return false;
+      auto* aConst = a.ptr->dynCast<Const>();
+      auto* bConst = b.ptr->dynCast<Const>();
+      if (aConst && bConst) {
+        aStart = uint64_t(uint32_t(aConst->value.geti32())) + a.offset;
+        bStart = uint64_t(uint32_t(bConst->value.geti32())) + b.offset;
+        return true;
+      }
+      if (!aConst && !bConst && ExpressionAnalyzer::equal(a.ptr, b.ptr)) {
+        aStart = a.offset;
+        bStart = b.offset;
+        return true;
+      }
+      return false;
+    }
+  };
 };
 
 } // namespace wasm
@@ -65,8 +65,27 @@ struct ExpressionAnalyzer {
     return flexibleEqual(left, right, comparer);
   }
 
-  // hash an expression, ignoring superficial details like specific internal names
-  static uint32_t hash(Expression* curr);
+  // hash an expression, ignoring superficial details like specific internal names.
+  // the hash only depends on the contents, so it is stable across runs.
+  static uint64_t hash(Expression* curr);
+
+  // The hash of a subtree, and whether it is closed, that is, does not
+  // branch to labels outside of itself. Closed subtrees hash the same
+  // wherever they are, so their hashes can be reused when hashing larger
+  // trees containing them.
+  struct SubtreeHash {
+    uint64_t hash;
+    bool closed;
+  };
+  typedef std::unordered_map<Expression*, SubtreeHash> SubtreeHashes;
+
+  // hash an expression, reusing the known hashes of closed subtrees, and
+  // noting the hashes of all the subtrees we hash along the way.
+  static uint64_t hash(Expression* curr, SubtreeHashes& known);
+
+  // hash an expression, ignoring the values of constants, so expressions
+  // that differ only in them have the same hash.
+  static uint64_t shapeHash(Expression* curr);
 };
 
 // Re-Finalizes all node types
@@ -21,6 +21,7 @@
 
 #include "wasm.h"
 #include "wasm-traversal.h"
+#include "analysis-manager.h"
 #include "mixed_arena.h"
 #include "support/utilities.h"
 
@@ -63,6 +64,7 @@ struct PassOptions {
   bool ignoreImplicitTraps = false; // optimize assuming things like div by 0, bad load/store, will not trap
   bool debugInfo = false; // whether to try to preserve debug info through, which are special calls
   FeatureSet features = Feature::MVP; // Which wasm features to accept, and be allowed to use
+  std::map<std::string, std::string> arguments; // arbitrary arguments for passes, given as KEY@VALUE on the commandline
 };
 
 //
@@ -73,9 +75,10 @@ struct PassRunner {
   MixedArena* allocator;
   std::vector<Pass*> passes;
   PassOptions options;
+  AnalysisManager analyses; // cached analyses of functions, shared by the passes
 
-  PassRunner(Module* wasm) : wasm(wasm), allocator(&wasm->allocator) {}
-  PassRunner(Module* wasm, PassOptions options) : wasm(wasm), allocator(&wasm->allocator), options(options) {}
+  PassRunner(Module* wasm) : wasm(wasm), allocator(&wasm->allocator), analyses(wasm, options) {}
+  PassRunner(Module* wasm, PassOptions options) : wasm(wasm), allocator(&wasm->allocator), options(options), analyses(wasm, this->options) {}
 
   // no copying, we control |passes|
   PassRunner(const PassRunner&) = delete;
@@ -162,6 +165,8 @@ private:
   void doAdd(Pass* pass);
 
   void runPassOnFunction(Pass* pass, Function* func);
+
+  void runPassOnModule(Pass* pass);
 };
 
 //
@@ -205,12 +210,43 @@ public:
   // this will create the parent class.
   virtual Pass* create() { WASM_UNREACHABLE(); }
 
+  // Which cached analyses (see analysis-manager.h) remain valid after this
+  // pass ran. For a function-parallel pass this is called on the instance
+  // that ran on a function, after it ran, so it can depend on what happened
+  // there; for other passes it is called after they ran on the module. By
+  // default nothing is preserved, which is always safe.
+  virtual PreservedAnalyses getPreservedAnalyses() {
+    return PreservedAnalyses::none();
+  }
+
   std::string name;
 
+  PassRunner* getPassRunner() {
+    return runner;
+  }
+
+  PassOptions& getPassOptions() {
+    return runner->options;
+  }
+
+  // Gets a (possibly cached) analysis of a function. It is only valid
+  // until the function is modified.
+  template<typename T>
+  T& getFunctionAnalysis(Function* func) {
+    return runner->analyses.template getFunctionAnalysis<T>(func);
+  }
+
+  void setPassRunner(PassRunner* runner_) {
+    runner = runner_;
+  }
+
 protected:
   Pass() {}
   Pass(Pass &) {}
   Pass &operator=(const Pass&) = delete;
+
+private:
+  PassRunner* runner = nullptr;
 };
 
 //
@@ -219,8 +255,6 @@ protected:
 //
 template <typename WalkerType>
 class WalkerPass : public Pass, public WalkerType {
-  PassRunner *runner;
-
 protected:
   typedef WalkerPass<WalkerType> super;
 
@@ -236,18 +270,6 @@ public:
     WalkerType::setModule(module);
     WalkerType::walkFunction(func);
   }
-
-  PassRunner* getPassRunner() {
-    return runner;
-  }
-
-  PassOptions& getPassOptions() {
-    return runner->options;
-  }
-
-  void setPassRunner(PassRunner* runner_) {
-    runner = runner_;
-  }
 };
 
 // Standard passes. All passes in /passes/ are runnable from the shell,
@@ -264,6 +286,10 @@ public:
   Printer(std::ostream* o) : o(*o) {}
 
   void run(PassRunner* runner, Module* module) override;
+
+  PreservedAnalyses getPreservedAnalyses() override {
+    return PreservedAnalyses::all();
+  }
 };
 
 } // namespace wasm
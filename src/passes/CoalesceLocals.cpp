@@ -33,6 +33,7 @@
 #include "wasm-builder.h"
 #include "support/learning.h"
 #include "support/permutations.h"
+#include "support/sparse_square_matrix.h"
 #ifdef CFG_PROFILE
 #include "support/timing.h"
 #endif
@@ -63,21 +64,31 @@ struct CoalesceLocals : public WalkerPass<LivenessWalker<CoalesceLocals, Visitor
 
   // interference state
 
-  std::vector<bool> interferences; // canonicalized - accesses should check (low, high)
+  SparseSquareMatrix<uint8_t> interferences; // canonicalized - accesses should check (low, high)
+
+  // the same information, as adjacency lists, plus the copies between
+  // locals, which is what the index picking iterates on
+  std::vector<std::vector<Index>> interferenceLists;
+  std::vector<std::vector<std::pair<Index, uint8_t>>> copyLists; // other local, copies
 
   void interfere(Index i, Index j) {
     if (i == j) return;
-    interferences[std::min(i, j) * numLocals + std::max(i, j)] = 1;
+    interfereLowHigh(std::min(i, j), std::max(i, j));
   }
 
   void interfereLowHigh(Index low, Index high) { // optimized version where you know that low < high
     assert(low < high);
-    interferences[low * numLocals + high] = 1;
+    if (interferences.get(low, high)) return;
+    interferences.set(low, high, 1);
+    interferenceLists[low].push_back(high);
+    interferenceLists[high].push_back(low);
   }
 
   bool interferes(Index i, Index j) {
-    return interferences[std::min(i, j) * numLocals + std::max(i, j)];
+    return interferences.get(std::min(i, j), std::max(i, j));
   }
+
+  void calculateCopyLists();
 };
 
 void CoalesceLocals::doWalkFunction(Function* func) {
@@ -86,6 +97,7 @@ void CoalesceLocals::doWalkFunction(Function* func) {
   increaseBackEdgePriorities();
   // use liveness to find interference
   calculateInterferences();
+  calculateCopyLists();
   // pick new indices
   std::vector<Index> indices;
   pickIndices(indices);
@@ -116,8 +128,9 @@ void CoalesceLocals::increaseBackEdgePriorities() {
 }
 
 void CoalesceLocals::calculateInterferences() {
-  interferences.resize(numLocals * numLocals);
-  std::fill(interferences.begin(), interferences.end(), 0);
+  interferences.recreate(numLocals);
+  interferenceLists.clear();
+  interferenceLists.resize(numLocals);
   for (auto& curr : basicBlocks) {
     if (liveBlocks.count(curr.get()) == 0) continue; // ignore dead blocks
     // everything coming in might interfere, as it might come from a different block
@@ -152,14 +165,25 @@ void CoalesceLocals::calculateInterferences() {
 }
 
 void CoalesceLocals::calculateInterferences(const LocalSet& locals) {
-  Index size = locals.size();
+  std::vector<Index> list(locals.begin(), locals.end());
+  Index size = list.size();
   for (Index i = 0; i < size; i++) {
     for (Index j = i + 1; j < size; j++) {
-      interfereLowHigh(locals[i], locals[j]);
+      interfereLowHigh(list[i], list[j]);
     }
   }
 }
 
+void CoalesceLocals::calculateCopyLists() {
+  copyLists.clear();
+  copyLists.resize(numLocals);
+  for (auto& pair : copyPairs) {
+    auto copies = getCopies(pair.first, pair.second);
+    copyLists[pair.first].emplace_back(pair.second, copies);
+    copyLists[pair.second].emplace_back(pair.first, copies);
+  }
+}
+
 // Indices decision making
 
 void CoalesceLocals::pickIndicesFromOrder(std::vector<Index>& order, std::vector<Index>& indices) {
@@ -201,16 +225,26 @@ void CoalesceLocals::pickIndicesFromOrder(std::vector<Index>& order, std::vector
   }
 #endif
   // TODO: take into account distribution (99-1 is better than 50-50 with two registers, for gzip)
+  // We go through the locals in order, giving each the first index that has
+  // the same type and does not interfere, preferring the one eliminating the
+  // most copies. An index interferes with a local if any of the locals
+  // already given that index interferes with it, which we find by looking at
+  // the neighbors in the (sparse) interference graph. The copies of an index
+  // are gathered the same way.
   std::vector<WasmType> types;
-  std::vector<bool> newInterferences; // new index * numLocals => list of all interferences of locals merged to it
-  std::vector<uint8_t> newCopies; // new index * numLocals => list of all copies of locals merged to it
+  std::vector<bool> assigned;
+  std::vector<Index> blocked, copiesValid; // for each new index, the local we last saw
+                                           // it interfere with / have copies with
+  std::vector<uint8_t> newCopies; // for each new index, its copies with the current local
   indices.resize(numLocals);
   types.resize(numLocals);
-  newInterferences.resize(numLocals * numLocals);
-  std::fill(newInterferences.begin(), newInterferences.end(), 0);
+  assigned.resize(numLocals);
+  blocked.resize(numLocals);
+  std::fill(blocked.begin(), blocked.end(), Index(-1));
+  copiesValid.resize(numLocals);
+  std::fill(copiesValid.begin(), copiesValid.end(), Index(-1));
+  newCopies.resize(numLocals);
   auto numParams = getFunction()->getNumParams();
-  newCopies.resize(numParams * numLocals); // start with enough room for the params
-  std::fill(newCopies.begin(), newCopies.end(), 0);
   Index nextFree = 0;
   removedCopies = 0;
   // we can't reorder parameters, they are fixed in order, and cannot coalesce
@@ -219,21 +253,30 @@ void CoalesceLocals::pickIndicesFromOrder(std::vector<Index>& order, std::vector
     assert(order[i] == i); // order must leave the params in place
     indices[i] = i;
     types[i] = getFunction()->getLocalType(i);
-    for (Index j = numParams; j < numLocals; j++) {
-      newInterferences[numLocals * i + j] = interferes(i, j);
-      newCopies[numLocals * i + j] = getCopies(i, j);
-    }
+    assigned[i] = true;
     nextFree++;
   }
   for (; i < numLocals; i++) {
     Index actual = order[i];
+    for (auto other : interferenceLists[actual]) {
+      if (assigned[other]) blocked[indices[other]] = actual;
+    }
+    for (auto& pair : copyLists[actual]) {
+      if (!assigned[pair.first]) continue;
+      auto index = indices[pair.first];
+      if (copiesValid[index] != actual) {
+        copiesValid[index] = actual;
+        newCopies[index] = 0;
+      }
+      newCopies[index] += pair.second;
+    }
     Index found = -1;
     uint8_t foundCopies = -1;
     for (Index j = 0; j < nextFree; j++) {
-      if (!newInterferences[j * numLocals + actual] && getFunction()->getLocalType(actual) == types[j]) {
+      if (blocked[j] != actual && getFunction()->getLocalType(actual) == types[j]) {
         // this does not interfere, so it might be what we want. but pick the one eliminating the most copies
         // (we could stop looking forward when there are no more items that have copies anyhow, but it doesn't seem to help)
-        auto currCopies = newCopies[j * numLocals + actual];
+        auto currCopies = copiesValid[j] == actual ? newCopies[j] : 0;
         if (found == Index(-1) || currCopies > foundCopies) {
           indices[actual] = found = j;
           foundCopies = currCopies;
@@ -245,19 +288,13 @@ void CoalesceLocals::pickIndicesFromOrder(std::vector<Index>& order, std::vector
       types[found] = getFunction()->getLocalType(actual);
       nextFree++;
       removedCopies += getCopies(found, actual);
-      newCopies.resize(nextFree * numLocals);
     } else {
       removedCopies += foundCopies;
     }
+    assigned[actual] = true;
 #if CFG_DEBUG
     std::cerr << "set local $" << actual << " to $" << found << '\n';
 #endif
-    // merge new interferences and copies for the new index
-    for (Index k = i + 1; k < numLocals; k++) {
-      auto j = order[k]; // go in the order, we only need to update for those we will see later
-      newInterferences[found * numLocals + j] = newInterferences[found * numLocals + j] | interferes(actual, j);
-      newCopies[found * numLocals + j] += getCopies(actual, j);
-    }
   }
 }
 
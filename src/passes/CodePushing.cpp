@@ -84,9 +84,10 @@ class Pusher {
   LocalAnalyzer& analyzer;
   std::vector<Index>& numGetsSoFar;
   PassOptions& passOptions;
+  EffectCache& effectCache;
 
 public:
-  Pusher(Block* block, LocalAnalyzer& analyzer, std::vector<Index>& numGetsSoFar, PassOptions& passOptions) : list(block->list), analyzer(analyzer), numGetsSoFar(numGetsSoFar), passOptions(passOptions) {
+  Pusher(Block* block, LocalAnalyzer& analyzer, std::vector<Index>& numGetsSoFar, PassOptions& passOptions, EffectCache& effectCache) : list(block->list), analyzer(analyzer), numGetsSoFar(numGetsSoFar), passOptions(passOptions), effectCache(effectCache) {
     // Find an optimization segment: from the first pushable thing, to the first
     // point past which we want to push. We then push in that range before
     // continuing forward.
@@ -120,7 +121,7 @@ private:
     // but also have no side effects, as it may not execute if pushed.
     if (analyzer.isSFA(index) &&
         numGetsSoFar[index] == analyzer.getNumGets(index) &&
-        !EffectAnalyzer(passOptions, set->value).hasSideEffects()) {
+        !EffectAnalyzer(passOptions, set->value, &effectCache).hasSideEffects()) {
       return set;
     }
     return nullptr;
@@ -147,8 +148,8 @@ private:
     // of earlier ones. Once we know all we can push, we push it all
     // in one pass, keeping the order of the pushables intact.
     assert(firstPushable != Index(-1) && pushPoint != Index(-1) && firstPushable < pushPoint);
-    EffectAnalyzer cumulativeEffects(passOptions); // everything that matters if you want
-                                                   // to be pushed past the pushPoint
+    EffectAnalyzer cumulativeEffects(passOptions, nullptr, &effectCache); // everything that matters if you want
+                                                                          // to be pushed past the pushPoint
     cumulativeEffects.analyze(list[pushPoint]);
     cumulativeEffects.branches = false; // it is ok to ignore the branching here,
                                         // that is the crucial point of this opt
@@ -157,15 +158,7 @@ private:
     while (1) {
       auto* pushable = isPushable(list[i]);
       if (pushable) {
-        auto iter = pushableEffects.find(pushable);
-        if (iter == pushableEffects.end()) {
-          iter = pushableEffects.emplace(
-            std::piecewise_construct,
-            std::forward_as_tuple(pushable),
-            std::forward_as_tuple(passOptions, pushable)
-          ).first;
-        }
-        auto& effects = iter->second;
+        EffectAnalyzer effects(passOptions, pushable, &effectCache);
         if (cumulativeEffects.invalidates(effects)) {
           // we can't push this, so further pushables must pass it
           cumulativeEffects.mergeIn(effects);
@@ -211,9 +204,6 @@ private:
     // proceed right after the push point, we may push the pushed elements again
     return pushPoint - total + 1;
   }
-
-  // Pushables may need to be scanned more than once, so cache their effects.
-  std::unordered_map<SetLocal*, EffectAnalyzer> pushableEffects;
 };
 
 struct CodePushing : public WalkerPass<PostWalker<CodePushing>> {
@@ -226,7 +216,14 @@ struct CodePushing : public WalkerPass<PostWalker<CodePushing>> {
   // gets seen so far in the main traversal
   std::vector<Index> numGetsSoFar;
 
+  // Segments may be scanned more than once, and outer blocks scan what we
+  // already scanned in inner ones, so cache effects. We only ever reorder
+  // block contents, which never invalidates them, so the cache is also
+  // preserved for later passes.
+  EffectCache* effectCache;
+
   void doWalkFunction(Function* func) {
+    effectCache = &getFunctionAnalysis<EffectCache>(func);
     // pre-scan to find which vars are sfa, and also count their gets&sets
     analyzer.analyze(func);
     // prepare to walk
@@ -253,7 +250,11 @@ struct CodePushing : public WalkerPass<PostWalker<CodePushing>> {
     // ordering invalidation issue, since if this isn't a loop, it's fine (we're not
     // used outside), and if it is, we hit the assign before any use (as we can't
     // push it past a use).
-    Pusher pusher(curr, analyzer, numGetsSoFar, getPassOptions());
+    Pusher pusher(curr, analyzer, numGetsSoFar, getPassOptions(), *effectCache);
+  }
+
+  PreservedAnalyses getPreservedAnalyses() override {
+    return PreservedAnalyses().preserve<EffectCache>();
   }
 };
 
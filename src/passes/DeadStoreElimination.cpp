@@ -0,0 +1,170 @@
+/*
+ * Copyright 2017 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// Dead store elimination
+//
+// In each linear area of execution, removes a store when a later store
+// writes the same bytes before anything could have read them:
+//
+//  * We track the stores that were not yet read, using the base+offset
+//    alias analysis in MemoryUtils::Access.
+//  * A load that may alias a store means it was read, as do calls and
+//    atomics, which may read anything.
+//  * Unless we ignore implicit traps, anything that may trap means the
+//    store was read, as the memory is noticeable after a trap. But an
+//    access cannot trap if a store before it, to bytes that end later,
+//    did not; we then keep that store.
+//  * A store that may trap cannot be removed across anything else that is
+//    noticeable, like a write to a global or to other memory, as that
+//    would not have happened had the store trapped. So we stop tracking
+//    it then, unless we ignore implicit traps.
+//  * Writing a local or global that a store's pointer reads means a later
+//    store using the same pointer may write other bytes, so we stop
+//    tracking it.
+//
+// The dead store's children are kept, in drops, for their side effects.
+//
+
+#include <wasm.h>
+#include <wasm-builder.h>
+#include <wasm-traversal.h>
+#include <pass.h>
+#include <ir/effects.h>
+#include <ir/memory-utils.h>
+
+namespace wasm {
+
+struct DeadStoreElimination : public WalkerPass<LinearExecutionWalker<DeadStoreElimination, UnifiedExpressionVisitor<DeadStoreElimination>>> {
+  bool isFunctionParallel() override { return true; }
+
+  Pass* create() override { return new DeadStoreElimination(); }
+
+  // a store that nothing read yet
+  struct Pending {
+    Expression** item;
+    MemoryUtils::Access access;
+    EffectSummary ptrEffects;
+    bool mayTrap;
+
+    Pending(Expression** item, Store* store, const EffectSummary& ptrEffects, bool mayTrap) : item(item), access(store), ptrEffects(ptrEffects), mayTrap(mayTrap) {}
+  };
+
+  std::vector<Pending> pending;
+
+  static void doNoteNonLinear(DeadStoreElimination* self, Expression** currp) {
+    self->pending.clear();
+  }
+
+  void visitExpression(Expression* curr) {
+    EffectAnalyzer effects(getPassOptions());
+    effects.visit(curr);
+    // the bytes this accesses, if we can tell
+    MemoryUtils::Access access;
+    auto* load = curr->dynCast<Load>();
+    auto* store = curr->dynCast<Store>();
+    if (load && !load->isAtomic && isComparable(load->ptr)) {
+      access = MemoryUtils::Access(load);
+    } else if (store && !store->isAtomic && store->type != unreachable && isComparable(store->ptr)) {
+      access = MemoryUtils::Access(store);
+    }
+    bool traps = effects.implicitTrap && !getPassOptions().ignoreImplicitTraps;
+    // whether this store may trap, if we track it
+    bool mayTrap = traps;
+    if (traps && access.isKnown()) {
+      // if a store that did not trap ends after us, we cannot trap either.
+      // that store must then stay, as without it we might trap later,
+      // unless we write the same bytes, and so trap just when it would
+      auto iter = pending.end();
+      if (store) {
+        iter = std::find_if(pending.begin(), pending.end(), [&](Pending& other) {
+          return MemoryUtils::Access::isSame(access, other.access);
+        });
+      }
+      if (iter != pending.end()) {
+        traps = false;
+        mayTrap = iter->mayTrap;
+      } else {
+        iter = std::find_if(pending.begin(), pending.end(), [&](Pending& other) {
+          return !MemoryUtils::Access::mayTrapAfter(other.access, access);
+        });
+        if (iter != pending.end()) {
+          traps = mayTrap = false;
+          pending.erase(iter);
+        }
+      }
+    }
+    if (store && access.isKnown()) {
+      // this overwrites the stores to the same bytes
+      Builder builder(*getModule());
+      removeIf([&](Pending& other) {
+        if (!MemoryUtils::Access::isSame(access, other.access)) return false;
+        auto* dead = (*other.item)->cast<Store>();
+        *other.item = builder.makeSequence(
+          builder.makeDrop(dead->ptr),
+          builder.makeDrop(dead->value)
+        );
+        return true;
+      });
+    }
+    if (effects.calls || effects.isAtomic || traps) {
+      pending.clear();
+    } else if (effects.readsMemory) {
+      if (!load || !access.isKnown()) {
+        pending.clear();
+      } else {
+        removeIf([&](Pending& other) {
+          return MemoryUtils::Access::mayOverlap(access, other.access);
+        });
+      }
+    }
+    if (effects.hasGlobalSideEffects()) {
+      // had a store that may trap done so, this would not have happened
+      removeIf([&](Pending& other) {
+        return other.mayTrap;
+      });
+    }
+    if (!effects.localsWritten.empty() || !effects.globalsWritten.empty()) {
+      removeIf([&](Pending& other) {
+        return effects.localsWritten.intersects(other.ptrEffects.localsRead) ||
+               effects.globalsWritten.intersects(other.ptrEffects.globalsRead);
+      });
+    }
+    if (store && access.isKnown()) {
+      pending.emplace_back(getCurrentPointer(), store, EffectAnalyzer(getPassOptions(), store->ptr), mayTrap);
+    }
+  }
+
+  bool isComparable(Expression* ptr) {
+    return MemoryUtils::Access::isComparable(EffectAnalyzer(getPassOptions(), ptr));
+  }
+
+  template<typename T>
+  void removeIf(T pred) {
+    pending.erase(std::remove_if(pending.begin(), pending.end(), pred), pending.end());
+  }
+
+  void doWalkFunction(Function* func) {
+    walk(func->body);
+    pending.clear();
+  }
+};
+
+Pass *createDeadStoreEliminationPass() {
+  return new DeadStoreElimination();
+}
+
+} // namespace wasm
@@ -0,0 +1,253 @@
+/*
+ * Copyright 2017 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// Turns indirect calls into direct ones, which can then be inlined.
+//
+// That is possible when we know what is in the table: it is not imported
+// or exported, so nothing outside can change it, and its segments have
+// constant offsets. A call_indirect through a constant index is then a
+// call of the function there, or a trap if there is none, or it has the
+// wrong type.
+//
+// A call_indirect through an index that can only be one of a few
+// constants, because all the sets of the local it reads are constants, or
+// it is a select between two constants, becomes a chain of ifs, with a
+// direct call in each arm:
+//
+//  (call_indirect (type $T) (get_local $x) (get_local $i))
+//   =>
+//  (if (i32.eq (get_local $i) (i32.const 1))
+//   (call $a (get_local $x))
+//   (call $b (get_local $x))
+//  )
+//
+// That makes the code bigger, so it is only done when not optimizing for
+// size, unless all the possible indexes lead to the same function.
+//
+
+#include <algorithm>
+
+#include <wasm.h>
+#include <pass.h>
+#include <asm_v_wasm.h>
+#include <wasm-builder.h>
+#include <ir/effects.h>
+#include <ir/literal-utils.h>
+#include <ir/local-graph.h>
+#include <ir/utils.h>
+
+namespace wasm {
+
+// The most different functions we call through a chain of ifs
+static const Index MAX_TARGETS = 4;
+
+// The known contents of the table: the function at each index, or a null
+// name where there is none
+typedef std::vector<Name> TableContents;
+
+struct FunctionDirectizer : public WalkerPass<PostWalker<FunctionDirectizer>> {
+  bool isFunctionParallel() override { return true; }
+
+  FunctionDirectizer(TableContents* table) : table(table) {}
+
+  FunctionDirectizer* create() override {
+    return new FunctionDirectizer(table);
+  }
+
+  void visitCallIndirect(CallIndirect* curr) {
+    if (curr->type == unreachable) return;
+    std::vector<uint32_t> indexes;
+    if (!getPossibleIndexes(curr->target, indexes)) return;
+    // the functions to call, in order of their lowest index, and the
+    // indexes that lead to each one
+    std::vector<Name> targets;
+    std::vector<std::vector<uint32_t>> indexesForTarget;
+    for (auto index : indexes) {
+      auto target = getTarget(index, curr);
+      auto iter = std::find(targets.begin(), targets.end(), target);
+      if (iter == targets.end()) {
+        targets.push_back(target);
+        indexesForTarget.emplace_back();
+        iter = targets.end() - 1;
+      }
+      indexesForTarget[iter - targets.begin()].push_back(index);
+    }
+    if (targets.size() > 1 && (getPassOptions().shrinkLevel > 0 || targets.size() > MAX_TARGETS)) return;
+    Builder builder(*getModule());
+    if (targets.size() == 1 && !EffectAnalyzer(getPassOptions(), curr->target).hasSideEffects()) {
+      // we don't need the index, and the operands can stay where they are
+      std::vector<Expression*> operands;
+      for (auto* operand : curr->operands) {
+        operands.push_back(operand);
+      }
+      replaceCurrent(makeDirectCall(targets[0], operands, curr->type));
+      worked = true;
+      return;
+    }
+    // evaluate the operands and then the index, as the call_indirect
+    // would, and then pick the call
+    auto* func = getFunction();
+    auto* block = builder.makeBlock();
+    std::vector<Expression*> operands;
+    for (auto* operand : curr->operands) {
+      auto temp = builder.addVar(func, operand->type);
+      block->list.push_back(builder.makeSetLocal(temp, operand));
+      operands.push_back(builder.makeGetLocal(temp, operand->type));
+    }
+    auto index = builder.addVar(func, i32);
+    block->list.push_back(builder.makeSetLocal(index, curr->target));
+    Expression* chain = makeDirectCall(targets.back(), operands, curr->type);
+    for (Index i = targets.size() - 1; i > 0; i--) {
+      Expression* condition = nullptr;
+      for (auto value : indexesForTarget[i - 1]) {
+        auto* check = builder.makeBinary(EqInt32, builder.makeGetLocal(index, i32), builder.makeConst(Literal(int32_t(value))));
+        condition = condition ? builder.makeBinary(OrInt32, condition, check) : check;
+      }
+      std::vector<Expression*> copies;
+      for (auto* operand : operands) {
+        copies.push_back(builder.makeGetLocal(operand->cast<GetLocal>()->index, operand->type));
+      }
+      chain = builder.makeIf(condition, makeDirectCall(targets[i - 1], copies, curr->type), chain);
+    }
+    block->list.push_back(chain);
+    block->finalize(curr->type);
+    replaceCurrent(block);
+    worked = true;
+  }
+
+  void visitFunction(Function* curr) {
+    // calls that trap are unreachable
+    if (worked) {
+      ReFinalize().walkFunctionInModule(curr, getModule());
+    }
+  }
+
+  PreservedAnalyses getPreservedAnalyses() override {
+    return worked ? PreservedAnalyses::none() : PreservedAnalyses::all();
+  }
+
+private:
+  TableContents* table;
+  bool worked = false;
+
+  // Finds all the values an index can have, if there are few of them and
+  // we can tell what they are.
+  bool getPossibleIndexes(Expression* curr, std::vector<uint32_t>& indexes) {
+    std::vector<Literal> values;
+    if (auto* c = curr->dynCast<Const>()) {
+      values.push_back(c->value);
+    } else if (auto* select = curr->dynCast<Select>()) {
+      auto* ifTrue = select->ifTrue->dynCast<Const>();
+      auto* ifFalse = select->ifFalse->dynCast<Const>();
+      if (!ifTrue || !ifFalse) return false;
+      values.push_back(ifTrue->value);
+      values.push_back(ifFalse->value);
+    } else if (auto* get = curr->dynCast<GetLocal>()) {
+      auto& graph = getFunctionAnalysis<LocalGraph>(getFunction());
+      for (auto* set : graph.getSetses[get]) {
+        if (!set) {
+          // the initial value, which we know for a var
+          if (getFunction()->isParam(get->index)) return false;
+          values.push_back(LiteralUtils::makeLiteralZero(i32));
+        } else if (auto* c = set->value->dynCast<Const>()) {
+          values.push_back(c->value);
+        } else {
+          return false;
+        }
+      }
+    } else {
+      return false;
+    }
+    for (auto& value : values) {
+      auto index = uint32_t(value.geti32());
+      if (std::find(indexes.begin(), indexes.end(), index) == indexes.end()) {
+        indexes.push_back(index);
+      }
+    }
+    // the sets of a local are in no useful order, so sort, for the output
+    // to be deterministic
+    std::sort(indexes.begin(), indexes.end());
+    return !indexes.empty() && indexes.size() <= MAX_TARGETS;
+  }
+
+  // The function a call_indirect through an index calls, or a null name
+  // if it traps.
+  Name getTarget(uint32_t index, CallIndirect* curr) {
+    if (index >= table->size()) return Name();
+    auto name = (*table)[index];
+    if (!name.is()) return Name();
+    auto* module = getModule();
+    auto sig = getSig(module->getFunctionType(curr->fullType));
+    if (auto* func = module->getFunctionOrNull(name)) {
+      if (getSig(func) == sig) return name;
+    } else if (auto* import = module->getImportOrNull(name)) {
+      if (import->kind == ExternalKind::Function && getSig(module->getFunctionType(import->functionType)) == sig) return name;
+    }
+    return Name();
+  }
+
+  Expression* makeDirectCall(Name target, std::vector<Expression*>& operands, WasmType type) {
+    Builder builder(*getModule());
+    if (!target.is()) {
+      // this traps, after the operands are evaluated
+      auto* block = builder.makeBlock();
+      for (auto* operand : operands) {
+        block->list.push_back(builder.makeDrop(operand));
+      }
+      block->list.push_back(builder.makeUnreachable());
+      block->finalize();
+      return block;
+    }
+    if (getModule()->getFunctionOrNull(target)) {
+      return builder.makeCall(target, operands, type);
+    }
+    return builder.makeCallImport(target, operands, type);
+  }
+};
+
+struct Directize : public Pass {
+  void run(PassRunner* runner, Module* module) override {
+    auto& table = module->table;
+    if (!table.exists || table.imported) return;
+    for (auto& ex : module->exports) {
+      if (ex->kind == ExternalKind::Table) return;
+    }
+    TableContents contents;
+    for (auto& segment : table.segments) {
+      auto* offset = segment.offset->dynCast<Const>();
+      if (!offset) return;
+      auto start = uint32_t(offset->value.geti32());
+      if (uint64_t(start) + segment.data.size() > table.initial) return; // invalid, leave it
+      if (contents.size() < start + segment.data.size()) {
+        contents.resize(start + segment.data.size());
+      }
+      for (Index i = 0; i < segment.data.size(); i++) {
+        contents[start + i] = segment.data[i];
+      }
+    }
+    PassRunner directizer(module, runner->options);
+    directizer.setIsNested(true);
+    directizer.add<FunctionDirectizer>(&contents);
+    directizer.run();
+  }
+};
+
+Pass *createDirectizePass() {
+  return new Directize();
+}
+
+} // namespace wasm
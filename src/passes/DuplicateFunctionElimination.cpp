@@ -30,34 +30,26 @@ namespace wasm {
 struct FunctionHasher : public WalkerPass<PostWalker<FunctionHasher>> {
   bool isFunctionParallel() override { return true; }
 
-  FunctionHasher(std::map<Function*, uint32_t>* output) : output(output) {}
+  FunctionHasher(std::map<Function*, uint64_t>* output) : output(output) {}
 
   FunctionHasher* create() override {
     return new FunctionHasher(output);
   }
 
   void doWalkFunction(Function* func) {
-    assert(digest == 0);
-    hash(func->getNumParams());
-    for (auto type : func->params) hash(type);
-    hash(func->getNumVars());
-    for (auto type : func->vars) hash(type);
-    hash(func->result);
-    hash64(func->type.is() ? uint64_t(func->type.str) : uint64_t(0));
-    hash(ExpressionAnalyzer::hash(func->body));
-    output->at(func) = digest;
+    Hasher64 hasher;
+    hasher.add(func->getNumParams());
+    for (auto type : func->params) hasher.add(type);
+    hasher.add(func->getNumVars());
+    for (auto type : func->vars) hasher.add(type);
+    hasher.add(func->result);
+    hasher.addString(func->type.is() ? func->type.str : nullptr);
+    hasher.add(ExpressionAnalyzer::hash(func->body));
+    output->at(func) = hasher.finish();
   }
 
 private:
-  std::map<Function*, uint32_t>* output;
-  uint32_t digest = 0;
-
-  void hash(uint32_t hash) {
-    digest = rehash(digest, hash);
-  }
-  void hash64(uint64_t hash) {
-    digest = rehash(rehash(digest, uint32_t(hash >> 32)), uint32_t(hash));
-  };
+  std::map<Function*, uint64_t>* output;
 };
 
 struct FunctionReplacer : public WalkerPass<PostWalker<FunctionReplacer>> {
@@ -93,7 +85,7 @@ struct DuplicateFunctionElimination : public Pass {
       hasherRunner.add<FunctionHasher>(&hashes);
       hasherRunner.run();
       // Find hash-equal groups
-      std::map<uint32_t, std::vector<Function*>> hashGroups;
+      std::map<uint64_t, std::vector<Function*>> hashGroups;
       for (auto& func : module->functions) {
         hashGroups[hashes[func.get()]].push_back(func.get());
       }
@@ -165,7 +157,7 @@ struct DuplicateFunctionElimination : public Pass {
   }
 
 private:
-  std::map<Function*, uint32_t> hashes;
+  std::map<Function*, uint64_t> hashes;
 
   bool equal(Function* left, Function* right) {
     if (left->getNumParams() != right->getNumParams()) return false;
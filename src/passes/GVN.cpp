@@ -0,0 +1,601 @@
+/*
+ * Copyright 2017 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// Global value numbering
+//
+// Like LocalCSE, finds pure expressions (and loads) that compute a value
+// that was already computed, and reuses the earlier value through a local,
+// but across the whole function and not just in linear traces.
+//
+// An earlier expression can be reused if it dominates the later one and
+// nothing on any path between them may have changed its value. In wasm's
+// structured control flow, dominance follows the nesting: code dominates
+// what executes after it in the same block, and what is nested in that,
+// until the end of a block that is branched to (the branches may skip it).
+// So we walk the function in execution order, keeping a table of the
+// values that are available, which is scoped: what is computed in an arm
+// of an if is forgotten when leaving the arm, and the same for the contents
+// of blocks that are branched to. Effects invalidate values as in LocalCSE,
+// and when leaving a scope (or entering a loop, for the effects of later
+// iterations) values are invalidated by the effects of the entire scope.
+//
+// A value computed in both arms of an if is available after the if, too,
+// if both write the same local (which is a simple form of partial
+// redundancy elimination, for values that are redundant on each path).
+//
+// Loads and other expressions that may trap are fine to reuse: if the first
+// did not trap, neither would the later one.
+//
+// Loads are looked up by the bytes they read, so a load can also reuse the
+// value that a store wrote (store-to-load forwarding), and loads of the same
+// bytes with different alignments or (for full-width loads) signs match.
+// Stores only invalidate the loads they may alias, using the base+offset
+// analysis in MemoryUtils::Access: accesses at constant addresses, or at
+// different offsets from the same pointer, are known to be distinct.
+//
+
+#include <wasm.h>
+#include <wasm-builder.h>
+#include <wasm-traversal.h>
+#include <pass.h>
+#include <ir/effects.h>
+#include <ir/hashed.h>
+#include <ir/memory-utils.h>
+
+namespace wasm {
+
+static const Index UNUSED = -1;
+
+// above this many stores in a scope, we don't check which loads they alias
+static const Index MAX_STORES = 100;
+
+struct GVN : public WalkerPass<PostWalker<GVN>> {
+  bool isFunctionParallel() override { return true; }
+
+  Pass* create() override { return new GVN(); }
+
+  // a place where a value is computed
+  struct Occurrence {
+    Expression** item;
+    bool written = false; // whether it writes the local already
+
+    Occurrence(Expression** item) : item(item) {}
+  };
+
+  // a value we can reuse
+  struct Value {
+    std::vector<Occurrence> occurrences; // one of which computed it, on any path here
+    Index index = UNUSED; // if not UNUSED, the local that the occurrences write
+    EffectSummary effects;
+    MemoryUtils::Access access; // for a load, the bytes it reads, if we can tell
+    Index added; // the position in the log where this was added
+  };
+
+  // the available values
+  HashedExpressionMap<Value> values;
+
+  // a log of the changes to the values, so that we can undo them when
+  // leaving a scope
+  struct Change {
+    HashedExpression key;
+    bool added; // if not, this removed the previous value
+    Value previous;
+
+    Change(HashedExpression key) : key(key), added(true) {}
+    Change(HashedExpression key, const Value& previous) : key(key), added(false), previous(previous) {}
+  };
+
+  std::vector<Change> log;
+
+  // the values that read each local, memory, and globals, so that we can
+  // invalidate them quickly. these may contain values that are no longer
+  // available
+  std::vector<std::vector<HashedExpression>> localReaders;
+  std::vector<HashedExpression> memoryReaders, globalReaders;
+
+  // the effects of entire scopes, computed before we modify anything
+  struct ScopeEffects {
+    EffectSummary first, second; // if arms, or a loop body or block in first
+    std::pair<Index, Index> firstStores, secondStores; // their ranges in stores
+  };
+
+  std::unordered_map<Expression*, ScopeEffects> scopeEffects;
+
+  std::set<Name> branchTargets;
+
+  // the accesses of all the stores, in post-order
+  std::vector<MemoryUtils::Access> stores;
+
+  // the hashes of the subtrees we have seen
+  ExpressionAnalyzer::SubtreeHashes hashes;
+
+  // the expression containing each one we have seen, so that we can find
+  // the hashes that a change invalidates
+  std::unordered_map<Expression*, Expression*> parents;
+
+  // the effects of the subtrees we have seen
+  std::unique_ptr<EffectCache> effectCache;
+
+  // the expressions we are in, and the size of the log when we entered them
+  std::vector<Expression*> expressionStack;
+  std::vector<Index> logStack;
+
+  struct IfState {
+    bool reversed; // whether we process ifFalse first
+    Index mark;
+    std::vector<std::pair<HashedExpression, Value>> firstValues; // added in the first arm
+  };
+
+  std::vector<IfState> ifStack;
+  std::vector<Index> blockStack;
+
+  void doWalkFunction(Function* func) {
+    scanScopes(func);
+    effectCache = make_unique<EffectCache>(getPassOptions());
+    walk(func->body);
+    values.clear();
+    log.clear();
+    localReaders.clear();
+    memoryReaders.clear();
+    globalReaders.clear();
+    scopeEffects.clear();
+    branchTargets.clear();
+    stores.clear();
+    hashes.clear();
+    parents.clear();
+    effectCache.reset();
+  }
+
+  void scanScopes(Function* func) {
+    struct ScopeScanner : public PostWalker<ScopeScanner> {
+      GVN* parent;
+      EffectCache cache;
+      std::vector<Index> marks; // positions in stores where scopes start
+
+      ScopeScanner(GVN* parent) : parent(parent), cache(parent->getPassOptions()) {}
+
+      // mark where each scope, and the arms of ifs, start
+      static void scan(ScopeScanner* self, Expression** currp) {
+        if (auto* iff = (*currp)->dynCast<If>()) {
+          self->pushTask(doVisitIf, currp);
+          if (iff->ifFalse) self->pushTask(scan, &iff->ifFalse);
+          self->pushTask(doMark, currp);
+          self->pushTask(scan, &iff->ifTrue);
+          self->pushTask(doMark, currp);
+          self->pushTask(scan, &iff->condition);
+          return;
+        }
+        PostWalker<ScopeScanner>::scan(self, currp);
+        if ((*currp)->is<Block>() || (*currp)->is<Loop>()) {
+          self->pushTask(doMark, currp);
+        }
+      }
+
+      static void doMark(ScopeScanner* self, Expression** currp) {
+        self->marks.push_back(self->parent->stores.size());
+      }
+
+      std::pair<Index, Index> popRange() {
+        auto begin = marks.back();
+        marks.pop_back();
+        return std::make_pair(begin, Index(parent->stores.size()));
+      }
+
+      EffectSummary get(Expression* curr) {
+        auto ret = cache.get(curr);
+        // branching does not change values
+        ret.branches = false;
+        return ret;
+      }
+
+      void visitBreak(Break* curr) {
+        parent->branchTargets.insert(curr->name);
+      }
+      void visitSwitch(Switch* curr) {
+        for (auto target : curr->targets) {
+          parent->branchTargets.insert(target);
+        }
+        parent->branchTargets.insert(curr->default_);
+      }
+      void visitStore(Store* curr) {
+        parent->stores.push_back(parent->getAccess(curr, cache));
+      }
+      void visitBlock(Block* curr) {
+        auto range = popRange();
+        // inner scopes were visited first, so this reuses their effects
+        if (curr->name.is() && parent->branchTargets.count(curr->name)) {
+          auto& effects = parent->scopeEffects[curr];
+          effects.first = get(curr);
+          effects.firstStores = range;
+        }
+      }
+      void visitIf(If* curr) {
+        auto& effects = parent->scopeEffects[curr];
+        effects.secondStores = popRange();
+        effects.firstStores = popRange();
+        effects.firstStores.second = effects.secondStores.first;
+        effects.first = get(curr->ifTrue);
+        if (curr->ifFalse) effects.second = get(curr->ifFalse);
+      }
+      void visitLoop(Loop* curr) {
+        auto& effects = parent->scopeEffects[curr];
+        effects.first = get(curr->body);
+        effects.firstStores = popRange();
+      }
+    };
+    ScopeScanner scanner(this);
+    scanner.walk(func->body);
+  }
+
+  // override scan to add pre and post tasks to all nodes, and to handle
+  // the scopes of control flow
+  static void scan(GVN* self, Expression** currp) {
+    auto* curr = *currp;
+    self->pushTask(visitPost, currp);
+    if (auto* iff = curr->dynCast<If>()) {
+      auto** first = &iff->ifTrue;
+      auto** second = &iff->ifFalse;
+      if (isReversed(iff)) std::swap(first, second);
+      self->pushTask(doEndIf, currp);
+      if (*second) self->pushTask(scan, second);
+      self->pushTask(doMiddleIf, currp);
+      self->pushTask(scan, first);
+      self->pushTask(doStartIf, currp);
+      self->pushTask(scan, &iff->condition);
+    } else if (auto* loop = curr->dynCast<Loop>()) {
+      self->pushTask(scan, &loop->body);
+      self->pushTask(doStartLoop, currp);
+    } else if (self->isBranchTarget(curr)) {
+      self->pushTask(doEndBlock, currp);
+      auto& list = curr->cast<Block>()->list;
+      for (int i = int(list.size()) - 1; i >= 0; i--) {
+        self->pushTask(scan, &list[i]);
+      }
+      self->pushTask(doStartBlock, currp);
+    } else {
+      super::scan(self, currp);
+    }
+    self->pushTask(visitPre, currp);
+  }
+
+  bool isBranchTarget(Expression* curr) {
+    auto* block = curr->dynCast<Block>();
+    return block && block->name.is() && branchTargets.count(block->name);
+  }
+
+  // We process an arm that cannot fall through first, so that the state at
+  // the end of the other one is what is available after the if.
+  static bool isReversed(If* iff) {
+    return iff->ifFalse && iff->ifFalse->type == unreachable && iff->ifTrue->type != unreachable;
+  }
+
+  static void visitPre(GVN* self, Expression** currp) {
+    self->parents[*currp] = self->expressionStack.empty() ? nullptr : self->expressionStack.back();
+    self->expressionStack.push_back(*currp);
+    self->logStack.push_back(self->log.size());
+  }
+
+  static void visitPost(GVN* self, Expression** currp) {
+    auto* curr = *currp;
+    self->expressionStack.pop_back();
+    auto mark = self->logStack.back();
+    self->logStack.pop_back();
+    if (self->isRelevant(curr)) {
+      self->handle(currp, curr, mark);
+    }
+    // invalidate what this node itself changes
+    EffectAnalyzer effects(self->getPassOptions());
+    effects.visit(*currp);
+    if (effects.hasGlobalSideEffects() || !effects.localsWritten.empty()) {
+      if (auto* store = curr->dynCast<Store>()) {
+        auto access = self->getAccess(store, *self->effectCache);
+        self->invalidate(effects, &access, 1);
+        self->forward(store);
+      } else {
+        self->invalidate(effects);
+      }
+    }
+  }
+
+  static void doStartIf(GVN* self, Expression** currp) {
+    self->ifStack.emplace_back();
+    auto& state = self->ifStack.back();
+    state.reversed = isReversed((*currp)->cast<If>());
+    state.mark = self->log.size();
+  }
+
+  static void doMiddleIf(GVN* self, Expression** currp) {
+    auto* iff = (*currp)->cast<If>();
+    auto& state = self->ifStack.back();
+    auto* first = state.reversed ? iff->ifFalse : iff->ifTrue;
+    auto* second = state.reversed ? iff->ifTrue : iff->ifFalse;
+    if (first->type != unreachable && second && second->type != unreachable) {
+      self->forEachAddedSince(state.mark, [&](const HashedExpression& key, Value& value) {
+        state.firstValues.emplace_back(key, value);
+      });
+    }
+    // the second arm starts from what was available before the first
+    self->undo(state.mark);
+  }
+
+  static void doEndIf(GVN* self, Expression** currp) {
+    auto* iff = (*currp)->cast<If>();
+    auto& state = self->ifStack.back();
+    auto* first = state.reversed ? iff->ifFalse : iff->ifTrue;
+    auto* second = state.reversed ? iff->ifTrue : iff->ifFalse;
+    auto& effects = self->scopeEffects[iff];
+    if (first->type == unreachable) {
+      // we can only get here through the second arm, if there is one, and
+      // what is available is what was at its end
+    } else if (!second) {
+      self->invalidate(effects.first, effects.firstStores);
+    } else {
+      // we may get here from either arm. values that were computed in both
+      // remain available, if both copies write the same local
+      HashedExpressionMap<Value> secondValues;
+      self->forEachAddedSince(state.mark, [&](const HashedExpression& key, Value& value) {
+        secondValues.emplace(key, value);
+      });
+      self->undo(state.mark);
+      self->invalidate(effects.first, effects.firstStores);
+      self->invalidate(effects.second, effects.secondStores);
+      for (auto& pair : state.firstValues) {
+        auto iter = secondValues.find(pair.first);
+        if (iter == secondValues.end()) continue;
+        auto& firstValue = pair.second;
+        auto& secondValue = iter->second;
+        if (firstValue.index != UNUSED && secondValue.index != UNUSED && firstValue.index != secondValue.index) {
+          continue;
+        }
+        Value merged;
+        merged.occurrences = firstValue.occurrences;
+        merged.occurrences.insert(merged.occurrences.end(), secondValue.occurrences.begin(), secondValue.occurrences.end());
+        merged.index = firstValue.index != UNUSED ? firstValue.index : secondValue.index;
+        merged.effects = secondValue.effects;
+        merged.access = secondValue.access;
+        self->add(pair.first, merged);
+      }
+    }
+    self->ifStack.pop_back();
+  }
+
+  static void doStartLoop(GVN* self, Expression** currp) {
+    // later iterations may change things before we get back here
+    auto& effects = self->scopeEffects[*currp];
+    self->invalidate(effects.first, effects.firstStores);
+  }
+
+  static void doStartBlock(GVN* self, Expression** currp) {
+    self->blockStack.push_back(self->log.size());
+  }
+
+  static void doEndBlock(GVN* self, Expression** currp) {
+    // branches may have skipped anything in the block
+    self->undo(self->blockStack.back());
+    self->blockStack.pop_back();
+    auto& effects = self->scopeEffects[*currp];
+    self->invalidate(effects.first, effects.firstStores);
+  }
+
+  bool isRelevant(Expression* curr) {
+    if (!isConcreteWasmType(curr->type)) {
+      return false; // don't bother with unreachable etc.
+    }
+    if (curr->is<GetLocal>() || curr->is<Const>() || curr->is<GetGlobal>()) {
+      return false; // trivial, or what we optimize to
+    }
+    if (curr->is<Block>() || curr->is<If>() || curr->is<Loop>()) {
+      return false; // control flow structures are scopes, not values
+    }
+    auto& effects = effectCache->get(curr);
+    // we can't reuse things with side effects, but see above about traps
+    return !effects.hasGlobalSideEffects() && effects.localsWritten.empty() && !effects.branches && !effects.hasExternalBreakTargets();
+  }
+
+  void handle(Expression** currp, Expression* curr, Index mark) {
+    auto* key = curr;
+    if (auto* load = curr->dynCast<Load>()) {
+      bool signed_ = load->signed_ && load->bytes < getWasmTypeSize(load->type);
+      key = makeLoadKey(load->bytes, signed_, load->offset, load->ptr, load->type);
+    }
+    HashedExpression hashed(key, ExpressionAnalyzer::hash(key, hashes));
+    auto iter = values.find(hashed);
+    if (iter != values.end()) {
+      // already available, reuse it
+      auto& value = iter->second;
+      if (value.index == UNUSED) {
+        value.index = Builder::addVar(getFunction(), curr->type);
+      }
+      for (auto& occurrence : value.occurrences) {
+        if (occurrence.written) continue;
+        auto* item = *occurrence.item;
+        *occurrence.item = Builder(*getModule()).makeTeeLocal(value.index, item);
+        occurrence.written = true;
+        // the hashes of the expressions containing it are no longer valid
+        for (auto* parent = parents[item]; parent; parent = parents[parent]) {
+          hashes.erase(parent);
+        }
+      }
+      replaceCurrent(
+        Builder(*getModule()).makeGetLocal(value.index, curr->type)
+      );
+      // values we found inside the expression we just removed are gone
+      forEachAddedSince(mark, [&](const HashedExpression& key, Value& value) {
+        remove(key);
+      });
+    } else {
+      // not available yet, add it, maybe we can help others later
+      Value value;
+      value.occurrences.emplace_back(currp);
+      value.effects = effectCache->get(curr);
+      value.effects.implicitTrap = false; // see above
+      if (auto* load = curr->dynCast<Load>()) {
+        if (MemoryUtils::Access::isComparable(effectCache->get(load->ptr))) {
+          value.access = MemoryUtils::Access(load);
+        }
+      }
+      add(hashed, value);
+    }
+  }
+
+  // after a store, a load of the same bytes would read the stored value
+  void forward(Store* store) {
+    auto type = store->valueType;
+    if (store->isAtomic || store->value->type != type || store->bytes != getWasmTypeSize(type)) {
+      return;
+    }
+    auto ptrEffects = effectCache->get(store->ptr);
+    if (!MemoryUtils::Access::isComparable(ptrEffects)) return;
+    auto* key = makeLoadKey(store->bytes, false, store->offset, store->ptr, type);
+    HashedExpression hashed(key, ExpressionAnalyzer::hash(key, hashes));
+    Value value;
+    value.occurrences.emplace_back(&store->value);
+    parents[store->value] = store; // it may be new, if we replaced it
+    // the value is valid while the pointer and the stored bytes are
+    value.effects = ptrEffects;
+    value.effects.implicitTrap = false;
+    value.effects.readsMemory = true;
+    value.access = MemoryUtils::Access(store);
+    add(hashed, value);
+  }
+
+  // Loads of the same bytes read the same value, whatever their alignment,
+  // and the sign does not matter if they read all the bytes of the type, so
+  // we look them up by a normalized copy (which shares the pointer).
+  Expression* makeLoadKey(Index bytes, bool signed_, Address offset, Expression* ptr, WasmType type) {
+    return Builder(*getModule()).makeLoad(bytes, signed_, offset, bytes, ptr, type);
+  }
+
+  MemoryUtils::Access getAccess(Store* store, EffectCache& cache) {
+    if (!MemoryUtils::Access::isComparable(cache.get(store->ptr))) return MemoryUtils::Access();
+    return MemoryUtils::Access(store);
+  }
+
+  // changes to the available values
+
+  void add(const HashedExpression& key, const Value& value) {
+    auto result = values.emplace(key, value);
+    if (!result.second) return;
+    auto& added = result.first->second;
+    added.added = log.size();
+    log.emplace_back(key);
+    noteReaders(key, added.effects);
+  }
+
+  void remove(const HashedExpression& key) {
+    auto iter = values.find(key);
+    if (iter == values.end()) return;
+    log.emplace_back(iter->first, iter->second);
+    values.erase(iter);
+  }
+
+  void undo(Index mark) {
+    while (log.size() > mark) {
+      auto& change = log.back();
+      if (change.added) {
+        values.erase(change.key);
+      } else {
+        auto& restored = values.emplace(change.key, change.previous).first->second;
+        noteReaders(change.key, restored.effects);
+      }
+      log.pop_back();
+    }
+  }
+
+  // calls func on the values added since a position in the log that are
+  // still available
+  template<typename T>
+  void forEachAddedSince(Index mark, T func) {
+    auto end = log.size();
+    for (auto i = mark; i < end; i++) {
+      if (!log[i].added) continue;
+      auto key = log[i].key;
+      auto iter = values.find(key);
+      if (iter != values.end() && iter->second.added == i) {
+        func(key, iter->second);
+      }
+    }
+  }
+
+  void noteReaders(const HashedExpression& key, EffectSummary& effects) {
+    effects.localsRead.forEach([&](Index i) {
+      if (i >= localReaders.size()) localReaders.resize(i + 1);
+      localReaders[i].push_back(key);
+    });
+    if (effects.readsMemory) memoryReaders.push_back(key);
+    if (effects.accessesGlobal()) globalReaders.push_back(key);
+  }
+
+  void invalidate(EffectSummary& effects, std::pair<Index, Index> storeRange) {
+    invalidate(effects, stores.data() + storeRange.first, storeRange.second - storeRange.first);
+  }
+
+  // removes the values that effects invalidate. if the effects write
+  // memory, the accesses of all the stores they contain must be given
+  void invalidate(EffectSummary& effects, const MemoryUtils::Access* accesses = nullptr, Index numAccesses = 0) {
+    effects.localsWritten.forEach([&](Index i) {
+      if (i >= localReaders.size()) return;
+      for (auto& key : localReaders[i]) {
+        remove(key);
+      }
+      localReaders[i].clear();
+    });
+    if (effects.calls || effects.isAtomic || (effects.writesMemory && (numAccesses == 0 || numAccesses > MAX_STORES))) {
+      for (auto& key : memoryReaders) {
+        remove(key);
+      }
+      memoryReaders.clear();
+    } else if (effects.writesMemory) {
+      // only remove the loads that the stores may alias
+      std::vector<HashedExpression> remaining;
+      for (auto& key : memoryReaders) {
+        auto iter = values.find(key);
+        if (iter == values.end()) continue;
+        auto& access = iter->second.access;
+        bool aliased = !access.isKnown();
+        for (Index i = 0; i < numAccesses && !aliased; i++) {
+          aliased = MemoryUtils::Access::mayOverlap(access, accesses[i]);
+        }
+        if (aliased) {
+          remove(key);
+        } else {
+          remaining.push_back(key);
+        }
+      }
+      memoryReaders.swap(remaining);
+    }
+    if (effects.calls || !effects.globalsWritten.empty()) {
+      std::vector<HashedExpression> remaining;
+      for (auto& key : globalReaders) {
+        auto iter = values.find(key);
+        if (iter == values.end()) continue;
+        if (effects.invalidates(iter->second.effects)) {
+          remove(key);
+        } else {
+          remaining.push_back(key);
+        }
+      }
+      globalReaders.swap(remaining);
+    }
+  }
+};
+
+Pass *createGVNPass() {
+  return new GVN();
+}
+
+} // namespace wasm
@@ -17,55 +17,116 @@
 //
 // Inlining.
 //
-// By default, this does a conservative inlining of all functions that have
-// exactly one use, and are fairly small. That should not increase code
-// size, and may have speed benefits.
+// Each call site gets an estimated benefit, the time saved by not making
+// the call: the overhead of the call itself, as measured by CostAnalyzer,
+// plus a bonus for constant arguments, which precompute can then
+// propagate into the inlined code. That is multiplied by how often the
+// call site runs. The cost is how much the code grows. We inline the call
+// sites with the most benefit for their size first, until a global budget
+// for growth is used up. Inlining that doesn't grow the code, like
+// inlining a function into its only caller, which then removes it, or
+// inlining a function that is no bigger than a call, is always done,
+// unless the function is so big that it would make a huge one.
 //
-// When opt level is 3+ (-O3 or above), we more aggressively inline
-// even functions with more than one use, that seem to be "lightweight"
-// (no loops or calls etc.), so inlining them may get rid of call overhead
-// that would be noticeable otherwise
+// When opt level is 3+ (-O3 or above), and we are not focusing on size,
+// the budget lets the code grow a little. Otherwise, there is none.
+//
+// How often a call site runs is estimated from its loop depth, unless a
+// profile is provided with --pass-arg=inlining-profile@FILE. Each line of
+// it is
+//
+//   CALLER CALLEE COUNT
+//
+// which means CALLER called CALLEE COUNT times, split evenly among the call
+// sites. Calls not in the profile are considered cold, and are only
+// inlined when that doesn't grow the code.
+//
+// When we may grow the code, functions that are too big to inline but
+// begin with a cheap early exit, like
+//
+//   if (x == 0) return 0;
+//   ..lots of code..
+//
+// are split: the rest of the body moves to a new function, which the
+// original function calls after the early exit. The original is then small
+// enough to inline, so callers only make a call on the slow path. Where
+// in the end we did not inline it, the slow path is merged back, so that
+// those callers do not pay for two calls.
 //
 
 #include <atomic>
+#include <fstream>
 
 #include <wasm.h>
 #include <pass.h>
 #include <wasm-builder.h>
+#include <asm_v_wasm.h>
+#include <ir/call-graph.h>
+#include <ir/cost.h>
+#include <ir/find_all.h>
 #include <ir/utils.h>
 #include <ir/literal-utils.h>
 #include <parsing.h>
+#include <support/file.h>
 
 namespace wasm {
 
-// A limit on how big a function to inline when being careful about size
-static const int CAREFUL_SIZE_LIMIT = 15;
+// The size of a function, in addition to its body, in the units of
+// Measurer: its declaration, and its body's size and local declarations.
+static const Index FUNCTION_SIZE = 4;
+
+// The estimated benefit of a constant argument, for each use of the
+// param in the function
+static const double CONSTANT_ARGUMENT_BONUS = 2;
+
+// How often a call site in a loop is assumed to run, relative to the
+// function, for each level of loops it is in, up to a max depth
+static const double LOOP_FREQUENCY = 8;
+static const Index MAX_LOOP_DEPTH = 2;
+
+// The frequency of the hottest call site in a profile, so that profiles
+// and loop depths give comparable frequencies
+static const double MAX_PROFILE_FREQUENCY = 64;
+
+// The minimum benefit for each unit of growth, below which it is not
+// worth growing the code
+static const double MIN_BENEFIT_PER_GROWTH = 0.25;
+
+// The largest function we will inline when that grows the code
+static const Index MAX_GROWING_SIZE = 100;
 
-// A limit on how big a function to inline when being more flexible. In
-// particular it's nice that with this limit we can inline the clamp
-// functions (i32s-div, f64-to-int, etc.), that can affect perf.
-static const int FLEXIBLE_SIZE_LIMIT = 20;
+// The largest function we will inline when that does not grow the code,
+// which is mostly when it has a single use: inlining a bigger one would
+// make a huge function, which is slow to optimize later
+static const Index MAX_SINGLE_USE_SIZE = 200;
+
+// The most an early exit may cost, in the units of CostAnalyzer, for us to
+// split it from the rest of a function: not much more than a call
+static const Index MAX_PROLOGUE_COST = 8;
+
+// How much the code may grow, as a fraction of its original size, and at
+// least, when we can grow it
+static const double GROWTH_BUDGET = 0.1;
+static const Index MIN_GROWTH_BUDGET = 100;
 
 // Useful into on a function, helping us decide if we can inline it
 struct FunctionInfo {
   std::atomic<Index> calls;
   Index size;
-  bool lightweight = true;
   bool usedGlobally = false; // in a table or export
-
-  bool worthInlining(PassOptions& options, bool allowMultipleInliningsPerFunction) {
-    // if it's big, it's just not worth doing (TODO: investigate more)
-    if (size > FLEXIBLE_SIZE_LIMIT) return false;
-    // if it has one use, then inlining it would likely reduce code size
-    // since we are just moving code around, + optimizing, so worth it
-    // if small enough that we are pretty sure its ok
-    if (calls == 1 && !usedGlobally && size <= CAREFUL_SIZE_LIMIT) return true;
-    if (!allowMultipleInliningsPerFunction) return false;
-    // more than one use, so we can't eliminate it after inlining,
-    // so only worth it if we really care about speed and don't care
-    // about size, and if it's lightweight so a good candidate for
-    // speeding us up
-    return options.optimizeLevel >= 3 && options.shrinkLevel == 0 && lightweight;
+  std::vector<Index> paramUses; // how many times each param is read
+  std::vector<bool> paramWritten; // whether each param is ever written
+
+  // how much the code grows by inlining one call to this function
+  int64_t getGrowth(Function* func) {
+    // the new code includes setting the params and zeroing the vars, and
+    // replaces the call
+    int64_t growth = int64_t(size) + func->getNumParams() + 2 * func->getNumVars() - 1;
+    // if this is the only use, the function will be removed
+    if (calls == 1 && !usedGlobally) {
+      growth -= size + FUNCTION_SIZE;
+    }
+    return growth;
   }
 };
 
@@ -80,20 +141,29 @@ struct FunctionInfoScanner : public WalkerPass<PostWalker<FunctionInfoScanner>>
     return new FunctionInfoScanner(infos);
   }
 
-  void visitLoop(Loop* curr) {
-    // having a loop is not lightweight
-    (*infos)[getFunction()->name].lightweight = false;
-  }
-
   void visitCall(Call* curr) {
     assert(infos->count(curr->target) > 0); // can't add a new element in parallel
     (*infos)[curr->target].calls++;
-    // having a call is not lightweight
-    (*infos)[getFunction()->name].lightweight = false;
   }
 
-  void visitFunction(Function* curr) {
-    (*infos)[curr->name].size = Measurer::measure(curr->body);
+  void visitGetLocal(GetLocal* curr) {
+    if (getFunction()->isParam(curr->index)) {
+      (*infos)[getFunction()->name].paramUses[curr->index]++;
+    }
+  }
+
+  void visitSetLocal(SetLocal* curr) {
+    if (getFunction()->isParam(curr->index)) {
+      (*infos)[getFunction()->name].paramWritten[curr->index] = true;
+    }
+  }
+
+  void doWalkFunction(Function* func) {
+    auto& info = (*infos)[func->name];
+    info.paramUses.resize(func->getNumParams());
+    info.paramWritten.resize(func->getNumParams());
+    walk(func->body);
+    info.size = Measurer::measure(func->body);
   }
 
 private:
@@ -103,16 +173,26 @@ private:
 struct InliningAction {
   Expression** callSite;
   Function* contents;
+  double benefit; // for each time the call runs
+  double frequency;
+  int64_t growth;
 
-  InliningAction(Expression** callSite, Function* contents) : callSite(callSite), contents(contents) {}
+  InliningAction(Expression** callSite, Function* contents, double benefit, double frequency, int64_t growth) : callSite(callSite), contents(contents), benefit(benefit), frequency(frequency), growth(growth) {}
+
+  double getPriority() {
+    if (growth <= 0) return std::numeric_limits<double>::infinity();
+    return benefit * frequency / growth;
+  }
 };
 
 struct InliningState {
-  std::unordered_set<Name> worthInlining;
+  NameInfoMap* infos;
+  std::unordered_map<Name, Name>* outlined; // the slow paths of split functions, which we don't inline back, and the functions they were split from
   std::unordered_map<Name, std::vector<InliningAction>> actionsForFunction; // function name => actions that can be performed in it
 };
 
-struct Planner : public WalkerPass<PostWalker<Planner>> {
+// Finds the call sites we could inline, and estimates their benefits
+struct Planner : public WalkerPass<ExpressionStackWalker<Planner>> {
   bool isFunctionParallel() override { return true; }
 
   Planner(InliningState* state) : state(state) {}
@@ -122,26 +202,31 @@ struct Planner : public WalkerPass<PostWalker<Planner>> {
   }
 
   void visitCall(Call* curr) {
-    // plan to inline if we know this is valid to inline, and if the call is
-    // actually performed - if it is dead code, it's pointless to inline
-    if (state->worthInlining.count(curr->target) &&
-        curr->type != unreachable) {
-      // nest the call in a block. that way the location of the pointer to the call will not
-      // change even if we inline multiple times into the same function, otherwise
-      // call1(call2()) might be a problem
-      auto* block = Builder(*getModule()).makeBlock(curr);
-      replaceCurrent(block);
-      assert(state->actionsForFunction.count(getFunction()->name) > 0); // can't add a new element in parallel
-      state->actionsForFunction[getFunction()->name].emplace_back(&block->list[0], getModule()->getFunction(curr->target));
+    // inlining a call that is never performed, or a function into itself,
+    // is pointless
+    if (curr->type == unreachable || curr->target == getFunction()->name) return;
+    if (state->outlined->count(curr->target)) return;
+    auto* contents = getModule()->getFunction(curr->target);
+    // asm2wasm may run us before it fixes up the types of calls
+    if (curr->type != contents->result) return;
+    auto& info = state->infos->at(curr->target);
+    auto growth = info.getGrowth(contents);
+    if (info.size > (growth > 0 ? MAX_GROWING_SIZE : MAX_SINGLE_USE_SIZE)) return;
+    double benefit = CostAnalyzer(curr).cost;
+    for (Index i = 0; i < curr->operands.size(); i++) {
+      auto* operand = curr->operands[i];
+      benefit -= CostAnalyzer(operand).cost;
+      if (operand->is<Const>() && !info.paramWritten[i]) {
+        benefit += CONSTANT_ARGUMENT_BONUS * info.paramUses[i];
+      }
     }
-  }
-
-  void doWalkFunction(Function* func) {
-    // we shouldn't inline into us if we are to be inlined
-    // ourselves - that has the risk of cycles
-    if (state->worthInlining.count(func->name) == 0) {
-      walk(func->body);
+    Index loopDepth = 0;
+    for (auto* parent : expressionStack) {
+      if (parent->is<Loop>()) loopDepth++;
     }
+    double frequency = std::pow(LOOP_FREQUENCY, std::min(loopDepth, MAX_LOOP_DEPTH));
+    assert(state->actionsForFunction.count(getFunction()->name) > 0); // can't add a new element in parallel
+    state->actionsForFunction[getFunction()->name].emplace_back(getCurrentPointer(), contents, benefit, frequency, growth);
   }
 
 private:
@@ -203,23 +288,85 @@ static Expression* doInlining(Module* module, Function* into, InliningAction& ac
   return block;
 }
 
+// Returns the early exit at the start of a function, if it has one that
+// can be split from the rest: an if that only reads params, and returns.
+static If* getPrologue(Function* func) {
+  auto* body = func->body->dynCast<Block>();
+  if (!body || body->list.size() < 2) return nullptr;
+  auto* iff = body->list[0]->dynCast<If>();
+  if (!iff || iff->ifFalse || !iff->ifTrue->is<Return>()) return nullptr;
+  if (FindAll<Return>(iff).list.size() != 1 ||
+      !FindAll<Break>(iff).list.empty() ||
+      !FindAll<Switch>(iff).list.empty() ||
+      !FindAll<SetLocal>(iff).list.empty()) {
+    return nullptr;
+  }
+  for (auto* get : FindAll<GetLocal>(iff).list) {
+    if (!func->isParam(get->index)) return nullptr;
+  }
+  if (CostAnalyzer(iff).cost > MAX_PROLOGUE_COST) return nullptr;
+  return iff;
+}
+
 struct Inlining : public Pass {
   // whether to optimize where we inline
   bool optimize = false;
 
   NameInfoMap infos;
 
-  bool firstIteration;
+  // how much more the code may grow
+  int64_t budget;
+
+  // the functions we split off, with the slow paths of others, and the
+  // functions they were split from
+  std::unordered_map<Name, Name> outlined;
+
+  // how many times callers called callees, from the profile
+  std::map<std::pair<Name, Name>, double> profile;
+  double maxProfileCount = 0;
 
   void run(PassRunner* runner, Module* module) override {
-    // keep going while we inline, to handle nesting. TODO: optimize
-    firstIteration = true;
+    auto& options = runner->options;
+    budget = 0;
+    if (options.optimizeLevel >= 3 && options.shrinkLevel == 0) {
+      Index size = 0;
+      for (auto& func : module->functions) {
+        size += Measurer::measure(func->body);
+      }
+      budget = std::max(Index(size * GROWTH_BUDGET), MIN_GROWTH_BUDGET);
+    }
+    auto iter = options.arguments.find("inlining-profile");
+    if (iter != options.arguments.end()) {
+      readProfile(iter->second);
+    }
+    if (budget > 0) {
+      calculateInfos(module);
+      splitPrologues(module);
+    }
+    // keep going while we inline, to handle nesting
     while (1) {
       calculateInfos(module);
       if (!iteration(runner, module)) {
+        if (!outlined.empty()) {
+          mergeSplits(runner, module);
+        }
         return;
       }
-      firstIteration = false;
+    }
+  }
+
+  void readProfile(std::string filename) {
+    std::istringstream input(read_file<std::string>(filename, Flags::Text, Flags::Release));
+    std::string caller, callee;
+    double count;
+    while (input >> caller >> callee >> count) {
+      profile[{ Name(caller), Name(callee) }] += count;
+    }
+    for (auto& pair : profile) {
+      maxProfileCount = std::max(maxProfileCount, pair.second);
+    }
+    if (maxProfileCount == 0) {
+      Fatal() << "inlining profile " << filename << " has no counts";
     }
   }
 
@@ -234,7 +381,7 @@ struct Inlining : public Pass {
     runner.add<FunctionInfoScanner>(&infos);
     runner.run();
     // fill in global uses
-    // anything exported or used in a table should not be inlined
+    // anything exported, used in a table, or the start function should not be removed
     for (auto& ex : module->exports) {
       if (ex->kind == ExternalKind::Function) {
         infos[ex->value].usedGlobally = true;
@@ -247,41 +394,185 @@ struct Inlining : public Pass {
         }
       }
     }
+    if (module->start.is()) {
+      infos[module->start].usedGlobally = true;
+    }
   }
 
-  bool iteration(PassRunner* runner, Module* module) {
-    // decide which to inline
-    InliningState state;
+  // Splits the functions that begin with an early exit, that we would not
+  // inline otherwise
+  void splitPrologues(Module* module) {
+    std::vector<Function*> funcs;
     for (auto& func : module->functions) {
-      // on the first iteration, allow multiple inlinings per function
-      if (infos[func->name].worthInlining(runner->options, firstIteration /* allowMultipleInliningsPerFunction */)) {
-        state.worthInlining.insert(func->name);
+      funcs.push_back(func.get());
+    }
+    for (auto* func : funcs) {
+      auto& info = infos[func->name];
+      if (info.calls == 0 || info.getGrowth(func) <= 0 || info.size <= MAX_GROWING_SIZE) continue;
+      auto* iff = getPrologue(func);
+      if (!iff) continue;
+      // move the rest of the body to a new function
+      Builder builder(*module);
+      Name name = std::string(func->name.str) + "$outlined";
+      for (Index i = 0; module->getFunctionOrNull(name); i++) {
+        name = std::string(func->name.str) + "$outlined" + std::to_string(i);
+      }
+      auto* body = func->body->cast<Block>();
+      body->list.erase(body->list.begin(), body->list.begin() + 1);
+      body->finalize(body->type);
+      auto* rest = new Function;
+      rest->name = name;
+      rest->result = func->result;
+      rest->params = func->params;
+      rest->vars = func->vars;
+      rest->localNames = func->localNames;
+      rest->localIndices = func->localIndices;
+      rest->body = body;
+      rest->type = ensureFunctionType(getSig(rest), module)->name;
+      module->addFunction(rest);
+      outlined[name] = func->name;
+      // the original function keeps the early exit, then calls the rest
+      std::vector<Expression*> operands;
+      for (Index i = 0; i < func->getNumParams(); i++) {
+        operands.push_back(builder.makeGetLocal(i, func->getLocalType(i)));
       }
+      func->body = builder.makeSequence(iff, builder.makeCall(name, operands, func->result));
+      for (Index i = func->getVarIndexBase(); i < func->getNumLocals(); i++) {
+        if (func->hasLocalName(i)) {
+          func->localIndices.erase(func->getLocalName(i));
+          func->localNames.erase(i);
+        }
+      }
+      func->vars.clear();
+    }
+  }
+
+  // Merges the slow paths of split functions back into the ones that are
+  // still called, and removes those that nothing else calls, as we did not
+  // inline the early exits that did. The infos must be up to date.
+  void mergeSplits(PassRunner* runner, Module* module) {
+    std::unordered_set<Function*> mergedInto;
+    for (auto& pair : outlined) {
+      auto* func = module->getFunctionOrNull(pair.second);
+      if (!func) continue;
+      auto& info = infos[func->name];
+      if (info.calls == 0 && !info.usedGlobally) continue;
+      auto* rest = module->getFunction(pair.first);
+      for (auto** callp : FindAllPointers<Call>(func->body).list) {
+        if ((*callp)->cast<Call>()->target != rest->name) continue;
+        InliningAction action(callp, rest, 0, 0, 0);
+        doInlining(module, func, action);
+        mergedInto.insert(func);
+      }
+    }
+    if (mergedInto.empty()) return;
+    for (auto func : mergedInto) {
+      wasm::UniqueNameMapper::uniquify(func->body);
     }
-    if (state.worthInlining.size() == 0) return false;
+    if (optimize) {
+      doOptimize(mergedInto, module, runner);
+    }
+    calculateInfos(module);
+    auto& funcs = module->functions;
+    funcs.erase(std::remove_if(funcs.begin(), funcs.end(), [&](const std::unique_ptr<Function>& curr) {
+      return outlined.count(curr->name) && infos[curr->name].calls == 0;
+    }), funcs.end());
+    module->updateMaps();
+  }
+
+  bool iteration(PassRunner* runner, Module* module) {
+    // find the call sites we could inline
+    InliningState state;
+    state.infos = &infos;
+    state.outlined = &outlined;
     // fill in actionsForFunction, as we operate on it in parallel (each function to its own entry)
     for (auto& func : module->functions) {
       state.actionsForFunction[func->name];
     }
-    // find and plan inlinings
     {
       PassRunner runner(module);
       runner.setIsNested(true);
       runner.add<Planner>(&state);
       runner.run();
     }
-    // perform inlinings TODO: parallelize
+    std::vector<std::pair<Function*, InliningAction*>> candidates;
+    for (auto& func : module->functions) {
+      auto& actions = state.actionsForFunction[func->name];
+      if (!profile.empty()) {
+        // split the profile counts evenly among the call sites
+        std::unordered_map<Name, Index> numCallSites;
+        for (auto& action : actions) {
+          numCallSites[action.contents->name]++;
+        }
+        for (auto& action : actions) {
+          auto iter = profile.find({ func->name, action.contents->name });
+          double count = iter == profile.end() ? 0 : iter->second;
+          action.frequency = MAX_PROFILE_FREQUENCY * count / maxProfileCount / numCallSites[action.contents->name];
+        }
+      }
+      for (auto& action : actions) {
+        if (action.growth <= 0 || action.getPriority() >= MIN_BENEFIT_PER_GROWTH) {
+          candidates.emplace_back(func.get(), &action);
+        }
+      }
+    }
+    // pick the best ones that fit in the budget. we shouldn't inline into
+    // a function we are inlining elsewhere, or the other way around, as
+    // that has the risk of cycles; nested inlining will happen in later
+    // iterations
+    std::stable_sort(candidates.begin(), candidates.end(), [](const std::pair<Function*, InliningAction*>& a, const std::pair<Function*, InliningAction*>& b) {
+      return a.second->getPriority() > b.second->getPriority();
+    });
+    std::unordered_set<Name> inlinedFrom, inlinedIntoNames;
+    std::unordered_map<Function*, std::vector<InliningAction*>> chosen;
     std::unordered_map<Name, Index> inlinedUses; // how many uses we inlined
+    for (auto& pair : candidates) {
+      auto* func = pair.first;
+      auto* action = pair.second;
+      Name inlinedName = action->contents->name;
+      if (inlinedIntoNames.count(inlinedName) || inlinedFrom.count(func->name)) continue;
+      if (action->growth > budget) continue;
+      budget -= action->growth;
+      inlinedFrom.insert(inlinedName);
+      inlinedIntoNames.insert(func->name);
+      chosen[func].push_back(action);
+      inlinedUses[inlinedName]++;
+      assert(inlinedUses[inlinedName] <= infos[inlinedName].calls);
+    }
+    if (chosen.empty()) return false;
+    // functions all of whose calls we inlined will be removed, which frees
+    // up budget
+    for (auto& pair : inlinedUses) {
+      auto& info = infos[pair.first];
+      if (pair.second == info.calls && !info.usedGlobally && info.calls > 1) {
+        budget += info.size + FUNCTION_SIZE;
+      }
+    }
+    // nest the calls in blocks. that way the location of the pointer to the
+    // call will not change even if we inline multiple times into the same
+    // function, otherwise call1(call2()) might be a problem
     std::unordered_set<Function*> inlinedInto; // which functions were inlined into
-    for (auto& func : module->functions) {
-      for (auto& action : state.actionsForFunction[func->name]) {
-        Name inlinedName = action.contents->name;
-        doInlining(module, func.get(), action);
-        inlinedUses[inlinedName]++;
-        inlinedInto.insert(func.get());
-        assert(inlinedUses[inlinedName] <= infos[inlinedName].calls);
+    for (auto& pair : chosen) {
+      inlinedInto.insert(pair.first);
+      for (auto* action : pair.second) {
+        auto* block = Builder(*module).makeBlock(*action->callSite);
+        *action->callSite = block;
+        action->callSite = &block->list[0];
       }
     }
+    // perform inlinings, in parallel. we go bottom-up in the call graph, so
+    // the code of a function is final by the time it is copied into a caller
+    CallGraph graph(*module);
+    graph.forEachSCCBottomUp([&](CallGraph::SCC& scc) {
+      for (auto i : scc.functions) {
+        auto* func = graph.nodes[i].func;
+        auto iter = chosen.find(func);
+        if (iter == chosen.end()) continue;
+        for (auto* action : iter->second) {
+          doInlining(module, func, *action);
+        }
+      }
+    });
     // anything we inlined into may now have non-unique label names, fix it up
     for (auto func : inlinedInto) {
       wasm::UniqueNameMapper::uniquify(func->body);
@@ -296,8 +587,8 @@ struct Inlining : public Pass {
       auto& info = infos[name];
       return inlinedUses.count(name) && inlinedUses[name] == info.calls && !info.usedGlobally;
     }), funcs.end());
-    // return whether we did any work
-    return inlinedUses.size() > 0;
+    module->updateMaps();
+    return true;
   }
 
   // Run useful optimizations after inlining, things like removing
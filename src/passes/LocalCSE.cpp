@@ -22,7 +22,7 @@
 //  * if already seen, write to a local if not already, and reuse
 //  * invalidate the list as we see effects
 //
-// TODO: global, inter-block gvn etc.
+// The gvn pass does the same across the whole function.
 //
 
 #include <wasm.h>
@@ -47,7 +47,7 @@ struct LocalCSE : public WalkerPass<LinearExecutionWalker<LocalCSE>> {
     Index index; // if not UNUSED, then the local we are assigned to, use that to reuse us
     EffectAnalyzer effects;
 
-    UsableInfo(Expression** item, PassOptions& passOptions) : item(item), index(UNUSED), effects(passOptions, *item) {}
+    UsableInfo(Expression** item, PassOptions& passOptions, EffectCache* cache) : item(item), index(UNUSED), effects(passOptions, *item, cache) {}
   };
 
   // a list of usables in a linear execution trace
@@ -56,6 +56,20 @@ struct LocalCSE : public WalkerPass<LinearExecutionWalker<LocalCSE>> {
   // locals in current linear execution trace, which we try to sink
   Usables usables;
 
+  // the hashes of the subtrees we have seen, as we hash a great many
+  // expressions that contain each other
+  ExpressionAnalyzer::SubtreeHashes hashes;
+
+  // the expression containing each one we have seen, so that we can find
+  // the hashes and effects that a change invalidates
+  std::unordered_map<Expression*, Expression*> parents;
+
+  // the effects of the subtrees we have seen, as we analyze each one after
+  // its children. the walk has not yet reached the expressions containing
+  // the current one, so replacing it invalidates nothing we cached, but
+  // adding a tee to an earlier one does
+  std::unique_ptr<EffectCache> effectCache;
+
   static void doNoteNonLinear(LocalCSE* self, Expression** currp) {
     self->usables.clear();
   }
@@ -84,6 +98,7 @@ struct LocalCSE : public WalkerPass<LinearExecutionWalker<LocalCSE>> {
       self->checkInvalidations(effects);
     }
 
+    self->parents[curr] = self->expressionStack.empty() ? nullptr : self->expressionStack.back();
     self->expressionStack.push_back(curr);
   }
 
@@ -105,6 +120,15 @@ struct LocalCSE : public WalkerPass<LinearExecutionWalker<LocalCSE>> {
     self->expressionStack.pop_back();
   }
 
+  void doWalkFunction(Function* func) {
+    effectCache = make_unique<EffectCache>(getPassOptions());
+    walk(func->body);
+    // what we know about expressions is per function
+    hashes.clear();
+    parents.clear();
+    effectCache.reset();
+  }
+
   // override scan to add a pre and a post check task to all nodes
   static void scan(LocalCSE* self, Expression** currp) {
     self->pushTask(visitPost, currp);
@@ -121,7 +145,7 @@ struct LocalCSE : public WalkerPass<LinearExecutionWalker<LocalCSE>> {
     if (!isConcreteWasmType(curr->type)) {
       return false; // don't bother with unreachable etc.
     }
-    if (EffectAnalyzer(getPassOptions(), curr).hasSideEffects()) {
+    if (EffectAnalyzer(getPassOptions(), curr, effectCache.get()).hasSideEffects()) {
       return false; // we can't combine things with side effects
     }
     // check what we care about TODO: use optimize/shrink levels?
@@ -129,7 +153,7 @@ struct LocalCSE : public WalkerPass<LinearExecutionWalker<LocalCSE>> {
   }
 
   void handle(Expression** currp, Expression* curr) {
-    HashedExpression hashed(curr);
+    HashedExpression hashed(curr, ExpressionAnalyzer::hash(curr, hashes));
     auto iter = usables.find(hashed);
     if (iter != usables.end()) {
       // already exists in the table, this is good to reuse
@@ -137,14 +161,21 @@ struct LocalCSE : public WalkerPass<LinearExecutionWalker<LocalCSE>> {
       if (info.index == UNUSED) {
         // we need to assign to a local. create a new one
         auto index = info.index = Builder::addVar(getFunction(), curr->type);
-        (*info.item) = Builder(*getModule()).makeTeeLocal(index, *info.item);
+        auto* item = *info.item;
+        (*info.item) = Builder(*getModule()).makeTeeLocal(index, item);
+        // the hashes and effects of the expressions containing it are no
+        // longer valid
+        for (auto* parent = parents[item]; parent; parent = parents[parent]) {
+          hashes.erase(parent);
+          effectCache->invalidate(parent);
+        }
       }
       replaceCurrent(
         Builder(*getModule()).makeGetLocal(info.index, curr->type)
       );
     } else {
       // not in table, add this, maybe we can help others later
-      usables.emplace(std::make_pair(hashed, UsableInfo(currp, getPassOptions())));
+      usables.emplace(std::make_pair(hashed, UsableInfo(currp, getPassOptions(), effectCache.get())));
     }
   }
 };
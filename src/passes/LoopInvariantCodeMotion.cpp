@@ -0,0 +1,224 @@
+/*
+ * Copyright 2017 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// Loop invariant code motion
+//
+// Finds expressions in loops that compute the same value in every
+// iteration, and computes them once, into a local set before the loop:
+//
+//  * An expression is invariant if it has no side effects, and everything
+//    it reads is not changed in the loop: the sets of locals it reads are
+//    all outside of the loop (according to the local graph), the globals
+//    it reads are not written, and if it loads, memory is not written.
+//  * We hoist the largest invariant expressions, and skip trivial ones.
+//  * An expression that may trap is only hoisted if it is certain to run
+//    in the first iteration, before anything else that is noticeable,
+//    as then trapping before the loop is no different. Other expressions
+//    are hoisted even if they are only run conditionally in the loop, as
+//    computing them has no effects.
+//
+// Loops are processed outermost first, so an expression is hoisted out of
+// as many loops as possible.
+//
+
+#include <wasm.h>
+#include <wasm-builder.h>
+#include <wasm-traversal.h>
+#include <pass.h>
+#include <ir/effects.h>
+#include <ir/find_all.h>
+#include <ir/local-graph.h>
+
+namespace wasm {
+
+struct LoopInvariantCodeMotion : public WalkerPass<PostWalker<LoopInvariantCodeMotion>> {
+  bool isFunctionParallel() override { return true; }
+
+  Pass* create() override { return new LoopInvariantCodeMotion(); }
+
+  LocalGraph* localGraph;
+  Index numOriginalLocals;
+
+  // the locations of the loops, innermost first
+  std::vector<Expression**> loops;
+
+  void visitLoop(Loop* curr) {
+    loops.push_back(getCurrentPointer());
+  }
+
+  void doWalkFunction(Function* func) {
+    walk(func->body);
+    if (loops.empty()) return;
+    localGraph = &getFunctionAnalysis<LocalGraph>(func);
+    numOriginalLocals = func->getNumLocals();
+    for (auto iter = loops.rbegin(); iter != loops.rend(); iter++) {
+      optimizeLoop(*iter);
+    }
+    loops.clear();
+  }
+
+  void optimizeLoop(Expression** currp) {
+    auto* loop = (*currp)->dynCast<Loop>();
+    if (!loop) return; // it was hoisted out of an outer loop, as a whole
+    EffectAnalyzer loopEffects(getPassOptions(), loop->body);
+    std::unordered_set<SetLocal*> loopSets;
+    for (auto* set : FindAll<SetLocal>(loop->body).list) {
+      loopSets.insert(set);
+    }
+    auto firstIteration = findFirstIteration(loop->body);
+
+    // find the invariant expressions
+    struct Finder : public PostWalker<Finder> {
+      LoopInvariantCodeMotion* parent;
+      EffectAnalyzer& loopEffects;
+      std::unordered_set<SetLocal*>& loopSets;
+      std::unordered_set<Expression*>& firstIteration;
+
+      std::unordered_set<Expression*> invariant;
+      std::vector<bool> stack; // whether the children of each expression we are in are invariant
+
+      Finder(LoopInvariantCodeMotion* parent, EffectAnalyzer& loopEffects, std::unordered_set<SetLocal*>& loopSets, std::unordered_set<Expression*>& firstIteration) : parent(parent), loopEffects(loopEffects), loopSets(loopSets), firstIteration(firstIteration) {}
+
+      static void doPre(Finder* self, Expression** currp) {
+        self->stack.push_back(true);
+      }
+
+      static void doPost(Finder* self, Expression** currp) {
+        auto* curr = *currp;
+        bool ret = self->stack.back() && self->isInvariant(curr);
+        self->stack.pop_back();
+        if (ret) {
+          self->invariant.insert(curr);
+        } else if (!self->stack.empty()) {
+          self->stack.back() = false;
+        }
+      }
+
+      static void scan(Finder* self, Expression** currp) {
+        self->pushTask(doPost, currp);
+        PostWalker<Finder>::scan(self, currp);
+        self->pushTask(doPre, currp);
+      }
+
+      // whether an expression whose children are invariant is invariant too
+      bool isInvariant(Expression* curr) {
+        if (!isConcreteWasmType(curr->type)) return false;
+        if (curr->is<Break>() || curr->is<Switch>()) {
+          return false; // we would need to check where they go
+        }
+        EffectAnalyzer effects(parent->getPassOptions());
+        effects.visit(curr);
+        if (effects.branches || effects.hasGlobalSideEffects() || !effects.localsWritten.empty()) {
+          return false;
+        }
+        if (auto* get = curr->dynCast<GetLocal>()) {
+          if (get->index >= parent->numOriginalLocals) {
+            return true; // set before an outer loop that we already hoisted out of
+          }
+          for (auto* set : parent->localGraph->getSetses[get]) {
+            if (loopSets.count(set)) return false;
+          }
+        }
+        if (!effects.globalsRead.empty()) {
+          if (loopEffects.calls || effects.globalsRead.intersects(loopEffects.globalsWritten)) {
+            return false;
+          }
+        }
+        if (effects.readsMemory && (loopEffects.writesMemory || loopEffects.calls || loopEffects.isAtomic)) {
+          return false;
+        }
+        if (effects.implicitTrap && !firstIteration.count(curr)) {
+          return false;
+        }
+        return true;
+      }
+    };
+
+    Finder finder(this, loopEffects, loopSets, firstIteration);
+    finder.walk(loop->body);
+    if (finder.invariant.empty()) return;
+
+    // hoist the largest invariant expressions
+    struct Hoister : public PostWalker<Hoister> {
+      std::unordered_set<Expression*>& invariant;
+      Function* func;
+      Builder builder;
+      std::vector<Expression*> sets;
+
+      Hoister(std::unordered_set<Expression*>& invariant, Function* func, Module* module) : invariant(invariant), func(func), builder(*module) {}
+
+      static void scan(Hoister* self, Expression** currp) {
+        auto* curr = *currp;
+        if (self->invariant.count(curr)) {
+          if (curr->is<Const>() || curr->is<GetLocal>() || curr->is<GetGlobal>()) {
+            return; // too small to bother
+          }
+          auto index = Builder::addVar(self->func, curr->type);
+          self->sets.push_back(self->builder.makeSetLocal(index, curr));
+          *currp = self->builder.makeGetLocal(index, curr->type);
+          return;
+        }
+        PostWalker<Hoister>::scan(self, currp);
+      }
+    };
+
+    Hoister hoister(finder.invariant, getFunction(), getModule());
+    hoister.walk(loop->body);
+    if (hoister.sets.empty()) return;
+    auto* block = Builder(*getModule()).makeBlock(hoister.sets);
+    block->list.push_back(loop);
+    block->finalize(loop->type);
+    *currp = block;
+  }
+
+  // Finds the expressions that are certainly fully executed in the first
+  // iteration of a loop, before anything that branches or has global side
+  // effects.
+  std::unordered_set<Expression*> findFirstIteration(Expression* body) {
+    struct Scanner : public LinearExecutionWalker<Scanner, UnifiedExpressionVisitor<Scanner>> {
+      PassOptions& passOptions;
+      std::unordered_set<Expression*> found;
+      bool done = false;
+
+      Scanner(PassOptions& passOptions) : passOptions(passOptions) {}
+
+      void noteNonLinear(Expression* curr) {
+        done = true;
+      }
+
+      void visitExpression(Expression* curr) {
+        if (done) return;
+        EffectAnalyzer effects(passOptions);
+        effects.visit(curr);
+        if (effects.branches || effects.hasGlobalSideEffects()) {
+          done = true;
+          return;
+        }
+        found.insert(curr);
+      }
+    };
+    Scanner scanner(getPassOptions());
+    scanner.walk(body);
+    return std::move(scanner.found);
+  }
+};
+
+Pass *createLoopInvariantCodeMotionPass() {
+  return new LoopInvariantCodeMotion();
+}
+
+} // namespace wasm
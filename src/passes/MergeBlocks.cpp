@@ -252,6 +252,17 @@ struct MergeBlocks : public WalkerPass<PostWalker<MergeBlocks>> {
 
   Pass* create() override { return new MergeBlocks; }
 
+  // the effects of the children we analyzed. we analyze the children of an
+  // expression when we visit it, so the expressions containing it are not
+  // cached yet, and when we move a block out, we invalidate what changed
+  std::unique_ptr<EffectCache> effectCache;
+
+  void doWalkFunction(Function* func) {
+    effectCache = make_unique<EffectCache>(getPassOptions());
+    walk(func->body);
+    effectCache.reset();
+  }
+
   void visitBlock(Block *curr) {
     optimizeBlock(curr, getModule(), getPassOptions());
   }
@@ -275,12 +286,6 @@ struct MergeBlocks : public WalkerPass<PostWalker<MergeBlocks>> {
   // at which point the block is on the outside and potentially mergeable with an outer block
   Block* optimize(Expression* curr, Expression*& child, Block* outer = nullptr, Expression** dependency1 = nullptr, Expression** dependency2 = nullptr) {
     if (!child) return outer;
-    if ((dependency1 && *dependency1) || (dependency2 && *dependency2)) {
-      // there are dependencies, things we must be reordered through. make sure no problems there
-      EffectAnalyzer childEffects(getPassOptions(), child);
-      if (dependency1 && *dependency1 && EffectAnalyzer(getPassOptions(), *dependency1).invalidates(childEffects)) return outer;
-      if (dependency2 && *dependency2 && EffectAnalyzer(getPassOptions(), *dependency2).invalidates(childEffects)) return outer;
-    }
     if (auto* block = child->dynCast<Block>()) {
       if (!block->name.is() && block->list.size() >= 2) {
         // if we move around unreachable code, type changes could occur. avoid that, as
@@ -300,7 +305,15 @@ struct MergeBlocks : public WalkerPass<PostWalker<MergeBlocks>> {
         if (block->type != back->type) {
           return outer;
         }
+        if ((dependency1 && *dependency1) || (dependency2 && *dependency2)) {
+          // there are dependencies, things we must be reordered through. make sure no problems there
+          EffectAnalyzer childEffects(getPassOptions(), child, effectCache.get());
+          if (dependency1 && *dependency1 && EffectAnalyzer(getPassOptions(), *dependency1, effectCache.get()).invalidates(childEffects)) return outer;
+          if (dependency2 && *dependency2 && EffectAnalyzer(getPassOptions(), *dependency2, effectCache.get()).invalidates(childEffects)) return outer;
+        }
         child = back;
+        effectCache->invalidate(block);
+        effectCache->invalidate(curr);
         if (outer == nullptr) {
           // reuse the block, move it out
           block->list.back() = curr;
@@ -311,6 +324,7 @@ struct MergeBlocks : public WalkerPass<PostWalker<MergeBlocks>> {
         } else {
           // append to an existing outer block
           assert(outer->list.back() == curr);
+          effectCache->invalidate(outer);
           outer->list.pop_back();
           for (Index i = 0; i < block->list.size() - 1; i++) {
             outer->list.push_back(block->list[i]);
@@ -349,11 +363,11 @@ struct MergeBlocks : public WalkerPass<PostWalker<MergeBlocks>> {
     // TODO: for now, just stop when we see any side effect. instead, we could
     //       check effects carefully for reordering
     Block* outer = nullptr;
-    if (EffectAnalyzer(getPassOptions(), first).hasSideEffects()) return;
+    if (EffectAnalyzer(getPassOptions(), first, effectCache.get()).hasSideEffects()) return;
     outer = optimize(curr, first, outer);
-    if (EffectAnalyzer(getPassOptions(), second).hasSideEffects()) return;
+    if (EffectAnalyzer(getPassOptions(), second, effectCache.get()).hasSideEffects()) return;
     outer = optimize(curr, second, outer);
-    if (EffectAnalyzer(getPassOptions(), third).hasSideEffects()) return;
+    if (EffectAnalyzer(getPassOptions(), third, effectCache.get()).hasSideEffects()) return;
     optimize(curr, third, outer);
   }
   void visitAtomicCmpxchg(AtomicCmpxchg* curr) {
@@ -379,7 +393,7 @@ struct MergeBlocks : public WalkerPass<PostWalker<MergeBlocks>> {
   void handleCall(T* curr) {
     Block* outer = nullptr;
     for (Index i = 0; i < curr->operands.size(); i++) {
-      if (EffectAnalyzer(getPassOptions(), curr->operands[i]).hasSideEffects()) return;
+      if (EffectAnalyzer(getPassOptions(), curr->operands[i], effectCache.get()).hasSideEffects()) return;
       outer = optimize(curr, curr->operands[i], outer);
     }
     return;
@@ -396,10 +410,10 @@ struct MergeBlocks : public WalkerPass<PostWalker<MergeBlocks>> {
   void visitCallIndirect(CallIndirect* curr) {
     Block* outer = nullptr;
     for (Index i = 0; i < curr->operands.size(); i++) {
-      if (EffectAnalyzer(getPassOptions(), curr->operands[i]).hasSideEffects()) return;
+      if (EffectAnalyzer(getPassOptions(), curr->operands[i], effectCache.get()).hasSideEffects()) return;
       outer = optimize(curr, curr->operands[i], outer);
     }
-    if (EffectAnalyzer(getPassOptions(), curr->target).hasSideEffects()) return;
+    if (EffectAnalyzer(getPassOptions(), curr->target, effectCache.get()).hasSideEffects()) return;
     optimize(curr, curr->target, outer);
   }
 };
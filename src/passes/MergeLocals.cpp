@@ -210,6 +210,11 @@ struct MergeLocals : public WalkerPass<PostWalker<MergeLocals, UnifiedExpression
       copy->value = copy->value->cast<SetLocal>()->value;
     }
   }
+
+  PreservedAnalyses getPreservedAnalyses() override {
+    // without copies, we did not change anything
+    return copies.empty() ? PreservedAnalyses::all() : PreservedAnalyses::none();
+  }
 };
 
 Pass *createMergeLocalsPass() {
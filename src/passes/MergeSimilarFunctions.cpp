@@ -0,0 +1,234 @@
+/*
+ * Copyright 2017 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// Merges functions that are identical except for the values of some
+// constants, which is common with C++ templates. Such functions become
+// thunks that call one shared function, passing it the constants that
+// differ as extra parameters:
+//
+//  (func $a (param $x i32)                 (func $a (param $x i32)
+//   (call $f (get_local $x) (i32.const 1))   (call $a$merged (get_local $x) (i32.const 1))
+//  )                                        )
+//  (func $b (param $x i32)             =>  (func $b (param $x i32)
+//   (call $f (get_local $x) (i32.const 2))   (call $a$merged (get_local $x) (i32.const 2))
+//  )                                        )
+//                                          (func $a$merged (param $x i32) (param $1 i32)
+//                                           (call $f (get_local $x) (get_local $1))
+//                                          )
+//
+// That is only done when it makes the code smaller. Inlining can later
+// turn calls of the thunks into calls of the shared function.
+//
+// Functions that are entirely identical are left for
+// DuplicateFunctionElimination, and functions that call different
+// functions are not merged.
+//
+
+#include <wasm.h>
+#include <pass.h>
+#include <asm_v_wasm.h>
+#include <wasm-builder.h>
+#include <ir/find_all.h>
+#include <ir/manipulation.h>
+#include <ir/utils.h>
+#include <support/hash.h>
+
+namespace wasm {
+
+// The size of a new function, in addition to its body, in the units of
+// Measurer.
+static const Index FunctionSize = 4;
+
+// The most parameters we add, as each one makes all the calls bigger.
+static const Index MaxNewParams = 8;
+
+struct FunctionShapeHasher : public WalkerPass<PostWalker<FunctionShapeHasher>> {
+  bool isFunctionParallel() override { return true; }
+
+  FunctionShapeHasher(std::map<Function*, uint64_t>* output) : output(output) {}
+
+  FunctionShapeHasher* create() override {
+    return new FunctionShapeHasher(output);
+  }
+
+  void doWalkFunction(Function* func) {
+    Hasher64 hasher;
+    hasher.add(func->getNumParams());
+    for (auto type : func->params) hasher.add(type);
+    hasher.add(func->getNumVars());
+    for (auto type : func->vars) hasher.add(type);
+    hasher.add(func->result);
+    hasher.add(ExpressionAnalyzer::shapeHash(func->body));
+    output->at(func) = hasher.finish();
+  }
+
+private:
+  std::map<Function*, uint64_t>* output;
+};
+
+struct MergeSimilarFunctions : public Pass {
+  void run(PassRunner* runner, Module* module) override {
+    std::map<Function*, uint64_t> hashes;
+    for (auto& func : module->functions) {
+      hashes[func.get()] = 0; // ensure an entry for each function - we must not modify the map shape in parallel, just the values
+    }
+    PassRunner hasherRunner(module);
+    hasherRunner.setIsNested(true);
+    hasherRunner.add<FunctionShapeHasher>(&hashes);
+    hasherRunner.run();
+    // Find hash-equal groups, in the order of the functions
+    std::unordered_map<uint64_t, std::vector<Function*>> hashGroups;
+    std::vector<uint64_t> order;
+    for (auto& func : module->functions) {
+      auto& group = hashGroups[hashes[func.get()]];
+      if (group.empty()) order.push_back(hashes[func.get()]);
+      group.push_back(func.get());
+    }
+    for (auto hash : order) {
+      auto& group = hashGroups[hash];
+      if (group.size() == 1) continue;
+      // split the group into sets of functions that are actually equal,
+      // ignoring constants
+      std::vector<std::vector<Function*>> similars;
+      for (auto* func : group) {
+        bool found = false;
+        for (auto& similar : similars) {
+          if (equalIgnoringConstants(func, similar[0])) {
+            similar.push_back(func);
+            found = true;
+            break;
+          }
+        }
+        if (!found) similars.push_back({ func });
+      }
+      for (auto& similar : similars) {
+        if (similar.size() > 1) merge(similar, module);
+      }
+    }
+  }
+
+  static bool equalIgnoringConstants(Function* left, Function* right) {
+    if (left->params != right->params) return false;
+    if (left->vars != right->vars) return false;
+    if (left->result != right->result) return false;
+    auto comparer = [](Expression* left, Expression* right) {
+      return left->is<Const>() && right->is<Const>() && left->type == right->type;
+    };
+    return ExpressionAnalyzer::flexibleEqual(left->body, right->body, comparer);
+  }
+
+  void merge(std::vector<Function*>& funcs, Module* module) {
+    // the constants are in the same order in all the functions. find the
+    // ones that differ, and use one parameter for all the ones that differ
+    // in the same way
+    std::vector<std::vector<Const*>> consts;
+    for (auto* func : funcs) {
+      consts.push_back(FindAll<Const>(func->body).list);
+    }
+    std::vector<std::vector<Literal>> paramValues;
+    std::vector<Index> paramOfConst;
+    for (Index i = 0; i < consts[0].size(); i++) {
+      std::vector<Literal> values;
+      for (auto& list : consts) {
+        values.push_back(list[i]->value);
+      }
+      Index param = Index(-1);
+      if (std::any_of(values.begin(), values.end(), [&](const Literal& value) { return value != values[0]; })) {
+        param = std::find(paramValues.begin(), paramValues.end(), values) - paramValues.begin();
+        if (param == paramValues.size()) {
+          if (paramValues.size() == MaxNewParams) return;
+          paramValues.push_back(values);
+        }
+      }
+      paramOfConst.push_back(param);
+    }
+    if (paramValues.empty()) return; // identical
+    auto* base = funcs[0];
+    Index numParams = base->getNumParams();
+    Index numNewParams = paramValues.size();
+    Index size = Measurer::measure(base->body);
+    Index sizeBefore = size * funcs.size();
+    Index sizeAfter = size + FunctionSize + numNewParams + (1 + numParams + numNewParams) * funcs.size();
+    if (sizeAfter >= sizeBefore) return;
+    // create the merged function, with the new params after the old ones
+    Builder builder(*module);
+    Name name = std::string(base->name.str) + "$merged";
+    for (Index i = 0; module->getFunctionOrNull(name); i++) {
+      name = std::string(base->name.str) + "$merged" + std::to_string(i);
+    }
+    auto* merged = new Function;
+    merged->name = name;
+    merged->result = base->result;
+    merged->params = base->params;
+    for (auto& values : paramValues) {
+      merged->params.push_back(values[0].type);
+    }
+    merged->vars = base->vars;
+    for (auto& pair : base->localNames) {
+      auto index = pair.first >= numParams ? pair.first + numNewParams : pair.first;
+      merged->localNames[index] = pair.second;
+      merged->localIndices[pair.second] = index;
+    }
+    merged->body = ExpressionManipulator::copy(base->body, *module);
+    struct Updater : public PostWalker<Updater> {
+      Index numParams, numNewParams;
+      void visitGetLocal(GetLocal* curr) {
+        if (curr->index >= numParams) curr->index += numNewParams;
+      }
+      void visitSetLocal(SetLocal* curr) {
+        if (curr->index >= numParams) curr->index += numNewParams;
+      }
+    } updater;
+    updater.numParams = numParams;
+    updater.numNewParams = numNewParams;
+    updater.walk(merged->body);
+    auto constPointers = FindAllPointers<Const>(merged->body).list;
+    for (Index i = 0; i < constPointers.size(); i++) {
+      auto param = paramOfConst[i];
+      if (param != Index(-1)) {
+        *constPointers[i] = builder.makeGetLocal(numParams + param, paramValues[param][0].type);
+      }
+    }
+    merged->type = ensureFunctionType(getSig(merged), module)->name;
+    module->addFunction(merged);
+    // turn the functions into thunks
+    for (Index i = 0; i < funcs.size(); i++) {
+      auto* func = funcs[i];
+      std::vector<Expression*> operands;
+      for (Index j = 0; j < numParams; j++) {
+        operands.push_back(builder.makeGetLocal(j, func->getLocalType(j)));
+      }
+      for (auto& values : paramValues) {
+        operands.push_back(builder.makeConst(values[i]));
+      }
+      func->body = builder.makeCall(name, operands, func->result);
+      for (Index j = numParams; j < func->getNumLocals(); j++) {
+        if (func->hasLocalName(j)) {
+          func->localIndices.erase(func->getLocalName(j));
+          func->localNames.erase(j);
+        }
+      }
+      func->vars.clear();
+    }
+  }
+};
+
+Pass *createMergeSimilarFunctionsPass() {
+  return new MergeSimilarFunctions();
+}
+
+} // namespace wasm
@@ -35,6 +35,10 @@ struct Metrics : public WalkerPass<PostWalker<Metrics, UnifiedExpressionVisitor<
     counts[name]++;
   }
 
+  PreservedAnalyses getPreservedAnalyses() override {
+    return PreservedAnalyses::all();
+  }
+
   void visitModule(Module* module) {
     ostream &o = cout;
     o << "Counts"
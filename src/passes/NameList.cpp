@@ -30,6 +30,10 @@ struct NameList : public Pass {
       std::cout << "    " << func->name << " : " << Measurer::measure(func->body) << '\n';
     }
   }
+
+  PreservedAnalyses getPreservedAnalyses() override {
+    return PreservedAnalyses::all();
+  }
 };
 
 Pass *createNameListPass() {
@@ -17,13 +17,16 @@
 //
 // Optimize combinations of instructions
 //
+// Simple patterns are declared in OptimizeInstructions.wast, from which
+// scripts/process_optimize_instructions.py generates a matcher that we
+// include here. The rest are written by hand below.
+//
 
 #include <algorithm>
 
 #include <wasm.h>
 #include <pass.h>
-#include <wasm-s-parser.h>
-#include <support/threads.h>
+#include <wasm-builder.h>
 #include <ir/utils.h>
 #include <ir/cost.h>
 #include <ir/effects.h>
@@ -36,138 +39,6 @@
 
 namespace wasm {
 
-Name I32_EXPR  = "i32.expr",
-     I64_EXPR  = "i64.expr",
-     F32_EXPR  = "f32.expr",
-     F64_EXPR  = "f64.expr",
-     ANY_EXPR  = "any.expr";
-
-// A pattern
-struct Pattern {
-  Expression* input;
-  Expression* output;
-
-  Pattern(Expression* input, Expression* output) : input(input), output(output) {}
-};
-
-#if 0
-// Database of patterns
-struct PatternDatabase {
-  Module wasm;
-
-  char* input;
-
-  std::map<Expression::Id, std::vector<Pattern>> patternMap; // root expression id => list of all patterns for it TODO optimize more
-
-  PatternDatabase() {
-    // generate module
-    input = strdup(
-      #include "OptimizeInstructions.wast.processed"
-    );
-    try {
-      SExpressionParser parser(input);
-      Element& root = *parser.root;
-      SExpressionWasmBuilder builder(wasm, *root[0]);
-      // parse module form
-      auto* func = wasm.getFunction("patterns");
-      auto* body = func->body->cast<Block>();
-      for (auto* item : body->list) {
-        auto* pair = item->cast<Block>();
-        patternMap[pair->list[0]->_id].emplace_back(pair->list[0], pair->list[1]);
-      }
-    } catch (ParseException& p) {
-      p.dump(std::cerr);
-      Fatal() << "error in parsing wasm binary";
-    }
-  }
-
-  ~PatternDatabase() {
-    free(input);
-  };
-};
-
-static PatternDatabase* database = nullptr;
-
-struct DatabaseEnsurer {
-  DatabaseEnsurer() {
-    assert(!database);
-    database = new PatternDatabase;
-  }
-};
-#endif
-
-// Check for matches and apply them
-struct Match {
-  Module& wasm;
-  Pattern& pattern;
-
-  Match(Module& wasm, Pattern& pattern) : wasm(wasm), pattern(pattern) {}
-
-  std::vector<Expression*> wildcards; // id in i32.any(id) etc. => the expression it represents in this match
-
-  // Comparing/checking
-
-  // Check if we can match to this pattern, updating ourselves with the info if so
-  bool check(Expression* seen) {
-    // compare seen to the pattern input, doing a special operation for our "wildcards"
-    assert(wildcards.size() == 0);
-    auto compare = [this](Expression* subInput, Expression* subSeen) {
-      CallImport* call = subInput->dynCast<CallImport>();
-      if (!call || call->operands.size() != 1 || call->operands[0]->type != i32 || !call->operands[0]->is<Const>()) return false;
-      Index index = call->operands[0]->cast<Const>()->value.geti32();
-      // handle our special functions
-      auto checkMatch = [&](WasmType type) {
-        if (type != none && subSeen->type != type) return false;
-        while (index >= wildcards.size()) {
-          wildcards.push_back(nullptr);
-        }
-        if (!wildcards[index]) {
-          // new wildcard
-          wildcards[index] = subSeen; // NB: no need to copy
-          return true;
-        } else {
-          // We are seeing this index for a second or later time, check it matches
-          return ExpressionAnalyzer::equal(subSeen, wildcards[index]);
-        };
-      };
-      if (call->target == I32_EXPR) {
-        if (checkMatch(i32)) return true;
-      } else if (call->target == I64_EXPR) {
-        if (checkMatch(i64)) return true;
-      } else if (call->target == F32_EXPR) {
-        if (checkMatch(f32)) return true;
-      } else if (call->target == F64_EXPR) {
-        if (checkMatch(f64)) return true;
-      } else if (call->target == ANY_EXPR) {
-        if (checkMatch(none)) return true;
-      }
-      return false;
-    };
-
-    return ExpressionAnalyzer::flexibleEqual(pattern.input, seen, compare);
-  }
-
-
-  // Applying/copying
-
-  // Apply the match, generate an output expression from the matched input, performing substitutions as necessary
-  Expression* apply() {
-    // When copying a wildcard, perform the substitution.
-    // TODO: we can reuse nodes, not copying a wildcard when it appears just once, and we can reuse other individual nodes when they are discarded anyhow.
-    auto copy = [this](Expression* curr) -> Expression* {
-      CallImport* call = curr->dynCast<CallImport>();
-      if (!call || call->operands.size() != 1 || call->operands[0]->type != i32 || !call->operands[0]->is<Const>()) return nullptr;
-      Index index = call->operands[0]->cast<Const>()->value.geti32();
-      // handle our special functions
-      if (call->target == I32_EXPR || call->target == I64_EXPR || call->target == F32_EXPR || call->target == F64_EXPR || call->target == ANY_EXPR) {
-        return ExpressionManipulator::copy(wildcards.at(index), wasm);
-      }
-      return nullptr;
-    };
-    return ExpressionManipulator::flexibleCopy(pattern.output, wasm, copy);
-  }
-};
-
 // Utilities
 
 // returns the maximum amount of bits used in an integer expression
@@ -353,12 +224,6 @@ struct OptimizeInstructions : public WalkerPass<PostWalker<OptimizeInstructions,
 
   Pass* create() override { return new OptimizeInstructions; }
 
-  void prepareToRun(PassRunner* runner, Module* module) override {
-#if 0
-    static DatabaseEnsurer ensurer;
-#endif
-  }
-
   void doWalkFunction(Function* func) {
     // first, scan locals
     {
@@ -378,28 +243,23 @@ struct OptimizeInstructions : public WalkerPass<PostWalker<OptimizeInstructions,
         replaceCurrent(curr);
         continue;
       }
-#if 0
-      auto iter = database->patternMap.find(curr->_id);
-      if (iter == database->patternMap.end()) return;
-      auto& patterns = iter->second;
-      bool more = false;
-      for (auto& pattern : patterns) {
-        Match match(*getModule(), pattern);
-        if (match.check(curr)) {
-          curr = match.apply();
+      // see handOptimize on dead code
+      if (curr->type != unreachable) {
+        auto* matched = applyPatterns(curr);
+        if (matched) {
+          curr = matched;
           replaceCurrent(curr);
-          more = true;
-          break; // exit pattern for loop, return to main while loop
+          continue;
         }
       }
-      if (!more) break;
-#else
       break;
-#endif
     }
   }
 
-  // Optimizations that don't yet fit in the pattern DSL, but could be eventually maybe
+  // The patterns in OptimizeInstructions.wast, compiled into a matcher
+  #include "OptimizeInstructions.wast.processed"
+
+  // Optimizations that don't fit in the pattern DSL
   Expression* handOptimize(Expression* curr) {
     // if this contains dead code, don't bother trying to optimize it, the type
     // might change (if might not be unreachable if just one arm is, for example).
@@ -439,10 +299,6 @@ struct OptimizeInstructions : public WalkerPass<PostWalker<OptimizeInstructions,
         }
       } else if (binary->op == EqInt32 || binary->op == NeInt32) {
         if (auto* c = binary->right->dynCast<Const>()) {
-          if (binary->op == EqInt32 && c->value.geti32() == 0) {
-            // equal 0 => eqz
-            return Builder(*getModule()).makeUnary(EqZInt32, binary->left);
-          }
           if (auto* ext = Properties::getSignExtValue(binary->left)) {
             // we are comparing a sign extend to a constant, which means we can use a cheaper zext
             auto bits = Properties::getSignExtBits(binary->left);
@@ -513,10 +369,6 @@ struct OptimizeInstructions : public WalkerPass<PostWalker<OptimizeInstructions,
       if (auto* right = binary->right->dynCast<Const>()) {
         if (binary->op == AndInt32) {
           auto mask = right->value.geti32();
-          // and with -1 does nothing (common in asm.js output)
-          if (mask == -1) {
-            return binary->left;
-          }
           // small loads do not need to be masted, the load itself masks
           if (auto* load = binary->left->dynCast<Load>()) {
             if ((load->bytes == 1 && mask == 0xff) ||
@@ -531,12 +383,6 @@ struct OptimizeInstructions : public WalkerPass<PostWalker<OptimizeInstructions,
             }
           }
         }
-        // some operations have no effect TODO: many more
-        if (right->value == Literal(int32_t(0))) {
-          if (binary->op == ShlInt32 || binary->op == ShrUInt32 || binary->op == ShrSInt32) {
-            return binary->left;
-          }
-        }
         // the square of some operations can be merged
         if (auto* left = binary->left->dynCast<Binary>()) {
           if (left->op == binary->op) {
@@ -592,41 +438,7 @@ struct OptimizeInstructions : public WalkerPass<PostWalker<OptimizeInstructions,
         return conditionalizeExpensiveOnBitwise(binary);
       }
     } else if (auto* unary = curr->dynCast<Unary>()) {
-      // de-morgan's laws
       if (unary->op == EqZInt32) {
-        if (auto* inner = unary->value->dynCast<Binary>()) {
-          switch (inner->op) {
-            case EqInt32:  inner->op = NeInt32;  return inner;
-            case NeInt32:  inner->op = EqInt32;  return inner;
-            case LtSInt32: inner->op = GeSInt32; return inner;
-            case LtUInt32: inner->op = GeUInt32; return inner;
-            case LeSInt32: inner->op = GtSInt32; return inner;
-            case LeUInt32: inner->op = GtUInt32; return inner;
-            case GtSInt32: inner->op = LeSInt32; return inner;
-            case GtUInt32: inner->op = LeUInt32; return inner;
-            case GeSInt32: inner->op = LtSInt32; return inner;
-            case GeUInt32: inner->op = LtUInt32; return inner;
-
-            case EqInt64:  inner->op = NeInt64;  return inner;
-            case NeInt64:  inner->op = EqInt64;  return inner;
-            case LtSInt64: inner->op = GeSInt64; return inner;
-            case LtUInt64: inner->op = GeUInt64; return inner;
-            case LeSInt64: inner->op = GtSInt64; return inner;
-            case LeUInt64: inner->op = GtUInt64; return inner;
-            case GtSInt64: inner->op = LeSInt64; return inner;
-            case GtUInt64: inner->op = LeUInt64; return inner;
-            case GeSInt64: inner->op = LtSInt64; return inner;
-            case GeUInt64: inner->op = LtUInt64; return inner;
-
-            case EqFloat32: inner->op = NeFloat32; return inner;
-            case NeFloat32: inner->op = EqFloat32; return inner;
-
-            case EqFloat64: inner->op = NeFloat64; return inner;
-            case NeFloat64: inner->op = EqFloat64; return inner;
-
-            default: {}
-          }
-        }
         // eqz of a sign extension can be of zero-extension
         if (auto* ext = Properties::getSignExtValue(unary->value)) {
           // we are comparing a sign extend to a constant, which means we can use a cheaper zext
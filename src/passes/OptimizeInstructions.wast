@@ -1,11 +1,19 @@
-
 ;; This file contains patterns for OptimizeInstructions. Basically, we use a DSL for the patterns,
 ;; and the DSL is just wasm itself, plus some functions with special meanings
 ;;
 ;; This file is converted into OptimizeInstructions.wast.processed by
 ;;    scripts/process_optimize_instructions.py
-;; which makes it importable by C++. Then we just #include it there, avoiding the need to ship
-;; a data file on the side.
+;; which compiles the patterns into a C++ matcher. Then we just #include it there, so
+;; matching does not parse or compare anything generic at runtime.
+;;
+;; Each pattern is a block with an input and an output. The input's root must be a unary or
+;; binary operation, and its children can be operations, constants, or expressions from the
+;; DSL functions. When the input matches, it is replaced with the output. Patterns are tried
+;; in order, and after one is applied we try again on the result, so patterns must not have
+;; cycles.
+;;
+;; The output must do the same as the input, including traps: patterns cannot remove
+;; operations that may trap.
 
 (module
   ;; "expr" represents an arbitrary expression. The input is an id, so the same expression
@@ -17,11 +25,87 @@
   (import $f64.expr "dsl" "f64.expr" (param i32) (result f64))
   (import $any.expr "dsl" "any.expr" (param i32) (result i32)) ;; ignorable return type
 
-  ;; TODO for now wasm is not that convenient for a DSL like this. Needs rethinking.
+  ;; "pure" is like "expr", but only matches an expression without side effects. An expression
+  ;; that the output does not use, or that appears more than once in the input, must be pure,
+  ;; as we remove it.
+  (import $i32.pure "dsl" "i32.pure" (param i32) (result i32))
+  (import $i64.pure "dsl" "i64.pure" (param i32) (result i64))
+  (import $f32.pure "dsl" "f32.pure" (param i32) (result f32))
+  (import $f64.pure "dsl" "f64.pure" (param i32) (result f64))
 
   (func $patterns
     (block
+      ;; de Morgan's laws: the eqz of a comparison is the opposite comparison
+      (block (i32.eqz (i32.eq (call $i32.expr (i32.const 0)) (call $i32.expr (i32.const 1)))) (i32.ne (call $i32.expr (i32.const 0)) (call $i32.expr (i32.const 1))))
+      (block (i32.eqz (i32.ne (call $i32.expr (i32.const 0)) (call $i32.expr (i32.const 1)))) (i32.eq (call $i32.expr (i32.const 0)) (call $i32.expr (i32.const 1))))
+      (block (i32.eqz (i32.lt_s (call $i32.expr (i32.const 0)) (call $i32.expr (i32.const 1)))) (i32.ge_s (call $i32.expr (i32.const 0)) (call $i32.expr (i32.const 1))))
+      (block (i32.eqz (i32.lt_u (call $i32.expr (i32.const 0)) (call $i32.expr (i32.const 1)))) (i32.ge_u (call $i32.expr (i32.const 0)) (call $i32.expr (i32.const 1))))
+      (block (i32.eqz (i32.le_s (call $i32.expr (i32.const 0)) (call $i32.expr (i32.const 1)))) (i32.gt_s (call $i32.expr (i32.const 0)) (call $i32.expr (i32.const 1))))
+      (block (i32.eqz (i32.le_u (call $i32.expr (i32.const 0)) (call $i32.expr (i32.const 1)))) (i32.gt_u (call $i32.expr (i32.const 0)) (call $i32.expr (i32.const 1))))
+      (block (i32.eqz (i32.gt_s (call $i32.expr (i32.const 0)) (call $i32.expr (i32.const 1)))) (i32.le_s (call $i32.expr (i32.const 0)) (call $i32.expr (i32.const 1))))
+      (block (i32.eqz (i32.gt_u (call $i32.expr (i32.const 0)) (call $i32.expr (i32.const 1)))) (i32.le_u (call $i32.expr (i32.const 0)) (call $i32.expr (i32.const 1))))
+      (block (i32.eqz (i32.ge_s (call $i32.expr (i32.const 0)) (call $i32.expr (i32.const 1)))) (i32.lt_s (call $i32.expr (i32.const 0)) (call $i32.expr (i32.const 1))))
+      (block (i32.eqz (i32.ge_u (call $i32.expr (i32.const 0)) (call $i32.expr (i32.const 1)))) (i32.lt_u (call $i32.expr (i32.const 0)) (call $i32.expr (i32.const 1))))
+      (block (i32.eqz (i64.eq (call $i64.expr (i32.const 0)) (call $i64.expr (i32.const 1)))) (i64.ne (call $i64.expr (i32.const 0)) (call $i64.expr (i32.const 1))))
+      (block (i32.eqz (i64.ne (call $i64.expr (i32.const 0)) (call $i64.expr (i32.const 1)))) (i64.eq (call $i64.expr (i32.const 0)) (call $i64.expr (i32.const 1))))
+      (block (i32.eqz (i64.lt_s (call $i64.expr (i32.const 0)) (call $i64.expr (i32.const 1)))) (i64.ge_s (call $i64.expr (i32.const 0)) (call $i64.expr (i32.const 1))))
+      (block (i32.eqz (i64.lt_u (call $i64.expr (i32.const 0)) (call $i64.expr (i32.const 1)))) (i64.ge_u (call $i64.expr (i32.const 0)) (call $i64.expr (i32.const 1))))
+      (block (i32.eqz (i64.le_s (call $i64.expr (i32.const 0)) (call $i64.expr (i32.const 1)))) (i64.gt_s (call $i64.expr (i32.const 0)) (call $i64.expr (i32.const 1))))
+      (block (i32.eqz (i64.le_u (call $i64.expr (i32.const 0)) (call $i64.expr (i32.const 1)))) (i64.gt_u (call $i64.expr (i32.const 0)) (call $i64.expr (i32.const 1))))
+      (block (i32.eqz (i64.gt_s (call $i64.expr (i32.const 0)) (call $i64.expr (i32.const 1)))) (i64.le_s (call $i64.expr (i32.const 0)) (call $i64.expr (i32.const 1))))
+      (block (i32.eqz (i64.gt_u (call $i64.expr (i32.const 0)) (call $i64.expr (i32.const 1)))) (i64.le_u (call $i64.expr (i32.const 0)) (call $i64.expr (i32.const 1))))
+      (block (i32.eqz (i64.ge_s (call $i64.expr (i32.const 0)) (call $i64.expr (i32.const 1)))) (i64.lt_s (call $i64.expr (i32.const 0)) (call $i64.expr (i32.const 1))))
+      (block (i32.eqz (i64.ge_u (call $i64.expr (i32.const 0)) (call $i64.expr (i32.const 1)))) (i64.lt_u (call $i64.expr (i32.const 0)) (call $i64.expr (i32.const 1))))
+      (block (i32.eqz (f32.eq (call $f32.expr (i32.const 0)) (call $f32.expr (i32.const 1)))) (f32.ne (call $f32.expr (i32.const 0)) (call $f32.expr (i32.const 1))))
+      (block (i32.eqz (f32.ne (call $f32.expr (i32.const 0)) (call $f32.expr (i32.const 1)))) (f32.eq (call $f32.expr (i32.const 0)) (call $f32.expr (i32.const 1))))
+      (block (i32.eqz (f64.eq (call $f64.expr (i32.const 0)) (call $f64.expr (i32.const 1)))) (f64.ne (call $f64.expr (i32.const 0)) (call $f64.expr (i32.const 1))))
+      (block (i32.eqz (f64.ne (call $f64.expr (i32.const 0)) (call $f64.expr (i32.const 1)))) (f64.eq (call $f64.expr (i32.const 0)) (call $f64.expr (i32.const 1))))
+      ;; comparing to zero is an eqz
+      (block (i32.eq (call $i32.expr (i32.const 0)) (i32.const 0)) (i32.eqz (call $i32.expr (i32.const 0))))
+      (block (i64.eq (call $i64.expr (i32.const 0)) (i64.const 0)) (i64.eqz (call $i64.expr (i32.const 0))))
+      ;; operations that do nothing with a constant
+      (block (i32.and (call $i32.expr (i32.const 0)) (i32.const -1)) (call $i32.expr (i32.const 0)))
+      (block (i32.or (call $i32.expr (i32.const 0)) (i32.const 0)) (call $i32.expr (i32.const 0)))
+      (block (i32.xor (call $i32.expr (i32.const 0)) (i32.const 0)) (call $i32.expr (i32.const 0)))
+      (block (i32.shl (call $i32.expr (i32.const 0)) (i32.const 0)) (call $i32.expr (i32.const 0)))
+      (block (i32.shr_u (call $i32.expr (i32.const 0)) (i32.const 0)) (call $i32.expr (i32.const 0)))
+      (block (i32.shr_s (call $i32.expr (i32.const 0)) (i32.const 0)) (call $i32.expr (i32.const 0)))
+      (block (i32.rotl (call $i32.expr (i32.const 0)) (i32.const 0)) (call $i32.expr (i32.const 0)))
+      (block (i32.rotr (call $i32.expr (i32.const 0)) (i32.const 0)) (call $i32.expr (i32.const 0)))
+      (block (i32.mul (call $i32.expr (i32.const 0)) (i32.const 1)) (call $i32.expr (i32.const 0)))
+      (block (i32.div_s (call $i32.expr (i32.const 0)) (i32.const 1)) (call $i32.expr (i32.const 0)))
+      (block (i32.div_u (call $i32.expr (i32.const 0)) (i32.const 1)) (call $i32.expr (i32.const 0)))
+      (block (i64.and (call $i64.expr (i32.const 0)) (i64.const -1)) (call $i64.expr (i32.const 0)))
+      (block (i64.or (call $i64.expr (i32.const 0)) (i64.const 0)) (call $i64.expr (i32.const 0)))
+      (block (i64.xor (call $i64.expr (i32.const 0)) (i64.const 0)) (call $i64.expr (i32.const 0)))
+      (block (i64.shl (call $i64.expr (i32.const 0)) (i64.const 0)) (call $i64.expr (i32.const 0)))
+      (block (i64.shr_u (call $i64.expr (i32.const 0)) (i64.const 0)) (call $i64.expr (i32.const 0)))
+      (block (i64.shr_s (call $i64.expr (i32.const 0)) (i64.const 0)) (call $i64.expr (i32.const 0)))
+      (block (i64.rotl (call $i64.expr (i32.const 0)) (i64.const 0)) (call $i64.expr (i32.const 0)))
+      (block (i64.rotr (call $i64.expr (i32.const 0)) (i64.const 0)) (call $i64.expr (i32.const 0)))
+      (block (i64.mul (call $i64.expr (i32.const 0)) (i64.const 1)) (call $i64.expr (i32.const 0)))
+      (block (i64.div_s (call $i64.expr (i32.const 0)) (i64.const 1)) (call $i64.expr (i32.const 0)))
+      (block (i64.div_u (call $i64.expr (i32.const 0)) (i64.const 1)) (call $i64.expr (i32.const 0)))
+      (block (i64.add (call $i64.expr (i32.const 0)) (i64.const 0)) (call $i64.expr (i32.const 0)))
+      (block (i64.sub (call $i64.expr (i32.const 0)) (i64.const 0)) (call $i64.expr (i32.const 0)))
+      ;; operations whose result does not depend on an expression without side effects
+      (block (i32.and (call $i32.pure (i32.const 0)) (i32.const 0)) (i32.const 0))
+      (block (i32.mul (call $i32.pure (i32.const 0)) (i32.const 0)) (i32.const 0))
+      (block (i64.and (call $i64.pure (i32.const 0)) (i64.const 0)) (i64.const 0))
+      (block (i64.mul (call $i64.pure (i32.const 0)) (i64.const 0)) (i64.const 0))
+      ;; operations on an expression without side effects and itself
+      (block (i32.sub (call $i32.pure (i32.const 0)) (call $i32.pure (i32.const 0))) (i32.const 0))
+      (block (i32.xor (call $i32.pure (i32.const 0)) (call $i32.pure (i32.const 0))) (i32.const 0))
+      (block (i32.eq (call $i32.pure (i32.const 0)) (call $i32.pure (i32.const 0))) (i32.const 1))
+      (block (i32.ne (call $i32.pure (i32.const 0)) (call $i32.pure (i32.const 0))) (i32.const 0))
+      (block (i32.and (call $i32.pure (i32.const 0)) (call $i32.pure (i32.const 0))) (call $i32.pure (i32.const 0)))
+      (block (i32.or (call $i32.pure (i32.const 0)) (call $i32.pure (i32.const 0))) (call $i32.pure (i32.const 0)))
+      (block (i64.sub (call $i64.pure (i32.const 0)) (call $i64.pure (i32.const 0))) (i64.const 0))
+      (block (i64.xor (call $i64.pure (i32.const 0)) (call $i64.pure (i32.const 0))) (i64.const 0))
+      (block (i64.eq (call $i64.pure (i32.const 0)) (call $i64.pure (i32.const 0))) (i32.const 1))
+      (block (i64.ne (call $i64.pure (i32.const 0)) (call $i64.pure (i32.const 0))) (i32.const 0))
+      (block (i64.and (call $i64.pure (i32.const 0)) (call $i64.pure (i32.const 0))) (call $i64.pure (i32.const 0)))
+      (block (i64.or (call $i64.pure (i32.const 0)) (call $i64.pure (i32.const 0))) (call $i64.pure (i32.const 0)))
     )
   )
 )
-
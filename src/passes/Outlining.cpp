@@ -0,0 +1,367 @@
+/*
+ * Copyright 2017 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// Outlines repeated sequences of code, anywhere in the module, into new
+// functions, to reduce code size.
+//
+// Each statement in a block (that is, each item in its list) gets a
+// symbol, with equal statements getting the same one, and the statements
+// of all the blocks in the module form one long string of them, in which
+// a suffix array finds the sequences that repeat. The ones that save the
+// most are then replaced by calls to new functions that contain them.
+//
+// A statement can be moved to another function if it has no value, and
+// does not branch out of itself, return, or write locals. The locals it
+// reads become parameters of the new function.
+//
+// This complements CodeFolding, which merges identical code at the ends of
+// blocks and ifs in a single function, and DuplicateFunctionElimination,
+// which merges identical functions.
+//
+
+#include <algorithm>
+
+#include <wasm.h>
+#include <pass.h>
+#include <asm_v_wasm.h>
+#include <wasm-builder.h>
+#include <ir/find_all.h>
+#include <ir/manipulation.h>
+#include <ir/utils.h>
+#include <support/suffix_array.h>
+
+namespace wasm {
+
+// The size of a new function, in addition to its body, in the units of
+// Measurer: its declaration, and its body's size and local declarations.
+static const Index FunctionSize = 4;
+
+static const Index NoPosition = Index(-1);
+
+// An item in the string: a statement in a block, or the end of a block.
+struct Position {
+  Block* block; // null at the end of a block
+  Index index;
+  Index size;
+  Index parent = NoPosition; // the statement this is inside of, if any
+  bool outlined = false;
+  bool changedInside = false; // something inside this was outlined
+};
+
+// Finds the statements in a function, and whether they can be moved.
+struct StatementScanner : public ExpressionStackWalker<StatementScanner> {
+  struct Statement {
+    Expression* expr;
+    Index size;
+  };
+
+  // the blocks, in post-order, with their statements
+  std::vector<std::pair<Block*, std::vector<Statement>>> blocks;
+  // the statement each block is in, if any
+  std::unordered_map<Block*, Expression*> blockParents;
+  std::unordered_set<Expression*> unmovable;
+
+  // we note the sizes of statements as we leave them
+  Index numVisited = 0;
+  std::vector<Index> starts;
+  std::unordered_map<Expression*, Index> sizes;
+
+  static void doPreVisit(StatementScanner* self, Expression** currp) {
+    ExpressionStackWalker<StatementScanner>::doPreVisit(self, currp);
+    self->starts.push_back(self->numVisited);
+  }
+
+  static void doPostVisit(StatementScanner* self, Expression** currp) {
+    self->numVisited++;
+    auto size = self->numVisited - self->starts.back();
+    self->starts.pop_back();
+    if (self->getParent() && self->getParent()->is<Block>()) {
+      self->sizes[*currp] = size;
+    }
+    ExpressionStackWalker<StatementScanner>::doPostVisit(self, currp);
+  }
+
+  void visitBlock(Block* curr) {
+    std::vector<Statement> statements;
+    for (auto* item : curr->list) {
+      statements.push_back(Statement{ item, sizes[item] });
+    }
+    blocks.emplace_back(curr, std::move(statements));
+    for (Index i = expressionStack.size() - 1; i > 0; i--) {
+      if (expressionStack[i - 1]->is<Block>()) {
+        blockParents[curr] = expressionStack[i];
+        break;
+      }
+    }
+  }
+
+  void visitSetLocal(SetLocal* curr) {
+    markUnmovable();
+  }
+
+  void visitReturn(Return* curr) {
+    markUnmovable();
+  }
+
+  // everything that contains the current expression can't be moved
+  void markUnmovable() {
+    for (Index i = expressionStack.size(); i > 0; i--) {
+      if (!unmovable.insert(expressionStack[i - 1]).second) break;
+    }
+  }
+};
+
+struct Outlining : public Pass {
+  Module* module;
+
+  std::vector<Position> positions;
+  std::vector<uint32_t> string;
+
+  // the statements we've seen, by hash, with their symbols
+  std::unordered_map<uint64_t, std::vector<std::pair<Expression*, uint32_t>>> symbolsByHash;
+  uint32_t numSymbols = 0;
+
+  struct Replacement {
+    Index index, length;
+    Call* call;
+  };
+  std::unordered_map<Block*, std::vector<Replacement>> replacements;
+
+  Index nextName = 0;
+
+  void run(PassRunner* runner, Module* module_) override {
+    module = module_;
+    for (auto& func : module->functions) {
+      scan(func.get());
+    }
+    // give the statements that can't be outlined unique symbols
+    for (auto& symbol : string) {
+      if (symbol == uint32_t(-1)) symbol = numSymbols++;
+    }
+    findRepeats();
+    for (auto& pair : replacements) {
+      replace(pair.first, pair.second);
+    }
+  }
+
+  void scan(Function* func) {
+    ExpressionAnalyzer::SubtreeHashes hashes;
+    ExpressionAnalyzer::hash(func->body, hashes);
+    StatementScanner scanner;
+    scanner.walk(func->body);
+    std::unordered_map<Expression*, Index> statementPositions;
+    auto first = positions.size();
+    for (auto& pair : scanner.blocks) {
+      auto* block = pair.first;
+      auto& statements = pair.second;
+      for (Index i = 0; i < statements.size(); i++) {
+        auto* curr = statements[i].expr;
+        statementPositions[curr] = positions.size();
+        positions.emplace_back();
+        auto& position = positions.back();
+        position.block = block;
+        position.index = i;
+        position.size = statements[i].size;
+        if (curr->type == none && hashes[curr].closed && !scanner.unmovable.count(curr)) {
+          string.push_back(getSymbol(curr, hashes[curr].hash));
+        } else {
+          string.push_back(-1);
+        }
+      }
+      positions.emplace_back();
+      positions.back().block = nullptr;
+      positions.back().size = 0;
+      string.push_back(-1);
+    }
+    for (auto i = first; i < positions.size(); i++) {
+      auto* block = positions[i].block;
+      if (!block) continue;
+      auto iter = scanner.blockParents.find(block);
+      if (iter != scanner.blockParents.end()) {
+        positions[i].parent = statementPositions[iter->second];
+      }
+    }
+  }
+
+  uint32_t getSymbol(Expression* curr, uint64_t hash) {
+    auto& known = symbolsByHash[hash];
+    for (auto& pair : known) {
+      if (equal(curr, pair.first)) return pair.second;
+    }
+    known.emplace_back(curr, numSymbols);
+    return numSymbols++;
+  }
+
+  // the statements may be in different functions, so also compare the
+  // types, as a get_local's type depends on the function
+  static bool equal(Expression* left, Expression* right) {
+    bool typesDiffer = false;
+    auto comparer = [&](Expression* left, Expression* right) {
+      if (left->type != right->type) typesDiffer = true;
+      return false;
+    };
+    return ExpressionAnalyzer::flexibleEqual(left, right, comparer) && !typesDiffer;
+  }
+
+  // How much smaller the code gets by outlining a sequence of a certain
+  // size that appears a certain number of times.
+  static int64_t getBenefit(uint64_t size, Index count, Index numParams) {
+    int64_t before = size * count;
+    int64_t after = count * (1 + numParams) + size + FunctionSize + numParams;
+    return before - after;
+  }
+
+  void findRepeats() {
+    auto suffixes = SuffixArray::build(string);
+    auto lcp = SuffixArray::buildLCP(string, suffixes);
+    std::vector<uint64_t> sizesBefore(positions.size() + 1);
+    for (Index i = 0; i < positions.size(); i++) {
+      sizesBefore[i + 1] = sizesBefore[i] + positions[i].size;
+    }
+    struct Repeat {
+      uint32_t length, begin, end;
+      int64_t benefit; // an upper bound, assuming no overlap or parameters
+    };
+    std::vector<Repeat> repeats;
+    SuffixArray::forEachRepeat(lcp, [&](uint32_t length, uint32_t begin, uint32_t end) {
+      auto start = suffixes[begin];
+      auto size = sizesBefore[start + length] - sizesBefore[start];
+      auto benefit = getBenefit(size, end - begin, 0);
+      if (benefit > 0) {
+        repeats.push_back(Repeat{ length, begin, end, benefit });
+      }
+    });
+    std::stable_sort(repeats.begin(), repeats.end(), [](const Repeat& a, const Repeat& b) {
+      return a.benefit > b.benefit;
+    });
+    // greedily outline the best ones, skipping occurrences that overlap
+    // what we already outlined
+    for (auto& repeat : repeats) {
+      std::vector<Index> starts(suffixes.begin() + repeat.begin, suffixes.begin() + repeat.end);
+      std::sort(starts.begin(), starts.end());
+      std::vector<Index> chosen;
+      Index nextFree = 0;
+      for (auto start : starts) {
+        if (start >= nextFree && isAvailable(start, repeat.length)) {
+          chosen.push_back(start);
+          nextFree = start + repeat.length;
+        }
+      }
+      if (chosen.size() < 2) continue;
+      auto params = getParams(chosen[0], repeat.length);
+      auto size = sizesBefore[chosen[0] + repeat.length] - sizesBefore[chosen[0]];
+      if (getBenefit(size, chosen.size(), params.size()) <= 0) continue;
+      outline(chosen, repeat.length, params);
+    }
+  }
+
+  // checks that nothing in or around a sequence was outlined already
+  bool isAvailable(Index start, Index length) {
+    for (auto i = start; i < start + length; i++) {
+      if (positions[i].outlined || positions[i].changedInside) return false;
+    }
+    for (auto i = positions[start].parent; i != NoPosition; i = positions[i].parent) {
+      if (positions[i].outlined) return false;
+    }
+    return true;
+  }
+
+  // the locals a sequence reads, in order of appearance
+  std::vector<GetLocal*> getParams(Index start, Index length) {
+    std::vector<GetLocal*> params;
+    std::unordered_set<Index> seen;
+    for (auto i = start; i < start + length; i++) {
+      auto& position = positions[i];
+      for (auto* get : FindAll<GetLocal>(position.block->list[position.index]).list) {
+        if (seen.insert(get->index).second) {
+          params.push_back(get);
+        }
+      }
+    }
+    return params;
+  }
+
+  void outline(const std::vector<Index>& starts, Index length, const std::vector<GetLocal*>& params) {
+    Builder builder(*module);
+    // create the function, from the first occurrence
+    Name name;
+    do {
+      name = Name(std::string("outlined$") + std::to_string(nextName++));
+    } while (module->getFunctionOrNull(name));
+    auto* func = new Function;
+    func->name = name;
+    func->result = none;
+    std::unordered_map<Index, Index> paramIndexes;
+    for (auto* get : params) {
+      paramIndexes[get->index] = func->params.size();
+      func->params.push_back(get->type);
+    }
+    auto& first = positions[starts[0]];
+    auto* body = builder.makeBlock();
+    for (Index i = 0; i < length; i++) {
+      body->list.push_back(ExpressionManipulator::copy(first.block->list[first.index + i], *module));
+    }
+    body->finalize(none);
+    for (auto* get : FindAll<GetLocal>(body).list) {
+      get->index = paramIndexes[get->index];
+    }
+    func->body = body;
+    func->type = ensureFunctionType(getSig(func), module)->name;
+    module->addFunction(func);
+    // replace the occurrences with calls
+    for (auto start : starts) {
+      std::vector<Expression*> operands;
+      for (auto* get : params) {
+        operands.push_back(builder.makeGetLocal(get->index, get->type));
+      }
+      auto& position = positions[start];
+      auto* call = builder.makeCall(name, operands, none);
+      replacements[position.block].push_back(Replacement{ position.index, length, call });
+      for (auto i = start; i < start + length; i++) {
+        positions[i].outlined = true;
+      }
+      for (auto i = position.parent; i != NoPosition && !positions[i].changedInside; i = positions[i].parent) {
+        positions[i].changedInside = true;
+      }
+    }
+  }
+
+  void replace(Block* block, std::vector<Replacement>& blockReplacements) {
+    std::sort(blockReplacements.begin(), blockReplacements.end(), [](const Replacement& a, const Replacement& b) {
+      return a.index < b.index;
+    });
+    std::vector<Expression*> list;
+    Index next = 0;
+    for (Index i = 0; i < block->list.size();) {
+      if (next < blockReplacements.size() && blockReplacements[next].index == i) {
+        list.push_back(blockReplacements[next].call);
+        i += blockReplacements[next].length;
+        next++;
+      } else {
+        list.push_back(block->list[i]);
+        i++;
+      }
+    }
+    block->list.set(list);
+  }
+};
+
+Pass *createOutliningPass() {
+  return new Outlining();
+}
+
+} // namespace wasm
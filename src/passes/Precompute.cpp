@@ -17,6 +17,10 @@
 //
 // Computes code at compile time where possible.
 //
+// Each expression is evaluated after its children, and we remember the
+// subtrees that are not constant, so evaluating a parent stops as soon as it
+// reaches one of them, instead of evaluating the entire subtree again.
+//
 
 #include <wasm.h>
 #include <pass.h>
@@ -33,15 +37,41 @@ static const Name NONSTANDALONE_FLOW("Binaryen|nonstandalone");
 
 typedef std::unordered_map<GetLocal*, Literal> GetValues;
 
-// Execute an expression by itself. Errors if we hit anything we need anything not in the expression itself standalone.
+typedef std::unordered_set<Expression*> NonConstants;
+
+// Execute an expression by itself. If we hit anything not in the expression
+// itself, or something that traps, the result is a break to NONSTANDALONE_FLOW.
 class StandaloneExpressionRunner : public ExpressionRunner<StandaloneExpressionRunner> {
   // map gets to constant values, if they are known to be constant
   GetValues& getValues;
 
+  // subtrees that we already know are not constant
+  NonConstants& nonConstants;
+
+  // whether more gets may become known to be constant later, in which case
+  // a subtree that reads a get we do not know yet is not known to be
+  // non-constant
+  bool getValuesFinal;
+
+  // whether the subtree being executed read a get we do not know
+  bool readUnknownGet = false;
+
 public:
-  StandaloneExpressionRunner(GetValues& getValues) : getValues(getValues) {}
+  StandaloneExpressionRunner(GetValues& getValues, NonConstants& nonConstants, bool getValuesFinal) : getValues(getValues), nonConstants(nonConstants), getValuesFinal(getValuesFinal) {}
 
-  struct NonstandaloneException {}; // TODO: use a flow with a special name, as this is likely very slow
+  Flow execute(Expression* curr) {
+    if (nonConstants.count(curr)) {
+      return Flow(NONSTANDALONE_FLOW);
+    }
+    bool outerReadUnknownGet = readUnknownGet;
+    readUnknownGet = false;
+    auto flow = ExpressionRunner<StandaloneExpressionRunner>::execute(curr);
+    if (flow.breakTo == NONSTANDALONE_FLOW && (getValuesFinal || !readUnknownGet)) {
+      nonConstants.insert(curr);
+    }
+    readUnknownGet = readUnknownGet || outerReadUnknownGet;
+    return flow;
+  }
 
   Flow visitLoop(Loop* curr) {
     // loops might be infinite, so must be careful
@@ -66,6 +96,7 @@ public:
         return Flow(value);
       }
     }
+    readUnknownGet = true;
     return Flow(NONSTANDALONE_FLOW);
   }
   Flow visitSetLocal(SetLocal *curr) {
@@ -99,8 +130,8 @@ public:
     return Flow(NONSTANDALONE_FLOW);
   }
 
-  void trap(const char* why) override {
-    throw NonstandaloneException();
+  Flow trap(const char* why) override {
+    return Flow(NONSTANDALONE_FLOW);
   }
 };
 
@@ -115,15 +146,25 @@ struct Precompute : public WalkerPass<PostWalker<Precompute, UnifiedExpressionVi
 
   GetValues getValues;
 
+  NonConstants nonConstants;
+
+  bool getValuesFinal;
+
+  bool worked = false;
+
   void doWalkFunction(Function* func) {
     // with extra effort, we can utilize the get-set graph to precompute
     // things that use locals that are known to be constant. otherwise,
     // we just look at what is immediately before us
     if (propagate) {
+      getValuesFinal = false;
       optimizeLocals(func, getModule());
     }
     // do the main and final walk over everything
+    getValuesFinal = true;
     super::doWalkFunction(func);
+    getValues.clear();
+    nonConstants.clear();
   }
 
   void visitExpression(Expression* curr) {
@@ -133,6 +174,7 @@ struct Precompute : public WalkerPass<PostWalker<Precompute, UnifiedExpressionVi
     Flow flow = precomputeFlow(curr);
     if (flow.breaking()) {
       if (flow.breakTo == NONSTANDALONE_FLOW) return;
+      worked = true;
       if (flow.breakTo == RETURN_FLOW) {
         // this expression causes a return. if it's already a return, reuse the node
         if (auto* ret = curr->dynCast<Return>()) {
@@ -181,6 +223,7 @@ struct Precompute : public WalkerPass<PostWalker<Precompute, UnifiedExpressionVi
       return;
     }
     // this was precomputed
+    worked = true;
     if (isConcreteWasmType(flow.value.type)) {
       replaceCurrent(Builder(*getModule()).makeConst(flow.value));
     } else {
@@ -193,13 +236,14 @@ struct Precompute : public WalkerPass<PostWalker<Precompute, UnifiedExpressionVi
     ReFinalize().walkFunctionInModule(curr, getModule());
   }
 
+  PreservedAnalyses getPreservedAnalyses() override {
+    // if nothing was precomputed, the function was not changed
+    return worked ? PreservedAnalyses::none() : PreservedAnalyses::all();
+  }
+
 private:
   Flow precomputeFlow(Expression* curr) {
-    try {
-      return StandaloneExpressionRunner(getValues).visit(curr);
-    } catch (StandaloneExpressionRunner::NonstandaloneException& e) {
-      return Flow(NONSTANDALONE_FLOW);
-    }
+    return StandaloneExpressionRunner(getValues, nonConstants, getValuesFinal).visit(curr);
   }
 
   Literal precomputeValue(Expression* curr) {
@@ -216,7 +260,7 @@ private:
     // compute other sets as locals (since some of the gets they read may be
     // constant).
     // compute all dependencies
-    LocalGraph localGraph(func, module);
+    auto& localGraph = getFunctionAnalysis<LocalGraph>(func);
     localGraph.computeInfluences();
     // prepare the work list. we add things here that might change to a constant
     // initially, that means everything
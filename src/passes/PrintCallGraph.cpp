@@ -29,6 +29,10 @@
 namespace wasm {
 
 struct PrintCallGraph : public Pass {
+  PreservedAnalyses getPreservedAnalyses() override {
+    return PreservedAnalyses::all();
+  }
+
   void run(PassRunner* runner, Module* module) override {
     std::ostream &o = std::cout;
     o << "digraph call {\n"
@@ -0,0 +1,185 @@
+/*
+ * Copyright 2017 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// Simplifies globals:
+//
+//  * A mutable global that is never written, and is not exported, is
+//    marked immutable.
+//  * Reads of an immutable global with a constant value are replaced by
+//    that value. That includes the init of other globals.
+//
+// The optimizing version also optimizes the functions where we replaced
+// reads, so that precompute etc. can use the new constants.
+//
+
+#include <atomic>
+
+#include <wasm.h>
+#include <pass.h>
+#include <wasm-builder.h>
+
+namespace wasm {
+
+struct GlobalInfo {
+  std::atomic<bool> written;
+  bool exported = false;
+
+  GlobalInfo() : written(false) {}
+};
+
+typedef std::map<Name, GlobalInfo> NameGlobalInfoMap;
+
+struct GlobalWriteScanner : public WalkerPass<PostWalker<GlobalWriteScanner>> {
+  bool isFunctionParallel() override { return true; }
+
+  GlobalWriteScanner(NameGlobalInfoMap* infos) : infos(infos) {}
+
+  GlobalWriteScanner* create() override {
+    return new GlobalWriteScanner(infos);
+  }
+
+  void visitSetGlobal(SetGlobal* curr) {
+    assert(infos->count(curr->name) > 0); // can't add a new element in parallel
+    (*infos)[curr->name].written = true;
+  }
+
+private:
+  NameGlobalInfoMap* infos;
+};
+
+struct ConstantGlobals {
+  std::map<Name, Literal> values;
+  std::map<Function*, bool> changed; // the functions where we replaced reads
+};
+
+struct ConstantGlobalReplacer : public WalkerPass<PostWalker<ConstantGlobalReplacer>> {
+  bool isFunctionParallel() override { return true; }
+
+  ConstantGlobalReplacer(ConstantGlobals* constants) : constants(constants) {}
+
+  ConstantGlobalReplacer* create() override {
+    return new ConstantGlobalReplacer(constants);
+  }
+
+  void visitGetGlobal(GetGlobal* curr) {
+    auto iter = constants->values.find(curr->name);
+    if (iter != constants->values.end()) {
+      replaceCurrent(Builder(*getModule()).makeConst(iter->second));
+      worked = true;
+    }
+  }
+
+  void visitFunction(Function* curr) {
+    constants->changed[curr] = worked;
+  }
+
+private:
+  ConstantGlobals* constants;
+  bool worked = false;
+};
+
+struct SimplifyGlobals : public Pass {
+  // whether to optimize where we replaced reads
+  bool optimize;
+
+  SimplifyGlobals(bool optimize) : optimize(optimize) {}
+
+  void run(PassRunner* runner, Module* module) override {
+    NameGlobalInfoMap infos;
+    for (auto& global : module->globals) {
+      infos[global->name];
+    }
+    {
+      PassRunner scanner(module);
+      scanner.setIsNested(true);
+      scanner.add<GlobalWriteScanner>(&infos);
+      scanner.run();
+    }
+    for (auto& ex : module->exports) {
+      if (ex->kind == ExternalKind::Global && infos.count(ex->value)) {
+        infos[ex->value].exported = true;
+      }
+    }
+    // find the constants, in order, as a global's init may read an earlier
+    // one
+    ConstantGlobals constants;
+    for (auto& global : module->globals) {
+      auto& info = infos[global->name];
+      if (global->mutable_ && !info.written && !info.exported) {
+        global->mutable_ = false;
+      }
+      if (global->mutable_) continue;
+      if (auto* get = global->init->dynCast<GetGlobal>()) {
+        auto iter = constants.values.find(get->name);
+        if (iter != constants.values.end()) {
+          global->init = Builder(*module).makeConst(iter->second);
+        }
+      }
+      if (auto* c = global->init->dynCast<Const>()) {
+        constants.values[global->name] = c->value;
+      }
+    }
+    if (constants.values.empty()) return;
+    for (auto& func : module->functions) {
+      constants.changed[func.get()] = false; // ensure an entry for each function - we must not modify the map shape in parallel, just the values
+    }
+    {
+      PassRunner replacer(module);
+      replacer.setIsNested(true);
+      replacer.add<ConstantGlobalReplacer>(&constants);
+      replacer.run();
+    }
+    if (optimize) {
+      doOptimize(constants.changed, module, runner);
+    }
+  }
+
+  void doOptimize(std::map<Function*, bool>& changed, Module* module, PassRunner* parentRunner) {
+    // run on the changed functions only, keeping the rest on the side
+    std::vector<std::unique_ptr<Function>> all;
+    all.swap(module->functions);
+    module->updateMaps();
+    for (auto& func : all) {
+      if (changed[func.get()]) {
+        module->addFunction(func.get());
+      }
+    }
+    if (!module->functions.empty()) {
+      PassRunner runner(module, parentRunner->options);
+      runner.setIsNested(true);
+      runner.setValidateGlobally(false); // not a full valid module
+      runner.addDefaultFunctionOptimizationPasses();
+      runner.run();
+    }
+    // restore all the funcs
+    for (auto& func : module->functions) {
+      func.release();
+    }
+    all.swap(module->functions);
+    module->updateMaps();
+  }
+};
+
+Pass *createSimplifyGlobalsPass() {
+  return new SimplifyGlobals(false);
+}
+
+Pass *createSimplifyGlobalsOptimizingPass() {
+  return new SimplifyGlobals(true);
+}
+
+} // namespace wasm
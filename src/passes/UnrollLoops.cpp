@@ -0,0 +1,448 @@
+/*
+ * Copyright 2017 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// Loop unrolling and peeling
+//
+// Works on innermost loops in the canonical form of a do-while loop,
+//
+//  (loop $l
+//    ..body..
+//    (br_if $l (condition))
+//  )
+//
+// where nothing else branches back to the top. If the loop counts, that is,
+// a local starts at a constant, is changed by a constant step once in every
+// iteration, and the condition compares it to a constant, then we know the
+// number of iterations, and:
+//
+//  * If the copies fit in the size budget, we fully unroll the loop, and
+//    the constant values of the counter can then be folded.
+//  * Otherwise, if the loop control costs enough compared to the body,
+//    according to CostAnalyzer, we unroll several iterations into each
+//    one, and peel the remainder before the loop.
+//
+// Other loops are peeled once if the body branches on a local that has a
+// constant value when entering the loop, which can then be folded in the
+// peeled iteration.
+//
+// Size budgets depend on the shrink level; when shrinking a lot, nothing
+// is done.
+//
+
+#include <functional>
+
+#include <wasm.h>
+#include <wasm-builder.h>
+#include <wasm-traversal.h>
+#include <pass.h>
+#include <parsing.h>
+#include <ir/branch-utils.h>
+#include <ir/cost.h>
+#include <ir/find_all.h>
+#include <ir/literal-utils.h>
+#include <ir/local-graph.h>
+#include <ir/manipulation.h>
+#include <ir/utils.h>
+
+namespace wasm {
+
+// the most iterations we simulate to find the number of iterations
+static const Index MaxIterations = 1 << 16;
+
+// the most iterations we unroll into one
+static const Index MaxUnrollFactor = 4;
+
+// whether a comparison of constants is true, if it is a comparison
+static bool compare(BinaryOp op, Literal left, Literal right, bool& isComparison) {
+  isComparison = true;
+  switch (op) {
+    case EqInt32:
+    case EqInt64:  return left.eq(right).geti32();
+    case NeInt32:
+    case NeInt64:  return left.ne(right).geti32();
+    case LtSInt32:
+    case LtSInt64: return left.ltS(right).geti32();
+    case LtUInt32:
+    case LtUInt64: return left.ltU(right).geti32();
+    case LeSInt32:
+    case LeSInt64: return left.leS(right).geti32();
+    case LeUInt32:
+    case LeUInt64: return left.leU(right).geti32();
+    case GtSInt32:
+    case GtSInt64: return left.gtS(right).geti32();
+    case GtUInt32:
+    case GtUInt64: return left.gtU(right).geti32();
+    case GeSInt32:
+    case GeSInt64: return left.geS(right).geti32();
+    case GeUInt32:
+    case GeUInt64: return left.geU(right).geti32();
+    default: {
+      isComparison = false;
+      return false;
+    }
+  }
+}
+
+struct UnrollLoops : public WalkerPass<PostWalker<UnrollLoops>> {
+  bool isFunctionParallel() override { return true; }
+
+  Pass* create() override { return new UnrollLoops(); }
+
+  // the size budgets, in expressions
+  Index fullUnrollBudget, partialUnrollBudget, peelBudget;
+
+  // an innermost loop, and the expressions containing it
+  struct LoopLocation {
+    Expression** currp;
+    // the loop and the expressions containing it, innermost last, up to
+    // the body of the enclosing loop, or of the function if there is none
+    std::vector<Expression*> parents;
+    bool nested; // whether there is an enclosing loop
+  };
+
+  std::vector<LoopLocation> loops;
+
+  // whether we saw a loop inside the current one
+  bool sawInnerLoop = false;
+
+  std::vector<Expression*> expressionStack;
+
+  static void doNoteLoop(UnrollLoops* self, Expression** currp) {
+    self->sawInnerLoop = false;
+  }
+
+  static void doPushStack(UnrollLoops* self, Expression** currp) {
+    self->expressionStack.push_back(*currp);
+  }
+
+  static void doPopStack(UnrollLoops* self, Expression** currp) {
+    self->expressionStack.pop_back();
+  }
+
+  static void scan(UnrollLoops* self, Expression** currp) {
+    self->pushTask(doPopStack, currp);
+    if ((*currp)->is<Loop>()) {
+      self->pushTask(doVisitLoop, currp);
+      self->pushTask(scan, &(*currp)->cast<Loop>()->body);
+      self->pushTask(doNoteLoop, currp);
+    } else {
+      PostWalker<UnrollLoops>::scan(self, currp);
+    }
+    self->pushTask(doPushStack, currp);
+  }
+
+  void visitLoop(Loop* curr) {
+    if (!sawInnerLoop) {
+      auto begin = expressionStack.end() - 1;
+      while (begin != expressionStack.begin() && !(*(begin - 1))->is<Loop>()) {
+        begin--;
+      }
+      loops.push_back({ getCurrentPointer(), std::vector<Expression*>(begin, expressionStack.end()), begin != expressionStack.begin() });
+    }
+    sawInnerLoop = true;
+  }
+
+  void doWalkFunction(Function* func) {
+    auto shrinkLevel = getPassOptions().shrinkLevel;
+    if (shrinkLevel >= 2) return;
+    fullUnrollBudget = shrinkLevel == 0 ? 128 : 32;
+    partialUnrollBudget = shrinkLevel == 0 ? 64 : 0;
+    peelBudget = shrinkLevel == 0 ? 64 : 16;
+    walk(func->body);
+    if (loops.empty()) return;
+    LocalGraph* localGraph = &getFunctionAnalysis<LocalGraph>(func);
+    std::unique_ptr<LocalGraph> updatedGraph;
+    bool changed = false, graphIsStale = false;
+    for (auto& location : loops) {
+      if (graphIsStale) {
+        // the loops are disjoint, but the sets and gets they see changed
+        updatedGraph = make_unique<LocalGraph>(func, getModule());
+        localGraph = updatedGraph.get();
+        graphIsStale = false;
+      }
+      if (optimizeLoop(location, localGraph)) {
+        changed = graphIsStale = true;
+      }
+    }
+    loops.clear();
+    if (changed) {
+      // the copies have the same labels
+      wasm::UniqueNameMapper::uniquify(func->body);
+    }
+  }
+
+  // the parts of a loop in the canonical form
+  struct LoopInfo {
+    LoopLocation* location;
+    Loop* loop;
+    Block* body;
+    Break* back; // the branch back to the top, at the end of the body
+    std::unordered_set<SetLocal*> sets; // the sets in the loop
+  };
+
+  bool optimizeLoop(LoopLocation& location, LocalGraph* localGraph) {
+    auto* currp = location.currp;
+    LoopInfo info;
+    info.location = &location;
+    info.loop = (*currp)->cast<Loop>();
+    if (info.loop->type != none || !info.loop->name.is()) return false;
+    info.body = info.loop->body->dynCast<Block>();
+    if (!info.body || info.body->list.empty()) return false;
+    if (BranchUtils::BranchSeeker::hasNamed(info.body, info.body->name)) return false;
+    info.back = info.body->list.back()->dynCast<Break>();
+    if (!info.back || info.back->name != info.loop->name || !info.back->condition || info.back->value) return false;
+    if (BranchUtils::BranchSeeker::countNamed(info.body, info.loop->name) != 1) return false;
+    for (auto* set : FindAll<SetLocal>(info.body).list) {
+      info.sets.insert(set);
+    }
+    auto bodySize = Measurer::measure(info.body);
+    Index iterations;
+    if (getIterations(info, localGraph, iterations)) {
+      if (iterations * bodySize <= fullUnrollBudget) {
+        fullyUnroll(currp, info, iterations);
+        return true;
+      }
+      auto controlCost = CostAnalyzer(info.back).cost;
+      auto bodyCost = CostAnalyzer(info.body).cost - controlCost;
+      auto factor = std::min(MaxUnrollFactor, partialUnrollBudget / bodySize);
+      if (factor >= 2 && iterations >= 2 * factor && controlCost * 4 >= bodyCost) {
+        partiallyUnroll(currp, info, iterations, factor);
+        return true;
+      }
+    }
+    if (bodySize <= peelBudget && isPeelingUseful(info, localGraph)) {
+      peel(currp, info);
+      return true;
+    }
+    return false;
+  }
+
+  // the constant value of a get when entering the loop, if it has one. a
+  // get that reads a set in the loop must read exactly one set before it,
+  // which must run every time before we enter the loop, as otherwise the
+  // value of a set in the loop may reach the top from outside of it, after
+  // going around an enclosing loop.
+  bool getEntryValue(GetLocal* get, LoopInfo& info, LocalGraph* localGraph, Literal& value) {
+    auto& sets = localGraph->getSetses[get];
+    SetLocal* entry = nullptr;
+    bool found = false;
+    for (auto* set : sets) {
+      if (info.sets.count(set)) continue;
+      if (found) return false;
+      found = true;
+      entry = set;
+    }
+    if (!found) return false;
+    if (!entry) {
+      if (info.location->nested || getFunction()->isParam(get->index)) return false;
+      value = LiteralUtils::makeLiteralZero(get->type);
+      return true;
+    }
+    if (!isBeforeLoop(entry, info)) return false;
+    auto* c = entry->value->dynCast<Const>();
+    if (!c) return false;
+    value = c->value;
+    return true;
+  }
+
+  // whether a set runs every time before we enter the loop, and after the
+  // top of the enclosing loop, if there is one: that is, it is in a block
+  // that contains the loop, before it. nothing can branch past the set into
+  // the code after it in the block, so it dominates the loop, and going
+  // around the enclosing loop runs it again.
+  bool isBeforeLoop(SetLocal* set, LoopInfo& info) {
+    auto& parents = info.location->parents;
+    for (Index i = 0; i + 1 < parents.size(); i++) {
+      if (auto* block = parents[i]->dynCast<Block>()) {
+        for (auto* item : block->list) {
+          if (item == parents[i + 1]) break;
+          if (item == set) return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  // finds how many times the loop body runs, if the loop counts
+  bool getIterations(LoopInfo& info, LocalGraph* localGraph, Index& iterations) {
+    // the condition is the counter, or compares it to a constant
+    auto* condition = info.back->condition;
+    Expression* counter = condition;
+    Binary* comparison = nullptr;
+    Const* limit = nullptr;
+    bool counterOnLeft = true;
+    if (auto* binary = condition->dynCast<Binary>()) {
+      comparison = binary;
+      if ((limit = binary->right->dynCast<Const>())) {
+        counter = binary->left;
+      } else if ((limit = binary->left->dynCast<Const>())) {
+        counter = binary->right;
+        counterOnLeft = false;
+      } else {
+        return false;
+      }
+    }
+    // the counter is updated once, by a constant step, before the condition
+    SetLocal* update = nullptr;
+    if (auto* set = counter->dynCast<SetLocal>()) {
+      update = set;
+    } else if (auto* get = counter->dynCast<GetLocal>()) {
+      auto& sets = localGraph->getSetses[get];
+      if (sets.size() != 1 || !info.sets.count(*sets.begin())) return false;
+      update = *sets.begin();
+    } else {
+      return false;
+    }
+    for (auto* set : info.sets) {
+      if (set->index == update->index && set != update) return false;
+    }
+    auto* step = update->value->dynCast<Binary>();
+    if (!step || (step->op != AddInt32 && step->op != SubInt32 && step->op != AddInt64 && step->op != SubInt64)) {
+      return false;
+    }
+    auto* previous = step->left->dynCast<GetLocal>();
+    auto* amount = step->right->dynCast<Const>();
+    if (!previous || !amount || previous->index != update->index) return false;
+    if (!localGraph->getSetses[previous].count(update)) return false;
+    Literal value;
+    if (!getEntryValue(previous, info, localGraph, value)) return false;
+    // run the loop control until it exits
+    for (iterations = 1; iterations <= MaxIterations; iterations++) {
+      bool isAdd = step->op == AddInt32 || step->op == AddInt64;
+      value = isAdd ? value.add(amount->value) : value.sub(amount->value);
+      bool continues;
+      if (comparison) {
+        bool isComparison;
+        continues = counterOnLeft ? compare(comparison->op, value, limit->value, isComparison)
+                                  : compare(comparison->op, limit->value, value, isComparison);
+        if (!isComparison) return false;
+      } else {
+        continues = value.getInteger() != 0;
+      }
+      if (!continues) return true;
+    }
+    return false;
+  }
+
+  // a copy of the body, in which the branch back to the top is replaced
+  Block* copyBody(LoopInfo& info, std::function<Expression* (Expression*)> replaceBack) {
+    auto* copy = ExpressionManipulator::copy(info.body, *getModule())->cast<Block>();
+    auto* back = copy->list.back()->cast<Break>();
+    copy->list.back() = replaceBack(back->condition);
+    copy->finalize();
+    return copy;
+  }
+
+  // a copy of the body for an iteration that is known to continue to the
+  // next one, or to be the last
+  Block* copyIteration(LoopInfo& info) {
+    Builder builder(*getModule());
+    return copyBody(info, [&](Expression* condition) {
+      return builder.makeDrop(condition);
+    });
+  }
+
+  void fullyUnroll(Expression** currp, LoopInfo& info, Index iterations) {
+    Builder builder(*getModule());
+    auto* block = builder.makeBlock();
+    for (Index i = 0; i < iterations; i++) {
+      block->list.push_back(copyIteration(info));
+    }
+    block->finalize(none);
+    *currp = block;
+  }
+
+  // each iteration runs factor iterations of the original loop, and the
+  // remainder is run before it
+  void partiallyUnroll(Expression** currp, LoopInfo& info, Index iterations, Index factor) {
+    Builder builder(*getModule());
+    auto* block = builder.makeBlock();
+    for (Index i = 0; i < iterations % factor; i++) {
+      block->list.push_back(copyIteration(info));
+    }
+    auto* body = builder.makeBlock();
+    for (Index i = 0; i < factor - 1; i++) {
+      body->list.push_back(copyIteration(info));
+    }
+    body->list.push_back(info.body);
+    body->finalize(none);
+    info.loop->body = body;
+    block->list.push_back(info.loop);
+    block->finalize(none);
+    *currp = block;
+  }
+
+  // whether the body branches on a local that has a constant value when
+  // entering the loop, and is set in the loop (otherwise it would be
+  // constant in all iterations, which precompute-propagate can handle). we
+  // look at the conditions of ifs and br_ifs in the body before anything
+  // sets the local, so that in the first iteration they read the value
+  // from before the loop.
+  bool isPeelingUseful(LoopInfo& info, LocalGraph* localGraph) {
+    std::unordered_set<Index> setBefore;
+    for (Index i = 0; i + 1 < info.body->list.size(); i++) {
+      auto* item = info.body->list[i];
+      Expression* condition = nullptr;
+      if (auto* iff = item->dynCast<If>()) {
+        condition = iff->condition;
+      } else if (auto* br = item->dynCast<Break>()) {
+        condition = br->condition;
+      }
+      if (condition) {
+        if (auto* unary = condition->dynCast<Unary>()) {
+          if (unary->op == EqZInt32 || unary->op == EqZInt64) condition = unary->value;
+        } else if (auto* binary = condition->dynCast<Binary>()) {
+          if (binary->right->is<Const>()) condition = binary->left;
+          else if (binary->left->is<Const>()) condition = binary->right;
+        }
+        auto* get = condition->dynCast<GetLocal>();
+        if (get && !setBefore.count(get->index)) {
+          bool setInLoop = false;
+          for (auto* set : localGraph->getSetses[get]) {
+            if (info.sets.count(set)) setInLoop = true;
+          }
+          Literal value;
+          if (setInLoop && getEntryValue(get, info, localGraph, value)) return true;
+        }
+      }
+      for (auto* set : FindAll<SetLocal>(item).list) {
+        setBefore.insert(set->index);
+      }
+    }
+    return false;
+  }
+
+  // runs the first iteration before the loop, and only enters the loop if
+  // it continues
+  void peel(Expression** currp, LoopInfo& info) {
+    Builder builder(*getModule());
+    Name exit("unroll-peel");
+    auto* first = copyBody(info, [&](Expression* condition) {
+      return builder.makeBreak(exit, nullptr, builder.makeUnary(EqZInt32, condition));
+    });
+    auto* block = builder.makeBlock(exit, first);
+    block->list.push_back(info.loop);
+    block->finalize(none);
+    *currp = block;
+  }
+};
+
+Pass *createUnrollLoopsPass() {
+  return new UnrollLoops();
+}
+
+} // namespace wasm
@@ -70,12 +70,16 @@ void PassRegistry::registerPasses() {
   registerPass("code-folding", "fold code, merging duplicates", createCodeFoldingPass);
   registerPass("const-hoisting", "hoist repeated constants to a local", createConstHoistingPass);
   registerPass("dce", "removes unreachable code", createDeadCodeEliminationPass);
+  registerPass("directize", "turns indirect calls into direct ones, when the table contents are known", createDirectizePass);
+  registerPass("dse", "dead store elimination: removes stores that are overwritten before being read", createDeadStoreEliminationPass);
   registerPass("duplicate-function-elimination", "removes duplicate functions", createDuplicateFunctionEliminationPass);
   registerPass("extract-function", "leaves just one function (useful for debugging)", createExtractFunctionPass);
   registerPass("flatten", "flattens out code, removing nesting", createFlattenPass);
+  registerPass("gvn", "global value numbering: reuses redundant computations across the function", createGVNPass);
   registerPass("inlining", "inlines functions", createInliningPass);
   registerPass("inlining-optimizing", "inlines functions and optimizes where we inlined", createInliningOptimizingPass);
   registerPass("legalize-js-interface", "legalizes i64 types on the import/export boundary", createLegalizeJSInterfacePass);
+  registerPass("licm", "loop invariant code motion: computes invariant expressions once, before their loop", createLoopInvariantCodeMotionPass);
   registerPass("local-cse", "common subexpression elimination inside basic blocks", createLocalCSEPass);
   registerPass("log-execution", "instrument the build with logging of where execution goes", createLogExecutionPass);
   registerPass("i64-to-i32-lowering", "lower all uses of i64s to use i32s instead", createI64ToI32LoweringPass);
@@ -84,9 +88,11 @@ void PassRegistry::registerPasses() {
   registerPass("memory-packing", "packs memory into separate segments, skipping zeros", createMemoryPackingPass);
   registerPass("merge-blocks", "merges blocks to their parents", createMergeBlocksPass);
   registerPass("merge-locals", "merges locals when beneficial", createMergeLocalsPass);
+  registerPass("merge-similar-functions", "merges functions that differ only in constants", createMergeSimilarFunctionsPass);
   registerPass("metrics", "reports metrics", createMetricsPass);
   registerPass("nm", "name list", createNameListPass);
   registerPass("optimize-instructions", "optimizes instruction combinations", createOptimizeInstructionsPass);
+  registerPass("outlining", "outlines repeated sequences of code into new functions", createOutliningPass);
   registerPass("pick-load-signs", "pick load signs based on their uses", createPickLoadSignsPass);
   registerPass("post-emscripten", "miscellaneous optimizations for Emscripten-generated code", createPostEmscriptenPass);
   registerPass("precompute", "computes compile-time evaluatable expressions", createPrecomputePass);
@@ -104,6 +110,8 @@ void PassRegistry::registerPasses() {
   registerPass("reorder-functions", "sorts functions by access frequency", createReorderFunctionsPass);
   registerPass("reorder-locals", "sorts locals by access frequency", createReorderLocalsPass);
   registerPass("rereloop", "re-optimize control flow using the relooper algorithm", createReReloopPass);
+  registerPass("simplify-globals", "marks globals that are never written as immutable, and propagates constant ones", createSimplifyGlobalsPass);
+  registerPass("simplify-globals-optimizing", "simplifies globals and optimizes where we propagated constants", createSimplifyGlobalsOptimizingPass);
   registerPass("simplify-locals", "miscellaneous locals-related optimizations", createSimplifyLocalsPass);
   registerPass("safe-heap", "instrument loads and stores to check for invalid behavior", createSafeHeapPass);
   registerPass("simplify-locals-notee", "miscellaneous locals-related optimizations", createSimplifyLocalsNoTeePass);
@@ -113,6 +121,7 @@ void PassRegistry::registerPasses() {
   registerPass("ssa", "ssa-ify variables so that they have a single assignment", createSSAifyPass);
   registerPass("trap-mode-clamp", "replace trapping operations with clamping semantics", createTrapModeClamp);
   registerPass("trap-mode-js", "replace trapping operations with js semantics", createTrapModeJS);
+  registerPass("unroll-loops", "unrolls and peels small loops, especially ones with a constant number of iterations", createUnrollLoopsPass);
   registerPass("untee", "removes tee_locals, replacing them with sets and gets", createUnteePass);
   registerPass("vacuum", "removes obviously unneeded code", createVacuumPass);
 //  registerPass("lower-i64", "lowers i64 into pairs of i32s", createLowerInt64Pass);
@@ -138,6 +147,10 @@ void PassRunner::addDefaultFunctionOptimizationPasses() {
   if (options.optimizeLevel >= 2 || options.shrinkLevel >= 2) {
     add("code-pushing");
   }
+  if (options.optimizeLevel >= 3) {
+    add("licm");
+    add("unroll-loops");
+  }
   add("simplify-locals-nostructure"); // don't create if/block return values yet, as coalesce can remove copies that that could inhibit
   add("vacuum"); // previous pass creates garbage
   add("reorder-locals");
@@ -163,7 +176,11 @@ void PassRunner::addDefaultFunctionOptimizationPasses() {
   } else {
     add("precompute");
   }
-  if (options.shrinkLevel >= 2) {
+  if (options.optimizeLevel >= 3) {
+    add("gvn"); // a superset of local-cse
+    add("dse"); // after gvn removed loads that read the stores
+    add("coalesce-locals"); // just for gvn
+  } else if (options.shrinkLevel >= 2) {
     add("local-cse"); // TODO: run this early, before first coalesce-locals. right now doing so uncovers some deficiencies we need to fix first
     add("coalesce-locals"); // just for localCSE
   }
@@ -172,14 +189,23 @@ void PassRunner::addDefaultFunctionOptimizationPasses() {
 
 void PassRunner::addDefaultGlobalOptimizationPrePasses() {
   add("duplicate-function-elimination");
+  add("simplify-globals");
 }
 
 void PassRunner::addDefaultGlobalOptimizationPostPasses() {
   add("duplicate-function-elimination"); // optimizations show more functions as duplicate
+  add("directize"); // direct calls can be inlined
+  if (options.shrinkLevel >= 1) {
+    add("merge-similar-functions");
+  }
   add("remove-unused-module-elements");
+  add("simplify-globals-optimizing"); // optimizations may have removed writes
   if (options.optimizeLevel >= 2 || options.shrinkLevel >= 2) {
     add("inlining-optimizing");
   }
+  if (options.shrinkLevel >= 2) {
+    add("outlining");
+  }
   add("memory-packing");
 }
 
@@ -229,7 +255,7 @@ void PassRunner::run() {
           runPassOnFunction(pass, func.get());
         }
       } else {
-        pass->run(this, wasm);
+        runPassOnModule(pass);
       }
       auto after = std::chrono::steady_clock::now();
       std::chrono::duration<double> diff = after - before;
@@ -251,6 +277,7 @@ void PassRunner::run() {
       }
     }
     std::cerr << "[PassRunner] passes took " << totalTime.count() << " seconds." << std::endl;
+    std::cerr << "[PassRunner] analyses: " << analyses.computed << " computed, " << analyses.reused << " reused" << std::endl;
     // validate
     std::cerr << "[PassRunner] (final validation)\n";
     if (!WasmValidator().validate(*wasm, options.features, validationFlags)) {
@@ -297,11 +324,13 @@ void PassRunner::run() {
         stack.push_back(pass);
       } else {
         flush();
-        pass->run(this, wasm);
+        runPassOnModule(pass);
       }
     }
     flush();
   }
+  // the module may be modified outside of the runner before it runs again
+  analyses.clear();
 }
 
 void PassRunner::runFunction(Function* func) {
@@ -311,6 +340,7 @@ void PassRunner::runFunction(Function* func) {
   for (auto* pass : passes) {
     runPassOnFunction(pass, func);
   }
+  analyses.clear();
 }
 
 PassRunner::~PassRunner() {
@@ -328,7 +358,15 @@ void PassRunner::runPassOnFunction(Pass* pass, Function* func) {
   assert(pass->isFunctionParallel());
   // function-parallel passes get a new instance per function
   auto instance = std::unique_ptr<Pass>(pass->create());
+  instance->setPassRunner(this);
   instance->runFunction(this, wasm, func);
+  analyses.invalidate(func, instance->getPreservedAnalyses());
+}
+
+void PassRunner::runPassOnModule(Pass* pass) {
+  pass->setPassRunner(this);
+  pass->run(this, wasm);
+  analyses.invalidate(pass->getPreservedAnalyses());
 }
 
 int PassRunner::getPassDebug() {
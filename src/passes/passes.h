@@ -28,25 +28,31 @@ Pass* createCodeFoldingPass();
 Pass* createCodePushingPass();
 Pass* createConstHoistingPass();
 Pass* createDeadCodeEliminationPass();
+Pass* createDeadStoreEliminationPass();
+Pass* createDirectizePass();
 Pass* createDuplicateFunctionEliminationPass();
 Pass* createExtractFunctionPass();
 Pass* createFlattenPass();
 Pass* createFullPrinterPass();
+Pass* createGVNPass();
 Pass* createI64ToI32LoweringPass();
 Pass* createInliningPass();
 Pass* createInliningOptimizingPass();
 Pass* createLegalizeJSInterfacePass();
 Pass* createLocalCSEPass();
 Pass* createLogExecutionPass();
+Pass* createLoopInvariantCodeMotionPass();
 Pass* createInstrumentLocalsPass();
 Pass* createInstrumentMemoryPass();
 Pass* createMemoryPackingPass();
 Pass* createMergeBlocksPass();
 Pass* createMergeLocalsPass();
+Pass* createMergeSimilarFunctionsPass();
 Pass* createMinifiedPrinterPass();
 Pass* createMetricsPass();
 Pass* createNameListPass();
 Pass* createOptimizeInstructionsPass();
+Pass* createOutliningPass();
 Pass* createPickLoadSignsPass();
 Pass* createPostEmscriptenPass();
 Pass* createPrecomputePass();
@@ -63,6 +69,8 @@ Pass* createReorderFunctionsPass();
 Pass* createReorderLocalsPass();
 Pass* createReReloopPass();
 Pass* createSafeHeapPass();
+Pass* createSimplifyGlobalsPass();
+Pass* createSimplifyGlobalsOptimizingPass();
 Pass* createSimplifyLocalsPass();
 Pass* createSimplifyLocalsNoTeePass();
 Pass* createSimplifyLocalsNoStructurePass();
@@ -71,6 +79,7 @@ Pass* createSpillPointersPass();
 Pass* createSSAifyPass();
 Pass* createTrapModeClamp();
 Pass* createTrapModeJS();
+Pass* createUnrollLoopsPass();
 Pass* createUnteePass();
 Pass* createVacuumPass();
 
@@ -31,6 +31,7 @@ namespace wasm {
 
 struct ExitException {};
 struct TrapException {};
+struct OutOfFuelException {};
 
 struct ShellExternalInterface final : ModuleInstance::ExternalInterface {
   // The underlying memory can be accessed through unaligned pointers which
@@ -43,6 +44,7 @@ struct ShellExternalInterface final : ModuleInstance::ExternalInterface {
   class Memory {
     // Use char because it doesn't run afoul of aliasing rules.
     std::vector<char> memory;
+    MemorySnapshot snapshot;
     template <typename T>
     static bool aligned(const char* address) {
       static_assert(!(sizeof(T) & (sizeof(T) - 1)), "must be a power of 2");
@@ -67,8 +69,15 @@ struct ShellExternalInterface final : ModuleInstance::ExternalInterface {
         std::memset(&memory[newSize], 0, minSize - newSize);
       }
     }
+    void takeSnapshot() {
+      snapshot.take(memory);
+    }
+    void restoreSnapshot() {
+      snapshot.restore(memory);
+    }
     template <typename T>
     void set(size_t address, T value) {
+      snapshot.noteWrite(memory, address, sizeof(T));
       if (aligned<T>(&memory[address])) {
         *reinterpret_cast<T*>(&memory[address]) = value;
       } else {
@@ -89,7 +98,11 @@ struct ShellExternalInterface final : ModuleInstance::ExternalInterface {
 
   std::vector<Name> table;
 
-  ShellExternalInterface() : memory() {}
+  // where printing from the module, and notes about traps, are sent
+  std::ostream& output;
+  std::ostream& errorOutput;
+
+  ShellExternalInterface(std::ostream& output = std::cout, std::ostream& errorOutput = std::cerr) : memory(), output(output), errorOutput(errorOutput) {}
 
   void init(Module& wasm, ModuleInstance& instance) override {
     memory.resize(wasm.memory.initial * wasm::Memory::kPageSize);
@@ -134,12 +147,12 @@ struct ShellExternalInterface final : ModuleInstance::ExternalInterface {
   Literal callImport(Import *import, LiteralList& arguments) override {
     if (import->module == SPECTEST && import->base == PRINT) {
       for (auto argument : arguments) {
-        std::cout << argument << '\n';
+        output << argument << '\n';
       }
       return Literal();
     } else if (import->module == ENV && import->base == EXIT) {
       // XXX hack for torture tests
-      std::cout << "exit()\n";
+      output << "exit()\n";
       throw ExitException();
     }
     Fatal() << "callImport: unknown import: " << import->module.str << "."
@@ -180,8 +193,21 @@ struct ShellExternalInterface final : ModuleInstance::ExternalInterface {
     memory.resize(newSize);
   }
 
+  void snapshot() override {
+    memory.takeSnapshot();
+  }
+
+  void restore() override {
+    memory.restoreSnapshot();
+  }
+
+  void outOfFuel() override {
+    errorOutput << "[out of fuel]\n";
+    throw OutOfFuelException();
+  }
+
   void trap(const char* why) override {
-    std::cerr << "[trap " << why << "]\n";
+    errorOutput << "[trap " << why << "]\n";
     throw TrapException();
   }
 };
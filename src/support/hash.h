@@ -39,6 +39,65 @@ inline uint64_t rehash(uint64_t x, uint64_t y) { // see boost and https://stacko
   return x ^ (y + 0x9e3779b9 + (x << 6) + (x >> 2));
 }
 
+// A strong 64-bit hash, built up from a sequence of values, using the
+// round and final avalanche of xxHash64. The result only depends on the
+// values added, in order, so it is the same across runs and platforms, and
+// can be used as a persistent key.
+class Hasher64 {
+public:
+  static const uint64_t Prime1 = 0x9E3779B185EBCA87ULL;
+  static const uint64_t Prime2 = 0xC2B2AE3D27D4EB4FULL;
+  static const uint64_t Prime3 = 0x165667B19E3779F9ULL;
+  static const uint64_t Prime4 = 0x85EBCA77C2B2AE63ULL;
+  static const uint64_t Prime5 = 0x27D4EB2F165667C5ULL;
+
+  Hasher64(uint64_t seed = 0) : state(seed + Prime5) {}
+
+  void add(uint64_t value) {
+    uint64_t k = rotate(value * Prime2, 31) * Prime1;
+    state = rotate(state ^ k, 27) * Prime1 + Prime4;
+  }
+
+  // adds the contents of a string (not its address)
+  void addString(const char* str) {
+    if (!str) {
+      add(0);
+      return;
+    }
+    uint64_t size = 0;
+    while (1) {
+      // read 8 bytes at a time, little-endian, stopping at the terminator
+      uint64_t word = 0;
+      int i = 0;
+      for (; i < 8 && str[size + i]; i++) {
+        word |= uint64_t(uint8_t(str[size + i])) << (8 * i);
+      }
+      size += i;
+      if (i == 0) break;
+      add(word);
+      if (i < 8) break;
+    }
+    add(size + 1);
+  }
+
+  uint64_t finish() const {
+    uint64_t h = state;
+    h ^= h >> 33;
+    h *= Prime2;
+    h ^= h >> 29;
+    h *= Prime3;
+    h ^= h >> 32;
+    return h;
+  }
+
+private:
+  uint64_t state;
+
+  static uint64_t rotate(uint64_t x, int bits) {
+    return (x << bits) | (x >> (64 - bits));
+  }
+};
+
 } // namespace wasm
 
 #endif // wasm_support_hash_h
@@ -0,0 +1,151 @@
+/*
+ * Copyright 2017 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// A set of small integers, stored as a bitset. The first 64 bits are
+// inline, so sets of low indexes (the common case for locals) never
+// allocate; higher indexes grow a vector of words as needed. Unions
+// and intersection checks work a word at a time.
+//
+
+#ifndef wasm_support_small_bitset_h
+#define wasm_support_small_bitset_h
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "support/bits.h"
+
+namespace wasm {
+
+struct SmallBitSet {
+  typedef uint32_t Index;
+
+  SmallBitSet() {}
+
+  void insert(Index i) {
+    if (i < 64) {
+      low |= uint64_t(1) << i;
+      return;
+    }
+    size_t word = (i - 64) >> 6;
+    if (word >= high.size()) high.resize(word + 1);
+    high[word] |= uint64_t(1) << (i & 63);
+  }
+
+  void erase(Index i) {
+    if (i < 64) {
+      low &= ~(uint64_t(1) << i);
+      return;
+    }
+    size_t word = (i - 64) >> 6;
+    if (word < high.size()) high[word] &= ~(uint64_t(1) << (i & 63));
+  }
+
+  bool has(Index i) const {
+    if (i < 64) return (low >> i) & 1;
+    size_t word = (i - 64) >> 6;
+    return word < high.size() && ((high[word] >> (i & 63)) & 1);
+  }
+
+  // std::set-like membership check
+  size_t count(Index i) const { return has(i); }
+
+  bool empty() const {
+    if (low) return false;
+    for (auto word : high) {
+      if (word) return false;
+    }
+    return true;
+  }
+
+  size_t size() const {
+    size_t ret = PopCount(low);
+    for (auto word : high) ret += PopCount(word);
+    return ret;
+  }
+
+  void clear() {
+    low = 0;
+    high.clear();
+  }
+
+  bool intersects(const SmallBitSet& other) const {
+    if (low & other.low) return true;
+    size_t size = std::min(high.size(), other.high.size());
+    for (size_t i = 0; i < size; i++) {
+      if (high[i] & other.high[i]) return true;
+    }
+    return false;
+  }
+
+  // adds all the elements of other to this set, returning whether it changed
+  bool merge(const SmallBitSet& other) {
+    uint64_t changed = other.low & ~low;
+    low |= other.low;
+    if (other.high.size() > high.size()) high.resize(other.high.size());
+    for (size_t i = 0; i < other.high.size(); i++) {
+      changed |= other.high[i] & ~high[i];
+      high[i] |= other.high[i];
+    }
+    return changed != 0;
+  }
+
+  // removes all the elements of other from this set
+  void subtract(const SmallBitSet& other) {
+    low &= ~other.low;
+    size_t size = std::min(high.size(), other.high.size());
+    for (size_t i = 0; i < size; i++) {
+      high[i] &= ~other.high[i];
+    }
+  }
+
+  bool operator==(const SmallBitSet& other) const {
+    if (low != other.low) return false;
+    size_t size = std::max(high.size(), other.high.size());
+    for (size_t i = 0; i < size; i++) {
+      uint64_t a = i < high.size() ? high[i] : 0;
+      uint64_t b = i < other.high.size() ? other.high[i] : 0;
+      if (a != b) return false;
+    }
+    return true;
+  }
+  bool operator!=(const SmallBitSet& other) const {
+    return !(*this == other);
+  }
+
+  // calls func on each element, in increasing order
+  template<typename T>
+  void forEach(T func) const {
+    for (uint64_t bits = low; bits; bits &= bits - 1) {
+      func(Index(CountTrailingZeroes(bits)));
+    }
+    for (size_t i = 0; i < high.size(); i++) {
+      for (uint64_t bits = high[i]; bits; bits &= bits - 1) {
+        func(Index(64 + (i << 6) + CountTrailingZeroes(bits)));
+      }
+    }
+  }
+
+private:
+  uint64_t low = 0;
+  std::vector<uint64_t> high; // bits 64 and up
+};
+
+} // namespace wasm
+
+#endif // wasm_support_small_bitset_h
@@ -0,0 +1,175 @@
+/*
+ * Copyright 2017 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// A set of integers, stored as a bitset of which only the non-zero 64-bit
+// words are kept, sorted by their position. Memory is proportional to how
+// spread out the elements are, not to the largest possible element, while
+// unions and comparisons still work a word at a time. This suits sets of
+// locals in functions with a great many of them, of which few are in a set
+// at once, but which tend to cluster.
+//
+
+#ifndef wasm_support_sparse_bitset_h
+#define wasm_support_sparse_bitset_h
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+#include "support/bits.h"
+
+namespace wasm {
+
+struct SparseBitSet {
+  typedef uint32_t Index;
+
+  struct Word {
+    Index index; // the position of the word, that is, the element >> 6
+    uint64_t bits;
+
+    bool operator==(const Word& other) const {
+      return index == other.index && bits == other.bits;
+    }
+  };
+
+  SparseBitSet() {}
+
+  void insert(Index i) {
+    auto iter = find(i >> 6);
+    if (iter == words.end() || iter->index != (i >> 6)) {
+      iter = words.insert(iter, Word{ i >> 6, 0 });
+    }
+    iter->bits |= uint64_t(1) << (i & 63);
+  }
+
+  // returns whether the element was present
+  bool erase(Index i) {
+    auto iter = find(i >> 6);
+    if (iter == words.end() || iter->index != (i >> 6)) return false;
+    auto bit = uint64_t(1) << (i & 63);
+    if (!(iter->bits & bit)) return false;
+    iter->bits &= ~bit;
+    if (!iter->bits) words.erase(iter);
+    return true;
+  }
+
+  bool has(Index i) const {
+    auto iter = std::lower_bound(words.begin(), words.end(), i >> 6, [](const Word& word, Index index) {
+      return word.index < index;
+    });
+    return iter != words.end() && iter->index == (i >> 6) && ((iter->bits >> (i & 63)) & 1);
+  }
+
+  // std::set-like membership check
+  size_t count(Index i) const { return has(i); }
+
+  bool empty() const { return words.empty(); }
+
+  size_t size() const {
+    size_t ret = 0;
+    for (auto& word : words) ret += PopCount(word.bits);
+    return ret;
+  }
+
+  void clear() { words.clear(); }
+
+  // adds all the elements of other to this set, returning whether it changed
+  bool merge(const SparseBitSet& other) {
+    if (other.words.empty()) return false;
+    if (words.empty()) {
+      words = other.words;
+      return true;
+    }
+    std::vector<Word> merged;
+    merged.reserve(words.size() + other.words.size());
+    bool changed = false;
+    auto a = words.cbegin(), b = other.words.cbegin();
+    while (a != words.cend() || b != other.words.cend()) {
+      if (b == other.words.cend() || (a != words.cend() && a->index < b->index)) {
+        merged.push_back(*a++);
+      } else if (a == words.cend() || b->index < a->index) {
+        merged.push_back(*b++);
+        changed = true;
+      } else {
+        changed = changed || (b->bits & ~a->bits);
+        merged.push_back(Word{ a->index, a->bits | b->bits });
+        a++;
+        b++;
+      }
+    }
+    words.swap(merged);
+    return changed;
+  }
+
+  bool operator==(const SparseBitSet& other) const { return words == other.words; }
+  bool operator!=(const SparseBitSet& other) const { return words != other.words; }
+
+  // iteration, in increasing order
+  struct const_iterator {
+    typedef std::forward_iterator_tag iterator_category;
+    typedef Index value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const Index* pointer;
+    typedef Index reference;
+
+    const std::vector<Word>* words;
+    size_t pos;
+    uint64_t bits; // the remaining bits in the current word
+
+    const_iterator(const std::vector<Word>* words, size_t pos) : words(words), pos(pos), bits(pos < words->size() ? (*words)[pos].bits : 0) {}
+
+    Index operator*() const {
+      return ((*words)[pos].index << 6) + CountTrailingZeroes(bits);
+    }
+    const_iterator& operator++() {
+      bits &= bits - 1;
+      if (!bits && ++pos < words->size()) bits = (*words)[pos].bits;
+      return *this;
+    }
+    bool operator!=(const const_iterator& other) const {
+      return pos != other.pos || bits != other.bits;
+    }
+    bool operator==(const const_iterator& other) const {
+      return !(*this != other);
+    }
+  };
+
+  const_iterator begin() const { return const_iterator(&words, 0); }
+  const_iterator end() const { return const_iterator(&words, words.size()); }
+
+  void dump(const char* str = nullptr) const {
+    std::cout << "SparseBitSet " << (str ? str : "") << ": ";
+    for (auto x : *this) std::cout << x << " ";
+    std::cout << '\n';
+  }
+
+private:
+  std::vector<Word> words; // sorted by index, and never zero
+
+  std::vector<Word>::iterator find(Index index) {
+    return std::lower_bound(words.begin(), words.end(), index, [](const Word& word, Index index) {
+      return word.index < index;
+    });
+  }
+};
+
+} // namespace wasm
+
+#endif // wasm_support_sparse_bitset_h
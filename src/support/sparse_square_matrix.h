@@ -0,0 +1,102 @@
+/*
+ * Copyright 2017 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// A square matrix, for things like relations between pairs of locals.
+// Up to DenseLimit rows it is a plain dense array, which is fastest; past
+// that, the quadratic size would be prohibitive (20,000 locals would need
+// 400MB per function), while such matrices tend to be sparse, so we
+// switch to a blocked layout: the matrix is split into square tiles of
+// BlockSize rows, and a tile is only allocated once something non-zero is
+// written to it. Access remains a couple of array lookups, and memory is
+// proportional to the regions actually in use.
+//
+
+#ifndef wasm_support_sparse_square_matrix_h
+#define wasm_support_sparse_square_matrix_h
+
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace wasm {
+
+template<typename Ty>
+class SparseSquareMatrix {
+public:
+  typedef uint32_t Index;
+
+  static const Index DenseLimit = 2048;
+  static const Index BlockBits = 6;
+  static const Index BlockSize = 1 << BlockBits;
+
+  // clears the matrix, setting a new width
+  void recreate(Index width) {
+    N = width;
+    dense = N <= DenseLimit;
+    denseStorage.clear();
+    blocks.clear();
+    if (dense) {
+      denseStorage.resize(size_t(N) * N);
+    } else {
+      numBlocks = (N + BlockSize - 1) >> BlockBits;
+      blocks.resize(size_t(numBlocks) * numBlocks);
+    }
+  }
+
+  Index width() const { return N; }
+  bool isDense() const { return dense; }
+
+  void set(Index i, Index j, Ty value) {
+    assert(i < N && j < N);
+    if (dense) {
+      denseStorage[size_t(i) * N + j] = value;
+      return;
+    }
+    auto& block = blocks[blockIndex(i, j)];
+    if (!block) {
+      if (value == Ty()) return;
+      block.reset(new Ty[BlockSize * BlockSize]());
+    }
+    block[offset(i, j)] = value;
+  }
+
+  Ty get(Index i, Index j) const {
+    assert(i < N && j < N);
+    if (dense) return denseStorage[size_t(i) * N + j];
+    auto& block = blocks[blockIndex(i, j)];
+    return block ? block[offset(i, j)] : Ty();
+  }
+
+private:
+  Index N = 0;
+  bool dense = true;
+  std::vector<Ty> denseStorage;
+  Index numBlocks = 0;
+  std::vector<std::unique_ptr<Ty[]>> blocks;
+
+  size_t blockIndex(Index i, Index j) const {
+    return size_t(i >> BlockBits) * numBlocks + (j >> BlockBits);
+  }
+  static Index offset(Index i, Index j) {
+    return ((i & (BlockSize - 1)) << BlockBits) + (j & (BlockSize - 1));
+  }
+};
+
+} // namespace wasm
+
+#endif // wasm_support_sparse_square_matrix_h
@@ -0,0 +1,122 @@
+/*
+ * Copyright 2017 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+
+#include "support/suffix_array.h"
+
+namespace wasm {
+
+namespace SuffixArray {
+
+// Prefix doubling: after the round for k, the suffixes are sorted by
+// their first k symbols, and rank tells apart the ones that differ in
+// them. Sorting the pairs (rank[i], rank[i + k]) then sorts by the first
+// 2k symbols. Both sorts are counting sorts, so each round is linear.
+std::vector<uint32_t> build(const std::vector<uint32_t>& string) {
+  uint32_t size = string.size();
+  std::vector<uint32_t> suffixes(size), rank(size), temp(size);
+  if (size == 0) return suffixes;
+  uint32_t alphabet = *std::max_element(string.begin(), string.end()) + 1;
+  std::vector<uint32_t> counts(std::max(alphabet, size) + 1);
+  for (auto symbol : string) counts[symbol + 1]++;
+  for (uint32_t i = 1; i < counts.size(); i++) counts[i] += counts[i - 1];
+  for (uint32_t i = 0; i < size; i++) suffixes[counts[string[i]]++] = i;
+  uint32_t classes = 1;
+  rank[suffixes[0]] = 0;
+  for (uint32_t i = 1; i < size; i++) {
+    if (string[suffixes[i]] != string[suffixes[i - 1]]) classes++;
+    rank[suffixes[i]] = classes - 1;
+  }
+  for (uint32_t k = 1; classes < size; k *= 2) {
+    // order by the second half: suffixes without one come first
+    uint32_t next = 0;
+    for (uint32_t i = size - std::min(k, size); i < size; i++) temp[next++] = i;
+    for (auto suffix : suffixes) {
+      if (suffix >= k) temp[next++] = suffix - k;
+    }
+    // stably order by the first half
+    std::fill(counts.begin(), counts.begin() + classes + 1, 0);
+    for (uint32_t i = 0; i < size; i++) counts[rank[i] + 1]++;
+    for (uint32_t i = 1; i <= classes; i++) counts[i] += counts[i - 1];
+    for (auto suffix : temp) suffixes[counts[rank[suffix]]++] = suffix;
+    // re-rank
+    auto second = [&](uint32_t suffix) -> int64_t {
+      return suffix + k < size ? int64_t(rank[suffix + k]) : -1;
+    };
+    classes = 1;
+    temp[suffixes[0]] = 0;
+    for (uint32_t i = 1; i < size; i++) {
+      auto curr = suffixes[i], prev = suffixes[i - 1];
+      if (rank[curr] != rank[prev] || second(curr) != second(prev)) classes++;
+      temp[curr] = classes - 1;
+    }
+    rank.swap(temp);
+  }
+  return suffixes;
+}
+
+// Kasai et al.: going through the suffixes in string order, the LCP of
+// each is at least that of the previous one minus 1.
+std::vector<uint32_t> buildLCP(const std::vector<uint32_t>& string,
+                               const std::vector<uint32_t>& suffixes) {
+  uint32_t size = string.size();
+  std::vector<uint32_t> inverse(size), lcp(size);
+  for (uint32_t i = 0; i < size; i++) inverse[suffixes[i]] = i;
+  uint32_t length = 0;
+  for (uint32_t i = 0; i < size; i++) {
+    if (inverse[i] == 0) {
+      length = 0;
+      continue;
+    }
+    auto other = suffixes[inverse[i] - 1];
+    while (i + length < size && other + length < size &&
+           string[i + length] == string[other + length]) {
+      length++;
+    }
+    lcp[inverse[i]] = length;
+    if (length > 0) length--;
+  }
+  return lcp;
+}
+
+// The intervals nest, and a stack of the open ones finds them all in one
+// pass over the LCP array.
+void forEachRepeat(const std::vector<uint32_t>& lcp,
+                   std::function<void (uint32_t length, uint32_t begin, uint32_t end)> func) {
+  struct Open {
+    uint32_t length, begin;
+  };
+  std::vector<Open> stack;
+  stack.push_back(Open{ 0, 0 });
+  for (uint32_t i = 1; i <= lcp.size(); i++) {
+    uint32_t length = i < lcp.size() ? lcp[i] : 0;
+    uint32_t begin = i - 1;
+    while (length < stack.back().length) {
+      auto open = stack.back();
+      stack.pop_back();
+      func(open.length, open.begin, i);
+      begin = open.begin;
+    }
+    if (length > stack.back().length) {
+      stack.push_back(Open{ length, begin });
+    }
+  }
+}
+
+} // namespace SuffixArray
+
+} // namespace wasm
@@ -0,0 +1,61 @@
+/*
+ * Copyright 2017 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// Suffix arrays, for finding repeated substrings in long strings of
+// integers.
+//
+// The suffix array of a string lists the start positions of all its
+// suffixes in lexicographic order, so suffixes that begin with the same
+// substring are next to each other. The longest common prefix (LCP) array
+// has, for each position in the suffix array, the length of the prefix its
+// suffix shares with the previous one. Together they describe all the
+// repeats: every maximal run of suffixes whose LCPs are at least some
+// length is a substring of that length that appears at each of their
+// start positions.
+//
+
+#ifndef wasm_support_suffix_array_h
+#define wasm_support_suffix_array_h
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace wasm {
+
+namespace SuffixArray {
+
+// Builds the suffix array of a string of integers, in O(n log n) time.
+std::vector<uint32_t> build(const std::vector<uint32_t>& string);
+
+// Builds the LCP array, in linear time. The first entry is always 0.
+std::vector<uint32_t> buildLCP(const std::vector<uint32_t>& string,
+                               const std::vector<uint32_t>& suffixes);
+
+// Calls a function for each substring that appears more than once and is
+// not always followed by the same symbol, that is, for each interval
+// [begin, end) in the suffix array whose suffixes all begin with the same
+// substring, of a given length, which none of the suffixes before or after
+// them do.
+void forEachRepeat(const std::vector<uint32_t>& lcp,
+                   std::function<void (uint32_t length, uint32_t begin, uint32_t end)> func);
+
+} // namespace SuffixArray
+
+} // namespace wasm
+
+#endif // wasm_support_suffix_array_h
@@ -147,8 +147,9 @@ ThreadPool* ThreadPool::get() {
 
 void ThreadPool::work(std::vector<std::function<ThreadWorkState ()>>& doWorkers) {
   size_t num = threads.size();
-  // If no multiple cores, or on a side thread, do not use worker threads
-  if (num == 0) {
+  // If no multiple cores, or on a side thread, do not use worker threads. (If
+  // the pool is already running, we must be on one of its threads.)
+  if (num == 0 || running) {
     // just run sequentially
     DEBUG_POOL("work() sequentially\n");
     assert(doWorkers.size() > 0);
@@ -30,6 +30,17 @@ namespace wasm {
 struct ExecutionResults {
   std::map<Name, Literal> results;
 
+  // limits on the execution of each function
+  ExecutionLimits limits;
+
+  // whether we stopped early because a function ran out of fuel. the state
+  // after that point is not comparable, as optimizations change how much
+  // fuel is used.
+  bool outOfFuel = false;
+
+  ExecutionResults() {}
+  ExecutionResults(ExecutionLimits limits) : limits(limits) {}
+
   // get results of execution
   void get(Module& wasm) {
     if (wasm.imports.size() > 0) {
@@ -42,13 +53,17 @@ struct ExecutionResults {
     for (auto& exp : wasm.exports) {
       if (exp->kind != ExternalKind::Function) continue;
       auto* func = wasm.getFunction(exp->value);
+      auto result = run(func, wasm, instance);
+      if (outOfFuel) {
+        std::cout << "[fuzz-exec] out of fuel in " << exp->name << ", stopping\n";
+        break;
+      }
       if (func->result != none) {
         // this has a result
-        results[exp->name] = run(func, wasm, instance);
+        results[exp->name] = result;
         std::cout << "[fuzz-exec] note result: " << exp->name << " => " << results[exp->name] << '\n';
       } else {
-        // no result, run it anyhow (it might modify memory etc.)
-        run(func, wasm, instance);
+        // no result, but we ran it anyhow (it might modify memory etc.)
         std::cout << "[fuzz-exec] no result for void func: " << exp->name << '\n';
       }
     }
@@ -57,7 +72,7 @@ struct ExecutionResults {
 
   // get current results and check them against previous ones
   void check(Module& wasm) {
-    ExecutionResults optimizedResults;
+    ExecutionResults optimizedResults(limits);
     optimizedResults.get(wasm);
     if (optimizedResults != *this) {
       std::cout << "[fuzz-exec] optimization passes changed execution results";
@@ -70,6 +85,10 @@ struct ExecutionResults {
     for (auto& iter : results) {
       auto name = iter.first;
       if (other.results.find(name) == other.results.end()) {
+        if (other.outOfFuel) {
+          std::cout << "[fuzz-exec] skipping " << name << ", which was not reached due to running out of fuel\n";
+          continue;
+        }
         std::cout << "[fuzz-exec] missing " << name << '\n';
         abort();
       }
@@ -109,9 +128,13 @@ struct ExecutionResults {
         // zeros in arguments TODO: more?
         arguments.push_back(Literal(param));
       }
+      instance.setLimits(limits);
       return instance.callFunction(func->name, arguments);
     } catch (const TrapException&) {
       return Literal();
+    } catch (const OutOfFuelException&) {
+      outOfFuel = true;
+      return Literal();
     }
   }
 };
@@ -90,6 +90,16 @@ struct OptimizationOptions : public Options {
                 Options::Arguments::Zero,
                 [this](Options*, const std::string&) {
                   passOptions.ignoreImplicitTraps = true;
+                })
+           .add("--pass-arg", "-pa", "An argument passed along to optimization passes being run, in the form KEY@VALUE",
+                Options::Arguments::N,
+                [this](Options*, const std::string& argument) {
+                  auto at = argument.find('@');
+                  if (at == std::string::npos) {
+                    passOptions.arguments[argument] = "1";
+                  } else {
+                    passOptions.arguments[argument.substr(0, at)] = argument.substr(at + 1);
+                  }
                 });
     // add passes in registry
     for (const auto& p : PassRegistry::get()->getRegisteredNames()) {
@@ -258,9 +258,48 @@ struct CtorEvalExternalInterface : EvallingModuleInstance::ExternalInterface {
     throw FailToEvalException(std::string("trap: ") + why);
   }
 
+  // the stack contents do not matter after a ctor returns (see
+  // setupEnvironment), so only the singleton segment needs to be tracked
+  void snapshot() override {
+    hadSegment = wasm->memory.segments.size() > 0;
+    if (hadSegment) {
+      memorySnapshot.take(getSegmentData());
+    } else {
+      memorySnapshot.take(std::vector<char>());
+    }
+  }
+
+  void restore() override {
+    if (!hadSegment) {
+      // the segment did not exist, so anything in it is new
+      wasm->memory.segments.clear();
+      return;
+    }
+    memorySnapshot.restore(getSegmentData());
+  }
+
 private:
+  MemorySnapshot memorySnapshot;
+  // whether the singleton segment existed when the snapshot was taken
+  bool hadSegment = false;
+
   // TODO: handle unaligned too, see shell-interface
 
+  std::vector<char>& getSegmentData() {
+    if (wasm->memory.segments.size() == 0) {
+      std::vector<char> temp;
+      Builder builder(*wasm);
+      wasm->memory.segments.push_back(
+        Memory::Segment(
+          builder.makeConst(Literal(int32_t(0))),
+          temp
+        )
+      );
+    }
+    assert(wasm->memory.segments[0].offset->cast<Const>()->value.getInteger() == 0);
+    return wasm->memory.segments[0].data;
+  }
+
   template <typename T>
   T* getMemory(Address address) {
     // if memory is on the stack, use the stack
@@ -274,19 +313,8 @@ private:
     }
 
     // otherwise, this must be in the singleton segment. resize as needed
-    if (wasm->memory.segments.size() == 0) {
-      std::vector<char> temp;
-      Builder builder(*wasm);
-      wasm->memory.segments.push_back(
-        Memory::Segment(
-          builder.makeConst(Literal(int32_t(0))),
-          temp
-        )
-      );
-    }
-    assert(wasm->memory.segments[0].offset->cast<Const>()->value.getInteger() == 0);
     auto max = address + sizeof(T);
-    auto& data = wasm->memory.segments[0].data;
+    auto& data = getSegmentData();
     if (max > data.size()) {
       data.resize(max);
     }
@@ -295,6 +323,9 @@ private:
 
   template <typename T>
   void doStore(Address address, T value) {
+    if (address < STACK_START) {
+      memorySnapshot.noteWrite(getSegmentData(), address, sizeof(T));
+    }
     // do a memcpy to avoid undefined behavior if unaligned
     memcpy(getMemory<T>(address), &value, sizeof(T));
   }
@@ -324,9 +355,10 @@ void evalCtors(Module& wasm, std::vector<std::string> ctors) {
     // TODO: if we knew priorities, we could reorder?
     for (auto& ctor : ctors) {
       std::cerr << "trying to eval " << ctor << '\n';
-      // snapshot memory, as either the entire function is done, or none
-      auto memoryBefore = wasm.memory;
-      // snapshot globals (note that STACKTOP might be modified, but should
+      // snapshot the instance, as either the entire function is done, or none.
+      // memory is tracked copy-on-write, so this is cheap even if it is large
+      instance.snapshot();
+      // note globals (note that STACKTOP might be modified, but should
       // be returned, so that works out)
       auto globalsBefore = instance.globals;
       try {
@@ -335,12 +367,12 @@ void evalCtors(Module& wasm, std::vector<std::string> ctors) {
         // that's it, we failed, so stop here, cleaning up partial
         // memory changes first
         std::cerr << "  ...stopping since could not eval: " << fail.why << "\n";
-        wasm.memory = memoryBefore;
+        instance.restore();
         return;
       }
       if (instance.globals != globalsBefore) {
         std::cerr << "  ...stopping since globals modified\n";
-        wasm.memory = memoryBefore;
+        instance.restore();
         return;
       }
       std::cerr << "  ...success on " << ctor << ".\n";
@@ -66,6 +66,7 @@ int main(int argc, const char* argv[]) {
   bool debugInfo = false;
   bool fuzzExec = false;
   bool fuzzBinary = false;
+  ExecutionLimits fuzzExecLimits;
   std::string extraFuzzCommand;
   bool translateToFuzz = false;
   bool fuzzPasses = false;
@@ -89,6 +90,12 @@ int main(int argc, const char* argv[]) {
       .add("--fuzz-exec", "-fe", "Execute functions before and after optimization, helping fuzzing find bugs",
            Options::Arguments::Zero,
            [&](Options *o, const std::string &arguments) { fuzzExec = true; })
+      .add("--fuzz-exec-fuel", "-fef", "Limit the number of expressions each function may execute in fuzz-exec, stopping execution when it is reached",
+           Options::Arguments::One,
+           [&](Options *o, const std::string &argument) { fuzzExecLimits.fuel = std::stoull(argument); })
+      .add("--fuzz-exec-timeout", "-fet", "Limit the time in seconds each function may run in fuzz-exec, stopping execution when it is reached",
+           Options::Arguments::One,
+           [&](Options *o, const std::string &argument) { fuzzExecLimits.timeout = std::stod(argument); })
       .add("--fuzz-binary", "-fb", "Convert to binary and back after optimizations and before fuzz-exec, helping fuzzing find binary format bugs",
            Options::Arguments::Zero,
            [&](Options *o, const std::string &arguments) { fuzzBinary = true; })
@@ -150,7 +157,7 @@ int main(int argc, const char* argv[]) {
     }
   }
 
-  ExecutionResults results;
+  ExecutionResults results(fuzzExecLimits);
   if (fuzzExec) {
     results.get(wasm);
   }
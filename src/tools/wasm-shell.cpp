@@ -27,7 +27,9 @@
 #include "shell-interface.h"
 #include "support/command-line.h"
 #include "support/file.h"
+#include "support/threads.h"
 #include "wasm-interpreter.h"
+#include "wasm-jit.h"
 #include "wasm-printing.h"
 #include "wasm-s-parser.h"
 #include "wasm-validator.h"
@@ -43,12 +45,58 @@ Name ASSERT_RETURN("assert_return"),
      INVOKE("invoke"),
      GET("get");
 
-// Modules named in the file
+//
+// The state of running (part of) a script: the modules it built, and its
+// output. Output is buffered so that parts of scripts can run in parallel
+// and still print in order.
+//
+
+struct ShellState {
+  // Modules named in the script
+  std::map<Name, std::unique_ptr<Module>> modules;
+  std::map<Name, std::unique_ptr<SExpressionWasmBuilder>> builders;
+  std::map<Name, std::unique_ptr<ShellExternalInterface>> interfaces;
+  std::map<Name, std::unique_ptr<ModuleInstance>> instances;
+  std::map<Name, std::unique_ptr<BaselineJIT>> jits;
+
+  // whether to compile functions to native code where possible
+  bool jit = false;
+
+  std::stringstream out, err;
+  bool checked = false;
+
+  // print buffered output and give up
+  void fail() {
+    flush();
+    abort();
+  }
 
-std::map<Name, std::unique_ptr<Module>> modules;
-std::map<Name, std::unique_ptr<SExpressionWasmBuilder>> builders;
-std::map<Name, std::unique_ptr<ShellExternalInterface>> interfaces;
-std::map<Name, std::unique_ptr<ModuleInstance>> instances;
+  void flush() {
+    std::cout << out.str();
+    std::cerr << err.str();
+    out.str("");
+    err.str("");
+  }
+};
+
+//
+// A part of a script that can be run independently of the rest: a module
+// and the commands that follow it, or an entire script if commands refer to
+// modules by name.
+//
+
+struct ScriptPart {
+  Element* root;
+  // the index of the module to build, or -1 if the module was skipped (or
+  // these are commands before any module)
+  Index module;
+  // the commands to run, [start, end) in the root
+  size_t start, end;
+  // for a part that covers an entire script, the sub-parts to run in order
+  std::vector<ScriptPart> sequence;
+
+  ScriptPart(Element* root, Index module, size_t start, size_t end) : root(root), module(module), start(start), end(end) {}
+};
 
 //
 // An operation on a module
@@ -60,13 +108,13 @@ struct Operation {
   Name name;
   LiteralList arguments;
 
-  Operation(Element& element, ModuleInstance* instanceInit, SExpressionWasmBuilder& builder) : instance(instanceInit) {
+  Operation(Element& element, ModuleInstance* instanceInit, SExpressionWasmBuilder& builder, ShellState& state) : instance(instanceInit) {
     operation = element[0]->str();
     Index i = 1;
     if (element.size() >= 3 && element[2]->isStr()) {
       // module also specified
       Name moduleName = element[i++]->str();
-      instance = instances[moduleName].get();
+      instance = state.instances[moduleName].get();
     }
     name = element[i++]->str();
     for (size_t j = i; j < element.size(); j++) {
@@ -87,21 +135,41 @@ struct Operation {
   }
 };
 
-static void run_asserts(Name moduleName, size_t* i, bool* checked, Module* wasm,
-                        Element* root,
+// Whether a command refers to a module by name, which means it may depend on
+// a module from an earlier part of the script
+static bool refersToModule(Element& curr) {
+  if (curr.isStr() || curr.size() == 0) return false;
+  IString id = curr[0]->str();
+  if (id == INVOKE || id == GET) {
+    return curr.size() >= 3 && curr[2]->isStr();
+  }
+  if (id == ASSERT_RETURN || id == ASSERT_TRAP) {
+    return curr.size() >= 2 && refersToModule(*curr[1]);
+  }
+  return false;
+}
+
+static void run_asserts(Name moduleName, ScriptPart& part, ShellState& state, Module* wasm,
                         SExpressionWasmBuilder* builder,
                         Name entry) {
+  Element* root = part.root;
+  auto& err = state.err;
   ModuleInstance* instance = nullptr;
   if (wasm) {
-    auto tempInterface = wasm::make_unique<ShellExternalInterface>(); // prefix make_unique to work around visual studio bugs
+    auto tempInterface = wasm::make_unique<ShellExternalInterface>(state.out, state.err); // prefix make_unique to work around visual studio bugs
     auto tempInstance = wasm::make_unique<ModuleInstance>(*wasm, tempInterface.get());
-    interfaces[moduleName].swap(tempInterface);
-    instances[moduleName].swap(tempInstance);
-    instance = instances[moduleName].get();
+    state.interfaces[moduleName].swap(tempInterface);
+    state.instances[moduleName].swap(tempInstance);
+    instance = state.instances[moduleName].get();
+    if (state.jit) {
+      auto tempJIT = wasm::make_unique<BaselineJIT>(*wasm);
+      instance->setNativeExecutor(tempJIT.get());
+      state.jits[moduleName].swap(tempJIT);
+    }
     if (entry.is()) {
       Function* function = wasm->getFunction(entry);
       if (!function) {
-        std::cerr << "Unknown entry " << entry << std::endl;
+        err << "Unknown entry " << entry << std::endl;
       } else {
         LiteralList arguments;
         for (WasmType param : function->params) {
@@ -114,20 +182,19 @@ static void run_asserts(Name moduleName, size_t* i, bool* checked, Module* wasm,
       }
     }
   }
-  while (*i < root->size()) {
-    Element& curr = *(*root)[*i];
+  for (size_t i = part.start; i < part.end; i++) {
+    Element& curr = *(*root)[i];
     IString id = curr[0]->str();
-    if (id == MODULE) break;
-    *checked = true;
-    Colors::red(std::cerr);
-    std::cerr << *i << '/' << (root->size() - 1);
-    Colors::green(std::cerr);
-    std::cerr << " CHECKING: ";
-    Colors::normal(std::cerr);
-    std::cerr << curr;
-    Colors::green(std::cerr);
-    std::cerr << " [line: " << curr.line << "]\n";
-    Colors::normal(std::cerr);
+    state.checked = true;
+    Colors::red(err);
+    err << i << '/' << (root->size() - 1);
+    Colors::green(err);
+    err << " CHECKING: ";
+    Colors::normal(err);
+    err << curr;
+    Colors::green(err);
+    err << " [line: " << curr.line << "]\n";
+    Colors::normal(err);
     if (id == ASSERT_INVALID || id == ASSERT_MALFORMED || id == ASSERT_UNLINKABLE) {
       // a module invalidity test
       Module wasm;
@@ -142,19 +209,19 @@ static void run_asserts(Name moduleName, size_t* i, bool* checked, Module* wasm,
       }
       if (!invalid) {
         // maybe parsed ok, but otherwise incorrect
-        invalid = !WasmValidator().validate(wasm);
+        invalid = !WasmValidator().validate(wasm, MVP, WasmValidator::Globally | WasmValidator::Quiet);
       }
       if (!invalid && id == ASSERT_UNLINKABLE) {
         // validate "instantiating" the mdoule
         for (auto& import : wasm.imports) {
           if (import->module == SPECTEST && import->base == PRINT) {
             if (import->kind != ExternalKind::Function) {
-              std::cerr << "spectest.print should be a function, but is " << int32_t(import->kind) << '\n';
+              err << "spectest.print should be a function, but is " << int32_t(import->kind) << '\n';
               invalid = true;
               break;
             }
           } else {
-            std::cerr << "unknown import: " << import->module << '.' << import->base << '\n';
+            err << "unknown import: " << import->module << '.' << import->base << '\n';
             invalid = true;
             break;
           }
@@ -164,7 +231,7 @@ static void run_asserts(Name moduleName, size_t* i, bool* checked, Module* wasm,
             // spec tests consider it illegal to use spectest.print in a table
             if (auto* import = wasm.getImportOrNull(name)) {
               if (import->module == SPECTEST && import->base == PRINT) {
-                std::cerr << "cannot put spectest.print in table\n";
+                err << "cannot put spectest.print in table\n";
                 invalid = true;
               }
             }
@@ -172,51 +239,122 @@ static void run_asserts(Name moduleName, size_t* i, bool* checked, Module* wasm,
         }
       }
       if (!invalid) {
-        Colors::red(std::cerr);
-        std::cerr << "[should have been invalid]\n";
-        Colors::normal(std::cerr);
-        std::cerr << &wasm << '\n';
-        abort();
+        Colors::red(err);
+        err << "[should have been invalid]\n";
+        Colors::normal(err);
+        err << &wasm << '\n';
+        state.fail();
       }
     } else if (id == INVOKE) {
-      assert(wasm);
-      Operation operation(curr, instance, *builder);
+      if (!wasm) state.fail();
+      Operation operation(curr, instance, *builder, state);
       operation.operate();
     } else if (wasm) { // if no wasm, we skipped the module
       // an invoke test
       bool trapped = false;
-      WASM_UNUSED(trapped);
       Literal result;
       try {
-        Operation operation(*curr[1], instance, *builder);
+        Operation operation(*curr[1], instance, *builder, state);
         result = operation.operate();
       } catch (const TrapException&) {
         trapped = true;
       }
       if (id == ASSERT_RETURN) {
-        assert(!trapped);
+        if (trapped) {
+          err << "unexpected trap\n";
+          state.fail();
+        }
+        Literal expected;
         if (curr.size() >= 3) {
-          Literal expected = builder
-                                 ->parseExpression(*curr[2])
-                                 ->dynCast<Const>()
-                                 ->value;
-          std::cerr << "seen " << result << ", expected " << expected << '\n';
-          if (!expected.bitwiseEqual(result)) {
-            std::cout << "unexpected, should be identical\n";
-            abort();
-          }
-        } else {
-          Literal expected;
-          std::cerr << "seen " << result << ", expected " << expected << '\n';
-          if (!expected.bitwiseEqual(result)) {
-            std::cout << "unexpected, should be identical\n";
-            abort();
-          }
+          expected = builder->parseExpression(*curr[2])
+                            ->dynCast<Const>()
+                            ->value;
         }
+        err << "seen " << result << ", expected " << expected << '\n';
+        if (!expected.bitwiseEqual(result)) {
+          state.out << "unexpected, should be identical\n";
+          state.fail();
+        }
+      }
+      if (id == ASSERT_TRAP && !trapped) {
+        err << "expected a trap\n";
+        state.fail();
       }
-      if (id == ASSERT_TRAP) assert(trapped);
     }
-    *i += 1;
+  }
+}
+
+static void run_part(ScriptPart& part, ShellState& state, Name entry) {
+  if (!part.sequence.empty()) {
+    for (auto& sub : part.sequence) {
+      run_part(sub, state, entry);
+    }
+    return;
+  }
+  try {
+    if (part.module == Index(-1)) {
+      run_asserts(Name(), part, state, nullptr, nullptr, entry);
+      return;
+    }
+    Element& curr = *(*part.root)[part.module];
+    Colors::green(state.err);
+    state.err << "BUILDING MODULE [line: " << curr.line << "]\n";
+    Colors::normal(state.err);
+    auto module = wasm::make_unique<Module>();
+    Name moduleName;
+    auto builder = wasm::make_unique<SExpressionWasmBuilder>(*module, curr, &moduleName);
+    state.builders[moduleName].swap(builder);
+    state.modules[moduleName].swap(module);
+    bool valid = WasmValidator().validate(*state.modules[moduleName], MVP, WasmValidator::Globally | WasmValidator::Quiet);
+    if (!valid) {
+      state.flush();
+      WasmPrinter::printModule(state.modules[moduleName].get());
+      // validate again, this time printing the errors
+      WasmValidator().validate(*state.modules[moduleName]);
+      abort();
+    }
+    run_asserts(moduleName, part, state, state.modules[moduleName].get(), state.builders[moduleName].get(), entry);
+  } catch (ParseException& p) {
+    state.flush();
+    p.dump(std::cerr);
+    abort();
+  }
+}
+
+// Split a script into parts that can run independently
+static void split_script(Element& root, std::set<size_t>& skipped, std::vector<ScriptPart>& parts) {
+  std::vector<ScriptPart> found;
+  bool independent = true;
+  // A .wast may have multiple modules, with some asserts after them
+  size_t i = 0;
+  while (i < root.size()) {
+    Element& curr = *root[i];
+    if (skipped.count(curr.line) > 0) {
+      Colors::green(std::cerr);
+      std::cerr << "SKIPPING [line: " << curr.line << "]\n";
+      Colors::normal(std::cerr);
+      i++;
+      continue;
+    }
+    Index module = -1;
+    if (curr[0]->str() == MODULE) {
+      module = i;
+      i++;
+    }
+    size_t start = i;
+    while (i < root.size() && (*root[i])[0]->str() != MODULE) {
+      if (refersToModule(*root[i])) independent = false;
+      i++;
+    }
+    found.emplace_back(&root, module, start, i);
+  }
+  if (independent) {
+    for (auto& part : found) {
+      parts.emplace_back(std::move(part));
+    }
+  } else {
+    parts.emplace_back(&root, Index(-1), 0, 0);
+    parts.back().sequence = std::move(found);
   }
 }
 
@@ -227,6 +365,8 @@ static void run_asserts(Name moduleName, size_t* i, bool* checked, Module* wasm,
 int main(int argc, const char* argv[]) {
   Name entry;
   std::set<size_t> skipped;
+  std::vector<std::string> filenames;
+  bool jit = false;
 
   Options options("wasm-shell", "Execute .wast files");
   options
@@ -249,57 +389,71 @@ int main(int argc, const char* argv[]) {
               i = ending + 1;
             }
           })
-      .add_positional("INFILE", Options::Arguments::One,
-                      [](Options* o, const std::string& argument) {
-                        o->extra["infile"] = argument;
+      .add("--jit", "", "compile functions to native code where possible, interpreting the rest",
+           Options::Arguments::Zero,
+           [&jit](Options*, const std::string&) {
+             if (!BaselineJIT::isSupported()) {
+               std::cerr << "warning: the JIT is not supported on this platform, interpreting everything\n";
+             }
+             jit = true;
+           })
+      .add_positional("INFILES", Options::Arguments::N,
+                      [&filenames](Options* o, const std::string& argument) {
+                        filenames.push_back(argument);
                       });
   options.parse(argc, argv);
 
-  auto input(read_file<std::vector<char>>(options.extra["infile"], Flags::Text, options.debug ? Flags::Debug : Flags::Release));
+  // keep all inputs alive, as the parts of the scripts refer to them
+  std::vector<std::vector<char>> inputs;
+  std::vector<std::unique_ptr<SExpressionParser>> parsers;
+  std::vector<ScriptPart> parts;
+  std::vector<std::unique_ptr<ShellState>> states;
 
-  bool checked = false;
-
-  try {
-    if (options.debug) std::cerr << "parsing text to s-expressions...\n";
-    SExpressionParser parser(input.data());
-    Element& root = *parser.root;
+  for (auto& filename : filenames) {
+    inputs.push_back(read_file<std::vector<char>>(filename, Flags::Text, options.debug ? Flags::Debug : Flags::Release));
+    try {
+      if (options.debug) std::cerr << "parsing text to s-expressions...\n";
+      parsers.push_back(wasm::make_unique<SExpressionParser>(inputs.back().data()));
+    } catch (ParseException& p) {
+      p.dump(std::cerr);
+      abort();
+    }
+    split_script(*parsers.back()->root, skipped, parts);
+  }
 
-    // A .wast may have multiple modules, with some asserts after them
-    size_t i = 0;
-    while (i < root.size()) {
-      Element& curr = *root[i];
-      if (skipped.count(curr.line) > 0) {
-        Colors::green(std::cerr);
-        std::cerr << "SKIPPING [line: " << curr.line << "]\n";
-        Colors::normal(std::cerr);
-        i++;
-        continue;
-      }
-      IString id = curr[0]->str();
-      if (id == MODULE) {
-        if (options.debug) std::cerr << "parsing s-expressions to wasm...\n";
-        Colors::green(std::cerr);
-        std::cerr << "BUILDING MODULE [line: " << curr.line << "]\n";
-        Colors::normal(std::cerr);
-        auto module = wasm::make_unique<Module>();
-        Name moduleName;
-        auto builder = wasm::make_unique<SExpressionWasmBuilder>(*module, *root[i], &moduleName);
-        builders[moduleName].swap(builder);
-        modules[moduleName].swap(module);
-        i++;
-        bool valid = WasmValidator().validate(*modules[moduleName]);
-        if (!valid) {
-          WasmPrinter::printModule(modules[moduleName].get());
+  // Run the parts in parallel. Their outputs are buffered, and printed in
+  // order once everything is done.
+  std::vector<std::function<ThreadWorkState ()>> doWorkers;
+  std::atomic<size_t> nextPart;
+  nextPart.store(0);
+  size_t numParts = parts.size();
+  for (size_t i = 0; i < numParts; i++) {
+    states.push_back(wasm::make_unique<ShellState>());
+    states.back()->jit = jit;
+  }
+  if (numParts > 0) {
+    size_t num = ThreadPool::get()->size();
+    for (size_t i = 0; i < num; i++) {
+      doWorkers.push_back([&]() {
+        auto index = nextPart.fetch_add(1);
+        // get the next task, if there is one
+        if (index >= numParts) {
+          return ThreadWorkState::Finished; // nothing left
         }
-        assert(valid);
-        run_asserts(moduleName, &i, &checked, modules[moduleName].get(), &root, builders[moduleName].get(), entry);
-      } else {
-        run_asserts(Name(), &i, &checked, nullptr, &root, nullptr, entry);
-      }
+        run_part(parts[index], *states[index], entry);
+        if (index + 1 == numParts) {
+          return ThreadWorkState::Finished; // we did the last one
+        }
+        return ThreadWorkState::More;
+      });
     }
-  } catch (ParseException& p) {
-    p.dump(std::cerr);
-    abort();
+    ThreadPool::get()->work(doWorkers);
+  }
+
+  bool checked = false;
+  for (auto& state : states) {
+    state->flush();
+    checked = checked || state->checked;
   }
 
   if (checked) {
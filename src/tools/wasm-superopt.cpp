@@ -0,0 +1,856 @@
+/*
+ * Copyright 2017 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// Finds peephole optimizations for OptimizeInstructions in a corpus of
+// modules.
+//
+// We harvest small fragments of integer operations from the corpus, in
+// which the expressions the operations are done on are abstracted into
+// inputs, and count how often each appears. For the common fragments that
+// the existing passes do not already improve, we enumerate expressions over
+// the same inputs that are cheaper according to CostAnalyzer, and look for
+// one that computes the same on a set of test inputs. A candidate that
+// does is then checked using the interpreter on all combinations of
+// interesting values and on many random ones.
+//
+// The results are printed as patterns in the DSL of
+// src/passes/OptimizeInstructions.wast. Random testing is not a proof, so
+// they should be reviewed before being added there.
+//
+
+#include <memory>
+#include <random>
+
+#include "pass.h"
+#include "support/bits.h"
+#include "support/command-line.h"
+#include "support/file.h"
+#include "support/hash.h"
+#include "wasm-builder.h"
+#include "wasm-interpreter.h"
+#include "wasm-io.h"
+#include "ir/cost.h"
+#include "ir/effects.h"
+#include "ir/manipulation.h"
+#include "ir/utils.h"
+
+using namespace wasm;
+
+// The operations that fragments can contain, and their names in the DSL
+
+struct UnaryInfo {
+  UnaryOp op;
+  const char* name;
+  WasmType param;
+};
+
+static const UnaryInfo unaryInfos[] = {
+  { ClzInt32,     "i32.clz",          i32 },
+  { CtzInt32,     "i32.ctz",          i32 },
+  { PopcntInt32,  "i32.popcnt",       i32 },
+  { EqZInt32,     "i32.eqz",          i32 },
+  { ClzInt64,     "i64.clz",          i64 },
+  { CtzInt64,     "i64.ctz",          i64 },
+  { PopcntInt64,  "i64.popcnt",       i64 },
+  { EqZInt64,     "i64.eqz",          i64 },
+  { ExtendSInt32, "i64.extend_s/i32", i32 },
+  { ExtendUInt32, "i64.extend_u/i32", i32 },
+  { WrapInt64,    "i32.wrap/i64",     i64 },
+};
+
+struct BinaryInfo {
+  BinaryOp op;
+  const char* name;
+  WasmType param;
+  bool mayTrap; // we only harvest these with a constant divisor that does
+                // not trap, and never use them in candidates
+};
+
+static const BinaryInfo binaryInfos[] = {
+  { AddInt32,  "i32.add",   i32, false },
+  { SubInt32,  "i32.sub",   i32, false },
+  { MulInt32,  "i32.mul",   i32, false },
+  { DivSInt32, "i32.div_s", i32, true  },
+  { DivUInt32, "i32.div_u", i32, true  },
+  { RemSInt32, "i32.rem_s", i32, true  },
+  { RemUInt32, "i32.rem_u", i32, true  },
+  { AndInt32,  "i32.and",   i32, false },
+  { OrInt32,   "i32.or",    i32, false },
+  { XorInt32,  "i32.xor",   i32, false },
+  { ShlInt32,  "i32.shl",   i32, false },
+  { ShrUInt32, "i32.shr_u", i32, false },
+  { ShrSInt32, "i32.shr_s", i32, false },
+  { RotLInt32, "i32.rotl",  i32, false },
+  { RotRInt32, "i32.rotr",  i32, false },
+  { EqInt32,   "i32.eq",    i32, false },
+  { NeInt32,   "i32.ne",    i32, false },
+  { LtSInt32,  "i32.lt_s",  i32, false },
+  { LtUInt32,  "i32.lt_u",  i32, false },
+  { LeSInt32,  "i32.le_s",  i32, false },
+  { LeUInt32,  "i32.le_u",  i32, false },
+  { GtSInt32,  "i32.gt_s",  i32, false },
+  { GtUInt32,  "i32.gt_u",  i32, false },
+  { GeSInt32,  "i32.ge_s",  i32, false },
+  { GeUInt32,  "i32.ge_u",  i32, false },
+  { AddInt64,  "i64.add",   i64, false },
+  { SubInt64,  "i64.sub",   i64, false },
+  { MulInt64,  "i64.mul",   i64, false },
+  { DivSInt64, "i64.div_s", i64, true  },
+  { DivUInt64, "i64.div_u", i64, true  },
+  { RemSInt64, "i64.rem_s", i64, true  },
+  { RemUInt64, "i64.rem_u", i64, true  },
+  { AndInt64,  "i64.and",   i64, false },
+  { OrInt64,   "i64.or",    i64, false },
+  { XorInt64,  "i64.xor",   i64, false },
+  { ShlInt64,  "i64.shl",   i64, false },
+  { ShrUInt64, "i64.shr_u", i64, false },
+  { ShrSInt64, "i64.shr_s", i64, false },
+  { RotLInt64, "i64.rotl",  i64, false },
+  { RotRInt64, "i64.rotr",  i64, false },
+  { EqInt64,   "i64.eq",    i64, false },
+  { NeInt64,   "i64.ne",    i64, false },
+  { LtSInt64,  "i64.lt_s",  i64, false },
+  { LtUInt64,  "i64.lt_u",  i64, false },
+  { LeSInt64,  "i64.le_s",  i64, false },
+  { LeUInt64,  "i64.le_u",  i64, false },
+  { GtSInt64,  "i64.gt_s",  i64, false },
+  { GtUInt64,  "i64.gt_u",  i64, false },
+  { GeSInt64,  "i64.ge_s",  i64, false },
+  { GeUInt64,  "i64.ge_u",  i64, false },
+};
+
+static const UnaryInfo* getInfo(UnaryOp op) {
+  for (auto& info : unaryInfos) {
+    if (info.op == op) return &info;
+  }
+  return nullptr;
+}
+
+static const BinaryInfo* getInfo(BinaryOp op) {
+  for (auto& info : binaryInfos) {
+    if (info.op == op) return &info;
+  }
+  return nullptr;
+}
+
+static bool isInteger(WasmType type) {
+  return type == i32 || type == i64;
+}
+
+// values are kept as bits, zero-extended for i32s
+
+static uint64_t toBits(Literal value) {
+  return value.type == i32 ? uint32_t(value.geti32()) : uint64_t(value.geti64());
+}
+
+static Literal toLiteral(WasmType type, uint64_t bits) {
+  return type == i32 ? Literal(int32_t(bits)) : Literal(int64_t(bits));
+}
+
+// A fragment of integer operations. Its gets are its inputs: expressions
+// that it operates on but that we abstracted away.
+
+struct Fragment {
+  Expression* expr;
+  std::vector<WasmType> inputs;
+  std::vector<bool> repeated; // inputs that appear more than once
+  Index count = 0;
+};
+
+static Name TRAP_FLOW("superopt|trap");
+
+// Evaluates fragments and candidates on given values of their inputs
+
+class FragmentRunner : public ExpressionRunner<FragmentRunner> {
+public:
+  const std::vector<Literal>* inputs = nullptr;
+
+  Flow visitGetLocal(GetLocal* curr) {
+    return Flow((*inputs)[curr->index]);
+  }
+
+  Flow trap(const char* why) override {
+    return Flow(TRAP_FLOW);
+  }
+
+  // returns whether it did not trap
+  bool evaluate(Expression* curr, const std::vector<Literal>& values, uint64_t& result) {
+    inputs = &values;
+    auto flow = visit(curr);
+    if (flow.breaking()) return false;
+    result = toBits(flow.value);
+    return true;
+  }
+};
+
+// Harvests the fragments rooted at every integer operation in a module
+
+struct Harvester : public PostWalker<Harvester> {
+  Module& scratch;
+  PassOptions& passOptions;
+  Index maxDepth;
+  Index maxInputs;
+  std::vector<Fragment>& fragments;
+  std::unordered_map<uint64_t, std::vector<Index>>& fragmentsByHash;
+
+  Harvester(Module& scratch, PassOptions& passOptions, Index maxDepth, Index maxInputs, std::vector<Fragment>& fragments, std::unordered_map<uint64_t, std::vector<Index>>& fragmentsByHash) : scratch(scratch), passOptions(passOptions), maxDepth(maxDepth), maxInputs(maxInputs), fragments(fragments), fragmentsByHash(fragmentsByHash) {}
+
+  // state while building a fragment
+  Index depthLimit;
+  std::vector<Expression*> leaves;
+  Fragment fragment;
+  bool abstracted; // whether the depth limit abstracted an operation away
+  bool valid;
+
+  void visitUnary(Unary* curr) {
+    harvest(curr);
+  }
+  void visitBinary(Binary* curr) {
+    harvest(curr);
+  }
+
+  void harvest(Expression* curr) {
+    if (!isInteger(curr->type) || !isSupported(curr)) return;
+    // harvest the fragments up to each depth, until there is nothing deeper
+    for (depthLimit = 1; depthLimit <= maxDepth; depthLimit++) {
+      leaves.clear();
+      fragment = Fragment();
+      abstracted = false;
+      valid = true;
+      fragment.expr = build(curr, 0);
+      if (!valid) return;
+      note();
+      if (!abstracted) return;
+    }
+  }
+
+  bool isSupported(Expression* curr) {
+    if (auto* unary = curr->dynCast<Unary>()) {
+      return getInfo(unary->op);
+    }
+    if (auto* binary = curr->dynCast<Binary>()) {
+      auto* info = getInfo(binary->op);
+      if (!info) return false;
+      if (!info->mayTrap) return true;
+      // a division or remainder that cannot trap
+      auto* c = binary->right->dynCast<Const>();
+      if (!c) return false;
+      auto divisor = toBits(c->value);
+      if (divisor == 0) return false;
+      bool isSigned = binary->op == DivSInt32 || binary->op == DivSInt64;
+      return !(isSigned && int64_t(toLiteral(c->type, divisor).getInteger()) == -1);
+    }
+    return false;
+  }
+
+  Expression* build(Expression* curr, Index depth) {
+    Builder builder(scratch);
+    if (auto* c = curr->dynCast<Const>()) {
+      if (isInteger(c->type)) return builder.makeConst(c->value);
+    }
+    if (isSupported(curr)) {
+      if (depth < depthLimit) {
+        if (auto* unary = curr->dynCast<Unary>()) {
+          return builder.makeUnary(unary->op, build(unary->value, depth + 1));
+        }
+        auto* binary = curr->cast<Binary>();
+        auto* left = build(binary->left, depth + 1);
+        auto* right = build(binary->right, depth + 1);
+        return builder.makeBinary(binary->op, left, right);
+      }
+      abstracted = true;
+    }
+    return makeInput(curr);
+  }
+
+  Expression* makeInput(Expression* curr) {
+    Builder builder(scratch);
+    if (!isInteger(curr->type)) {
+      valid = false;
+      return builder.makeUnreachable();
+    }
+    // an expression without side effects that we saw before has the same
+    // value, and is the same input
+    bool pure = !EffectAnalyzer(passOptions, curr).hasSideEffects();
+    for (Index i = 0; i < leaves.size(); i++) {
+      if (pure && fragment.inputs[i] == curr->type && ExpressionAnalyzer::equal(leaves[i], curr)) {
+        fragment.repeated[i] = true;
+        return builder.makeGetLocal(i, curr->type);
+      }
+    }
+    if (leaves.size() == maxInputs) {
+      valid = false;
+    }
+    leaves.push_back(curr);
+    fragment.inputs.push_back(curr->type);
+    fragment.repeated.push_back(false);
+    return builder.makeGetLocal(leaves.size() - 1, curr->type);
+  }
+
+  void note() {
+    auto hash = ExpressionAnalyzer::hash(fragment.expr);
+    auto& indices = fragmentsByHash[hash];
+    for (auto index : indices) {
+      auto& other = fragments[index];
+      if (other.inputs == fragment.inputs && other.repeated == fragment.repeated &&
+          ExpressionAnalyzer::equal(other.expr, fragment.expr)) {
+        other.count++;
+        return;
+      }
+    }
+    indices.push_back(fragments.size());
+    fragments.push_back(fragment);
+    fragments.back().count = 1;
+  }
+};
+
+// Whether optimize-instructions and precompute already make a fragment
+// cheaper
+static bool isAlreadyOptimized(Fragment& fragment) {
+  Module module;
+  Builder builder(module);
+  std::vector<NameType> params;
+  for (Index i = 0; i < fragment.inputs.size(); i++) {
+    params.emplace_back(Name(std::string("input") + std::to_string(i)), fragment.inputs[i]);
+  }
+  auto* func = builder.makeFunction("fragment", std::move(params), fragment.expr->type, {}, ExpressionManipulator::copy(fragment.expr, module));
+  module.addFunction(func);
+  PassRunner runner(&module);
+  runner.add("optimize-instructions");
+  runner.add("precompute");
+  runner.run();
+  return CostAnalyzer(func->body).cost < CostAnalyzer(fragment.expr).cost;
+}
+
+// Searches for a cheaper expression that is equivalent to a fragment
+
+struct Search {
+  // a candidate, whose children are other candidates
+  struct Candidate {
+    enum Kind { InputKind, ConstKind, UnaryKind, BinaryKind } kind;
+    Index index; // the input, or the op for unaries and binaries
+    uint64_t bits; // the value of a constant
+    Index left, right;
+    WasmType type;
+    Index cost;
+    // the inputs that the candidate uses, which must be in order
+    uint32_t used;
+    Index first, last;
+  };
+
+  Fragment& fragment;
+  Module& scratch;
+  std::mt19937_64& random;
+  Index samples;
+  Index maxCandidates;
+
+  FragmentRunner runner;
+
+  // the values of the inputs that we compare candidates on, and what the
+  // fragment computes for them
+  std::vector<std::vector<Literal>> tests;
+  std::vector<uint64_t> expected;
+
+  std::vector<Candidate> candidates;
+  std::vector<uint64_t> results; // the results for the tests of each candidate
+  std::vector<std::vector<Index>> byCost;
+  std::unordered_map<uint64_t, std::vector<Index>> byResults;
+  Index tried = 0;
+
+  // nodes for evaluating an operation on the results of its children
+  Const* scratchLeft;
+  Const* scratchRight;
+  Unary* scratchUnary;
+  Binary* scratchBinary;
+
+  static const Index NumTests = 24;
+
+  Search(Fragment& fragment, Module& scratch, std::mt19937_64& random, Index samples, Index maxCandidates) : fragment(fragment), scratch(scratch), random(random), samples(samples), maxCandidates(maxCandidates) {
+    Builder builder(scratch);
+    scratchLeft = builder.makeConst(Literal(int32_t(0)));
+    scratchRight = builder.makeConst(Literal(int32_t(0)));
+    scratchUnary = builder.makeUnary(EqZInt32, scratchLeft);
+    scratchBinary = builder.makeBinary(AddInt32, scratchLeft, scratchRight);
+    computeInterestingValues(i32, interesting32);
+    computeInterestingValues(i64, interesting64);
+  }
+
+  // values that are likely to behave differently than others: the edges of
+  // ranges, and the fragment's constants and ones related to them
+  std::vector<uint64_t> interesting32, interesting64;
+
+  void computeInterestingValues(WasmType type, std::vector<uint64_t>& ret) {
+    ret = getConstants(type);
+    std::vector<uint64_t> values = {
+      2, 3, 7, 8, 15, 16, 31, 32, 33, 63, 64,
+      0x7f, 0x80, 0xff, 0x100, 0x7fff, 0x8000, 0xffff, 0x10000,
+      uint64_t(-2), uint64_t(-8), uint64_t(-32),
+      0x7fffffff, 0x80000000, 0x80000001
+    };
+    if (type == i64) {
+      values.insert(values.end(), { 0xffffffff, 0x100000000ULL,
+                                    0x7fffffffffffffffULL, 0x8000000000000000ULL, 0x8000000000000001ULL });
+    }
+    for (auto value : values) {
+      value = toBits(toLiteral(type, value));
+      if (std::find(ret.begin(), ret.end(), value) == ret.end()) ret.push_back(value);
+    }
+  }
+
+  const std::vector<uint64_t>& getInterestingValues(WasmType type) {
+    return type == i32 ? interesting32 : interesting64;
+  }
+
+  uint64_t getRandomValue(WasmType type) {
+    uint64_t ret;
+    switch (random() % 4) {
+      case 0: ret = random() % 129 - 64; break; // a small value
+      case 1: ret = (uint64_t(1) << (random() % 64)) + random() % 3 - 1; break; // around a power of 2
+      case 2: { // around an interesting value
+        auto& interesting = getInterestingValues(type);
+        ret = interesting[random() % interesting.size()] + random() % 5 - 2;
+        break;
+      }
+      default: ret = random();
+    }
+    return toBits(toLiteral(type, ret));
+  }
+
+  // returns whether the candidate computes the same as the fragment on all
+  // combinations of interesting values, and on random ones
+  bool verify(Expression* candidate) {
+    auto numInputs = fragment.inputs.size();
+    std::vector<const std::vector<uint64_t>*> interesting;
+    for (auto type : fragment.inputs) {
+      interesting.push_back(&getInterestingValues(type));
+    }
+    std::vector<Index> positions(numInputs, 0);
+    std::vector<Literal> values(numInputs);
+    auto check = [&]() {
+      uint64_t expected, seen;
+      bool ok = runner.evaluate(fragment.expr, values, expected);
+      assert(ok);
+      return runner.evaluate(candidate, values, seen) && seen == expected;
+    };
+    while (1) {
+      for (Index i = 0; i < numInputs; i++) {
+        values[i] = toLiteral(fragment.inputs[i], (*interesting[i])[positions[i]]);
+      }
+      if (!check()) return false;
+      Index i = 0;
+      while (i < numInputs && ++positions[i] == interesting[i]->size()) {
+        positions[i++] = 0;
+      }
+      if (i == numInputs) break;
+    }
+    for (Index sample = 0; sample < samples; sample++) {
+      for (Index i = 0; i < numInputs; i++) {
+        values[i] = toLiteral(fragment.inputs[i], getRandomValue(fragment.inputs[i]));
+      }
+      if (!check()) return false;
+    }
+    return true;
+  }
+
+  Expression* build(Index index) {
+    Builder builder(scratch);
+    auto& candidate = candidates[index];
+    switch (candidate.kind) {
+      case Candidate::InputKind: return builder.makeGetLocal(candidate.index, candidate.type);
+      case Candidate::ConstKind: return builder.makeConst(toLiteral(candidate.type, candidate.bits));
+      case Candidate::UnaryKind: return builder.makeUnary(unaryInfos[candidate.index].op, build(candidate.left));
+      case Candidate::BinaryKind: {
+        auto* left = build(candidate.left);
+        auto* right = build(candidate.right);
+        return builder.makeBinary(binaryInfos[candidate.index].op, left, right);
+      }
+    }
+    WASM_UNREACHABLE();
+  }
+
+  // adds a candidate, if it computes something new, and returns it if it
+  // is equivalent to the fragment
+  Expression* add(Candidate candidate) {
+    tried++;
+    auto start = results.size();
+    for (Index test = 0; test < NumTests; test++) {
+      uint64_t result;
+      switch (candidate.kind) {
+        case Candidate::InputKind: {
+          result = toBits(tests[test][candidate.index]);
+          break;
+        }
+        case Candidate::ConstKind: {
+          result = candidate.bits;
+          break;
+        }
+        case Candidate::UnaryKind: {
+          auto& child = candidates[candidate.left];
+          scratchLeft->set(toLiteral(child.type, results[candidate.left * NumTests + test]));
+          scratchUnary->op = unaryInfos[candidate.index].op;
+          scratchUnary->finalize();
+          bool ok = runner.evaluate(scratchUnary, {}, result);
+          assert(ok);
+          break;
+        }
+        case Candidate::BinaryKind: {
+          auto& left = candidates[candidate.left];
+          auto& right = candidates[candidate.right];
+          scratchLeft->set(toLiteral(left.type, results[candidate.left * NumTests + test]));
+          scratchRight->set(toLiteral(right.type, results[candidate.right * NumTests + test]));
+          scratchBinary->op = binaryInfos[candidate.index].op;
+          scratchBinary->finalize();
+          bool ok = runner.evaluate(scratchBinary, {}, result);
+          assert(ok);
+          break;
+        }
+      }
+      results.push_back(result);
+    }
+    Hasher64 hasher(candidate.type);
+    for (Index test = 0; test < NumTests; test++) {
+      hasher.add(results[start + test]);
+    }
+    auto& same = byResults[hasher.finish()];
+    for (auto other : same) {
+      if (candidates[other].type == candidate.type &&
+          std::equal(results.begin() + start, results.end(), results.begin() + other * NumTests)) {
+        // we already have something that computes this, and is no more
+        // expensive
+        results.resize(start);
+        return nullptr;
+      }
+    }
+    Index index = candidates.size();
+    candidates.push_back(candidate);
+    same.push_back(index);
+    byCost[candidate.cost].push_back(index);
+    if (candidate.type == fragment.expr->type &&
+        std::equal(expected.begin(), expected.end(), results.begin() + start)) {
+      auto* expr = build(index);
+      if (verify(expr)) return expr;
+    }
+    return nullptr;
+  }
+
+  Index getCost(Expression* curr) {
+    return CostAnalyzer(curr).cost;
+  }
+
+  // returns the cheapest equivalent expression we can find, or nullptr
+  Expression* run() {
+    auto numInputs = fragment.inputs.size();
+    for (Index test = 0; test < NumTests; test++) {
+      std::vector<Literal> values;
+      for (Index i = 0; i < numInputs; i++) {
+        auto type = fragment.inputs[i];
+        if (random() % 2) {
+          auto& interesting = getInterestingValues(type);
+          values.push_back(toLiteral(type, interesting[random() % interesting.size()]));
+        } else {
+          values.push_back(toLiteral(type, getRandomValue(type)));
+        }
+      }
+      uint64_t result;
+      bool ok = runner.evaluate(fragment.expr, values, result);
+      assert(ok);
+      tests.push_back(values);
+      expected.push_back(result);
+    }
+    auto target = getCost(fragment.expr);
+    if (target == 0) return nullptr;
+    byCost.resize(target);
+    Builder builder(scratch);
+    // the leaves are the inputs, and constants that are likely to be useful
+    for (Index i = 0; i < numInputs; i++) {
+      Candidate candidate;
+      candidate.kind = Candidate::InputKind;
+      candidate.index = i;
+      candidate.type = fragment.inputs[i];
+      candidate.cost = getCost(builder.makeGetLocal(i, candidate.type));
+      candidate.used = 1 << i;
+      candidate.first = candidate.last = i;
+      if (auto* found = add(candidate)) return found;
+    }
+    auto constantCost = getCost(builder.makeConst(Literal(int32_t(0))));
+    if (constantCost < target) {
+      for (auto type : { i32, i64 }) {
+        for (auto bits : getConstants(type)) {
+          Candidate candidate;
+          candidate.kind = Candidate::ConstKind;
+          candidate.bits = bits;
+          candidate.type = type;
+          candidate.cost = constantCost;
+          candidate.used = 0;
+          if (auto* found = add(candidate)) return found;
+        }
+      }
+    }
+    // build the operations on them, cheapest first
+    for (Index cost = 1; cost < target; cost++) {
+      for (Index op = 0; op < sizeof(unaryInfos) / sizeof(unaryInfos[0]); op++) {
+        auto& info = unaryInfos[op];
+        auto* node = builder.makeUnary(info.op, builder.makeGetLocal(0, info.param));
+        auto opCost = getCost(node);
+        if (opCost > cost) continue;
+        auto& children = byCost[cost - opCost];
+        for (Index i = 0; i < children.size(); i++) {
+          auto& child = candidates[children[i]];
+          if (child.type != info.param) continue;
+          Candidate candidate = child;
+          candidate.kind = Candidate::UnaryKind;
+          candidate.index = op;
+          candidate.left = children[i];
+          candidate.type = node->type;
+          candidate.cost = cost;
+          if (auto* found = add(candidate)) return found;
+          if (tried >= maxCandidates) return nullptr;
+        }
+      }
+      for (Index op = 0; op < sizeof(binaryInfos) / sizeof(binaryInfos[0]); op++) {
+        auto& info = binaryInfos[op];
+        if (info.mayTrap) continue;
+        auto* node = builder.makeBinary(info.op, builder.makeGetLocal(0, info.param), builder.makeGetLocal(0, info.param));
+        auto opCost = getCost(node);
+        for (Index leftCost = 0; leftCost + opCost <= cost; leftCost++) {
+          auto& lefts = byCost[leftCost];
+          auto& rights = byCost[cost - opCost - leftCost];
+          for (Index i = 0; i < lefts.size(); i++) {
+            for (Index j = 0; j < rights.size(); j++) {
+              auto& left = candidates[lefts[i]];
+              auto& right = candidates[rights[j]];
+              if (left.type != info.param || right.type != info.param) continue;
+              // each input can be used once, in order
+              if (left.used && right.used && left.last >= right.first) continue;
+              Candidate candidate;
+              candidate.kind = Candidate::BinaryKind;
+              candidate.index = op;
+              candidate.left = lefts[i];
+              candidate.right = rights[j];
+              candidate.type = node->type;
+              candidate.cost = cost;
+              candidate.used = left.used | right.used;
+              candidate.first = left.used ? left.first : right.first;
+              candidate.last = right.used ? right.last : left.last;
+              if (auto* found = add(candidate)) return found;
+              if (tried >= maxCandidates) return nullptr;
+            }
+          }
+        }
+      }
+    }
+    return nullptr;
+  }
+
+  // constants that are likely to be useful: simple ones, the fragment's,
+  // and ones related to them
+  std::vector<uint64_t> getConstants(WasmType type) {
+    std::vector<uint64_t> bases;
+    std::function<void (Expression*)> noteConstants = [&](Expression* curr) {
+      if (auto* c = curr->dynCast<Const>()) {
+        bases.push_back(toBits(c->value));
+      } else if (auto* unary = curr->dynCast<Unary>()) {
+        noteConstants(unary->value);
+      } else if (auto* binary = curr->dynCast<Binary>()) {
+        noteConstants(binary->left);
+        noteConstants(binary->right);
+      }
+    };
+    noteConstants(fragment.expr);
+    std::vector<uint64_t> ret;
+    auto note = [&](uint64_t value) {
+      value = toBits(toLiteral(type, value));
+      if (std::find(ret.begin(), ret.end(), value) == ret.end()) ret.push_back(value);
+    };
+    note(0);
+    note(1);
+    note(-1);
+    for (auto value : bases) note(value);
+    for (auto value : bases) {
+      note(value + 1);
+      note(value - 1);
+      note(-value);
+      note(~value);
+      if (value < 64) {
+        note(uint64_t(1) << value);
+        note((uint64_t(1) << value) - 1);
+        note(-(uint64_t(1) << value));
+      }
+      if (value && (value & (value - 1)) == 0) {
+        note(CountTrailingZeroes(value));
+      }
+    }
+    return ret;
+  }
+};
+
+static void printExpression(std::ostream& o, Expression* curr, std::vector<bool>& pure) {
+  if (auto* get = curr->dynCast<GetLocal>()) {
+    o << "(call $" << printWasmType(get->type) << (pure[get->index] ? ".pure" : ".expr") << " (i32.const " << get->index << "))";
+  } else if (auto* c = curr->dynCast<Const>()) {
+    o << '(' << printWasmType(c->type) << ".const " << c->value.getInteger() << ')';
+  } else if (auto* unary = curr->dynCast<Unary>()) {
+    o << '(' << getInfo(unary->op)->name << ' ';
+    printExpression(o, unary->value, pure);
+    o << ')';
+  } else {
+    auto* binary = curr->cast<Binary>();
+    o << '(' << getInfo(binary->op)->name << ' ';
+    printExpression(o, binary->left, pure);
+    o << ' ';
+    printExpression(o, binary->right, pure);
+    o << ')';
+  }
+}
+
+static void noteUsedInputs(Expression* curr, std::vector<bool>& used) {
+  if (auto* get = curr->dynCast<GetLocal>()) {
+    used[get->index] = true;
+  } else if (auto* unary = curr->dynCast<Unary>()) {
+    noteUsedInputs(unary->value, used);
+  } else if (auto* binary = curr->dynCast<Binary>()) {
+    noteUsedInputs(binary->left, used);
+    noteUsedInputs(binary->right, used);
+  }
+}
+
+//
+// main
+//
+
+int main(int argc, const char* argv[]) {
+  std::vector<std::string> filenames;
+  Index maxDepth = 2;
+  Index maxInputs = 3;
+  Index minCount = 2;
+  Index maxFragments = 100;
+  Index maxCandidates = 1000000;
+  Index samples = 10000;
+  uint64_t seed = 0;
+
+  Options options("wasm-superopt", "Search for peephole optimizations in a corpus of modules.\n\n"
+                                   "This tool harvests small fragments of integer operations from the "
+                                   "input modules, which should already be optimized, and for the most "
+                                   "common fragments that optimize-instructions and precompute do not "
+                                   "improve, it searches for cheaper equivalent expressions. Candidates "
+                                   "are checked in the interpreter on all combinations of interesting "
+                                   "values and on random ones, which is not a proof, so the results "
+                                   "should be reviewed.\n\n"
+                                   "The output is patterns for src/passes/OptimizeInstructions.wast.");
+  options
+      .add("--output", "-o", "Output file (stdout if not specified)",
+           Options::Arguments::One,
+           [](Options* o, const std::string& argument) {
+             o->extra["output"] = argument;
+           })
+      .add("--max-depth", "-md", "The maximum depth of operations in a fragment (default: 2)",
+           Options::Arguments::One,
+           [&](Options* o, const std::string& argument) {
+             maxDepth = std::max(1, atoi(argument.c_str()));
+           })
+      .add("--max-inputs", "-mi", "The maximum number of inputs to a fragment, at most 4 (default: 3)",
+           Options::Arguments::One,
+           [&](Options* o, const std::string& argument) {
+             maxInputs = std::min(std::max(1, atoi(argument.c_str())), 4);
+           })
+      .add("--min-count", "-mc", "Only search for fragments that appear at least this many times (default: 2)",
+           Options::Arguments::One,
+           [&](Options* o, const std::string& argument) {
+             minCount = atoi(argument.c_str());
+           })
+      .add("--max-fragments", "-mf", "The maximum number of fragments to search for, most common first (default: 100)",
+           Options::Arguments::One,
+           [&](Options* o, const std::string& argument) {
+             maxFragments = atoi(argument.c_str());
+           })
+      .add("--max-candidates", "-mca", "The maximum number of candidates to try for each fragment (default: 1000000)",
+           Options::Arguments::One,
+           [&](Options* o, const std::string& argument) {
+             maxCandidates = atoi(argument.c_str());
+           })
+      .add("--samples", "-s", "The number of random inputs to check a candidate on (default: 10000)",
+           Options::Arguments::One,
+           [&](Options* o, const std::string& argument) {
+             samples = atoi(argument.c_str());
+           })
+      .add("--seed", "", "The seed for the random inputs (default: 0)",
+           Options::Arguments::One,
+           [&](Options* o, const std::string& argument) {
+             seed = atoll(argument.c_str());
+           })
+      .add_positional("INFILES", Options::Arguments::N,
+                      [&](Options *o, const std::string &argument) {
+                        filenames.push_back(argument);
+                      });
+  options.parse(argc, argv);
+
+  Module scratch;
+  PassOptions passOptions;
+  std::vector<Fragment> fragments;
+  std::unordered_map<uint64_t, std::vector<Index>> fragmentsByHash;
+  for (auto& filename : filenames) {
+    Module wasm;
+    ModuleReader reader;
+    reader.setDebug(options.debug);
+    try {
+      reader.read(filename, wasm);
+    } catch (ParseException& p) {
+      p.dump(std::cerr);
+      Fatal() << "error in parsing input";
+    }
+    Harvester harvester(scratch, passOptions, maxDepth, maxInputs, fragments, fragmentsByHash);
+    for (auto& func : wasm.functions) {
+      harvester.walk(func->body);
+    }
+  }
+
+  std::vector<Index> order;
+  for (Index i = 0; i < fragments.size(); i++) {
+    if (fragments[i].count >= minCount) order.push_back(i);
+  }
+  std::stable_sort(order.begin(), order.end(), [&](Index a, Index b) {
+    return fragments[a].count > fragments[b].count;
+  });
+  if (order.size() > maxFragments) order.resize(maxFragments);
+
+  Output output(options.extra["output"], Flags::Text, options.debug ? Flags::Debug : Flags::Release);
+  output << ";; " << fragments.size() << " fragments harvested, searching the " << order.size() << " most common\n";
+  std::mt19937_64 random(seed);
+  Index found = 0;
+  for (auto index : order) {
+    auto& fragment = fragments[index];
+    if (isAlreadyOptimized(fragment)) continue;
+    Search search(fragment, scratch, random, samples, maxCandidates);
+    auto* replacement = search.run();
+    if (!replacement) continue;
+    found++;
+    // inputs that are removed or repeated must be pure
+    std::vector<bool> pure(fragment.inputs.size());
+    noteUsedInputs(replacement, pure);
+    for (Index i = 0; i < pure.size(); i++) {
+      pure[i] = !pure[i] || fragment.repeated[i];
+    }
+    output << ";; seen " << fragment.count << " times, cost " << CostAnalyzer(fragment.expr).cost
+           << " => " << CostAnalyzer(replacement).cost << "\n(block ";
+    std::stringstream text;
+    printExpression(text, fragment.expr, pure);
+    text << ' ';
+    printExpression(text, replacement, pure);
+    output << text.str() << ")\n";
+  }
+  output << ";; " << found << " patterns found\n";
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright 2017 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// wasm2c console tool
+//
+
+#include "support/colors.h"
+#include "support/command-line.h"
+#include "support/file.h"
+#include "wasm-s-parser.h"
+#include "wasm-validator.h"
+#include "wasm2c.h"
+
+using namespace cashew;
+using namespace wasm;
+
+int main(int argc, const char *argv[]) {
+  Wasm2CBuilder::Flags builderFlags;
+  Options options("wasm2c", "Transform .wast files to C");
+  options
+      .add("--output", "-o", "Output file (stdout if not specified)",
+           Options::Arguments::One,
+           [](Options* o, const std::string& argument) {
+             o->extra["output"] = argument;
+             Colors::disable();
+           })
+      .add("--allow-asserts", "", "Emit a main() that runs the .wast testing asserts",
+           Options::Arguments::Zero,
+           [](Options* o, const std::string& argument) {
+             o->extra["asserts"] = "1";
+           })
+      .add_positional("INFILE", Options::Arguments::One,
+                      [](Options *o, const std::string &argument) {
+                        o->extra["infile"] = argument;
+                      });
+  options.parse(argc, argv);
+  if (options.debug) builderFlags.debug = true;
+
+  auto input(
+      read_file<std::vector<char>>(options.extra["infile"], Flags::Text, options.debug ? Flags::Debug : Flags::Release));
+
+  Element* root;
+  Module wasm;
+  std::stringstream c;
+
+  try {
+    if (options.debug) std::cerr << "s-parsing..." << std::endl;
+    SExpressionParser parser(input.data());
+    root = parser.root;
+
+    if (options.debug) std::cerr << "w-parsing..." << std::endl;
+    SExpressionWasmBuilder builder(wasm, *(*root)[0]);
+
+    if (!WasmValidator().validate(wasm)) {
+      Fatal() << "error in validating input";
+    }
+
+    if (options.debug) std::cerr << "c-ing..." << std::endl;
+    Wasm2CBuilder wasm2c(builderFlags);
+    wasm2c.processWasm(&wasm, c);
+
+    if (options.extra["asserts"] == "1") {
+      if (options.debug) std::cerr << "asserting..." << std::endl;
+      wasm2c.processAsserts(&wasm, *root, builder, c);
+    }
+  } catch (ParseException& p) {
+    p.dump(std::cerr);
+    Fatal() << "error in parsing input";
+  } catch (std::bad_alloc& b) {
+    Fatal() << "error in building module, std::bad_alloc (possibly invalid request for silly amounts of memory)";
+  }
+
+  if (options.debug) std::cerr << "printing..." << std::endl;
+  Output output(options.extra["output"], Flags::Text, options.debug ? Flags::Debug : Flags::Release);
+  output << c.str();
+
+  if (options.debug) std::cerr << "done." << std::endl;
+}
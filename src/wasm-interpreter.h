@@ -23,6 +23,7 @@
 #ifndef wasm_wasm_interpreter_h
 #define wasm_wasm_interpreter_h
 
+#include <chrono>
 #include <cmath>
 #include <limits.h>
 #include <sstream>
@@ -77,6 +78,19 @@ public:
 // A list of literals, for function calls
 typedef std::vector<Literal> LiteralList;
 
+// Limits on how much execution may be done. Fuel is the number of expressions
+// that may be executed, and the timeout is in seconds of wall-clock time. Zero
+// means there is no limit.
+struct ExecutionLimits {
+  uint64_t fuel = 0;
+  double timeout = 0;
+
+  ExecutionLimits() {}
+  ExecutionLimits(uint64_t fuel, double timeout) : fuel(fuel), timeout(timeout) {}
+
+  bool isLimited() { return fuel > 0 || timeout > 0; }
+};
+
 // Debugging helpers
 #ifdef WASM_INTERPRETER_DEBUG
 class Indenter {
@@ -119,6 +133,13 @@ template<typename SubType>
 class ExpressionRunner : public Visitor<SubType, Flow> {
 public:
   Flow visit(Expression *curr) {
+    return static_cast<SubType*>(this)->execute(curr);
+  }
+
+  // Executes an expression. Runners can override this to see every
+  // expression that is executed, including children, and its result.
+  Flow execute(Expression *curr) {
+    static_cast<SubType*>(this)->noteStep();
     auto ret = Visitor<SubType, Flow>::visit(curr);
     if (!ret.breaking() && (isConcreteWasmType(curr->type) || isConcreteWasmType(ret.value.type))) {
 #if 1 // def WASM_INTERPRETER_DEBUG
@@ -341,21 +362,21 @@ public:
         case SubInt32:      return left.sub(right);
         case MulInt32:      return left.mul(right);
         case DivSInt32: {
-          if (right.getInteger() == 0) trap("i32.div_s by 0");
-          if (left.getInteger() == std::numeric_limits<int32_t>::min() && right.getInteger() == -1) trap("i32.div_s overflow"); // signed division overflow
+          if (right.getInteger() == 0) return trap("i32.div_s by 0");
+          if (left.getInteger() == std::numeric_limits<int32_t>::min() && right.getInteger() == -1) return trap("i32.div_s overflow"); // signed division overflow
           return left.divS(right);
         }
         case DivUInt32: {
-          if (right.getInteger() == 0) trap("i32.div_u by 0");
+          if (right.getInteger() == 0) return trap("i32.div_u by 0");
           return left.divU(right);
         }
         case RemSInt32: {
-          if (right.getInteger() == 0) trap("i32.rem_s by 0");
+          if (right.getInteger() == 0) return trap("i32.rem_s by 0");
           if (left.getInteger() == std::numeric_limits<int32_t>::min() && right.getInteger() == -1) return Literal(int32_t(0));
           return left.remS(right);
         }
         case RemUInt32: {
-          if (right.getInteger() == 0) trap("i32.rem_u by 0");
+          if (right.getInteger() == 0) return trap("i32.rem_u by 0");
           return left.remU(right);
         }
         case AndInt32:  return left.and_(right);
@@ -384,21 +405,21 @@ public:
         case SubInt64:      return left.sub(right);
         case MulInt64:      return left.mul(right);
         case DivSInt64: {
-          if (right.getInteger() == 0) trap("i64.div_s by 0");
-          if (left.getInteger() == LLONG_MIN && right.getInteger() == -1LL) trap("i64.div_s overflow"); // signed division overflow
+          if (right.getInteger() == 0) return trap("i64.div_s by 0");
+          if (left.getInteger() == LLONG_MIN && right.getInteger() == -1LL) return trap("i64.div_s overflow"); // signed division overflow
           return left.divS(right);
         }
         case DivUInt64: {
-          if (right.getInteger() == 0) trap("i64.div_u by 0");
+          if (right.getInteger() == 0) return trap("i64.div_u by 0");
           return left.divU(right);
         }
         case RemSInt64: {
-          if (right.getInteger() == 0) trap("i64.rem_s by 0");
+          if (right.getInteger() == 0) return trap("i64.rem_s by 0");
           if (left.getInteger() == LLONG_MIN && right.getInteger() == -1LL) return Literal(int64_t(0));
           return left.remS(right);
         }
         case RemUInt64: {
-          if (right.getInteger() == 0) trap("i64.rem_u by 0");
+          if (right.getInteger() == 0) return trap("i64.rem_u by 0");
           return left.remU(right);
         }
         case AndInt64:  return left.and_(right);
@@ -475,51 +496,57 @@ public:
   }
   Flow visitUnreachable(Unreachable *curr) {
     NOTE_ENTER("Unreachable");
-    trap("unreachable");
-    WASM_UNREACHABLE();
+    return trap("unreachable");
   }
 
-  Literal truncSFloat(Unary* curr, Literal value) {
+  Flow truncSFloat(Unary* curr, Literal value) {
     double val = value.getFloat();
-    if (std::isnan(val)) trap("truncSFloat of nan");
+    if (std::isnan(val)) return trap("truncSFloat of nan");
     if (curr->type == i32) {
       if (value.type == f32) {
-        if (!isInRangeI32TruncS(value.reinterpreti32())) trap("i32.truncSFloat overflow");
+        if (!isInRangeI32TruncS(value.reinterpreti32())) return trap("i32.truncSFloat overflow");
       } else {
-        if (!isInRangeI32TruncS(value.reinterpreti64())) trap("i32.truncSFloat overflow");
+        if (!isInRangeI32TruncS(value.reinterpreti64())) return trap("i32.truncSFloat overflow");
       }
       return Literal(int32_t(val));
     } else {
       if (value.type == f32) {
-        if (!isInRangeI64TruncS(value.reinterpreti32())) trap("i64.truncSFloat overflow");
+        if (!isInRangeI64TruncS(value.reinterpreti32())) return trap("i64.truncSFloat overflow");
       } else {
-        if (!isInRangeI64TruncS(value.reinterpreti64())) trap("i64.truncSFloat overflow");
+        if (!isInRangeI64TruncS(value.reinterpreti64())) return trap("i64.truncSFloat overflow");
       }
       return Literal(int64_t(val));
     }
   }
 
-  Literal truncUFloat(Unary* curr, Literal value) {
+  Flow truncUFloat(Unary* curr, Literal value) {
     double val = value.getFloat();
-    if (std::isnan(val)) trap("truncUFloat of nan");
+    if (std::isnan(val)) return trap("truncUFloat of nan");
     if (curr->type == i32) {
       if (value.type == f32) {
-        if (!isInRangeI32TruncU(value.reinterpreti32())) trap("i32.truncUFloat overflow");
+        if (!isInRangeI32TruncU(value.reinterpreti32())) return trap("i32.truncUFloat overflow");
       } else {
-        if (!isInRangeI32TruncU(value.reinterpreti64())) trap("i32.truncUFloat overflow");
+        if (!isInRangeI32TruncU(value.reinterpreti64())) return trap("i32.truncUFloat overflow");
       }
       return Literal(uint32_t(val));
     } else {
       if (value.type == f32) {
-        if (!isInRangeI64TruncU(value.reinterpreti32())) trap("i64.truncUFloat overflow");
+        if (!isInRangeI64TruncU(value.reinterpreti32())) return trap("i64.truncUFloat overflow");
       } else {
-        if (!isInRangeI64TruncU(value.reinterpreti64())) trap("i64.truncUFloat overflow");
+        if (!isInRangeI64TruncU(value.reinterpreti64())) return trap("i64.truncUFloat overflow");
       }
       return Literal(uint64_t(val));
     }
   }
 
-  virtual void trap(const char* why) {
+  // Called on each expression that is executed. By default nothing is done;
+  // runners that limit execution override this.
+  void noteStep() {}
+
+  // Called when execution traps. Runners either do not return from here, or
+  // return a flow that breaks out of everything, which then is the result of
+  // the execution.
+  virtual Flow trap(const char* why) {
     WASM_UNREACHABLE();
   }
 };
@@ -547,6 +574,95 @@ public:
 };
 
 //
+// Copy-on-write tracking for a linear memory buffer. Once a snapshot is taken,
+// the first write to each page saves the previous contents of that page, so
+// that restoring only copies back the pages that were actually modified (and
+// undoes any growth), instead of copying the entire memory each time.
+//
+class MemorySnapshot {
+public:
+  // Granularity of dirty tracking. This is smaller than a wasm page, as code
+  // tends to touch a few scattered locations in a large memory.
+  static const size_t kPageSize = 4096;
+
+  void take(const std::vector<char>& data) {
+    active = true;
+    size = data.size();
+    dirty.assign((size + kPageSize - 1) / kPageSize, false);
+    saved.clear();
+  }
+
+  // Must be called before the range [address, address + bytes) is modified.
+  void noteWrite(const std::vector<char>& data, size_t address, size_t bytes) {
+    if (!active) return;
+    // anything past the original size is simply truncated when restoring
+    auto end = std::min(address + bytes, size);
+    for (size_t page = address / kPageSize; page * kPageSize < end; page++) {
+      if (!dirty[page]) {
+        dirty[page] = true;
+        auto start = page * kPageSize;
+        auto pageEnd = std::min(start + kPageSize, size);
+        saved.emplace_back(page, std::vector<char>(data.begin() + start, data.begin() + pageEnd));
+      }
+    }
+  }
+
+  // Return the data to the state it had when the snapshot was taken. The
+  // snapshot remains active, so this can be done repeatedly.
+  void restore(std::vector<char>& data) {
+    assert(active);
+    data.resize(size);
+    for (auto& pair : saved) {
+      std::copy(pair.second.begin(), pair.second.end(), data.begin() + pair.first * kPageSize);
+      dirty[pair.first] = false;
+    }
+    saved.clear();
+  }
+
+private:
+  bool active = false;
+  size_t size = 0;
+  std::vector<bool> dirty;
+  std::vector<std::pair<size_t, std::vector<char>>> saved;
+};
+
+//
+// Something that can execute some functions natively instead of by
+// interpreting them, see ModuleInstanceBase::setNativeExecutor.
+//
+
+// What native code needs from the instance it runs in: memory, globals,
+// imports, the table and interpreted functions, with the same checks and
+// traps as the interpreter.
+struct NativeRuntime {
+  virtual ~NativeRuntime() {}
+
+  virtual Literal load(Load* load, Literal ptr) = 0;
+  virtual void store(Store* store, Literal ptr, Literal value) = 0;
+  virtual Literal getGlobal(Name name) = 0;
+  virtual void setGlobal(Name name, Literal value) = 0;
+  virtual Literal currentMemory() = 0;
+  virtual Literal growMemory(uint32_t delta) = 0;
+  // Calls out of native code. callDepth is the depth of the caller, which
+  // calls made from here on continue from.
+  virtual Literal callFunctionInternal(Name name, LiteralList& arguments, size_t callDepth) = 0;
+  virtual Literal callImport(Import* import, LiteralList& arguments, size_t callDepth) = 0;
+  virtual Literal callTable(Index index, LiteralList& arguments, WasmType result, size_t callDepth) = 0;
+};
+
+struct NativeExecutor {
+  virtual ~NativeExecutor() {}
+
+  // Whether run() can be called on this function.
+  virtual bool canRun(Function* func) = 0;
+
+  // Runs a function. callDepth is the current depth of calls, which must not
+  // exceed maxCallDepth. Returns nullptr on success, after setting the result,
+  // or the reason for trapping. Anything the runtime throws, such as when
+  // the external interface traps, propagates out.
+  virtual const char* run(Function* func, LiteralList& arguments, Literal& result, size_t callDepth, NativeRuntime& runtime) = 0;
+};
+
 // An instance of a WebAssembly module, which can execute it via AST interpretation.
 //
 // To embed this interpreter, you need to provide an ExternalInterface instance
@@ -557,7 +673,7 @@ public:
 //
 
 template<typename GlobalManager, typename SubType>
-class ModuleInstanceBase {
+class ModuleInstanceBase : public NativeRuntime {
 public:
   //
   // You need to implement one of these to create a concrete interpreter. The
@@ -572,6 +688,14 @@ public:
     virtual void growMemory(Address oldSize, Address newSize) = 0;
     virtual void trap(const char* why) = 0;
 
+    // called when the execution limits are reached, see ModuleInstanceBase::setLimits.
+    // this must not return.
+    virtual void outOfFuel() { trap("out of fuel"); }
+
+    // save and restore the state of memory, see ModuleInstanceBase::snapshot
+    virtual void snapshot() { WASM_UNREACHABLE(); }
+    virtual void restore() { WASM_UNREACHABLE(); }
+
     // the default impls for load and store switch on the sizes. you can either
     // customize load/store, or the sub-functions which they call
     virtual Literal load(Load* load, Address addr) {
@@ -652,7 +776,8 @@ public:
   // Values of globals
   GlobalManager globals;
 
-  ModuleInstanceBase(Module& wasm, ExternalInterface* externalInterface) : wasm(wasm), externalInterface(externalInterface) {
+  ModuleInstanceBase(Module& wasm, ExternalInterface* externalInterface, ExecutionLimits limits = ExecutionLimits()) : wasm(wasm), externalInterface(externalInterface) {
+    setLimits(limits);
     // import globals from the outside
     externalInterface->importGlobals(globals, wasm);
     // prepare memory
@@ -692,6 +817,49 @@ public:
     return iter->second;
   }
 
+  // Limit execution from now on. When a limit is reached, execution stops by
+  // calling ExternalInterface::outOfFuel().
+  void setLimits(ExecutionLimits limits) {
+    limited = limits.isLimited();
+    hasFuelLimit = limits.fuel > 0;
+    fuel = limits.fuel;
+    hasDeadline = limits.timeout > 0;
+    if (hasDeadline) {
+      auto timeout = std::chrono::duration<double>(limits.timeout);
+      deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(timeout);
+    }
+    stepsSinceClockCheck = 0;
+  }
+
+  // Run functions that the executor supports natively rather than interpreting
+  // them. This is not done when execution limits are set, as native code does
+  // not count steps.
+  void setNativeExecutor(NativeExecutor* executor) {
+    nativeExecutor = executor;
+  }
+
+  // Save the current state of the instance - globals and memory - so that it
+  // can be returned to later using restore(). This allows running code
+  // speculatively, or running many exports from the same starting state,
+  // without creating a new instance each time. Memory is tracked copy-on-write
+  // by the external interface, so restoring only costs as much as the memory
+  // that was modified since the snapshot.
+  void snapshot() {
+    snapshotGlobals = globals;
+    snapshotMemorySize = memorySize;
+    externalInterface->snapshot();
+    hasSnapshot = true;
+  }
+
+  // Return to the state at the last snapshot. The snapshot remains valid, so
+  // this can be done repeatedly.
+  void restore() {
+    assert(hasSnapshot);
+    globals = snapshotGlobals;
+    memorySize = snapshotMemorySize;
+    externalInterface->restore();
+  }
+
   std::string printFunctionStack() {
     std::string ret = "/== (binaryen interpreter stack trace)\n";
     for (int i = int(functionStack.size()) - 1; i >= 0; i--) {
@@ -709,6 +877,37 @@ private:
   // stack traces.
   std::vector<Name> functionStack;
 
+  NativeExecutor* nativeExecutor = nullptr;
+
+  // Execution limits, see setLimits()
+  bool limited = false;
+  bool hasFuelLimit = false;
+  uint64_t fuel = 0;
+  bool hasDeadline = false;
+  std::chrono::steady_clock::time_point deadline;
+  size_t stepsSinceClockCheck;
+
+  // How many steps to take between checks of the clock, as reading it is
+  // much slower than executing a typical expression.
+  static const size_t clockCheckInterval = 1024;
+
+  void noteStep() {
+    if (!limited) return;
+    if (hasFuelLimit) {
+      if (fuel == 0) externalInterface->outOfFuel();
+      fuel--;
+    }
+    if (hasDeadline && ++stepsSinceClockCheck == clockCheckInterval) {
+      stepsSinceClockCheck = 0;
+      if (std::chrono::steady_clock::now() > deadline) externalInterface->outOfFuel();
+    }
+  }
+
+  // State saved by snapshot()
+  bool hasSnapshot = false;
+  GlobalManager snapshotGlobals;
+  Address snapshotMemorySize;
+
 public:
   // Call a function, starting an invocation.
   Literal callFunction(Name name, LiteralList& arguments) {
@@ -762,6 +961,10 @@ public:
     public:
       RuntimeExpressionRunner(ModuleInstanceBase& instance, FunctionScope& scope) : instance(instance), scope(scope) {}
 
+      void noteStep() {
+        instance.noteStep();
+      }
+
       Flow generateArguments(const ExpressionList& operands, LiteralList& arguments) {
         NOTE_ENTER_("generateArguments");
         arguments.reserve(operands.size());
@@ -951,18 +1154,9 @@ public:
           case PageSize:   return Literal((int32_t)Memory::kPageSize);
           case CurrentMemory: return Literal(int32_t(instance.memorySize));
           case GrowMemory: {
-            auto fail = Literal(int32_t(-1));
             Flow flow = this->visit(curr->operands[0]);
             if (flow.breaking()) return flow;
-            int32_t ret = instance.memorySize;
-            uint32_t delta = flow.value.geti32();
-            if (delta > uint32_t(-1) /Memory::kPageSize) return fail;
-            if (instance.memorySize >= uint32_t(-1) - delta) return fail;
-            uint32_t newSize = instance.memorySize + delta;
-            if (newSize > instance.wasm.memory.max) return fail;
-            instance.externalInterface->growMemory(instance.memorySize * Memory::kPageSize, newSize * Memory::kPageSize);
-            instance.memorySize = newSize;
-            return Literal(int32_t(ret));
+            return instance.growMemory(flow.value.geti32());
           }
           case HasFeature: {
             Name id = curr->nameOperand;
@@ -973,8 +1167,9 @@ public:
         }
       }
 
-      void trap(const char* why) override {
+      Flow trap(const char* why) override {
         instance.externalInterface->trap(why);
+        WASM_UNREACHABLE();
       }
     };
 
@@ -996,9 +1191,15 @@ public:
     }
 #endif
 
-    Flow flow = RuntimeExpressionRunner(*this, scope).visit(function->body);
-    assert(!flow.breaking() || flow.breakTo == RETURN_FLOW); // cannot still be breaking, it means we missed our stop
-    Literal ret = flow.value;
+    Literal ret;
+    if (nativeExecutor && !limited && nativeExecutor->canRun(function)) {
+      const char* trapReason = nativeExecutor->run(function, arguments, ret, previousCallDepth, *this);
+      if (trapReason) externalInterface->trap(trapReason);
+    } else {
+      Flow flow = RuntimeExpressionRunner(*this, scope).visit(function->body);
+      assert(!flow.breaking() || flow.breakTo == RETURN_FLOW); // cannot still be breaking, it means we missed our stop
+      ret = flow.value;
+    }
     if (function->result != ret.type) {
       std::cerr << "calling " << function->name << " resulted in " << ret << " but the function type is " << function->result << '\n';
       WASM_UNREACHABLE();
@@ -1014,6 +1215,49 @@ public:
     return ret;
   }
 
+  // NativeRuntime implementation, which does what the interpreter does for
+  // the corresponding expressions
+
+  Literal load(Load* load, Literal ptr) override {
+    return externalInterface->load(load, getFinalAddress(load, ptr));
+  }
+  void store(Store* store, Literal ptr, Literal value) override {
+    externalInterface->store(store, getFinalAddress(store, ptr), value);
+  }
+  Literal getGlobal(Name name) override {
+    assert(globals.find(name) != globals.end());
+    return globals[name];
+  }
+  void setGlobal(Name name, Literal value) override {
+    globals[name] = value;
+  }
+  Literal currentMemory() override {
+    return Literal(int32_t(memorySize));
+  }
+  Literal growMemory(uint32_t delta) override {
+    auto fail = Literal(int32_t(-1));
+    int32_t ret = memorySize;
+    if (delta > uint32_t(-1) /Memory::kPageSize) return fail;
+    if (memorySize >= uint32_t(-1) - delta) return fail;
+    uint32_t newSize = memorySize + delta;
+    if (newSize > wasm.memory.max) return fail;
+    externalInterface->growMemory(memorySize * Memory::kPageSize, newSize * Memory::kPageSize);
+    memorySize = newSize;
+    return Literal(int32_t(ret));
+  }
+  Literal callFunctionInternal(Name name, LiteralList& arguments, size_t depth) override {
+    callDepth = depth;
+    return callFunctionInternal(name, arguments);
+  }
+  Literal callImport(Import* import, LiteralList& arguments, size_t depth) override {
+    callDepth = depth;
+    return externalInterface->callImport(import, arguments);
+  }
+  Literal callTable(Index index, LiteralList& arguments, WasmType result, size_t depth) override {
+    callDepth = depth;
+    return externalInterface->callTable(index, arguments, result, *self());
+  }
+
 protected:
 
   Address memorySize; // in pages
@@ -1089,7 +1333,7 @@ protected:
 typedef std::map<Name, Literal> TrivialGlobalManager;
 class ModuleInstance : public ModuleInstanceBase<TrivialGlobalManager, ModuleInstance> {
 public:
-  ModuleInstance(Module& wasm, ExternalInterface* externalInterface) : ModuleInstanceBase(wasm, externalInterface) {}
+  ModuleInstance(Module& wasm, ExternalInterface* externalInterface, ExecutionLimits limits = ExecutionLimits()) : ModuleInstanceBase(wasm, externalInterface, limits) {}
 };
 
 } // namespace wasm
@@ -0,0 +1,1002 @@
+/*
+ * Copyright 2017 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// Code layout and calling convention:
+//
+//  * A compiled function is called as  uint64_t f(uint64_t* locals, Context*),
+//    using the System V ABI. It keeps the locals pointer in rbx and the
+//    context in r12. Each local is a 64-bit slot, with i32 values kept
+//    zero-extended.
+//  * Expression results are left in rax. Values that must survive the
+//    evaluation of a sibling are pushed on the native stack, and we track how
+//    many are pushed so that branches can pop them.
+//  * Values are kept as their bits, with i32 and f32 values zero-extended.
+//    Float arithmetic moves them to xmm0 and xmm1 and back.
+//  * Calls between compiled functions allocate the callee's locals on the
+//    native stack and call it directly.
+//  * Everything else that involves the instance - memory, globals, imports,
+//    the table and calls to interpreted functions - is done by calling the
+//    runtime functions below, which go through the NativeRuntime. The native
+//    stack is kept 16-byte aligned at calls for that.
+//  * A trap stores its reason in the context and returns through every
+//    frame; after each call we check whether that happened. Exceptions from
+//    the runtime are handled the same way, and rethrown once we are out of
+//    native code.
+//
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <unordered_set>
+#include <vector>
+
+#if defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__))
+#define WASM_JIT_X64 1
+#include <sys/mman.h>
+#endif
+
+#include "wasm-jit.h"
+#include "wasm-traversal.h"
+
+namespace wasm {
+
+// Trap reasons, indexed by the code compiled code stores in Context::trap.
+// These match the interpreter's messages.
+enum TrapCode {
+  NoTrap,
+  TrapUnreachable,
+  TrapStackLimit,
+  TrapDivSInt32ByZero,
+  TrapDivSInt32Overflow,
+  TrapDivUInt32ByZero,
+  TrapRemSInt32ByZero,
+  TrapRemUInt32ByZero,
+  TrapDivSInt64ByZero,
+  TrapDivSInt64Overflow,
+  TrapDivUInt64ByZero,
+  TrapRemSInt64ByZero,
+  TrapRemUInt64ByZero,
+  TrapRuntime, // the runtime threw, see Context::exception
+};
+
+static const char* trapReasons[] = {
+  nullptr,
+  "unreachable",
+  "stack limit",
+  "i32.div_s by 0",
+  "i32.div_s overflow",
+  "i32.div_u by 0",
+  "i32.rem_s by 0",
+  "i32.rem_u by 0",
+  "i64.div_s by 0",
+  "i64.div_s overflow",
+  "i64.div_u by 0",
+  "i64.rem_s by 0",
+  "i64.rem_u by 0",
+  nullptr,
+};
+
+static bool isSupportedType(WasmType type) {
+  return type == none || isConcreteWasmType(type) || type == unreachable;
+}
+
+static uint64_t getBits(const Literal& value) {
+  switch (value.type) {
+    case i32: return uint32_t(value.geti32());
+    case i64: return uint64_t(value.geti64());
+    case f32: return uint32_t(value.reinterpreti32());
+    case f64: return uint64_t(value.reinterpreti64());
+    default: return 0;
+  }
+}
+
+static Literal makeLiteral(WasmType type, uint64_t bits) {
+  switch (type) {
+    case i32: return Literal(int32_t(uint32_t(bits)));
+    case i64: return Literal(int64_t(bits));
+    case f32: return Literal(int32_t(uint32_t(bits))).castToF32();
+    case f64: return Literal(int64_t(bits)).castToF64();
+    default: return Literal();
+  }
+}
+
+// Finds whether a function only uses things we can compile.
+
+struct SupportChecker : public PostWalker<SupportChecker, UnifiedExpressionVisitor<SupportChecker>> {
+  bool supported = true;
+
+  void visitExpression(Expression* curr) {
+    if (!isSupportedType(curr->type)) {
+      supported = false;
+      return;
+    }
+    switch (curr->_id) {
+      case Expression::Id::BlockId:
+      case Expression::Id::IfId:
+      case Expression::Id::LoopId:
+      case Expression::Id::BreakId:
+      case Expression::Id::SwitchId:
+      case Expression::Id::GetLocalId:
+      case Expression::Id::SetLocalId:
+      case Expression::Id::ConstId:
+      case Expression::Id::SelectId:
+      case Expression::Id::DropId:
+      case Expression::Id::ReturnId:
+      case Expression::Id::NopId:
+      case Expression::Id::UnreachableId:
+      case Expression::Id::CallId:
+      case Expression::Id::CallImportId:
+      case Expression::Id::CallIndirectId:
+      case Expression::Id::GetGlobalId:
+      case Expression::Id::SetGlobalId:
+      case Expression::Id::LoadId:
+      case Expression::Id::StoreId: break;
+      case Expression::Id::HostId: {
+        auto op = curr->cast<Host>()->op;
+        if (op != CurrentMemory && op != GrowMemory) supported = false;
+        break;
+      }
+      case Expression::Id::UnaryId: {
+        switch (curr->cast<Unary>()->op) {
+          case EqZInt32:
+          case EqZInt64:
+          case ExtendSInt32:
+          case ExtendUInt32:
+          case WrapInt64:
+          case ExtendS8Int32:
+          case ExtendS16Int32:
+          case ExtendS8Int64:
+          case ExtendS16Int64:
+          case ExtendS32Int64:
+          case ReinterpretInt32:
+          case ReinterpretInt64:
+          case ReinterpretFloat32:
+          case ReinterpretFloat64:
+          case NegFloat32:
+          case NegFloat64:
+          case AbsFloat32:
+          case AbsFloat64: break;
+          default: supported = false;
+        }
+        break;
+      }
+      case Expression::Id::BinaryId: {
+        switch (curr->cast<Binary>()->op) {
+          case DivFloat32:
+          case DivFloat64:
+          case MinFloat32:
+          case MinFloat64:
+          case MaxFloat32:
+          case MaxFloat64: supported = false; break;
+          default: {}
+        }
+        break;
+      }
+      default: supported = false;
+    }
+  }
+};
+
+#ifdef WASM_JIT_X64
+
+// Functions that compiled code calls to use the runtime. Exceptions cannot be
+// thrown through native frames, so one is caught here and saved in the
+// context, and compiled code returns as if it trapped.
+
+template<typename T>
+static uint64_t callRuntime(BaselineJIT::Context* context, T doCall) {
+  try {
+    return doCall();
+  } catch (...) {
+    context->exception = std::current_exception();
+    context->trap = TrapRuntime;
+    return 0;
+  }
+}
+
+// The operands of a call were pushed in order, so they are in reverse order
+// in memory.
+static LiteralList getArguments(ExpressionList& operands, uint64_t* pushed) {
+  LiteralList arguments;
+  Index num = operands.size();
+  for (Index i = 0; i < num; i++) {
+    arguments.push_back(makeLiteral(operands[i]->type, pushed[num - 1 - i]));
+  }
+  return arguments;
+}
+
+static uint64_t runtimeLoad(BaselineJIT::Context* context, Load* curr, uint64_t ptr) {
+  return callRuntime(context, [&]() {
+    return getBits(context->runtime->load(curr, makeLiteral(curr->ptr->type, ptr)));
+  });
+}
+
+static uint64_t runtimeStore(BaselineJIT::Context* context, Store* curr, uint64_t ptr, uint64_t value) {
+  return callRuntime(context, [&]() {
+    context->runtime->store(curr, makeLiteral(curr->ptr->type, ptr), makeLiteral(curr->valueType, value));
+    return uint64_t(0);
+  });
+}
+
+static uint64_t runtimeGetGlobal(BaselineJIT::Context* context, GetGlobal* curr) {
+  return callRuntime(context, [&]() {
+    return getBits(context->runtime->getGlobal(curr->name));
+  });
+}
+
+static uint64_t runtimeSetGlobal(BaselineJIT::Context* context, SetGlobal* curr, uint64_t value) {
+  return callRuntime(context, [&]() {
+    context->runtime->setGlobal(curr->name, makeLiteral(curr->value->type, value));
+    return uint64_t(0);
+  });
+}
+
+static uint64_t runtimeCurrentMemory(BaselineJIT::Context* context) {
+  return callRuntime(context, [&]() {
+    return getBits(context->runtime->currentMemory());
+  });
+}
+
+static uint64_t runtimeGrowMemory(BaselineJIT::Context* context, uint64_t delta) {
+  return callRuntime(context, [&]() {
+    return getBits(context->runtime->growMemory(uint32_t(delta)));
+  });
+}
+
+static uint64_t runtimeCall(BaselineJIT::Context* context, Call* curr, uint64_t* pushed) {
+  return callRuntime(context, [&]() {
+    auto arguments = getArguments(curr->operands, pushed);
+    return getBits(context->runtime->callFunctionInternal(curr->target, arguments, context->depth));
+  });
+}
+
+static uint64_t runtimeCallImport(BaselineJIT::Context* context, CallImport* curr, Import* import, uint64_t* pushed) {
+  return callRuntime(context, [&]() {
+    auto arguments = getArguments(curr->operands, pushed);
+    return getBits(context->runtime->callImport(import, arguments, context->depth));
+  });
+}
+
+static uint64_t runtimeCallTable(BaselineJIT::Context* context, CallIndirect* curr, uint64_t* pushed, uint64_t index) {
+  return callRuntime(context, [&]() {
+    auto arguments = getArguments(curr->operands, pushed);
+    return getBits(context->runtime->callTable(Index(index), arguments, curr->type, context->depth));
+  });
+}
+
+// A position in the code that jumps can target, possibly before it is known.
+
+struct Label {
+  static const size_t Unbound = size_t(-1);
+
+  size_t position = Unbound;
+  std::vector<size_t> fixups; // locations of rel32 fields that refer to us
+};
+
+// Emits x86-64 machine code. Registers are referred to by their encoding
+// numbers, and only what the compiler below needs is provided.
+
+struct Assembler {
+  std::vector<uint8_t> code;
+
+  size_t size() { return code.size(); }
+
+  void byte(uint8_t x) { code.push_back(x); }
+  void bytes(std::initializer_list<uint8_t> list) {
+    code.insert(code.end(), list.begin(), list.end());
+  }
+  void imm32(uint32_t x) {
+    for (int i = 0; i < 4; i++) byte(uint8_t(x >> (8 * i)));
+  }
+  void imm64(uint64_t x) {
+    for (int i = 0; i < 8; i++) byte(uint8_t(x >> (8 * i)));
+  }
+  void patch32(size_t at, uint32_t x) {
+    for (int i = 0; i < 4; i++) code[at + i] = uint8_t(x >> (8 * i));
+  }
+
+  // a rel32 field that refers to a label
+  void rel32(Label& label) {
+    if (label.position != Label::Unbound) {
+      imm32(uint32_t(label.position - (size() + 4)));
+    } else {
+      label.fixups.push_back(size());
+      imm32(0);
+    }
+  }
+  void bind(Label& label) {
+    assert(label.position == Label::Unbound);
+    label.position = size();
+    for (auto at : label.fixups) {
+      patch32(at, uint32_t(label.position - (at + 4)));
+    }
+    label.fixups.clear();
+  }
+
+  void jmp(Label& label) { byte(0xe9); rel32(label); }
+  // condition codes are the low nibble of the Jcc/SETcc opcodes
+  void jcc(uint8_t cc, Label& label) { bytes({ 0x0f, uint8_t(0x80 | cc) }); rel32(label); }
+};
+
+enum ConditionCode : uint8_t {
+  CondB = 0x2, CondAE = 0x3, CondE = 0x4, CondNE = 0x5, CondBE = 0x6, CondA = 0x7,
+  CondP = 0xa, CondNP = 0xb, CondL = 0xc, CondGE = 0xd, CondLE = 0xe, CondG = 0xf
+};
+
+// Compiles one function.
+
+struct FunctionCompiler : public Visitor<FunctionCompiler> {
+  Module& wasm;
+  Function* func;
+  Assembler& out;
+  std::unordered_map<Name, Label>& functionLabels;
+  std::unordered_set<Name>& compiled;
+
+  struct BreakTarget {
+    Name name;
+    Label* label;
+    size_t depth;
+  };
+
+  std::vector<BreakTarget> breakTargets;
+
+  // the number of 8-byte values we have pushed in this frame
+  size_t depth = 0;
+
+  Label epilogue;
+
+  FunctionCompiler(Module& wasm, Function* func, Assembler& out, std::unordered_map<Name, Label>& functionLabels, std::unordered_set<Name>& compiled) : wasm(wasm), func(func), out(out), functionLabels(functionLabels), compiled(compiled) {}
+
+  void compile() {
+    out.bind(functionLabels[func->name]);
+    // push rbp; mov rbp, rsp; push rbx; push r12; mov rbx, rdi; mov r12, rsi
+    out.bytes({ 0x55, 0x48, 0x89, 0xe5, 0x53, 0x41, 0x54, 0x48, 0x89, 0xfb, 0x49, 0x89, 0xf4 });
+    // mov eax, [r12 + maxDepth]; cmp [r12 + depth], eax; ja trap; inc [r12 + depth]
+    Label ok;
+    out.bytes({ 0x41, 0x8b, 0x44, 0x24, offsetof(BaselineJIT::Context, maxDepth) });
+    out.bytes({ 0x41, 0x39, 0x44, 0x24, offsetof(BaselineJIT::Context, depth) });
+    out.jcc(CondBE, ok);
+    emitTrap(TrapStackLimit);
+    out.bind(ok);
+    out.bytes({ 0x41, 0xff, 0x44, 0x24, offsetof(BaselineJIT::Context, depth) });
+    visit(func->body);
+    out.bind(epilogue);
+    // dec [r12 + depth]; lea rsp, [rbp - 16]; pop r12; pop rbx; pop rbp; ret
+    out.bytes({ 0x41, 0xff, 0x4c, 0x24, offsetof(BaselineJIT::Context, depth) });
+    out.bytes({ 0x48, 0x8d, 0x65, 0xf0, 0x41, 0x5c, 0x5b, 0x5d, 0xc3 });
+  }
+
+  // helpers
+
+  void push() {
+    out.byte(0x50); // push rax
+    depth++;
+  }
+  void popToRCX() {
+    out.byte(0x59); // pop rcx
+    depth--;
+  }
+  void popToRAX() {
+    out.byte(0x58); // pop rax
+    depth--;
+  }
+  void popToRDX() {
+    out.byte(0x5a); // pop rdx
+    depth--;
+  }
+  void moveRAXToRCX() {
+    out.bytes({ 0x48, 0x89, 0xc1 });
+  }
+  void adjustStack(size_t slots) {
+    if (slots == 0) return;
+    // add rsp, imm32
+    out.bytes({ 0x48, 0x81, 0xc4 });
+    out.imm32(uint32_t(slots * 8));
+  }
+  void emitTrapCheck() {
+    // cmp dword [r12 + trap], 0; jne epilogue
+    out.bytes({ 0x41, 0x83, 0x3c, 0x24, 0x00 });
+    out.jcc(CondNE, epilogue);
+  }
+  // mov rsi, imm64
+  void moveToRSI(const void* pointer) {
+    out.bytes({ 0x48, 0xbe });
+    out.imm64(uint64_t(reinterpret_cast<uintptr_t>(pointer)));
+  }
+  // mov rdx, imm64
+  void moveToRDX(const void* pointer) {
+    out.bytes({ 0x48, 0xba });
+    out.imm64(uint64_t(reinterpret_cast<uintptr_t>(pointer)));
+  }
+  // Calls a runtime function with the context and what was already put in
+  // rsi, rdx and rcx. The stack is aligned at function entry, and then
+  // changes by 8 bytes for each value we push.
+  template<typename T>
+  void emitRuntimeCall(T* function) {
+    out.bytes({ 0x4c, 0x89, 0xe7 }); // mov rdi, r12
+    bool pad = depth % 2 != 0;
+    if (pad) out.bytes({ 0x48, 0x83, 0xec, 0x08 }); // sub rsp, 8
+    out.bytes({ 0x48, 0xb8 }); // mov rax, imm64
+    out.imm64(uint64_t(reinterpret_cast<uintptr_t>(function)));
+    out.bytes({ 0xff, 0xd0 }); // call rax
+    if (pad) out.bytes({ 0x48, 0x83, 0xc4, 0x08 }); // add rsp, 8
+    emitTrapCheck();
+  }
+  // Pushes the operands of a call, and returns how many there are.
+  size_t pushOperands(ExpressionList& operands) {
+    for (auto* operand : operands) {
+      visit(operand);
+      push();
+    }
+    return operands.size();
+  }
+  void popOperands(size_t num) {
+    adjustStack(num);
+    depth -= num;
+  }
+  void emitTrap(TrapCode code) {
+    // mov dword [r12 + trap], code; jmp epilogue
+    out.bytes({ 0x41, 0xc7, 0x04, 0x24 });
+    out.imm32(code);
+    out.jmp(epilogue);
+  }
+  // test eax, eax  or  test rax, rax
+  void testRAX(WasmType type) {
+    if (type == i64) out.byte(0x48);
+    out.bytes({ 0x85, 0xc0 });
+  }
+  // test ecx, ecx  or  test rcx, rcx
+  void testRCX(WasmType type) {
+    if (type == i64) out.byte(0x48);
+    out.bytes({ 0x85, 0xc9 });
+  }
+
+  BreakTarget& getBreakTarget(Name name) {
+    for (auto i = breakTargets.rbegin(); i != breakTargets.rend(); ++i) {
+      if (i->name == name) return *i;
+    }
+    WASM_UNREACHABLE();
+  }
+  void emitBreakTo(Name name) {
+    auto& target = getBreakTarget(name);
+    adjustStack(depth - target.depth);
+    out.jmp(*target.label);
+  }
+
+  // Evaluates an operand into rcx, keeping rax intact. Simple operands are
+  // loaded directly, others are computed and then moved.
+  void emitIntoRCX(Expression* curr) {
+    if (auto* c = curr->dynCast<Const>()) {
+      uint64_t bits = getBits(c->value);
+      if (bits <= UINT32_MAX) {
+        out.byte(0xb9); // mov ecx, imm32
+        out.imm32(uint32_t(bits));
+      } else {
+        out.bytes({ 0x48, 0xb9 }); // mov rcx, imm64
+        out.imm64(bits);
+      }
+      return;
+    }
+    if (auto* get = curr->dynCast<GetLocal>()) {
+      out.bytes({ 0x48, 0x8b, 0x8b }); // mov rcx, [rbx + disp32]
+      out.imm32(get->index * 8);
+      return;
+    }
+    push();
+    visit(curr);
+    moveRAXToRCX();
+    popToRAX();
+  }
+
+  // visitors
+
+  void visitBlock(Block* curr) {
+    Label done;
+    if (curr->name.is()) {
+      breakTargets.push_back({ curr->name, &done, depth });
+    }
+    for (auto* child : curr->list) {
+      visit(child);
+    }
+    if (curr->name.is()) {
+      breakTargets.pop_back();
+    }
+    out.bind(done);
+  }
+  void visitIf(If* curr) {
+    visit(curr->condition);
+    testRAX(i32);
+    Label otherwise, done;
+    out.jcc(CondE, otherwise);
+    visit(curr->ifTrue);
+    if (curr->ifFalse) {
+      out.jmp(done);
+      out.bind(otherwise);
+      visit(curr->ifFalse);
+      out.bind(done);
+    } else {
+      out.bind(otherwise);
+    }
+  }
+  void visitLoop(Loop* curr) {
+    Label top;
+    out.bind(top);
+    if (curr->name.is()) {
+      breakTargets.push_back({ curr->name, &top, depth });
+    }
+    visit(curr->body);
+    if (curr->name.is()) {
+      breakTargets.pop_back();
+    }
+  }
+  void visitBreak(Break* curr) {
+    if (curr->value) {
+      visit(curr->value);
+    }
+    if (!curr->condition) {
+      emitBreakTo(curr->name);
+      return;
+    }
+    if (curr->value) {
+      emitIntoRCX(curr->condition);
+    } else {
+      visit(curr->condition);
+      moveRAXToRCX();
+    }
+    testRCX(i32);
+    auto& target = getBreakTarget(curr->name);
+    if (depth == target.depth) {
+      out.jcc(CondNE, *target.label);
+    } else {
+      Label skip;
+      out.jcc(CondE, skip);
+      emitBreakTo(curr->name);
+      out.bind(skip);
+    }
+  }
+  void visitSwitch(Switch* curr) {
+    if (curr->value) {
+      visit(curr->value);
+      emitIntoRCX(curr->condition);
+    } else {
+      visit(curr->condition);
+      moveRAXToRCX();
+    }
+    for (Index i = 0; i < curr->targets.size(); i++) {
+      // cmp ecx, imm32
+      out.bytes({ 0x81, 0xf9 });
+      out.imm32(i);
+      Label next;
+      out.jcc(CondNE, next);
+      emitBreakTo(curr->targets[i]);
+      out.bind(next);
+    }
+    emitBreakTo(curr->default_);
+  }
+  void visitCall(Call* curr) {
+    size_t numOperands = pushOperands(curr->operands);
+    if (!compiled.count(curr->target)) {
+      out.bytes({ 0x48, 0x89, 0xe2 }); // mov rdx, rsp
+      moveToRSI(curr);
+      emitRuntimeCall(runtimeCall);
+      popOperands(numOperands);
+      return;
+    }
+    // the pushed operands are in reverse order, so copy them into a new frame
+    // for the callee's locals, which is padded to keep the stack aligned
+    size_t numLocals = wasm.getFunction(curr->target)->getNumLocals();
+    size_t frameSize = numLocals + (depth + numLocals) % 2;
+    if (frameSize > 0) {
+      // sub rsp, imm32
+      out.bytes({ 0x48, 0x81, 0xec });
+      out.imm32(uint32_t(frameSize * 8));
+      depth += frameSize;
+    }
+    for (size_t i = 0; i < numOperands; i++) {
+      // mov rax, [rsp + disp32]; mov [rsp + disp32], rax
+      out.bytes({ 0x48, 0x8b, 0x84, 0x24 });
+      out.imm32(uint32_t((frameSize + numOperands - 1 - i) * 8));
+      out.bytes({ 0x48, 0x89, 0x84, 0x24 });
+      out.imm32(uint32_t(i * 8));
+    }
+    if (numLocals > numOperands) {
+      out.bytes({ 0x31, 0xc0 }); // xor eax, eax
+      for (size_t i = numOperands; i < numLocals; i++) {
+        out.bytes({ 0x48, 0x89, 0x84, 0x24 });
+        out.imm32(uint32_t(i * 8));
+      }
+    }
+    // mov rdi, rsp; mov rsi, r12; call target
+    out.bytes({ 0x48, 0x89, 0xe7, 0x4c, 0x89, 0xe6, 0xe8 });
+    out.rel32(functionLabels[curr->target]);
+    popOperands(frameSize + numOperands);
+    emitTrapCheck();
+  }
+  void visitCallImport(CallImport* curr) {
+    size_t numOperands = pushOperands(curr->operands);
+    out.bytes({ 0x48, 0x89, 0xe1 }); // mov rcx, rsp
+    moveToRSI(curr);
+    moveToRDX(wasm.getImport(curr->target));
+    emitRuntimeCall(runtimeCallImport);
+    popOperands(numOperands);
+  }
+  void visitCallIndirect(CallIndirect* curr) {
+    size_t numOperands = pushOperands(curr->operands);
+    visit(curr->target);
+    moveRAXToRCX();
+    out.bytes({ 0x48, 0x89, 0xe2 }); // mov rdx, rsp
+    moveToRSI(curr);
+    emitRuntimeCall(runtimeCallTable);
+    popOperands(numOperands);
+  }
+  void visitGetLocal(GetLocal* curr) {
+    out.bytes({ 0x48, 0x8b, 0x83 }); // mov rax, [rbx + disp32]
+    out.imm32(curr->index * 8);
+  }
+  void visitSetLocal(SetLocal* curr) {
+    visit(curr->value);
+    out.bytes({ 0x48, 0x89, 0x83 }); // mov [rbx + disp32], rax
+    out.imm32(curr->index * 8);
+  }
+  void visitGetGlobal(GetGlobal* curr) {
+    moveToRSI(curr);
+    emitRuntimeCall(runtimeGetGlobal);
+  }
+  void visitSetGlobal(SetGlobal* curr) {
+    visit(curr->value);
+    out.bytes({ 0x48, 0x89, 0xc2 }); // mov rdx, rax
+    moveToRSI(curr);
+    emitRuntimeCall(runtimeSetGlobal);
+  }
+  void visitLoad(Load* curr) {
+    visit(curr->ptr);
+    out.bytes({ 0x48, 0x89, 0xc2 }); // mov rdx, rax
+    moveToRSI(curr);
+    emitRuntimeCall(runtimeLoad);
+  }
+  void visitStore(Store* curr) {
+    visit(curr->ptr);
+    push();
+    visit(curr->value);
+    moveRAXToRCX();
+    popToRDX();
+    moveToRSI(curr);
+    emitRuntimeCall(runtimeStore);
+  }
+  void visitConst(Const* curr) {
+    uint64_t bits = getBits(curr->value);
+    if (bits <= UINT32_MAX) {
+      out.byte(0xb8); // mov eax, imm32
+      out.imm32(uint32_t(bits));
+    } else {
+      out.bytes({ 0x48, 0xb8 }); // mov rax, imm64
+      out.imm64(bits);
+    }
+  }
+  void visitUnary(Unary* curr) {
+    visit(curr->value);
+    switch (curr->op) {
+      case EqZInt32:
+      case EqZInt64: {
+        testRAX(curr->value->type);
+        emitSetCC(CondE);
+        break;
+      }
+      case ExtendSInt32:
+      case ExtendS32Int64: out.bytes({ 0x48, 0x63, 0xc0 }); break; // movsxd rax, eax
+      case ExtendUInt32:
+      case WrapInt64: out.bytes({ 0x89, 0xc0 }); break; // mov eax, eax
+      case ExtendS8Int32: out.bytes({ 0x0f, 0xbe, 0xc0 }); break; // movsx eax, al
+      case ExtendS16Int32: out.bytes({ 0x0f, 0xbf, 0xc0 }); break; // movsx eax, ax
+      case ExtendS8Int64: out.bytes({ 0x48, 0x0f, 0xbe, 0xc0 }); break; // movsx rax, al
+      case ExtendS16Int64: out.bytes({ 0x48, 0x0f, 0xbf, 0xc0 }); break; // movsx rax, ax
+      // the bits are already what we want
+      case ReinterpretInt32:
+      case ReinterpretInt64:
+      case ReinterpretFloat32:
+      case ReinterpretFloat64: break;
+      case NegFloat32: out.bytes({ 0x0f, 0xba, 0xf8, 0x1f }); break; // btc eax, 31
+      case NegFloat64: out.bytes({ 0x48, 0x0f, 0xba, 0xf8, 0x3f }); break; // btc rax, 63
+      case AbsFloat32: out.bytes({ 0x0f, 0xba, 0xf0, 0x1f }); break; // btr eax, 31
+      case AbsFloat64: out.bytes({ 0x48, 0x0f, 0xba, 0xf0, 0x3f }); break; // btr rax, 63
+      default: WASM_UNREACHABLE();
+    }
+  }
+  // setcc al; movzx eax, al
+  void emitSetCC(uint8_t cc) {
+    out.bytes({ 0x0f, uint8_t(0x90 | cc), 0xc0, 0x0f, 0xb6, 0xc0 });
+  }
+  void visitBinary(Binary* curr) {
+    visit(curr->left);
+    emitIntoRCX(curr->right);
+    bool is64 = curr->left->type == i64 || curr->left->type == f64;
+    auto rex = [&]() {
+      if (is64) out.byte(0x48);
+    };
+    // the rcx, rax register form of an ALU opcode
+    auto alu = [&](uint8_t opcode) {
+      rex();
+      out.bytes({ opcode, 0xc8 });
+    };
+    auto shift = [&](uint8_t modrm) {
+      rex();
+      out.bytes({ 0xd3, modrm });
+    };
+    auto compare = [&](uint8_t cc) {
+      alu(0x39); // cmp rax, rcx
+      emitSetCC(cc);
+    };
+    switch (curr->op) {
+      case AddInt32: case AddInt64: alu(0x01); break;
+      case SubInt32: case SubInt64: alu(0x29); break;
+      case AndInt32: case AndInt64: alu(0x21); break;
+      case OrInt32: case OrInt64: alu(0x09); break;
+      case XorInt32: case XorInt64: alu(0x31); break;
+      case MulInt32: case MulInt64: {
+        rex();
+        out.bytes({ 0x0f, 0xaf, 0xc1 }); // imul rax, rcx
+        break;
+      }
+      case ShlInt32: case ShlInt64: shift(0xe0); break;
+      case ShrUInt32: case ShrUInt64: shift(0xe8); break;
+      case ShrSInt32: case ShrSInt64: shift(0xf8); break;
+      case RotLInt32: case RotLInt64: shift(0xc0); break;
+      case RotRInt32: case RotRInt64: shift(0xc8); break;
+      case EqInt32: case EqInt64: compare(CondE); break;
+      case NeInt32: case NeInt64: compare(CondNE); break;
+      case LtSInt32: case LtSInt64: compare(CondL); break;
+      case LtUInt32: case LtUInt64: compare(CondB); break;
+      case LeSInt32: case LeSInt64: compare(CondLE); break;
+      case LeUInt32: case LeUInt64: compare(CondBE); break;
+      case GtSInt32: case GtSInt64: compare(CondG); break;
+      case GtUInt32: case GtUInt64: compare(CondA); break;
+      case GeSInt32: case GeSInt64: compare(CondGE); break;
+      case GeUInt32: case GeUInt64: compare(CondAE); break;
+      case DivSInt32: emitDivision(false, true, false, TrapDivSInt32ByZero, TrapDivSInt32Overflow); break;
+      case DivUInt32: emitDivision(false, false, false, TrapDivUInt32ByZero, NoTrap); break;
+      case RemSInt32: emitDivision(false, true, true, TrapRemSInt32ByZero, NoTrap); break;
+      case RemUInt32: emitDivision(false, false, true, TrapRemUInt32ByZero, NoTrap); break;
+      case DivSInt64: emitDivision(true, true, false, TrapDivSInt64ByZero, TrapDivSInt64Overflow); break;
+      case DivUInt64: emitDivision(true, false, false, TrapDivUInt64ByZero, NoTrap); break;
+      case RemSInt64: emitDivision(true, true, true, TrapRemSInt64ByZero, NoTrap); break;
+      case RemUInt64: emitDivision(true, false, true, TrapRemUInt64ByZero, NoTrap); break;
+      case AddFloat32: case AddFloat64: emitFloatArithmetic(is64, 0x58); break;
+      case SubFloat32: case SubFloat64: emitFloatArithmetic(is64, 0x5c); break;
+      case MulFloat32: case MulFloat64: emitFloatArithmetic(is64, 0x59); break;
+      case CopySignFloat32: case CopySignFloat64: {
+        uint8_t sign = is64 ? 0x3f : 0x1f;
+        rex();
+        out.bytes({ 0x0f, 0xba, 0xf0, sign }); // btr rax, sign
+        rex();
+        out.bytes({ 0xc1, 0xe9, sign }); // shr rcx, sign
+        rex();
+        out.bytes({ 0xc1, 0xe1, sign }); // shl rcx, sign
+        alu(0x09); // or rax, rcx
+        break;
+      }
+      case EqFloat32: case EqFloat64: {
+        // equal and ordered
+        emitFloatCompare(is64, false);
+        out.bytes({ 0x0f, 0x90 | CondE, 0xc0, 0x0f, 0x90 | CondNP, 0xc1 }); // sete al; setnp cl
+        out.bytes({ 0x20, 0xc8, 0x0f, 0xb6, 0xc0 }); // and al, cl; movzx eax, al
+        break;
+      }
+      case NeFloat32: case NeFloat64: {
+        // not equal or unordered
+        emitFloatCompare(is64, false);
+        out.bytes({ 0x0f, 0x90 | CondNE, 0xc0, 0x0f, 0x90 | CondP, 0xc1 }); // setne al; setp cl
+        out.bytes({ 0x08, 0xc8, 0x0f, 0xb6, 0xc0 }); // or al, cl; movzx eax, al
+        break;
+      }
+      // an unordered comparison sets CF, so these are false for NaNs
+      case LtFloat32: case LtFloat64: emitFloatCompare(is64, true); emitSetCC(CondA); break;
+      case LeFloat32: case LeFloat64: emitFloatCompare(is64, true); emitSetCC(CondAE); break;
+      case GtFloat32: case GtFloat64: emitFloatCompare(is64, false); emitSetCC(CondA); break;
+      case GeFloat32: case GeFloat64: emitFloatCompare(is64, false); emitSetCC(CondAE); break;
+      default: WASM_UNREACHABLE();
+    }
+  }
+  void moveToXMM() {
+    out.bytes({ 0x66, 0x48, 0x0f, 0x6e, 0xc0 }); // movq xmm0, rax
+    out.bytes({ 0x66, 0x48, 0x0f, 0x6e, 0xc9 }); // movq xmm1, rcx
+  }
+  // Computes rax op rcx, with the opcode of addss/subss/mulss.
+  void emitFloatArithmetic(bool is64, uint8_t opcode) {
+    moveToXMM();
+    out.bytes({ uint8_t(is64 ? 0xf2 : 0xf3), 0x0f, opcode, 0xc1 }); // op xmm0, xmm1
+    if (is64) {
+      out.bytes({ 0x66, 0x48, 0x0f, 0x7e, 0xc0 }); // movq rax, xmm0
+    } else {
+      out.bytes({ 0x66, 0x0f, 0x7e, 0xc0 }); // movd eax, xmm0
+    }
+  }
+  // Compares rax to rcx, or the other way around, setting the flags as for
+  // unsigned integers.
+  void emitFloatCompare(bool is64, bool swap) {
+    moveToXMM();
+    if (is64) out.byte(0x66);
+    out.bytes({ 0x0f, 0x2e, uint8_t(swap ? 0xc8 : 0xc1) }); // ucomiss xmm0, xmm1
+  }
+  // Divides rax by rcx. The hardware faults on division by zero and on signed
+  // overflow, so check for those first: the former traps, and the latter
+  // either traps (div) or results in 0 (rem).
+  void emitDivision(bool is64, bool isSigned, bool isRem, TrapCode byZero, TrapCode overflow) {
+    WasmType type = is64 ? i64 : i32;
+    Label nonZero, normal, done;
+    testRCX(type);
+    out.jcc(CondNE, nonZero);
+    emitTrap(byZero);
+    out.bind(nonZero);
+    if (isSigned) {
+      // cmp rcx, -1; jne normal
+      if (is64) out.byte(0x48);
+      out.bytes({ 0x83, 0xf9, 0xff });
+      out.jcc(CondNE, normal);
+      if (isRem) {
+        // x rem -1 is always 0
+        out.bytes({ 0x31, 0xc0 }); // xor eax, eax
+        out.jmp(done);
+      } else {
+        if (is64) {
+          // mov rdx, INT64_MIN; cmp rax, rdx
+          out.bytes({ 0x48, 0xba });
+          out.imm64(uint64_t(1) << 63);
+          out.bytes({ 0x48, 0x39, 0xd0 });
+        } else {
+          // cmp eax, INT32_MIN
+          out.byte(0x3d);
+          out.imm32(uint32_t(1) << 31);
+        }
+        out.jcc(CondNE, normal);
+        emitTrap(overflow);
+      }
+    }
+    out.bind(normal);
+    if (is64) out.byte(0x48);
+    if (isSigned) {
+      out.byte(0x99); // cdq / cqo
+      if (is64) out.byte(0x48);
+      out.bytes({ 0xf7, 0xf9 }); // idiv rcx
+    } else {
+      out.bytes({ 0x31, 0xd2 }); // xor edx, edx
+      if (is64) out.byte(0x48);
+      out.bytes({ 0xf7, 0xf1 }); // div rcx
+    }
+    if (isRem) {
+      if (is64) out.byte(0x48);
+      out.bytes({ 0x89, 0xd0 }); // mov rax, rdx
+    }
+    out.bind(done);
+  }
+  void visitSelect(Select* curr) {
+    visit(curr->ifTrue);
+    push();
+    visit(curr->ifFalse);
+    push();
+    visit(curr->condition);
+    testRAX(i32);
+    popToRCX(); // ifFalse
+    popToRAX(); // ifTrue
+    out.bytes({ 0x48, 0x0f, 0x44, 0xc1 }); // cmovz rax, rcx
+  }
+  void visitDrop(Drop* curr) {
+    visit(curr->value);
+  }
+  void visitReturn(Return* curr) {
+    if (curr->value) {
+      visit(curr->value);
+    }
+    out.jmp(epilogue);
+  }
+  void visitHost(Host* curr) {
+    switch (curr->op) {
+      case CurrentMemory: emitRuntimeCall(runtimeCurrentMemory); break;
+      case GrowMemory: {
+        visit(curr->operands[0]);
+        out.bytes({ 0x48, 0x89, 0xc6 }); // mov rsi, rax
+        emitRuntimeCall(runtimeGrowMemory);
+        break;
+      }
+      default: WASM_UNREACHABLE();
+    }
+  }
+  void visitNop(Nop* curr) {}
+  void visitUnreachable(Unreachable* curr) {
+    emitTrap(TrapUnreachable);
+  }
+};
+
+#endif // WASM_JIT_X64
+
+bool BaselineJIT::isSupported() {
+#ifdef WASM_JIT_X64
+  return true;
+#else
+  return false;
+#endif
+}
+
+BaselineJIT::BaselineJIT(Module& wasm) : wasm(wasm) {
+#ifdef WASM_JIT_X64
+  // Find what we can compile: functions that only use supported features.
+  std::unordered_set<Name> compilable;
+  for (auto& func : wasm.functions) {
+    if (!isSupportedType(func->result)) continue;
+    bool typesSupported = true;
+    for (auto type : func->params) typesSupported = typesSupported && isSupportedType(type);
+    for (auto type : func->vars) typesSupported = typesSupported && isSupportedType(type);
+    if (!typesSupported) continue;
+    SupportChecker checker;
+    checker.walk(func->body);
+    if (!checker.supported) continue;
+    compilable.insert(func->name);
+  }
+  if (compilable.empty()) return;
+
+  Assembler out;
+  std::unordered_map<Name, Label> functionLabels;
+  for (auto& func : wasm.functions) {
+    if (compilable.count(func->name)) {
+      FunctionCompiler(wasm, func.get(), out, functionLabels, compilable).compile();
+    }
+  }
+
+  codeSize = out.size();
+  void* memory = mmap(nullptr, codeSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (memory == MAP_FAILED) return;
+  memcpy(memory, out.code.data(), codeSize);
+  if (mprotect(memory, codeSize, PROT_READ | PROT_EXEC) != 0) {
+    munmap(memory, codeSize);
+    return;
+  }
+  code = memory;
+  for (auto& func : wasm.functions) {
+    if (compilable.count(func->name)) {
+      entries[func.get()] = reinterpret_cast<Entry>(static_cast<uint8_t*>(code) + functionLabels[func->name].position);
+    }
+  }
+#endif
+}
+
+BaselineJIT::~BaselineJIT() {
+#ifdef WASM_JIT_X64
+  if (code) munmap(code, codeSize);
+#endif
+}
+
+bool BaselineJIT::canRun(Function* func) {
+  return entries.count(func) > 0;
+}
+
+const char* BaselineJIT::run(Function* func, LiteralList& arguments, Literal& result, size_t callDepth, NativeRuntime& runtime) {
+  std::vector<uint64_t> locals(func->getNumLocals());
+  for (Index i = 0; i < arguments.size(); i++) {
+    locals[i] = getBits(arguments[i]);
+  }
+  Context context;
+  context.trap = NoTrap;
+  context.depth = uint32_t(callDepth);
+  context.maxDepth = maxCallDepth;
+  context.runtime = &runtime;
+  uint64_t value = entries[func](locals.data(), &context);
+  if (context.trap == TrapRuntime) std::rethrow_exception(context.exception);
+  if (context.trap != NoTrap) return trapReasons[context.trap];
+  result = makeLiteral(func->result, value);
+  return nullptr;
+}
+
+} // namespace wasm
@@ -0,0 +1,86 @@
+/*
+ * Copyright 2017 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// Baseline JIT compiler for the interpreter.
+//
+// This translates functions directly to x86-64 machine code in a single pass
+// over the AST, without register allocation or optimization: each expression
+// leaves its value in rax, operands are spilled to the native stack, and
+// locals live in an array in memory. That is enough to remove the dispatch
+// overhead of the interpreter, which dominates on loop- and arithmetic-heavy
+// code.
+//
+// Control flow, locals, integer arithmetic, the bitwise and simple arithmetic
+// float operations, and calls between compiled functions are done natively.
+// Memory and global accesses, imports, indirect calls and calls to
+// interpreted functions go through the instance (see NativeRuntime), so they
+// behave and trap exactly as when interpreting. Functions using anything else
+// - for example float division, rounding or conversions, or atomic
+// read-modify-write operations - are left to the interpreter, which
+// remains the reference implementation; a module can freely mix compiled and
+// interpreted functions. On platforms other than x86-64 nothing is compiled.
+//
+
+#ifndef wasm_wasm_jit_h
+#define wasm_wasm_jit_h
+
+#include <exception>
+#include <unordered_map>
+
+#include "wasm.h"
+#include "wasm-interpreter.h"
+
+namespace wasm {
+
+class BaselineJIT : public NativeExecutor {
+public:
+  // Whether native code can be generated on this platform at all.
+  static bool isSupported();
+
+  BaselineJIT(Module& wasm);
+  ~BaselineJIT();
+
+  // The number of functions that were compiled.
+  Index getNumCompiled() { return Index(entries.size()); }
+
+  bool canRun(Function* func) override;
+  const char* run(Function* func, LiteralList& arguments, Literal& result, size_t callDepth, NativeRuntime& runtime) override;
+
+  // State shared between the runtime and compiled code, see wasm-jit.cpp.
+  struct Context {
+    uint32_t trap;
+    uint32_t depth;
+    uint32_t maxDepth;
+    NativeRuntime* runtime;
+    // what the runtime threw, to be rethrown once we are out of native code
+    std::exception_ptr exception;
+  };
+
+  typedef uint64_t (*Entry)(uint64_t* locals, Context* context);
+
+private:
+  Module& wasm;
+
+  void* code = nullptr;
+  size_t codeSize = 0;
+
+  std::unordered_map<Function*, Entry> entries;
+};
+
+} // namespace wasm
+
+#endif // wasm_wasm_jit_h
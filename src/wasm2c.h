@@ -0,0 +1,1073 @@
+/*
+ * Copyright 2017 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// WebAssembly-to-C translator.
+//
+// The output is a single portable C99 file that needs nothing but libc and
+// libm, so that a native compiler can turn a wasm module into a fast
+// executable, for differential testing, benchmarking, or running wasm
+// outside of a VM.
+//
+// The module becomes global state in the C file: linear memory is a byte
+// array, the table is an array of typed function pointers, and globals are
+// static variables. Its interface is
+//
+//  * wasm_init(): instantiates the module - allocates memory, applies the
+//    segments and runs the start function.
+//  * export_NAME(...): one function for each exported function.
+//  * import_MODULE_BASE: a function pointer for each imported function, and a
+//    variable for each imported global, which must be set before wasm_init()
+//    is called.
+//  * wasm_memory and wasm_memory_pages: the linear memory.
+//  * wasm_trap_handler: traps longjmp() to this if it is set, after setting
+//    wasm_trap_reason, and abort() otherwise.
+//
+// Names are mangled so that anything but [a-zA-Z0-9] becomes _XX, where XX
+// is the hex value of the character. A host is assumed to be little-endian,
+// like wasm itself, and the C compiler must not contract floating-point
+// operations (e.g. into fused multiply-adds), which is the default in ISO C
+// modes like -std=c99.
+//
+// Wasm's expressions can contain statements, like a block whose value is
+// used as an operand, which C's cannot. We therefore emit each function as a
+// flat sequence of statements, computing each value into a temporary
+// variable, in the order wasm evaluates them. Control flow becomes if/else,
+// labels and gotos. This is verbose but simple, and C compilers optimize the
+// temporaries away entirely.
+//
+
+#ifndef wasm_wasm2c_h
+#define wasm_wasm2c_h
+
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+#include "asm_v_wasm.h"
+#include "support/name.h"
+#include "wasm.h"
+#include "wasm-builder.h"
+#include "wasm-s-parser.h"
+
+namespace wasm {
+
+class Wasm2CBuilder {
+public:
+  struct Flags {
+    bool debug = false;
+  };
+
+  Wasm2CBuilder(Flags f) : flags(f) {}
+
+  // Emits C for a module
+  void processWasm(Module* wasm, std::ostream& o);
+
+  // Emits a main() that runs the assert_return, assert_trap and invoke
+  // commands in a .wast script on the module, printing any failures, and
+  // returning nonzero if there were any. Imports from "spectest" are
+  // provided.
+  void processAsserts(Module* wasm, Element& root, SExpressionWasmBuilder& sexpBuilder, std::ostream& o);
+
+  static std::string mangle(Name name);
+  static const char* getCType(WasmType type);
+  static std::string getLiteral(Literal value);
+
+private:
+  Flags flags;
+  Module* wasm;
+
+  // canonical ids for function signatures, for call_indirect type checks
+  std::map<std::string, Index> signatureIds;
+
+  Index getSignatureId(const std::string& sig) {
+    auto iter = signatureIds.find(sig);
+    if (iter != signatureIds.end()) return iter->second;
+    Index id = signatureIds.size();
+    signatureIds[sig] = id;
+    return id;
+  }
+
+  std::string getFunctionName(Name name) { return "f_" + mangle(name); }
+  std::string getGlobalName(Name name);
+  std::string getImportName(Import* import) {
+    return "import_" + mangle(import->module) + "_" + mangle(import->base);
+  }
+  // a function declaration with the given C name, or a pointer type if the
+  // name is empty
+  std::string getSignature(const std::string& cName, WasmType result, const std::vector<WasmType>& params);
+  std::string getInitExpression(Expression* init);
+
+  // the type of a function or an imported function
+  FunctionType* getFunctionType(Name name) {
+    if (auto* import = wasm->getImportOrNull(name)) {
+      return wasm->getFunctionType(import->functionType);
+    }
+    auto* func = wasm->getFunction(name);
+    functionTypes.emplace_back(wasm::make_unique<FunctionType>());
+    auto* type = functionTypes.back().get();
+    type->params = func->params;
+    type->result = func->result;
+    return type;
+  }
+  std::vector<std::unique_ptr<FunctionType>> functionTypes;
+
+  void processFunction(Function* func, std::ostream& o);
+  void processAssert(Element& e, Index index, SExpressionWasmBuilder& sexpBuilder, std::ostream& o, std::ostream& checks);
+
+  friend struct Wasm2CFunctionEmitter;
+};
+
+static const char* WASM2C_PRELUDE = R"(#include <math.h>
+#include <setjmp.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef uint8_t u8;
+typedef int8_t s8;
+typedef uint16_t u16;
+typedef int16_t s16;
+typedef uint32_t u32;
+typedef int32_t s32;
+typedef uint64_t u64;
+typedef int64_t s64;
+typedef float f32;
+typedef double f64;
+
+#if defined(__GNUC__)
+#define WASM_NORETURN __attribute__((noreturn))
+#define WASM_UNUSED __attribute__((unused))
+#else
+#define WASM_NORETURN
+#define WASM_UNUSED
+#endif
+
+#ifndef WASM_MAX_CALL_DEPTH
+#define WASM_MAX_CALL_DEPTH 10000
+#endif
+
+#define WASM_PAGE_SIZE 65536
+
+jmp_buf* wasm_trap_handler = NULL;
+const char* wasm_trap_reason = NULL;
+static u32 wasm_call_depth = 0;
+
+static WASM_NORETURN void wasm_trap(const char* reason) {
+  wasm_trap_reason = reason;
+  if (wasm_trap_handler) longjmp(*wasm_trap_handler, 1);
+  fprintf(stderr, "wasm trap: %s\n", reason);
+  abort();
+}
+
+u8* wasm_memory = NULL;
+u32 wasm_memory_pages = 0;
+static u32 wasm_memory_max_pages = 0;
+static u64 wasm_memory_size = 0;
+
+static WASM_UNUSED u32 wasm_grow_memory(u32 delta) {
+  u32 old = wasm_memory_pages;
+  if (delta > wasm_memory_max_pages - old) return (u32)-1;
+  u64 size = (u64)(old + delta) * WASM_PAGE_SIZE;
+  u8* memory = (u8*)realloc(wasm_memory, size ? size : 1);
+  if (!memory) return (u32)-1;
+  memset(memory + wasm_memory_size, 0, size - wasm_memory_size);
+  wasm_memory = memory;
+  wasm_memory_pages = old + delta;
+  wasm_memory_size = size;
+  return old;
+}
+
+typedef void (*wasm_funcref)(void);
+
+typedef struct {
+  u32 type;
+  wasm_funcref func;
+} wasm_table_entry;
+
+#define WASM_MEMCHECK(addr, t) \
+  if ((addr) + sizeof(t) > wasm_memory_size) wasm_trap("out of bounds memory access")
+
+#define WASM_DEFINE_LOAD(name, t1, t2, t3) \
+  static WASM_UNUSED inline t3 name(u64 addr) { \
+    WASM_MEMCHECK(addr, t1); \
+    t1 result; \
+    memcpy(&result, &wasm_memory[addr], sizeof(t1)); \
+    return (t3)(t2)result; \
+  }
+
+#define WASM_DEFINE_STORE(name, t1, t2) \
+  static WASM_UNUSED inline void name(u64 addr, t2 value) { \
+    WASM_MEMCHECK(addr, t1); \
+    t1 wrapped = (t1)value; \
+    memcpy(&wasm_memory[addr], &wrapped, sizeof(t1)); \
+  }
+
+WASM_DEFINE_LOAD(i32_load, u32, u32, u32)
+WASM_DEFINE_LOAD(i64_load, u64, u64, u64)
+WASM_DEFINE_LOAD(f32_load, f32, f32, f32)
+WASM_DEFINE_LOAD(f64_load, f64, f64, f64)
+WASM_DEFINE_LOAD(i32_load8_s, s8, s32, u32)
+WASM_DEFINE_LOAD(i64_load8_s, s8, s64, u64)
+WASM_DEFINE_LOAD(i32_load8_u, u8, u32, u32)
+WASM_DEFINE_LOAD(i64_load8_u, u8, u64, u64)
+WASM_DEFINE_LOAD(i32_load16_s, s16, s32, u32)
+WASM_DEFINE_LOAD(i64_load16_s, s16, s64, u64)
+WASM_DEFINE_LOAD(i32_load16_u, u16, u32, u32)
+WASM_DEFINE_LOAD(i64_load16_u, u16, u64, u64)
+WASM_DEFINE_LOAD(i64_load32_s, s32, s64, u64)
+WASM_DEFINE_LOAD(i64_load32_u, u32, u64, u64)
+WASM_DEFINE_STORE(i32_store, u32, u32)
+WASM_DEFINE_STORE(i64_store, u64, u64)
+WASM_DEFINE_STORE(f32_store, f32, f32)
+WASM_DEFINE_STORE(f64_store, f64, f64)
+WASM_DEFINE_STORE(i32_store8, u8, u32)
+WASM_DEFINE_STORE(i32_store16, u16, u32)
+WASM_DEFINE_STORE(i64_store8, u8, u64)
+WASM_DEFINE_STORE(i64_store16, u16, u64)
+WASM_DEFINE_STORE(i64_store32, u32, u64)
+
+#define WASM_DEFINE_DIV(name, t, st, min) \
+  static WASM_UNUSED inline t name##_div_s(t a, t b) { \
+    if (b == 0) wasm_trap("integer divide by zero"); \
+    if (a == (t)(min) && b == (t)-1) wasm_trap("integer overflow"); \
+    return (t)((st)a / (st)b); \
+  } \
+  static WASM_UNUSED inline t name##_div_u(t a, t b) { \
+    if (b == 0) wasm_trap("integer divide by zero"); \
+    return a / b; \
+  } \
+  static WASM_UNUSED inline t name##_rem_s(t a, t b) { \
+    if (b == 0) wasm_trap("integer divide by zero"); \
+    if (b == (t)-1) return 0; \
+    return (t)((st)a % (st)b); \
+  } \
+  static WASM_UNUSED inline t name##_rem_u(t a, t b) { \
+    if (b == 0) wasm_trap("integer divide by zero"); \
+    return a % b; \
+  }
+
+WASM_DEFINE_DIV(i32, u32, s32, 0x80000000u)
+WASM_DEFINE_DIV(i64, u64, s64, 0x8000000000000000ull)
+
+static WASM_UNUSED inline u32 i32_rotl(u32 x, u32 n) { n &= 31; return n ? (x << n) | (x >> (32 - n)) : x; }
+static WASM_UNUSED inline u32 i32_rotr(u32 x, u32 n) { n &= 31; return n ? (x >> n) | (x << (32 - n)) : x; }
+static WASM_UNUSED inline u64 i64_rotl(u64 x, u64 n) { n &= 63; return n ? (x << n) | (x >> (64 - n)) : x; }
+static WASM_UNUSED inline u64 i64_rotr(u64 x, u64 n) { n &= 63; return n ? (x >> n) | (x << (64 - n)) : x; }
+
+#if defined(__GNUC__)
+static WASM_UNUSED inline u32 i32_clz(u32 x) { return x ? __builtin_clz(x) : 32; }
+static WASM_UNUSED inline u32 i32_ctz(u32 x) { return x ? __builtin_ctz(x) : 32; }
+static WASM_UNUSED inline u32 i32_popcnt(u32 x) { return __builtin_popcount(x); }
+static WASM_UNUSED inline u64 i64_clz(u64 x) { return x ? __builtin_clzll(x) : 64; }
+static WASM_UNUSED inline u64 i64_ctz(u64 x) { return x ? __builtin_ctzll(x) : 64; }
+static WASM_UNUSED inline u64 i64_popcnt(u64 x) { return __builtin_popcountll(x); }
+#else
+static WASM_UNUSED u32 i32_clz(u32 x) { u32 n = 0; while (n < 32 && !(x & (0x80000000u >> n))) n++; return n; }
+static WASM_UNUSED u32 i32_ctz(u32 x) { u32 n = 0; while (n < 32 && !(x & (1u << n))) n++; return n; }
+static WASM_UNUSED u32 i32_popcnt(u32 x) { u32 n = 0; while (x) { n += x & 1; x >>= 1; } return n; }
+static WASM_UNUSED u64 i64_clz(u64 x) { u64 n = 0; while (n < 64 && !(x & (0x8000000000000000ull >> n))) n++; return n; }
+static WASM_UNUSED u64 i64_ctz(u64 x) { u64 n = 0; while (n < 64 && !(x & (1ull << n))) n++; return n; }
+static WASM_UNUSED u64 i64_popcnt(u64 x) { u64 n = 0; while (x) { n += x & 1; x >>= 1; } return n; }
+#endif
+
+static WASM_UNUSED inline u32 i32_reinterpret_f32(f32 x) { u32 r; memcpy(&r, &x, 4); return r; }
+static WASM_UNUSED inline u64 i64_reinterpret_f64(f64 x) { u64 r; memcpy(&r, &x, 8); return r; }
+static WASM_UNUSED inline f32 f32_reinterpret_i32(u32 x) { f32 r; memcpy(&r, &x, 4); return r; }
+static WASM_UNUSED inline f64 f64_reinterpret_i64(u64 x) { f64 r; memcpy(&r, &x, 8); return r; }
+
+#define WASM_DEFINE_MIN_MAX(t, it, reinterpret, back, quiet) \
+  static WASM_UNUSED inline t t##_min(t a, t b) { \
+    if (isnan(a)) return back(reinterpret(a) | quiet); \
+    if (isnan(b)) return back(reinterpret(b) | quiet); \
+    if (a == 0 && b == 0) return signbit(a) ? a : b; \
+    return a < b ? a : b; \
+  } \
+  static WASM_UNUSED inline t t##_max(t a, t b) { \
+    if (isnan(a)) return back(reinterpret(a) | quiet); \
+    if (isnan(b)) return back(reinterpret(b) | quiet); \
+    if (a == 0 && b == 0) return signbit(a) ? b : a; \
+    return a > b ? a : b; \
+  }
+
+WASM_DEFINE_MIN_MAX(f32, u32, i32_reinterpret_f32, f32_reinterpret_i32, 0x400000u)
+WASM_DEFINE_MIN_MAX(f64, u64, i64_reinterpret_f64, f64_reinterpret_i64, 0x8000000000000ull)
+
+// valid ranges are exclusive on both ends
+#define WASM_DEFINE_TRUNC(name, ft, it, min, max) \
+  static WASM_UNUSED inline it name(ft x) { \
+    if (isnan(x)) wasm_trap("invalid conversion to integer"); \
+    if (!(x > (min) && x < (max))) wasm_trap("integer overflow"); \
+    return (it)x; \
+  }
+
+WASM_DEFINE_TRUNC(i32_trunc_s_f32_, f32, s32, -2147483904.0f, 2147483648.0f)
+WASM_DEFINE_TRUNC(i32_trunc_u_f32, f32, u32, -1.0f, 4294967296.0f)
+WASM_DEFINE_TRUNC(i32_trunc_s_f64_, f64, s32, -2147483649.0, 2147483648.0)
+WASM_DEFINE_TRUNC(i32_trunc_u_f64, f64, u32, -1.0, 4294967296.0)
+WASM_DEFINE_TRUNC(i64_trunc_s_f32_, f32, s64, -9223373136366403584.0f, 9223372036854775808.0f)
+WASM_DEFINE_TRUNC(i64_trunc_u_f32, f32, u64, -1.0f, 18446744073709551616.0f)
+WASM_DEFINE_TRUNC(i64_trunc_s_f64_, f64, s64, -9223372036854777856.0, 9223372036854775808.0)
+WASM_DEFINE_TRUNC(i64_trunc_u_f64, f64, u64, -1.0, 18446744073709551616.0)
+
+#define i32_trunc_s_f32(x) ((u32)i32_trunc_s_f32_(x))
+#define i32_trunc_s_f64(x) ((u32)i32_trunc_s_f64_(x))
+#define i64_trunc_s_f32(x) ((u64)i64_trunc_s_f32_(x))
+#define i64_trunc_s_f64(x) ((u64)i64_trunc_s_f64_(x))
+
+// run a function, returning whether it trapped
+static WASM_UNUSED int wasm_run_guarded(void (*func)(void)) {
+  jmp_buf buf;
+  jmp_buf* previousHandler = wasm_trap_handler;
+  u32 previousDepth = wasm_call_depth;
+  int trapped;
+  wasm_trap_handler = &buf;
+  trapped = setjmp(buf);
+  if (!trapped) func();
+  wasm_trap_handler = previousHandler;
+  wasm_call_depth = previousDepth;
+  return trapped;
+}
+)";
+
+//
+// Emits the body of a function. Each expression is computed into a
+// temporary (or is a constant), whose name is returned, after emitting the
+// statements that compute it. If the expression has no value, or is
+// unreachable, the empty string is returned; code after something
+// unreachable is not emitted.
+//
+
+struct Wasm2CFunctionEmitter : public OverriddenVisitor<Wasm2CFunctionEmitter, std::string> {
+  Wasm2CBuilder& parent;
+  Module* wasm;
+  Function* func;
+
+  std::stringstream body;
+  std::map<WasmType, std::vector<std::string>> temps;
+  Index numTemps = 0;
+  int indent = 1;
+
+  struct Label {
+    Name name;
+    std::string label;
+    std::string result; // the temp a break with a value assigns to
+  };
+
+  std::vector<Label> labels;
+  Index numLabels = 0;
+
+  Wasm2CFunctionEmitter(Wasm2CBuilder& parent, Module* wasm, Function* func) : parent(parent), wasm(wasm), func(func) {}
+
+  void line(const std::string& text) {
+    for (int i = 0; i < indent; i++) body << "  ";
+    body << text << '\n';
+  }
+
+  std::string makeTemp(WasmType type) {
+    std::string name = "t" + std::to_string(numTemps++);
+    temps[type].push_back(name);
+    return name;
+  }
+
+  std::string assignTemp(WasmType type, const std::string& value) {
+    auto temp = makeTemp(type);
+    line(temp + " = " + value + ";");
+    return temp;
+  }
+
+  // Emits a child, returning whether code after it is reachable. Types are
+  // not always refinalized, so a child that should have a value but does not
+  // is unreachable as well.
+  bool emitChild(Expression* child, std::string& value) {
+    value = visit(child);
+    if (child->type == unreachable) return false;
+    return !(isConcreteWasmType(child->type) && value.empty());
+  }
+
+  Label& getLabel(Name name) {
+    for (auto i = labels.rbegin(); i != labels.rend(); ++i) {
+      if (i->name == name) return *i;
+    }
+    WASM_UNREACHABLE();
+  }
+
+  std::string getBreak(Name name, const std::string& value) {
+    auto& target = getLabel(name);
+    std::string ret;
+    if (!value.empty() && !target.result.empty()) {
+      ret += target.result + " = " + value + "; ";
+    }
+    return ret + "goto " + target.label + ";";
+  }
+
+  std::string getReturn(const std::string& value) {
+    if (value.empty()) return "wasm_call_depth--; return;";
+    return "wasm_call_depth--; return " + value + ";";
+  }
+
+  // Emits the operands of a call, returning false if one is unreachable.
+  bool emitOperands(ExpressionList& operands, std::string& list) {
+    for (auto* operand : operands) {
+      std::string value;
+      if (!emitChild(operand, value)) return false;
+      if (!list.empty()) list += ", ";
+      list += value;
+    }
+    return true;
+  }
+
+  std::string emitCall(WasmType type, const std::string& call) {
+    if (isConcreteWasmType(type)) return assignTemp(type, call);
+    line(call + ";");
+    return "";
+  }
+
+  std::string visitBlock(Block* curr) {
+    std::string result;
+    if (isConcreteWasmType(curr->type)) result = makeTemp(curr->type);
+    std::string label;
+    if (curr->name.is()) {
+      label = "B" + std::to_string(numLabels++);
+      labels.push_back({ curr->name, label, result });
+    }
+    for (Index i = 0; i < curr->list.size(); i++) {
+      std::string value;
+      if (!emitChild(curr->list[i], value)) break;
+      if (i == curr->list.size() - 1 && !result.empty()) {
+        line(result + " = " + value + ";");
+      }
+    }
+    if (curr->name.is()) {
+      labels.pop_back();
+      line(label + ":;");
+    }
+    if (curr->type == unreachable) return "";
+    return result;
+  }
+  std::string visitIf(If* curr) {
+    std::string condition;
+    if (!emitChild(curr->condition, condition)) return "";
+    std::string result;
+    if (isConcreteWasmType(curr->type)) result = makeTemp(curr->type);
+    line("if (" + condition + ") {");
+    indent++;
+    std::string value;
+    if (emitChild(curr->ifTrue, value) && !result.empty()) line(result + " = " + value + ";");
+    indent--;
+    if (curr->ifFalse) {
+      line("} else {");
+      indent++;
+      if (emitChild(curr->ifFalse, value) && !result.empty()) line(result + " = " + value + ";");
+      indent--;
+    }
+    line("}");
+    if (curr->type == unreachable) return "";
+    return result;
+  }
+  std::string visitLoop(Loop* curr) {
+    std::string label;
+    if (curr->name.is()) {
+      label = "L" + std::to_string(numLabels++);
+      line(label + ":;");
+      labels.push_back({ curr->name, label, "" });
+    }
+    auto value = visit(curr->body);
+    if (curr->name.is()) labels.pop_back();
+    if (curr->type == unreachable) return "";
+    return value;
+  }
+  std::string visitBreak(Break* curr) {
+    std::string value, condition;
+    if (curr->value && !emitChild(curr->value, value)) return "";
+    if (!curr->condition) {
+      line(getBreak(curr->name, value));
+      return "";
+    }
+    if (!emitChild(curr->condition, condition)) return "";
+    line("if (" + condition + ") { " + getBreak(curr->name, value) + " }");
+    return value;
+  }
+  std::string visitSwitch(Switch* curr) {
+    std::string value, condition;
+    if (curr->value && !emitChild(curr->value, value)) return "";
+    if (!emitChild(curr->condition, condition)) return "";
+    line("switch (" + condition + ") {");
+    for (Index i = 0; i < curr->targets.size(); i++) {
+      line("  case " + std::to_string(i) + ": " + getBreak(curr->targets[i], value));
+    }
+    line("  default: " + getBreak(curr->default_, value));
+    line("}");
+    return "";
+  }
+  std::string visitCall(Call* curr) {
+    std::string operands;
+    if (!emitOperands(curr->operands, operands)) return "";
+    return emitCall(curr->type, parent.getFunctionName(curr->target) + "(" + operands + ")");
+  }
+  std::string visitCallImport(CallImport* curr) {
+    std::string operands;
+    if (!emitOperands(curr->operands, operands)) return "";
+    return emitCall(curr->type, parent.getFunctionName(curr->target) + "(" + operands + ")");
+  }
+  std::string visitCallIndirect(CallIndirect* curr) {
+    std::string operands, target;
+    if (!emitOperands(curr->operands, operands)) return "";
+    if (!emitChild(curr->target, target)) return "";
+    auto* type = wasm->getFunctionType(curr->fullType);
+    line("if (" + target + " >= wasm_table_size || !wasm_table[" + target + "].func) wasm_trap(\"undefined element\");");
+    line("if (wasm_table[" + target + "].type != " + std::to_string(parent.getSignatureId(getSig(type))) + ") wasm_trap(\"indirect call type mismatch\");");
+    auto pointerType = parent.getSignature("", type->result, type->params);
+    return emitCall(curr->type, "((" + pointerType + ")wasm_table[" + target + "].func)(" + operands + ")");
+  }
+  std::string visitGetLocal(GetLocal* curr) {
+    return assignTemp(curr->type, "l" + std::to_string(curr->index));
+  }
+  std::string visitSetLocal(SetLocal* curr) {
+    std::string value;
+    if (!emitChild(curr->value, value)) return "";
+    line("l" + std::to_string(curr->index) + " = " + value + ";");
+    if (curr->isTee()) return value;
+    return "";
+  }
+  std::string visitGetGlobal(GetGlobal* curr) {
+    return assignTemp(curr->type, parent.getGlobalName(curr->name));
+  }
+  std::string visitSetGlobal(SetGlobal* curr) {
+    std::string value;
+    if (!emitChild(curr->value, value)) return "";
+    line(parent.getGlobalName(curr->name) + " = " + value + ";");
+    return "";
+  }
+  std::string getAddress(const std::string& ptr, Address offset) {
+    return "(u64)" + ptr + " + " + std::to_string(offset.addr) + "u";
+  }
+  std::string visitLoad(Load* curr) {
+    if (curr->isAtomic) Fatal() << "wasm2c does not support atomics";
+    std::string ptr;
+    if (!emitChild(curr->ptr, ptr)) return "";
+    std::string name = printWasmType(curr->type);
+    name += "_load";
+    if (curr->bytes < getWasmTypeSize(curr->type)) {
+      name += std::to_string(curr->bytes * 8) + (curr->signed_ ? "_s" : "_u");
+    }
+    return assignTemp(curr->type, name + "(" + getAddress(ptr, curr->offset) + ")");
+  }
+  std::string visitStore(Store* curr) {
+    if (curr->isAtomic) Fatal() << "wasm2c does not support atomics";
+    std::string ptr, value;
+    if (!emitChild(curr->ptr, ptr)) return "";
+    if (!emitChild(curr->value, value)) return "";
+    std::string name = printWasmType(curr->valueType);
+    name += "_store";
+    if (curr->bytes < getWasmTypeSize(curr->valueType)) {
+      name += std::to_string(curr->bytes * 8);
+    }
+    line(name + "(" + getAddress(ptr, curr->offset) + ", " + value + ");");
+    return "";
+  }
+  std::string visitAtomicRMW(AtomicRMW* curr) { Fatal() << "wasm2c does not support atomics"; WASM_UNREACHABLE(); }
+  std::string visitAtomicCmpxchg(AtomicCmpxchg* curr) { Fatal() << "wasm2c does not support atomics"; WASM_UNREACHABLE(); }
+  std::string visitAtomicWait(AtomicWait* curr) { Fatal() << "wasm2c does not support atomics"; WASM_UNREACHABLE(); }
+  std::string visitAtomicWake(AtomicWake* curr) { Fatal() << "wasm2c does not support atomics"; WASM_UNREACHABLE(); }
+  std::string visitConst(Const* curr) {
+    return Wasm2CBuilder::getLiteral(curr->value);
+  }
+  std::string visitUnary(Unary* curr) {
+    std::string value;
+    if (!emitChild(curr->value, value)) return "";
+    std::string x = value;
+    std::string expr;
+    switch (curr->op) {
+      case ClzInt32: expr = "i32_clz(" + x + ")"; break;
+      case ClzInt64: expr = "i64_clz(" + x + ")"; break;
+      case CtzInt32: expr = "i32_ctz(" + x + ")"; break;
+      case CtzInt64: expr = "i64_ctz(" + x + ")"; break;
+      case PopcntInt32: expr = "i32_popcnt(" + x + ")"; break;
+      case PopcntInt64: expr = "i64_popcnt(" + x + ")"; break;
+      case NegFloat32:
+      case NegFloat64: expr = "-" + x; break;
+      case AbsFloat32: expr = "fabsf(" + x + ")"; break;
+      case AbsFloat64: expr = "fabs(" + x + ")"; break;
+      case CeilFloat32: expr = "ceilf(" + x + ")"; break;
+      case CeilFloat64: expr = "ceil(" + x + ")"; break;
+      case FloorFloat32: expr = "floorf(" + x + ")"; break;
+      case FloorFloat64: expr = "floor(" + x + ")"; break;
+      case TruncFloat32: expr = "truncf(" + x + ")"; break;
+      case TruncFloat64: expr = "trunc(" + x + ")"; break;
+      case NearestFloat32: expr = "nearbyintf(" + x + ")"; break;
+      case NearestFloat64: expr = "nearbyint(" + x + ")"; break;
+      case SqrtFloat32: expr = "sqrtf(" + x + ")"; break;
+      case SqrtFloat64: expr = "sqrt(" + x + ")"; break;
+      case EqZInt32:
+      case EqZInt64: expr = "(u32)(" + x + " == 0)"; break;
+      case ExtendSInt32: expr = "(u64)(s64)(s32)" + x; break;
+      case ExtendUInt32: expr = "(u64)" + x; break;
+      case WrapInt64: expr = "(u32)" + x; break;
+      case TruncSFloat32ToInt32: expr = "i32_trunc_s_f32(" + x + ")"; break;
+      case TruncSFloat32ToInt64: expr = "i64_trunc_s_f32(" + x + ")"; break;
+      case TruncUFloat32ToInt32: expr = "i32_trunc_u_f32(" + x + ")"; break;
+      case TruncUFloat32ToInt64: expr = "i64_trunc_u_f32(" + x + ")"; break;
+      case TruncSFloat64ToInt32: expr = "i32_trunc_s_f64(" + x + ")"; break;
+      case TruncSFloat64ToInt64: expr = "i64_trunc_s_f64(" + x + ")"; break;
+      case TruncUFloat64ToInt32: expr = "i32_trunc_u_f64(" + x + ")"; break;
+      case TruncUFloat64ToInt64: expr = "i64_trunc_u_f64(" + x + ")"; break;
+      case ReinterpretFloat32: expr = "i32_reinterpret_f32(" + x + ")"; break;
+      case ReinterpretFloat64: expr = "i64_reinterpret_f64(" + x + ")"; break;
+      case ConvertSInt32ToFloat32: expr = "(f32)(s32)" + x; break;
+      case ConvertSInt32ToFloat64: expr = "(f64)(s32)" + x; break;
+      case ConvertUInt32ToFloat32: expr = "(f32)" + x; break;
+      case ConvertUInt32ToFloat64: expr = "(f64)" + x; break;
+      case ConvertSInt64ToFloat32: expr = "(f32)(s64)" + x; break;
+      case ConvertSInt64ToFloat64: expr = "(f64)(s64)" + x; break;
+      case ConvertUInt64ToFloat32: expr = "(f32)" + x; break;
+      case ConvertUInt64ToFloat64: expr = "(f64)" + x; break;
+      case PromoteFloat32: expr = "(f64)" + x; break;
+      case DemoteFloat64: expr = "(f32)" + x; break;
+      case ReinterpretInt32: expr = "f32_reinterpret_i32(" + x + ")"; break;
+      case ReinterpretInt64: expr = "f64_reinterpret_i64(" + x + ")"; break;
+      case ExtendS8Int32: expr = "(u32)(s32)(s8)" + x; break;
+      case ExtendS16Int32: expr = "(u32)(s32)(s16)" + x; break;
+      case ExtendS8Int64: expr = "(u64)(s64)(s8)" + x; break;
+      case ExtendS16Int64: expr = "(u64)(s64)(s16)" + x; break;
+      case ExtendS32Int64: expr = "(u64)(s64)(s32)" + x; break;
+      default: WASM_UNREACHABLE();
+    }
+    return assignTemp(curr->type, expr);
+  }
+  std::string visitBinary(Binary* curr) {
+    std::string left, right;
+    if (!emitChild(curr->left, left)) return "";
+    if (!emitChild(curr->right, right)) return "";
+    auto infix = [&](const char* op) {
+      return left + " " + op + " " + right;
+    };
+    auto compare = [&](const char* op) {
+      return "(u32)(" + infix(op) + ")";
+    };
+    auto compareSigned = [&](const char* op, const char* type) {
+      return "(u32)((" + std::string(type) + ")" + left + " " + op + " (" + type + ")" + right + ")";
+    };
+    auto call = [&](const char* name) {
+      return std::string(name) + "(" + left + ", " + right + ")";
+    };
+    std::string expr;
+    switch (curr->op) {
+      case AddInt32: case AddInt64: case AddFloat32: case AddFloat64: expr = infix("+"); break;
+      case SubInt32: case SubInt64: case SubFloat32: case SubFloat64: expr = infix("-"); break;
+      case MulInt32: case MulInt64: case MulFloat32: case MulFloat64: expr = infix("*"); break;
+      case DivFloat32: case DivFloat64: expr = infix("/"); break;
+      case AndInt32: case AndInt64: expr = infix("&"); break;
+      case OrInt32: case OrInt64: expr = infix("|"); break;
+      case XorInt32: case XorInt64: expr = infix("^"); break;
+      case DivSInt32: expr = call("i32_div_s"); break;
+      case DivUInt32: expr = call("i32_div_u"); break;
+      case RemSInt32: expr = call("i32_rem_s"); break;
+      case RemUInt32: expr = call("i32_rem_u"); break;
+      case DivSInt64: expr = call("i64_div_s"); break;
+      case DivUInt64: expr = call("i64_div_u"); break;
+      case RemSInt64: expr = call("i64_rem_s"); break;
+      case RemUInt64: expr = call("i64_rem_u"); break;
+      case ShlInt32: expr = left + " << (" + right + " & 31)"; break;
+      case ShrUInt32: expr = left + " >> (" + right + " & 31)"; break;
+      case ShrSInt32: expr = "(u32)((s32)" + left + " >> (" + right + " & 31))"; break;
+      case ShlInt64: expr = left + " << (" + right + " & 63)"; break;
+      case ShrUInt64: expr = left + " >> (" + right + " & 63)"; break;
+      case ShrSInt64: expr = "(u64)((s64)" + left + " >> (" + right + " & 63))"; break;
+      case RotLInt32: expr = call("i32_rotl"); break;
+      case RotRInt32: expr = call("i32_rotr"); break;
+      case RotLInt64: expr = call("i64_rotl"); break;
+      case RotRInt64: expr = call("i64_rotr"); break;
+      case EqInt32: case EqInt64: case EqFloat32: case EqFloat64: expr = compare("=="); break;
+      case NeInt32: case NeInt64: case NeFloat32: case NeFloat64: expr = compare("!="); break;
+      case LtUInt32: case LtUInt64: case LtFloat32: case LtFloat64: expr = compare("<"); break;
+      case LeUInt32: case LeUInt64: case LeFloat32: case LeFloat64: expr = compare("<="); break;
+      case GtUInt32: case GtUInt64: case GtFloat32: case GtFloat64: expr = compare(">"); break;
+      case GeUInt32: case GeUInt64: case GeFloat32: case GeFloat64: expr = compare(">="); break;
+      case LtSInt32: expr = compareSigned("<", "s32"); break;
+      case LeSInt32: expr = compareSigned("<=", "s32"); break;
+      case GtSInt32: expr = compareSigned(">", "s32"); break;
+      case GeSInt32: expr = compareSigned(">=", "s32"); break;
+      case LtSInt64: expr = compareSigned("<", "s64"); break;
+      case LeSInt64: expr = compareSigned("<=", "s64"); break;
+      case GtSInt64: expr = compareSigned(">", "s64"); break;
+      case GeSInt64: expr = compareSigned(">=", "s64"); break;
+      case CopySignFloat32: expr = call("copysignf"); break;
+      case CopySignFloat64: expr = call("copysign"); break;
+      case MinFloat32: expr = call("f32_min"); break;
+      case MaxFloat32: expr = call("f32_max"); break;
+      case MinFloat64: expr = call("f64_min"); break;
+      case MaxFloat64: expr = call("f64_max"); break;
+      default: WASM_UNREACHABLE();
+    }
+    return assignTemp(curr->type, expr);
+  }
+  std::string visitSelect(Select* curr) {
+    std::string ifTrue, ifFalse, condition;
+    if (!emitChild(curr->ifTrue, ifTrue)) return "";
+    if (!emitChild(curr->ifFalse, ifFalse)) return "";
+    if (!emitChild(curr->condition, condition)) return "";
+    return assignTemp(curr->type, condition + " ? " + ifTrue + " : " + ifFalse);
+  }
+  std::string visitDrop(Drop* curr) {
+    visit(curr->value);
+    return "";
+  }
+  std::string visitReturn(Return* curr) {
+    std::string value;
+    if (curr->value && !emitChild(curr->value, value)) return "";
+    line(getReturn(value));
+    return "";
+  }
+  std::string visitHost(Host* curr) {
+    switch (curr->op) {
+      case PageSize: return "65536u";
+      case CurrentMemory: return assignTemp(i32, "wasm_memory_pages");
+      case GrowMemory: {
+        std::string delta;
+        if (!emitChild(curr->operands[0], delta)) return "";
+        return assignTemp(i32, "wasm_grow_memory(" + delta + ")");
+      }
+      case HasFeature: return curr->nameOperand == Name("wasm") ? "1u" : "0u";
+      default: WASM_UNREACHABLE();
+    }
+  }
+  std::string visitNop(Nop* curr) {
+    return "";
+  }
+  std::string visitUnreachable(Unreachable* curr) {
+    line("wasm_trap(\"unreachable\");");
+    return "";
+  }
+};
+
+std::string Wasm2CBuilder::mangle(Name name) {
+  std::string ret;
+  for (const char* c = name.str; *c; c++) {
+    if (isalnum(*c)) {
+      ret += *c;
+    } else {
+      char buffer[4];
+      snprintf(buffer, sizeof(buffer), "_%02X", (unsigned char)*c);
+      ret += buffer;
+    }
+  }
+  return ret;
+}
+
+const char* Wasm2CBuilder::getCType(WasmType type) {
+  switch (type) {
+    case none: return "void";
+    case i32: return "u32";
+    case i64: return "u64";
+    case f32: return "f32";
+    case f64: return "f64";
+    default: WASM_UNREACHABLE();
+  }
+}
+
+std::string Wasm2CBuilder::getLiteral(Literal value) {
+  std::stringstream ret;
+  switch (value.type) {
+    case i32: ret << uint32_t(value.geti32()) << "u"; break;
+    case i64: ret << uint64_t(value.geti64()) << "ull"; break;
+    case f32: {
+      float f = value.getf32();
+      if (std::isfinite(f)) {
+        char buffer[64];
+        snprintf(buffer, sizeof(buffer), "%af", double(f));
+        ret << '(' << buffer << ')';
+      } else {
+        ret << "f32_reinterpret_i32(" << uint32_t(value.reinterpreti32()) << "u)";
+      }
+      break;
+    }
+    case f64: {
+      double d = value.getf64();
+      if (std::isfinite(d)) {
+        char buffer[64];
+        snprintf(buffer, sizeof(buffer), "%a", d);
+        ret << '(' << buffer << ')';
+      } else {
+        ret << "f64_reinterpret_i64(" << uint64_t(value.reinterpreti64()) << "ull)";
+      }
+      break;
+    }
+    default: WASM_UNREACHABLE();
+  }
+  return ret.str();
+}
+
+std::string Wasm2CBuilder::getGlobalName(Name name) {
+  auto* import = wasm->getImportOrNull(name);
+  if (import) return getImportName(import);
+  return "g_" + mangle(name);
+}
+
+std::string Wasm2CBuilder::getSignature(const std::string& cName, WasmType result, const std::vector<WasmType>& params) {
+  bool named = !cName.empty();
+  std::string ret = getCType(result);
+  ret += named ? " " + cName + "(" : " (*)(";
+  if (params.empty()) ret += "void";
+  for (Index i = 0; i < params.size(); i++) {
+    if (i > 0) ret += ", ";
+    ret += getCType(params[i]);
+    if (named) ret += " l" + std::to_string(i);
+  }
+  return ret + ")";
+}
+
+std::string Wasm2CBuilder::getInitExpression(Expression* init) {
+  if (auto* c = init->dynCast<Const>()) return getLiteral(c->value);
+  if (auto* get = init->dynCast<GetGlobal>()) return getGlobalName(get->name);
+  Fatal() << "wasm2c: unsupported initializer expression";
+  WASM_UNREACHABLE();
+}
+
+void Wasm2CBuilder::processFunction(Function* func, std::ostream& o) {
+  Wasm2CFunctionEmitter emitter(*this, wasm, func);
+  emitter.line("if (++wasm_call_depth > WASM_MAX_CALL_DEPTH) wasm_trap(\"call stack exhausted\");");
+  std::string value;
+  if (emitter.emitChild(func->body, value)) {
+    emitter.line(emitter.getReturn(func->result == none ? "" : value));
+  }
+  o << "static " << getSignature(getFunctionName(func->name), func->result, func->params) << " {\n";
+  for (Index i = func->getVarIndexBase(); i < func->getNumLocals(); i++) {
+    o << "  " << getCType(func->getLocalType(i)) << " l" << i << " = 0;\n";
+  }
+  for (auto& pair : emitter.temps) {
+    o << "  " << getCType(pair.first);
+    for (Index i = 0; i < pair.second.size(); i++) {
+      o << (i > 0 ? ", " : " ") << pair.second[i];
+    }
+    o << ";\n";
+  }
+  o << emitter.body.str() << "}\n\n";
+}
+
+void Wasm2CBuilder::processWasm(Module* wasm_, std::ostream& o) {
+  wasm = wasm_;
+  o << "/* generated by wasm2c */\n\n" << WASM2C_PRELUDE << '\n';
+
+  // memory and table
+  uint64_t maxPages = wasm->memory.hasMax() ? wasm->memory.max.addr : 65536;
+  o << "static const u32 wasm_memory_initial_pages = " << wasm->memory.initial.addr << "u;\n";
+  o << "static const u32 wasm_memory_declared_max_pages = " << maxPages << "u;\n";
+  o << "static const u32 wasm_table_size = " << wasm->table.initial.addr << "u;\n";
+  o << "static wasm_table_entry wasm_table[" << std::max<uint64_t>(1, wasm->table.initial.addr) << "];\n\n";
+
+  // imports
+  for (auto& import : wasm->imports) {
+    if (import->kind == ExternalKind::Function) {
+      auto* type = wasm->getFunctionType(import->functionType);
+      o << getCType(type->result) << " (*" << getImportName(import.get()) << ")(";
+      if (type->params.empty()) o << "void";
+      for (Index i = 0; i < type->params.size(); i++) {
+        o << (i > 0 ? ", " : "") << getCType(type->params[i]);
+      }
+      o << ") = NULL;\n";
+    } else if (import->kind == ExternalKind::Global) {
+      o << getCType(import->globalType) << ' ' << getImportName(import.get()) << " = 0;\n";
+    }
+  }
+
+  // globals
+  for (auto& global : wasm->globals) {
+    o << "static " << getCType(global->type) << ' ' << getGlobalName(global->name) << ";\n";
+  }
+  o << '\n';
+
+  // declarations, and wrappers that let imports be used as functions
+  for (auto& import : wasm->imports) {
+    if (import->kind != ExternalKind::Function) continue;
+    auto* type = wasm->getFunctionType(import->functionType);
+    o << "static " << getSignature(getFunctionName(import->name), type->result, type->params) << " {\n";
+    o << "  if (!" << getImportName(import.get()) << ") wasm_trap(\"missing import\");\n";
+    o << "  " << (type->result == none ? "" : "return ") << getImportName(import.get()) << "(";
+    for (Index i = 0; i < type->params.size(); i++) {
+      o << (i > 0 ? ", " : "") << 'l' << i;
+    }
+    o << ");\n}\n";
+  }
+  for (auto& func : wasm->functions) {
+    o << "static " << getSignature(getFunctionName(func->name), func->result, func->params) << ";\n";
+  }
+  o << '\n';
+
+  for (auto& func : wasm->functions) {
+    processFunction(func.get(), o);
+  }
+
+  // exports
+  for (auto& export_ : wasm->exports) {
+    if (export_->kind != ExternalKind::Function) continue;
+    auto* type = getFunctionType(export_->value);
+    o << getSignature("export_" + mangle(export_->name), type->result, type->params) << " {\n  " << (type->result == none ? "" : "return ") << getFunctionName(export_->value) << "(";
+    for (Index i = 0; i < type->params.size(); i++) {
+      o << (i > 0 ? ", " : "") << 'l' << i;
+    }
+    o << ");\n}\n\n";
+  }
+
+  // instantiation
+  o << "void wasm_init(void) {\n";
+  o << "  u64 offset;\n";
+  for (auto& global : wasm->globals) {
+    o << "  " << getGlobalName(global->name) << " = " << getInitExpression(global->init) << ";\n";
+  }
+  o << "  free(wasm_memory);\n";
+  o << "  wasm_memory = NULL;\n";
+  o << "  wasm_memory_pages = wasm_memory_size = 0;\n";
+  o << "  wasm_memory_max_pages = wasm_memory_declared_max_pages;\n";
+  o << "  if (wasm_grow_memory(wasm_memory_initial_pages) == (u32)-1) wasm_trap(\"out of memory\");\n";
+  for (auto& segment : wasm->memory.segments) {
+    o << "  offset = " << getInitExpression(segment.offset) << ";\n";
+    o << "  if (offset + " << segment.data.size() << "u > wasm_memory_size) wasm_trap(\"data segment does not fit\");\n";
+    if (segment.data.empty()) continue;
+    o << "  memcpy(wasm_memory + offset, \"";
+    for (char c : segment.data) {
+      unsigned char u = c;
+      if (u >= 32 && u < 127 && u != '"' && u != '\\' && u != '?') {
+        o << c;
+      } else {
+        o << '\\' << std::oct << std::setw(3) << std::setfill('0') << unsigned(u) << std::dec;
+      }
+    }
+    o << "\", " << segment.data.size() << "u);\n";
+  }
+  for (auto& segment : wasm->table.segments) {
+    o << "  offset = " << getInitExpression(segment.offset) << ";\n";
+    o << "  if (offset + " << segment.data.size() << "u > wasm_table_size) wasm_trap(\"elements segment does not fit\");\n";
+    for (Index i = 0; i < segment.data.size(); i++) {
+      Name name = segment.data[i];
+      o << "  wasm_table[offset + " << i << "u].type = " << getSignatureId(getSig(getFunctionType(name))) << ";\n";
+      o << "  wasm_table[offset + " << i << "u].func = (wasm_funcref)" << getFunctionName(name) << ";\n";
+    }
+  }
+  if (wasm->start.is()) {
+    o << "  " << getFunctionName(wasm->start) << "();\n";
+  }
+  o << "}\n";
+}
+
+void Wasm2CBuilder::processAssert(Element& e, Index index, SExpressionWasmBuilder& sexpBuilder, std::ostream& o, std::ostream& checks) {
+  Name command = e[0]->str();
+  Element& action = command == Name("invoke") ? e : *e[1];
+  if (!action.isList() || action.size() < 2 || !action[0]->isStr() || action[0]->str() != Name("invoke")) {
+    std::cerr << "skipping " << e << std::endl;
+    return;
+  }
+  auto* export_ = wasm->getExportOrNull(action[1]->str());
+  if (!export_ || export_->kind != ExternalKind::Function) {
+    std::cerr << "skipping " << e << std::endl;
+    return;
+  }
+  // build the action as a call to the function, then compare to the
+  // expected value
+  Builder builder(*wasm);
+  auto* func = wasm->getFunction(export_->value);
+  std::vector<Expression*> operands;
+  for (size_t i = 2; i < action.size(); i++) {
+    operands.push_back(sexpBuilder.parseExpression(action[i]));
+  }
+  Expression* body = builder.makeCall(func->name, operands, func->result);
+  std::vector<NameType> vars;
+  if (command == Name("assert_return_canonical_nan") || command == Name("assert_return_arithmetic_nan")) {
+    // check that the result is a NaN, that is, not equal to itself
+    vars.emplace_back(Name("result"), func->result);
+    body = builder.makeSequence(
+      builder.makeSetLocal(0, body),
+      builder.makeBinary(func->result == f32 ? NeFloat32 : NeFloat64, builder.makeGetLocal(0, func->result), builder.makeGetLocal(0, func->result))
+    );
+  } else if (command == Name("assert_return") && e.size() == 3) {
+    // compare bits, so that NaNs and signed zeros are checked precisely
+    Expression* expected = sexpBuilder.parseExpression(e[2]);
+    switch (expected->type) {
+      case i32: body = builder.makeBinary(EqInt32, body, expected); break;
+      case i64: body = builder.makeBinary(EqInt64, body, expected); break;
+      case f32: body = builder.makeBinary(EqInt32, builder.makeUnary(ReinterpretFloat32, body), builder.makeUnary(ReinterpretFloat32, expected)); break;
+      case f64: body = builder.makeBinary(EqInt64, builder.makeUnary(ReinterpretFloat64, body), builder.makeUnary(ReinterpretFloat64, expected)); break;
+      default: WASM_UNREACHABLE();
+    }
+  } else if (isConcreteWasmType(body->type)) {
+    body = builder.makeDrop(body);
+  }
+  Name name(cashew::IString(("assert$" + std::to_string(index)).c_str(), false));
+  std::unique_ptr<Function> testFunc(builder.makeFunction(name, {}, body->type, std::move(vars), body));
+  processFunction(testFunc.get(), o);
+  std::string run = "run_" + mangle(name);
+  o << "static void " << run << "(void) { ";
+  if (body->type == i32) o << "assert_result = ";
+  o << getFunctionName(name) << "(); }\n\n";
+  std::string location = std::to_string(e.line);
+  if (command == Name("assert_trap")) {
+    checks << "  if (!wasm_run_guarded(" << run << ")) { printf(\"assert_trap did not trap (line " << location << ")\\n\"); failures++; }\n";
+  } else {
+    checks << "  assert_result = 1;\n";
+    checks << "  if (wasm_run_guarded(" << run << ")) { printf(\"unexpected trap: %s (line " << location << ")\\n\", wasm_trap_reason); failures++; }\n";
+    checks << "  else if (!assert_result) { printf(\"" << command.str << " failed (line " << location << ")\\n\"); failures++; }\n";
+  }
+}
+
+void Wasm2CBuilder::processAsserts(Module* wasm_, Element& root, SExpressionWasmBuilder& sexpBuilder, std::ostream& o) {
+  wasm = wasm_;
+  o << "\n/* asserts */\n\n";
+  o << "static u32 assert_result;\n\n";
+  // provide the spectest imports
+  std::stringstream setup;
+  for (auto& import : wasm->imports) {
+    if (import->module != Name("spectest")) continue;
+    if (import->kind == ExternalKind::Function) {
+      auto* type = wasm->getFunctionType(import->functionType);
+      std::string stub = "spectest_" + mangle(import->name);
+      o << "static " << getSignature(stub, type->result, type->params) << " {\n";
+      for (Index i = 0; i < type->params.size(); i++) {
+        o << "  printf(\"%" << (isWasmTypeFloat(type->params[i]) ? "g" : "llu") << " : " << printWasmType(type->params[i]) << "\\n\", "
+          << (isWasmTypeFloat(type->params[i]) ? "(double)" : "(unsigned long long)") << 'l' << i << ");\n";
+      }
+      if (type->result != none) o << "  return 0;\n";
+      o << "}\n";
+      setup << "  " << getImportName(import.get()) << " = " << stub << ";\n";
+    } else if (import->kind == ExternalKind::Global) {
+      setup << "  " << getImportName(import.get()) << " = 666;\n";
+    }
+  }
+  std::stringstream checks;
+  for (size_t i = 1; i < root.size(); ++i) {
+    Element& e = *root[i];
+    if (!e.isList() || e.size() < 2 || !e[0]->isStr()) continue;
+    Name command = e[0]->str();
+    if (command == Name("invoke") || command == Name("assert_return") || command == Name("assert_trap") ||
+        command == Name("assert_return_canonical_nan") || command == Name("assert_return_arithmetic_nan")) {
+      processAssert(e, i, sexpBuilder, o, checks);
+    }
+  }
+  o << "static void init(void) {\n" << setup.str() << "  wasm_init();\n}\n\n";
+  o << "int main(void) {\n";
+  o << "  int failures = 0;\n";
+  o << "  if (wasm_run_guarded(init)) {\n";
+  o << "    printf(\"instantiation trapped: %s\\n\", wasm_trap_reason);\n";
+  o << "    return 1;\n";
+  o << "  }\n";
+  o << checks.str();
+  o << "  return failures != 0;\n";
+  o << "}\n";
+}
+
+} // namespace wasm
+
+#endif // wasm_wasm2c_h
@@ -0,0 +1,8 @@
+(module
+  (memory 256 256)
+  (export "test1" $test1)
+  (func $test1
+    (i32.store8 (i32.const 12) (i32.const 115)) ;; rolled back, as we trap, which leaves no segment
+    (unreachable)
+  )
+)
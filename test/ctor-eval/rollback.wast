@@ -0,0 +1,14 @@
+(module
+  (memory 256 256)
+  (data (i32.const 10) "waka waka waka waka waka")
+  (export "test1" $test1)
+  (export "test2" $test2)
+  (func $test1
+    (i32.store8 (i32.const 12) (i32.const 115)) ;; a safe store, which is kept
+  )
+  (func $test2
+    (i32.store8 (i32.const 13) (i32.const 114)) ;; rolled back, as we trap
+    (i32.store (i32.const 5000) (i32.const 1)) ;; grows the segment, also rolled back
+    (unreachable)
+  )
+)
@@ -548,6 +548,22 @@ void test_interpret() {
   BinaryenModulePrint(module);
   assert(BinaryenModuleValidate(module));
   BinaryenModuleInterpret(module);
+  // with enough fuel, this runs to completion, printing the number again
+  assert(BinaryenModuleInterpretWithLimits(module, 1000, 0) == 1);
+  BinaryenModuleDispose(module);
+}
+
+void test_interpret_limits() {
+  // create a module with a start method that loops forever, and interpret it with limited fuel.
+  BinaryenModuleRef module = BinaryenModuleCreate();
+
+  BinaryenFunctionTypeRef v = BinaryenAddFunctionType(module, "v", BinaryenTypeNone(), NULL, 0);
+  BinaryenExpressionRef loop = BinaryenLoop(module, "loop", BinaryenBreak(module, "loop", NULL, NULL));
+  BinaryenFunctionRef starter = BinaryenAddFunction(module, "starter", v, NULL, 0, loop);
+  BinaryenSetStart(module, starter);
+
+  assert(BinaryenModuleValidate(module));
+  assert(BinaryenModuleInterpretWithLimits(module, 1000, 0) == 0);
   BinaryenModuleDispose(module);
 }
 
@@ -599,6 +615,7 @@ int main() {
   test_relooper();
   test_binaries();
   test_interpret();
+  test_interpret_limits();
   test_nonvalid();
   test_tracing();
 
@@ -0,0 +1,205 @@
+#include <cassert>
+#include <iostream>
+#include <memory>
+#include <random>
+
+#include "cfg/domtree.h"
+
+using namespace wasm;
+
+struct BasicBlock {
+  Index id;
+  std::vector<BasicBlock*> out, in;
+};
+
+struct CFG {
+  std::vector<std::unique_ptr<BasicBlock>> blocks;
+
+  CFG(Index size) {
+    for (Index i = 0; i < size; i++) {
+      blocks.emplace_back(new BasicBlock());
+      blocks.back()->id = i;
+    }
+  }
+
+  void link(Index from, Index to) {
+    blocks[from]->out.push_back(blocks[to].get());
+    blocks[to]->in.push_back(blocks[from].get());
+  }
+};
+
+void dump(const char* title, CFG& cfg) {
+  std::cout << title << '\n';
+  BlockGraph<BasicBlock> graph(cfg.blocks[0].get());
+  DominatorTree dominators(graph.preds);
+  PostDominatorTree postDominators(graph.succs);
+  LoopForest loops(graph.preds, dominators);
+  auto name = [&](Index index) -> std::string {
+    if (index == NoBlock) return "-";
+    if (index == PostDominatorTree::Exit) return "exit";
+    return std::to_string(graph.blocks[index]->id);
+  };
+  for (auto& block : cfg.blocks) {
+    auto index = graph.getIndex(block.get());
+    std::cout << "  block " << block->id;
+    if (index == NoBlock) {
+      std::cout << ": unreachable\n";
+      continue;
+    }
+    std::cout << ": idom " << (index == 0 ? "-" : name(dominators.idom[index]))
+              << ", ipdom " << name(postDominators.ipdom[index])
+              << ", loop depth " << loops.getDepth(index);
+    auto loop = loops.loopOf[index];
+    if (loop != NoBlock && loops.loops[loop].header == index) {
+      std::cout << " (header)";
+    }
+    std::cout << '\n';
+  }
+}
+
+// naive dominators, as sets, for checking
+std::vector<std::vector<bool>> naiveDominators(const Adjacency& preds) {
+  Index size = preds.size();
+  std::vector<std::vector<bool>> doms(size, std::vector<bool>(size, true));
+  doms[0].assign(size, false);
+  doms[0][0] = true;
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (Index i = 1; i < size; i++) {
+      std::vector<bool> next(size, true);
+      for (Index j = preds.begin(i); j < preds.end(i); j++) {
+        auto& pred = doms[preds.list[j]];
+        for (Index k = 0; k < size; k++) next[k] = next[k] && pred[k];
+      }
+      next[i] = true;
+      if (next != doms[i]) {
+        doms[i] = next;
+        changed = true;
+      }
+    }
+  }
+  return doms;
+}
+
+// whether a node can reach one without successors, avoiding another
+bool reachesExit(const Adjacency& succs, Index from, Index avoid) {
+  std::vector<bool> seen(succs.size());
+  std::vector<Index> work;
+  if (from != avoid) work.push_back(from);
+  while (!work.empty()) {
+    auto node = work.back();
+    work.pop_back();
+    if (seen[node]) continue;
+    seen[node] = true;
+    if (succs.count(node) == 0) return true;
+    for (Index j = succs.begin(node); j < succs.end(node); j++) {
+      if (succs.list[j] != avoid) work.push_back(succs.list[j]);
+    }
+  }
+  return false;
+}
+
+void checkRandom() {
+  std::mt19937 random(42);
+  for (int iteration = 0; iteration < 200; iteration++) {
+    Index size = 2 + random() % 30;
+    CFG cfg(size);
+    Index numEdges = random() % (size * 2);
+    for (Index i = 0; i < numEdges; i++) {
+      cfg.link(random() % size, random() % size);
+    }
+    BlockGraph<BasicBlock> graph(cfg.blocks[0].get());
+    DominatorTree dominators(graph.preds);
+    auto naive = naiveDominators(graph.preds);
+    Index numBlocks = graph.blocks.size();
+    for (Index a = 0; a < numBlocks; a++) {
+      for (Index b = 0; b < numBlocks; b++) {
+        assert(dominators.dominates(a, b) == naive[b][a]);
+      }
+    }
+    // a post-dominates b if b cannot reach an exit without going through a
+    PostDominatorTree postDominators(graph.succs);
+    for (Index a = 0; a < numBlocks; a++) {
+      for (Index b = 0; b < numBlocks; b++) {
+        assert((postDominators.ipdom[b] == NoBlock) == !reachesExit(graph.succs, b, NoBlock));
+        if (postDominators.ipdom[b] == NoBlock) continue;
+        bool naivePostDominates = a == b || !reachesExit(graph.succs, b, a);
+        assert(postDominators.postDominates(a, b) == naivePostDominates);
+      }
+    }
+    // every node of a loop is dominated by its header, and is in the loops
+    // containing its loop
+    LoopForest loops(graph.preds, dominators);
+    for (Index i = 0; i < numBlocks; i++) {
+      Index depth = 0;
+      for (auto loop = loops.loopOf[i]; loop != NoBlock; loop = loops.loops[loop].parent) {
+        assert(dominators.dominates(loops.loops[loop].header, i));
+        assert(loops.contains(loop, i));
+        depth++;
+      }
+      assert(loops.getDepth(i) == depth);
+    }
+    // the loop of each header contains exactly the natural loops of its
+    // backedges
+    for (Index header = 0; header < numBlocks; header++) {
+      std::vector<bool> body(numBlocks);
+      std::vector<Index> work;
+      for (Index j = graph.preds.begin(header); j < graph.preds.end(header); j++) {
+        auto pred = graph.preds.list[j];
+        if (dominators.dominates(header, pred)) work.push_back(pred);
+      }
+      if (work.empty()) continue;
+      body[header] = true;
+      while (!work.empty()) {
+        auto node = work.back();
+        work.pop_back();
+        if (body[node]) continue;
+        body[node] = true;
+        for (Index j = graph.preds.begin(node); j < graph.preds.end(node); j++) {
+          work.push_back(graph.preds.list[j]);
+        }
+      }
+      auto loop = loops.loopOf[header];
+      assert(loops.loops[loop].header == header);
+      for (Index i = 0; i < numBlocks; i++) {
+        assert(loops.contains(loop, i) == body[i]);
+      }
+    }
+  }
+  std::cout << "random graphs: ok\n";
+}
+
+int main() {
+  {
+    CFG cfg(4);
+    cfg.link(0, 1);
+    cfg.link(0, 2);
+    cfg.link(1, 3);
+    cfg.link(2, 3);
+    dump("diamond", cfg);
+  }
+  {
+    CFG cfg(6);
+    cfg.link(0, 1);
+    cfg.link(1, 2);
+    cfg.link(2, 3);
+    cfg.link(3, 2);
+    cfg.link(3, 4);
+    cfg.link(4, 1);
+    cfg.link(4, 5);
+    dump("nested loops", cfg);
+  }
+  {
+    CFG cfg(6);
+    cfg.link(0, 1);
+    cfg.link(1, 1);
+    cfg.link(0, 2);
+    cfg.link(3, 2);
+    cfg.link(2, 4);
+    cfg.link(4, 2);
+    cfg.link(4, 5);
+    dump("infinite loops and unreachable code", cfg);
+  }
+  checkRandom();
+}
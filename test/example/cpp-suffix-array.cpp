@@ -0,0 +1,76 @@
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+
+#include "support/suffix_array.h"
+
+using namespace wasm;
+
+std::vector<uint32_t> toString(const std::string& text) {
+  return std::vector<uint32_t>(text.begin(), text.end());
+}
+
+void dump(const std::string& text) {
+  auto string = toString(text);
+  auto suffixes = SuffixArray::build(string);
+  auto lcp = SuffixArray::buildLCP(string, suffixes);
+  std::cout << text << '\n';
+  for (uint32_t i = 0; i < suffixes.size(); i++) {
+    std::cout << "  " << lcp[i] << ' ' << text.substr(suffixes[i]) << '\n';
+  }
+  std::map<std::string, uint32_t> repeats;
+  SuffixArray::forEachRepeat(lcp, [&](uint32_t length, uint32_t begin, uint32_t end) {
+    repeats[text.substr(suffixes[begin], length)] = end - begin;
+  });
+  for (auto& pair : repeats) {
+    std::cout << "  repeat " << pair.first << " x" << pair.second << '\n';
+  }
+}
+
+void checkRandom() {
+  std::mt19937 random(42);
+  for (int iteration = 0; iteration < 500; iteration++) {
+    uint32_t size = random() % 60;
+    uint32_t alphabet = 1 + random() % 4;
+    std::vector<uint32_t> string;
+    for (uint32_t i = 0; i < size; i++) string.push_back(random() % alphabet);
+    auto suffixes = SuffixArray::build(string);
+    auto lcp = SuffixArray::buildLCP(string, suffixes);
+    // compare to sorting the suffixes directly
+    std::vector<uint32_t> expected;
+    for (uint32_t i = 0; i < size; i++) expected.push_back(i);
+    std::sort(expected.begin(), expected.end(), [&](uint32_t a, uint32_t b) {
+      return std::lexicographical_compare(string.begin() + a, string.end(), string.begin() + b, string.end());
+    });
+    assert(suffixes == expected);
+    for (uint32_t i = 1; i < size; i++) {
+      uint32_t length = 0;
+      while (suffixes[i] + length < size && suffixes[i - 1] + length < size &&
+             string[suffixes[i] + length] == string[suffixes[i - 1] + length]) {
+        length++;
+      }
+      assert(lcp[i] == length);
+    }
+    // every repeat appears exactly where it says it does
+    SuffixArray::forEachRepeat(lcp, [&](uint32_t length, uint32_t begin, uint32_t end) {
+      assert(length > 0 && end - begin >= 2);
+      std::vector<uint32_t> repeat(string.begin() + suffixes[begin], string.begin() + suffixes[begin] + length);
+      uint32_t count = 0;
+      for (uint32_t i = 0; i + length <= size; i++) {
+        if (std::equal(repeat.begin(), repeat.end(), string.begin() + i)) count++;
+      }
+      assert(count == end - begin);
+    });
+  }
+  std::cout << "random strings: ok\n";
+}
+
+int main() {
+  dump("banana");
+  dump("abcabxabcd");
+  dump("aaaa");
+  checkRandom();
+}
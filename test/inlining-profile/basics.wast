@@ -0,0 +1,37 @@
+(module
+  (memory 1)
+  (export "main" (func $main))
+  (export "other" (func $other))
+  (func $hot (param $x i32) (result i32)
+    (i32.store (get_local $x) (i32.add (i32.load (get_local $x)) (i32.const 1)))
+    (i32.store offset=4 (get_local $x) (i32.add (i32.load offset=4 (get_local $x)) (i32.const 2)))
+    (i32.store offset=8 (get_local $x) (i32.add (i32.load offset=8 (get_local $x)) (i32.const 3)))
+    (i32.load offset=12 (get_local $x))
+  )
+  (func $cold (param $x i32) (result i32)
+    (i32.store (get_local $x) (i32.sub (i32.load (get_local $x)) (i32.const 1)))
+    (i32.store offset=4 (get_local $x) (i32.sub (i32.load offset=4 (get_local $x)) (i32.const 2)))
+    (i32.store offset=8 (get_local $x) (i32.sub (i32.load offset=8 (get_local $x)) (i32.const 3)))
+    (i32.load offset=12 (get_local $x))
+  )
+  (func $unprofiled (param $x i32) (result i32)
+    (i32.store (get_local $x) (i32.mul (i32.load (get_local $x)) (i32.const 3)))
+    (i32.store offset=4 (get_local $x) (i32.mul (i32.load offset=4 (get_local $x)) (i32.const 5)))
+    (i32.store offset=8 (get_local $x) (i32.mul (i32.load offset=8 (get_local $x)) (i32.const 7)))
+    (i32.load offset=12 (get_local $x))
+  )
+  (func $main (param $p i32) (result i32)
+    (i32.add
+      (i32.add
+        (call $hot (get_local $p))
+        (call $cold (get_local $p))
+      )
+      (call $unprofiled (get_local $p))
+    )
+  )
+  (func $other (param $p i32) (result i32)
+    (drop (call $hot (get_local $p)))
+    (drop (call $cold (get_local $p)))
+    (call $unprofiled (get_local $p))
+  )
+)
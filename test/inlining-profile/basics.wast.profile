@@ -0,0 +1,4 @@
+main hot 10000
+other hot 5000
+main cold 1
+other cold 2
@@ -0,0 +1,75 @@
+(module
+  (func $add32 (export "add32") (param $x i32) (param $y i32) (result i32)
+    (i32.add (get_local $x) (get_local $y))
+  )
+  (func $mix32 (export "mix32") (param $x i32) (param $y i32) (result i32)
+    (i32.xor
+      (i32.rotl (i32.mul (get_local $x) (i32.const 31)) (get_local $y))
+      (i32.shr_s (i32.sub (get_local $x) (get_local $y)) (i32.const 3))
+    )
+  )
+  (func $mix64 (export "mix64") (param $x i64) (param $y i64) (result i64)
+    (i64.or
+      (i64.rotr (i64.mul (get_local $x) (i64.const 1000003)) (get_local $y))
+      (i64.shr_u (i64.and (get_local $x) (get_local $y)) (i64.const 7))
+    )
+  )
+  (func $div (export "div") (param $x i32) (param $y i32) (result i32)
+    (i32.add
+      (i32.div_s (get_local $x) (get_local $y))
+      (i32.rem_u (get_local $x) (get_local $y))
+    )
+  )
+  (func $div64 (export "div64") (param $x i64) (param $y i64) (result i64)
+    (i64.sub
+      (i64.div_u (get_local $x) (get_local $y))
+      (i64.rem_s (get_local $x) (get_local $y))
+    )
+  )
+  (func $rem-overflow (export "rem-overflow") (result i32)
+    ;; does not trap, unlike the division
+    (i32.rem_s (i32.const 0x80000000) (i32.const -1))
+  )
+  (func $compare (export "compare") (param $x i32) (param $y i32) (result i32)
+    (i32.add
+      (i32.add
+        (i32.lt_s (get_local $x) (get_local $y))
+        (i32.shl (i32.lt_u (get_local $x) (get_local $y)) (i32.const 1))
+      )
+      (i32.add
+        (i32.shl (i32.ge_s (get_local $x) (get_local $y)) (i32.const 2))
+        (i32.shl (i32.eqz (get_local $x)) (i32.const 3))
+      )
+    )
+  )
+  (func $extend (export "extend") (param $x i32) (result i64)
+    (i64.add
+      (i64.extend_s/i32 (get_local $x))
+      (i64.extend_u/i32 (i32.extend8_s (get_local $x)))
+    )
+  )
+  (func $wrap (export "wrap") (param $x i64) (result i32)
+    (i32.wrap/i64 (i64.extend16_s (get_local $x)))
+  )
+  (func $select (export "select") (param $x i32) (result i64)
+    (select (i64.const 10) (i64.const 20) (get_local $x))
+  )
+)
+(assert_return (invoke "add32" (i32.const 1) (i32.const 2)) (i32.const 3))
+(assert_return (invoke "add32" (i32.const 0x7fffffff) (i32.const 1)) (i32.const 0x80000000))
+(assert_return (invoke "mix32" (i32.const 123456) (i32.const 5)) (i32.const 122455111))
+(assert_return (invoke "mix32" (i32.const -7) (i32.const 33)) (i32.const 436))
+(assert_return (invoke "mix64" (i64.const 0x123456789abcdef) (i64.const 13)) (i64.const 2047916854554599548))
+(assert_return (invoke "mix64" (i64.const -1) (i64.const 64)) (i64.const -1000003))
+(assert_return (invoke "div" (i32.const -17) (i32.const 5)) (i32.const 1))
+(assert_return (invoke "div" (i32.const 17) (i32.const -5)) (i32.const 14))
+(assert_return (invoke "div64" (i64.const -1000000000000) (i64.const 7)) (i64.const 2635249010529935946))
+(assert_return (invoke "rem-overflow") (i32.const 0))
+(assert_return (invoke "compare" (i32.const -1) (i32.const 1)) (i32.const 1))
+(assert_return (invoke "compare" (i32.const 0) (i32.const 0)) (i32.const 12))
+(assert_return (invoke "compare" (i32.const 5) (i32.const -5)) (i32.const 6))
+(assert_return (invoke "extend" (i32.const -2)) (i64.const 4294967292))
+(assert_return (invoke "extend" (i32.const 0x7f)) (i64.const 254))
+(assert_return (invoke "wrap" (i64.const 0x1234fffe)) (i32.const -2))
+(assert_return (invoke "select" (i32.const 0)) (i64.const 20))
+(assert_return (invoke "select" (i32.const 1)) (i64.const 10))
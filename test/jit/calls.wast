@@ -0,0 +1,54 @@
+(module
+  (import "spectest" "print" (func $print (param i32)))
+  (import "spectest" "print" (func $print-f64 (param f64)))
+  (type $binary (func (param i32 i32) (result i32)))
+  (type $unary (func (param i32) (result i32)))
+  (table 5 anyfunc)
+  (elem (i32.const 0) $add $sub $halve)
+  (func $add (type $binary) (i32.add (get_local 0) (get_local 1)))
+  (func $sub (type $binary) (i32.sub (get_local 0) (get_local 1)))
+  (func $halve (param $x i32) (result i32)
+    ;; float division is left to the interpreter
+    (i32.trunc_s/f32 (f32.div (f32.convert_s/i32 (get_local $x)) (f32.const 2)))
+  )
+  (func $print-all (export "print-all") (param $x i32) (param $y f64)
+    (call $print (get_local $x))
+    (call $print-f64 (get_local $y))
+    (call $print (call $halve (get_local $x)))
+  )
+  (func $dispatch (export "dispatch") (param $i i32) (param $x i32) (param $y i32) (result i32)
+    (call_indirect (type $binary) (get_local $x) (get_local $y) (get_local $i))
+  )
+  (func $dispatch-unary (export "dispatch-unary") (param $i i32) (param $x i32) (result i32)
+    (call_indirect (type $unary) (get_local $x) (get_local $i))
+  )
+  (func $mixed (export "mixed") (param $n i32) (result i32)
+    ;; calls between compiled and interpreted code, several levels deep
+    (if (result i32) (i32.eqz (get_local $n))
+      (i32.const 0)
+      (i32.add
+        (call $halve (i32.mul (get_local $n) (i32.const 4)))
+        (call_indirect (type $binary)
+          (call $mixed (i32.sub (get_local $n) (i32.const 1)))
+          (i32.const 0)
+          (i32.const 0)
+        )
+      )
+    )
+  )
+  (func $recurse (export "recurse") (param $n i32) (result i32)
+    (i32.add (call $halve (get_local $n)) (call_indirect (type $unary) (get_local $n) (i32.const 3)))
+  )
+  (elem (i32.const 3) $recurse)
+)
+(invoke "print-all" (i32.const 7) (f64.const 0.125))
+(assert_return (invoke "dispatch" (i32.const 0) (i32.const 5) (i32.const 3)) (i32.const 8))
+(assert_return (invoke "dispatch" (i32.const 1) (i32.const 5) (i32.const 3)) (i32.const 2))
+(assert_trap (invoke "dispatch" (i32.const 2) (i32.const 5) (i32.const 3)) "indirect call signature mismatch")
+(assert_trap (invoke "dispatch" (i32.const 3) (i32.const 5) (i32.const 3)) "indirect call signature mismatch")
+(assert_trap (invoke "dispatch" (i32.const 4) (i32.const 5) (i32.const 3)) "uninitialized element")
+(assert_trap (invoke "dispatch" (i32.const 5) (i32.const 5) (i32.const 3)) "undefined element")
+(assert_trap (invoke "dispatch" (i32.const -1) (i32.const 5) (i32.const 3)) "undefined element")
+(assert_return (invoke "dispatch-unary" (i32.const 2) (i32.const 9)) (i32.const 4))
+(assert_return (invoke "mixed" (i32.const 10)) (i32.const 110))
+(assert_trap (invoke "recurse" (i32.const 1)) "call stack exhausted")
@@ -0,0 +1,80 @@
+(module
+  (func $fac (export "fac") (param $n i64) (result i64)
+    (if (result i64) (i64.eqz (get_local $n))
+      (i64.const 1)
+      (i64.mul (get_local $n) (call $fac (i64.sub (get_local $n) (i64.const 1))))
+    )
+  )
+  (func $sum (export "sum") (param $n i32) (result i32)
+    (local $i i32)
+    (local $total i32)
+    (block $out
+      (loop $top
+        (br_if $out (i32.ge_u (get_local $i) (get_local $n)))
+        (set_local $total (i32.add (get_local $total) (get_local $i)))
+        (set_local $i (i32.add (get_local $i) (i32.const 1)))
+        (br $top)
+      )
+    )
+    (get_local $total)
+  )
+  (func $switch (export "switch") (param $x i32) (result i32)
+    (block $default
+      (block $two
+        (block $one
+          (block $zero
+            (br_table $zero $one $two $default (get_local $x))
+          )
+          (return (i32.const 100))
+        )
+        (return (i32.const 101))
+      )
+      (return (i32.const 102))
+    )
+    (i32.const -1)
+  )
+  (func $block-value (export "block-value") (param $x i32) (result i32)
+    (i32.add
+      (block $b (result i32)
+        (drop (br_if $b (i32.const 7) (get_local $x)))
+        (i32.const 9)
+      )
+      (i32.const 1)
+    )
+  )
+  (func $tee (export "tee") (param $x i32) (result i32)
+    (local $y i32)
+    (i32.mul (tee_local $y (i32.add (get_local $x) (i32.const 1))) (get_local $y))
+  )
+  (func $even (export "even") (param $n i32) (result i32)
+    (if (result i32) (i32.eqz (get_local $n))
+      (i32.const 1)
+      (call $odd (i32.sub (get_local $n) (i32.const 1)))
+    )
+  )
+  (func $odd (param $n i32) (result i32)
+    (if (result i32) (i32.eqz (get_local $n))
+      (i32.const 0)
+      (call $even (i32.sub (get_local $n) (i32.const 1)))
+    )
+  )
+  (func $nop (export "nop")
+    (nop)
+  )
+)
+(assert_return (invoke "fac" (i64.const 0)) (i64.const 1))
+(assert_return (invoke "fac" (i64.const 20)) (i64.const 2432902008176640000))
+(assert_return (invoke "fac" (i64.const 25)) (i64.const 7034535277573963776))
+(assert_return (invoke "sum" (i32.const 0)) (i32.const 0))
+(assert_return (invoke "sum" (i32.const 100000)) (i32.const 704982704))
+(assert_return (invoke "switch" (i32.const 0)) (i32.const 100))
+(assert_return (invoke "switch" (i32.const 1)) (i32.const 101))
+(assert_return (invoke "switch" (i32.const 2)) (i32.const 102))
+(assert_return (invoke "switch" (i32.const 3)) (i32.const -1))
+(assert_return (invoke "switch" (i32.const -1)) (i32.const -1))
+(assert_return (invoke "block-value" (i32.const 0)) (i32.const 10))
+(assert_return (invoke "block-value" (i32.const 1)) (i32.const 8))
+(assert_return (invoke "tee" (i32.const 6)) (i32.const 49))
+(assert_return (invoke "even" (i32.const 100)) (i32.const 1))
+(assert_return (invoke "even" (i32.const 77)) (i32.const 0))
+(invoke "nop")
@@ -0,0 +1,59 @@
+(module
+  (import "spectest" "global" (global $imported i32))
+  (global $counter (mut i32) (i32.const 0))
+  (global $wide (mut i64) (i64.const -1))
+  (global $float (mut f64) (f64.const 1.5))
+  (func $count (export "count") (param $n i32) (result i32)
+    (block $done
+      (loop $top
+        (br_if $done (i32.eqz (get_local $n)))
+        (set_global $counter (i32.add (get_global $counter) (i32.const 1)))
+        (set_local $n (i32.sub (get_local $n) (i32.const 1)))
+        (br $top)
+      )
+    )
+    (i32.add (get_global $counter) (get_global $imported))
+  )
+  (func $wide (export "wide") (param $x i64) (result i64)
+    (set_global $wide (i64.xor (get_global $wide) (get_local $x)))
+    (get_global $wide)
+  )
+  (func $float (export "float") (param $x f64) (result f64)
+    (set_global $float (f64.sub (get_global $float) (get_local $x)))
+    (f64.copysign (get_global $float) (get_local $x))
+  )
+  (func $compare (export "compare") (param $x f32) (param $y f32) (result i32)
+    (i32.or
+      (i32.or
+        (f32.eq (get_local $x) (get_local $y))
+        (i32.shl (f32.ne (get_local $x) (get_local $y)) (i32.const 1))
+      )
+      (i32.or
+        (i32.or
+          (i32.shl (f32.lt (get_local $x) (get_local $y)) (i32.const 2))
+          (i32.shl (f32.le (get_local $x) (get_local $y)) (i32.const 3))
+        )
+        (i32.or
+          (i32.shl (f32.gt (get_local $x) (get_local $y)) (i32.const 4))
+          (i32.shl (f32.ge (get_local $x) (get_local $y)) (i32.const 5))
+        )
+      )
+    )
+  )
+  (func $bits (export "bits") (param $x f64) (result i64)
+    (i64.reinterpret/f64 (f64.neg (f64.abs (get_local $x))))
+  )
+)
+(assert_return (invoke "count" (i32.const 5)) (i32.const 671))
+(assert_return (invoke "count" (i32.const 3)) (i32.const 674))
+(assert_return (invoke "wide" (i64.const 0xff)) (i64.const 0xffffffffffffff00))
+(assert_return (invoke "wide" (i64.const -1)) (i64.const 0xff))
+(assert_return (invoke "float" (f64.const 0.25)) (f64.const 1.25))
+(assert_return (invoke "float" (f64.const -2)) (f64.const -3.25))
+(assert_return (invoke "compare" (f32.const 1) (f32.const 2)) (i32.const 14))
+(assert_return (invoke "compare" (f32.const 2) (f32.const 2)) (i32.const 41))
+(assert_return (invoke "compare" (f32.const 3) (f32.const 2)) (i32.const 50))
+(assert_return (invoke "compare" (f32.const nan) (f32.const 2)) (i32.const 2))
+(assert_return (invoke "compare" (f32.const -0) (f32.const 0)) (i32.const 41))
+(assert_return (invoke "bits" (f64.const 2)) (i64.const 0xc000000000000000))
+(assert_return (invoke "bits" (f64.const -nan)) (i64.const 0xfff8000000000000))
@@ -0,0 +1,65 @@
+(module
+  (memory 1 2)
+  (data (i32.const 8) "\01\02\03\04\05\06\07\08\ff\fe")
+  (func $load (export "load") (param $x i32) (result i64)
+    (i64.add
+      (i64.add
+        (i64.load8_s offset=8 (get_local $x))
+        (i64.load16_u offset=8 (get_local $x))
+      )
+      (i64.extend_u/i32 (i32.load offset=8 (get_local $x)))
+    )
+  )
+  (func $store (export "store") (param $x i32) (param $y i64) (result i64)
+    (i64.store offset=4 align=4 (get_local $x) (get_local $y))
+    (i32.store8 (get_local $x) (i32.const 0x1234))
+    (i64.load (get_local $x))
+  )
+  (func $copy (export "copy") (param $from i32) (param $to i32) (param $n i32) (result i32)
+    (local $i i32)
+    (block $done
+      (loop $top
+        (br_if $done (i32.ge_u (get_local $i) (get_local $n)))
+        (i32.store8
+          (i32.add (get_local $to) (get_local $i))
+          (i32.load8_u (i32.add (get_local $from) (get_local $i)))
+        )
+        (set_local $i (i32.add (get_local $i) (i32.const 1)))
+        (br $top)
+      )
+    )
+    (i32.load offset=2 (get_local $to))
+  )
+  (func $floats (export "floats") (param $x f32) (param $y f64) (result f64)
+    (f32.store (i32.const 100) (f32.mul (get_local $x) (f32.const 2)))
+    (f64.store (i32.const 104) (f64.add (get_local $y) (f64.const 0.5)))
+    (if (f32.eq (f32.load (i32.const 100)) (f32.const 2.5))
+      (return (f64.load (i32.const 104)))
+    )
+    (f64.const -1)
+  )
+  (func $grow (export "grow") (param $x i32) (result i32)
+    (drop (grow_memory (get_local $x)))
+    (i32.store (i32.const 70000) (current_memory))
+    (i32.load (i32.const 70000))
+  )
+  (func $out-of-bounds (export "out-of-bounds") (param $x i32) (result i32)
+    (i32.add (i32.const 1) (i32.load offset=4 (get_local $x)))
+  )
+  (func $store-out-of-bounds (export "store-out-of-bounds") (param $x i32)
+    (i64.store (get_local $x) (i64.const -1))
+  )
+)
+(assert_return (invoke "load" (i32.const 0)) (i64.const 0x04030403))
+(assert_return (invoke "load" (i32.const 8)) (i64.const 130557))
+(assert_return (invoke "store" (i32.const 200) (i64.const 0x1122334455667788)) (i64.const 0x5566778800000034))
+(assert_return (invoke "copy" (i32.const 8) (i32.const 300) (i32.const 10)) (i32.const 0x06050403))
+(assert_return (invoke "floats" (f32.const 1.25) (f64.const 2.5)) (f64.const 3))
+(assert_return (invoke "floats" (f32.const 1) (f64.const 2.5)) (f64.const -1))
+(assert_trap (invoke "out-of-bounds" (i32.const 65532)) "out of bounds memory access")
+(assert_trap (invoke "out-of-bounds" (i32.const -1)) "out of bounds memory access")
+(assert_trap (invoke "store-out-of-bounds" (i32.const 65529)) "out of bounds memory access")
+(assert_return (invoke "out-of-bounds" (i32.const 65528)) (i32.const 1))
+(assert_trap (invoke "grow" (i32.const 0)) "out of bounds memory access")
+(assert_return (invoke "grow" (i32.const 1)) (i32.const 2))
+(assert_return (invoke "grow" (i32.const 1)) (i32.const 2))
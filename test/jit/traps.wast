@@ -0,0 +1,30 @@
+(module
+  (func $div-zero (export "div-zero") (param $x i32) (result i32)
+    (i32.div_u (i32.const 1) (get_local $x))
+  )
+  (func $div-overflow (export "div-overflow") (param $x i64) (result i64)
+    (i64.div_s (i64.const 0x8000000000000000) (get_local $x))
+  )
+  (func $rem-zero (export "rem-zero") (param $x i64) (result i64)
+    (i64.rem_s (i64.const 1) (get_local $x))
+  )
+  (func $unreachable (export "unreachable") (result i32)
+    (unreachable)
+  )
+  (func $nested (export "nested") (param $x i32) (result i32)
+    ;; the trap happens deep inside a call
+    (i32.add (i32.const 1) (call $div-zero (get_local $x)))
+  )
+  (func $infinite (export "infinite") (param $x i32) (result i32)
+    (i32.add (get_local $x) (call $infinite (get_local $x)))
+  )
+)
+(assert_trap (invoke "div-zero" (i32.const 0)) "integer divide by zero")
+(assert_return (invoke "div-zero" (i32.const 1)) (i32.const 1))
+(assert_trap (invoke "div-overflow" (i64.const -1)) "integer overflow")
+(assert_return (invoke "div-overflow" (i64.const 1)) (i64.const 0x8000000000000000))
+(assert_trap (invoke "rem-zero" (i64.const 0)) "integer divide by zero")
+(assert_trap (invoke "unreachable") "unreachable")
+(assert_trap (invoke "nested" (i32.const 0)) "integer divide by zero")
+(assert_return (invoke "nested" (i32.const 1)) (i32.const 2))
+(assert_trap (invoke "infinite" (i32.const 1)) "call stack exhausted")
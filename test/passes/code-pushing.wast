@@ -0,0 +1,38 @@
+(module
+  (memory 1)
+  (func $push-pure
+    (local $x i32)
+    (block $out
+      (set_local $x (i32.add (i32.const 1) (i32.const 2)))
+      (br_if $out (i32.const 2))
+      (drop (get_local $x))
+    )
+  )
+  (func $load-traps ;; the load may trap, so it must stay before the br_if
+    (local $x i32)
+    (block $out
+      (set_local $x (i32.load (i32.const 1000000)))
+      (br_if $out (i32.const 2))
+      (drop (get_local $x))
+    )
+  )
+  (func $div-traps-nested ;; the trap is deep in the value
+    (local $x i32)
+    (block $out
+      (set_local $x (i32.add (i32.const 1) (i32.eqz (i32.div_s (i32.const 1) (i32.const 0)))))
+      (br_if $out (i32.const 2))
+      (drop (get_local $x))
+    )
+  )
+  (func $trap-blocks-later ;; a value that stays behind because it may trap also stops later ones
+    (local $x i32)
+    (local $y i32)
+    (block $out
+      (set_local $x (i32.load (i32.const 1000000)))
+      (set_local $y (i32.const 1))
+      (br_if $out (i32.const 2))
+      (drop (get_local $x))
+      (drop (get_local $y))
+    )
+  )
+)
@@ -0,0 +1,113 @@
+(module
+  (type $ii (func (param i32) (result i32)))
+  (type $v (func))
+  (import "env" "imported" (func $imported (param i32) (result i32)))
+  (table 6 6 anyfunc)
+  (elem (i32.const 0) $foo $bar $imported)
+  (elem (i32.const 4) $foo $other-type)
+  (func $foo (param $x i32) (result i32)
+    (get_local $x)
+  )
+  (func $bar (param $x i32) (result i32)
+    (i32.add (get_local $x) (i32.const 1))
+  )
+  (func $other-type
+  )
+  (func $constant (param $x i32) (result i32)
+    (call_indirect (type $ii) (get_local $x) (i32.const 1))
+  )
+  (func $constant-import (param $x i32) (result i32)
+    (call_indirect (type $ii) (get_local $x) (i32.const 2))
+  )
+  (func $trap-empty (param $x i32) (result i32)
+    (call_indirect (type $ii) (get_local $x) (i32.const 3))
+  )
+  (func $trap-out-of-bounds (param $x i32) (result i32)
+    (call_indirect (type $ii) (get_local $x) (i32.const 6))
+  )
+  (func $trap-wrong-type
+    (call_indirect (type $v) (i32.const 4))
+  )
+  (func $local (param $x i32) (result i32)
+    (local $i i32)
+    (if (get_local $x)
+      (set_local $i (i32.const 1))
+    )
+    (call_indirect (type $ii) (get_local $x) (get_local $i))
+  )
+  (func $local-same-function (param $x i32) (result i32)
+    (local $i i32)
+    (if (get_local $x)
+      (set_local $i (i32.const 4))
+    )
+    (call_indirect (type $ii) (get_local $x) (get_local $i))
+  )
+  (func $select (param $x i32) (result i32)
+    (call_indirect (type $ii)
+      (get_local $x)
+      (select (i32.const 1) (i32.const 2) (get_local $x))
+    )
+  )
+  (func $local-sorted (param $x i32) (result i32)
+    (local $i i32)
+    (if (get_local $x) ;; the chain checks the indexes in order
+      (set_local $i (i32.const 2))
+      (set_local $i (i32.const 1))
+    )
+    (call_indirect (type $ii) (get_local $x) (get_local $i))
+  )
+  (func $select-with-trap (param $x i32) (result i32)
+    (call_indirect (type $ii)
+      (get_local $x)
+      (select (i32.const 0) (i32.const 3) (get_local $x))
+    )
+  )
+  (func $operand-writes-index (param $x i32) (result i32)
+    (local $i i32)
+    (call_indirect (type $ii)
+      (tee_local $i (get_local $x))
+      (get_local $i)
+    )
+  )
+  (func $param (param $x i32) (result i32)
+    (call_indirect (type $ii) (get_local $x) (get_local $x))
+  )
+  (func $unreachable (result i32)
+    (call_indirect (type $ii) (unreachable) (i32.const 1))
+  )
+)
+(module
+  (type $ii (func (param i32) (result i32)))
+  (import "env" "table" (table 2 2 anyfunc))
+  (elem (i32.const 0) $foo)
+  (func $foo (param $x i32) (result i32)
+    (get_local $x)
+  )
+  (func $imported-table (param $x i32) (result i32)
+    (call_indirect (type $ii) (get_local $x) (i32.const 0))
+  )
+)
+(module
+  (type $ii (func (param i32) (result i32)))
+  (table 2 2 anyfunc)
+  (export "table" (table 0))
+  (elem (i32.const 0) $foo)
+  (func $foo (param $x i32) (result i32)
+    (get_local $x)
+  )
+  (func $exported-table (param $x i32) (result i32)
+    (call_indirect (type $ii) (get_local $x) (i32.const 0))
+  )
+)
+(module
+  (type $ii (func (param i32) (result i32)))
+  (import "env" "base" (global $base i32))
+  (table 2 2 anyfunc)
+  (elem (get_global $base) $foo)
+  (func $foo (param $x i32) (result i32)
+    (get_local $x)
+  )
+  (func $unknown-offset (param $x i32) (result i32)
+    (call_indirect (type $ii) (get_local $x) (i32.const 0))
+  )
+)
@@ -0,0 +1,59 @@
+(module
+  (memory 100 100)
+  (global $g (mut i32) (i32.const 0))
+  (func $basics (param $x i32) (param $y i32)
+    (i32.store (i32.const 8) (i32.const 1)) ;; overwritten
+    (i32.store (i32.const 8) (i32.const 2))
+    (i32.store offset=4 (get_local $x) (get_local $y)) ;; overwritten
+    (i32.store offset=4 (get_local $x) (i32.const 3))
+    (i32.store offset=4 (get_local $x) (i32.const 4)) ;; only partially overwritten
+    (i32.store8 offset=4 (get_local $x) (i32.const 5))
+  )
+  (func $reads (param $x i32) (param $y i32)
+    (i32.store (i32.const 8) (i32.const 1)) ;; read by the load
+    (drop (i32.load (i32.const 8)))
+    (i32.store (i32.const 8) (i32.const 2))
+    (i32.store (get_local $x) (i32.const 1)) ;; the load may read it
+    (drop (i32.load (get_local $y)))
+    (i32.store (get_local $x) (i32.const 2))
+    (i32.store offset=8 (get_local $x) (i32.const 1)) ;; the call may read it
+    (call $reads (i32.const 0) (i32.const 0))
+    (i32.store offset=8 (get_local $x) (i32.const 2))
+  )
+  (func $pointers (param $x i32) (param $y i32)
+    (i32.store (get_local $x) (i32.const 1)) ;; x changes, so this is not overwritten
+    (set_local $x (i32.add (get_local $x) (i32.const 4)))
+    (i32.store (get_local $x) (i32.const 2))
+    (i32.store (get_global $g) (i32.const 1)) ;; same for the global
+    (set_global $g (i32.const 4))
+    (i32.store (get_global $g) (i32.const 2))
+    (i32.store (get_local $y) (i32.const 1)) ;; y does not change
+    (set_local $x (i32.const 0))
+    (i32.store (get_local $y) (i32.const 2))
+  )
+  (func $traps (param $x i32)
+    (i32.store offset=4 (get_local $x) (i32.const 1)) ;; the next store may trap, and then this is noticeable
+    (i32.store offset=8 (get_local $x) (i32.const 2)) ;; the next store cannot trap, if this did not, so this must stay even though it is overwritten
+    (i32.store offset=4 (get_local $x) (i32.const 3))
+    (i32.store offset=8 (get_local $x) (i32.const 4))
+  )
+  (func $traps-side-effects (param $x i32) (param $y i32)
+    (i32.store (i32.const 65536) (i32.const 1)) ;; if this traps, the global is not written
+    (set_global $g (i32.const 5))
+    (i32.store (i32.const 65536) (i32.const 2))
+    (i32.store offset=4 (get_local $x) (i32.const 1)) ;; if this traps, the other store does not happen
+    (i32.store offset=4 (get_local $y) (i32.const 2))
+    (i32.store offset=4 (get_local $x) (i32.const 3))
+    (i32.store offset=8 (get_local $x) (i32.const 1))
+    (i32.store offset=4 (get_local $x) (i32.const 2)) ;; this cannot trap, if the last did not, so it is overwritten
+    (set_global $g (i32.const 6))
+    (i32.store offset=4 (get_local $x) (i32.const 3))
+  )
+  (func $control-flow (param $x i32)
+    (i32.store (i32.const 8) (i32.const 1)) ;; the if may return
+    (if (get_local $x)
+      (return)
+    )
+    (i32.store (i32.const 8) (i32.const 2))
+  )
+)
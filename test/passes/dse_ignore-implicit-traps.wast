@@ -0,0 +1,12 @@
+(module
+  (memory 100 100)
+  (func $traps (param $x i32)
+    (i32.store offset=4 (get_local $x) (i32.const 1)) ;; traps do not matter
+    (i32.store offset=8 (get_local $x) (i32.const 2))
+    (i32.store offset=4 (get_local $x) (i32.const 3))
+    (i32.store (get_local $x) (i32.const 1)) ;; a load elsewhere does not read this
+    (drop (i32.load offset=4 (get_local $x)))
+    (drop (i32.div_s (get_local $x) (get_local $x)))
+    (i32.store (get_local $x) (i32.const 2))
+  )
+)
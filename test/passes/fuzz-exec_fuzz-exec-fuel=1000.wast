@@ -0,0 +1,18 @@
+(module
+ (memory 1 1)
+ (export "a" (func $a))
+ (export "loop" (func $loop))
+ (export "b" (func $b))
+ (func $a (result i32)
+  (i32.add (i32.const 1) (i32.const 2))
+ )
+ (func $loop (result i32)
+  (loop $l
+   (br $l)
+  )
+  (i32.const 0)
+ )
+ (func $b (result i32)
+  (i32.const 3)
+ )
+)
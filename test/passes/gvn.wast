@@ -0,0 +1,175 @@
+(module
+  (memory 100 100)
+  (global $g (mut i32) (i32.const 0))
+  (func $across-ifs (param $x i32) (param $y i32)
+    (drop
+      (i32.add (get_local $x) (get_local $y))
+    )
+    (if (get_local $x)
+      (drop ;; dominated by the first
+        (i32.add (get_local $x) (get_local $y))
+      )
+      (block
+        (set_local $y (i32.const 1))
+        (drop ;; y was changed
+          (i32.add (get_local $x) (get_local $y))
+        )
+      )
+    )
+    (drop ;; y may have been changed in an arm
+      (i32.add (get_local $x) (get_local $y))
+    )
+    (drop
+      (i32.mul (get_local $x) (get_local $y))
+    )
+    (if (get_local $x)
+      (nop)
+    )
+    (drop ;; nothing changed in between
+      (i32.mul (get_local $x) (get_local $y))
+    )
+  )
+  (func $computed-in-both-arms (param $x i32) (param $y i32)
+    (if (get_local $x)
+      (drop
+        (i32.sub (get_local $x) (get_local $y))
+      )
+      (drop
+        (i32.sub (get_local $x) (get_local $y))
+      )
+    )
+    (drop ;; available on both paths
+      (i32.sub (get_local $x) (get_local $y))
+    )
+    (if (get_local $x)
+      (drop
+        (i32.xor (get_local $x) (get_local $y))
+      )
+    )
+    (drop ;; not computed if the condition is false
+      (i32.xor (get_local $x) (get_local $y))
+    )
+  )
+  (func $early-exit (param $x i32) (param $y i32) (result i32)
+    (if (get_local $x)
+      (return (i32.div_s (get_local $x) (get_local $y)))
+    )
+    (drop ;; the arm did not fall through, but it did not dominate us
+      (i32.div_s (get_local $x) (get_local $y))
+    )
+    (if (get_local $y)
+      (block
+        (set_local $x (i32.const 2))
+        (return (i32.const 0))
+      )
+    )
+    (i32.div_s (get_local $x) (get_local $y)) ;; x is unchanged if we got here
+  )
+  (func $loops (param $x i32) (param $y i32)
+    (drop
+      (i32.add (get_local $x) (i32.const 8))
+    )
+    (drop
+      (i32.add (get_local $y) (i32.const 8))
+    )
+    (loop $loop
+      (drop ;; x is not changed in the loop
+        (i32.add (get_local $x) (i32.const 8))
+      )
+      (drop ;; y is changed later in the loop
+        (i32.add (get_local $y) (i32.const 8))
+      )
+      (drop
+        (i32.mul (get_local $x) (get_local $x))
+      )
+      (set_local $y (i32.add (get_local $y) (i32.const 1)))
+      (br_if $loop (get_local $y))
+    )
+    (drop ;; the loop body dominates us
+      (i32.mul (get_local $x) (get_local $x))
+    )
+    (drop ;; but y was changed after this was computed
+      (i32.add (get_local $y) (i32.const 1))
+    )
+  )
+  (func $branches (param $x i32) (param $y i32)
+    (block $out
+      (br_if $out (get_local $x))
+      (drop
+        (i32.shl (get_local $x) (get_local $y))
+      )
+      (drop ;; a br_if does not change values
+        (i32.shl (get_local $x) (get_local $y))
+      )
+    )
+    (drop ;; the br_if may have skipped the computation
+      (i32.shl (get_local $x) (get_local $y))
+    )
+  )
+  (func $loads (param $x i32)
+    (drop
+      (i32.load offset=4 (get_local $x))
+    )
+    (if (get_local $x)
+      (drop ;; the load is dominated and memory is unchanged
+        (i32.load offset=4 (get_local $x))
+      )
+    )
+    (drop
+      (i32.load offset=4 (get_local $x))
+    )
+    (i32.store offset=6 (get_local $x) (i32.const 1))
+    (drop ;; memory was changed
+      (i32.load offset=4 (get_local $x))
+    )
+    (drop
+      (i32.add (get_global $g) (get_local $x))
+    )
+    (call $loads (i32.const 0))
+    (drop ;; the call may change the global
+      (i32.add (get_global $g) (get_local $x))
+    )
+  )
+  (func $forwarding (param $x i32) (param $y i32)
+    (i32.store offset=8 (get_local $x) (i32.add (get_local $y) (i32.const 1)))
+    (i32.store offset=12 (get_local $x) (i32.const 2)) ;; does not alias, by the offsets
+    (drop ;; reads what was stored, with a different alignment
+      (i32.load offset=8 align=1 (get_local $x))
+    )
+    (i32.store offset=10 (get_local $x) (i32.const 3)) ;; aliases two bytes
+    (drop
+      (i32.load offset=8 (get_local $x))
+    )
+    (i32.store (i32.const 100) (i32.const 4))
+    (i32.store (i32.const 104) (i32.const 5)) ;; does not alias, by the addresses
+    (drop
+      (i32.load (i32.const 100))
+    )
+    (i32.store (get_local $y) (i32.const 6)) ;; may alias anything
+    (drop
+      (i32.load (i32.const 104))
+    )
+    (i32.store8 (i32.const 200) (i32.const 7))
+    (drop ;; a partial store is not forwarded
+      (i32.load8_u (i32.const 200))
+    )
+  )
+  (func $loads-in-scopes (param $x i32)
+    (drop
+      (i32.load16_s offset=4 (get_local $x))
+    )
+    (if (get_local $x)
+      (i32.store offset=8 (get_local $x) (i32.const 1))
+    )
+    (drop ;; the store in the arm does not alias
+      (i32.load16_s offset=4 (get_local $x))
+    )
+    (loop $loop
+      (i32.store offset=5 (get_local $x) (i32.const 1))
+      (br_if $loop (get_local $x))
+    )
+    (drop ;; the store in the loop does
+      (i32.load16_s offset=4 (get_local $x))
+    )
+  )
+)
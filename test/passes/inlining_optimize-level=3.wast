@@ -1,4 +1,5 @@
 (module
+  (import "env" "check" (func $check (param i32) (result i32)))
   (export "yes" (func $yes))
   (export "no-loops-but-one-use-but-exported" (func $no-loops-but-one-use-but-exported))
   (table 1 1 anyfunc)
@@ -54,5 +55,225 @@
     (drop (call $no-loops-but-one-use-but-exported))
     (drop (call $no-loops-but-one-use-but-tabled))
   )
+  (func $split (param $x i32) (result i32) ;; too big, but has an early exit that we can split off and inline
+    (if (i32.eqz (get_local $x))
+      (return (i32.const 0))
+    )
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 0)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 1)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 2)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 3)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 4)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 5)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 6)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 7)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 8)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 9)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 10)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 11)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 12)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 13)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 14)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 15)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 16)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 17)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 18)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 19)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 20)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 21)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 22)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 23)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 24)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 25)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 26)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 27)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 28)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 29)))
+    (get_local $x)
+  )
+  (func $no-split-reads-var (param $x i32) (result i32)
+    (local $y i32)
+    (if (i32.eqz (get_local $y))
+      (return (i32.const 0))
+    )
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 0)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 1)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 2)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 3)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 4)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 5)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 6)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 7)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 8)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 9)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 10)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 11)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 12)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 13)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 14)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 15)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 16)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 17)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 18)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 19)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 20)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 21)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 22)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 23)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 24)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 25)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 26)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 27)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 28)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 29)))
+    (get_local $x)
+  )
+  (func $no-split-expensive (param $x i32) (result i32)
+    (if (call $check (get_local $x))
+      (return (i32.const 0))
+    )
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 0)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 1)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 2)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 3)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 4)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 5)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 6)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 7)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 8)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 9)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 10)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 11)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 12)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 13)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 14)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 15)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 16)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 17)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 18)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 19)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 20)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 21)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 22)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 23)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 24)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 25)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 26)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 27)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 28)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 29)))
+    (get_local $x)
+  )
+  (func $splitCalls (param $x i32) (result i32)
+    (drop (call $split (get_local $x)))
+    (drop (call $split (i32.const 1)))
+    (drop (call $no-split-reads-var (get_local $x)))
+    (drop (call $no-split-reads-var (get_local $x)))
+    (drop (call $no-split-expensive (get_local $x)))
+    (call $no-split-expensive (get_local $x))
+  )
 )
 
+(module
+  (memory 1 1)
+  (func $split-partly-inlined (param $x i32) (result i32) ;; the early exit is inlined only in the loop before the budget runs out, so the slow path is merged back for the other calls
+    (if (i32.eqz (get_local $x))
+      (return (i32.const 0))
+    )
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 0)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 1)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 2)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 3)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 4)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 5)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 6)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 7)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 8)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 9)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 10)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 11)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 12)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 13)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 14)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 15)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 16)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 17)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 18)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 19)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 20)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 21)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 22)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 23)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 24)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 25)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 26)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 27)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 28)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 29)))
+    (get_local $x)
+  )
+  (func $split-not-inlined (param $x i32) (result i32) ;; the early exit is not inlined anywhere, so the split is undone
+    (if (i32.eqz (get_local $x))
+      (return (i32.const 0))
+    )
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 0)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 1)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 2)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 3)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 4)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 5)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 6)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 7)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 8)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 9)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 10)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 11)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 12)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 13)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 14)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 15)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 16)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 17)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 18)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 19)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 20)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 21)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 22)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 23)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 24)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 25)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 26)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 27)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 28)))
+    (i32.store (get_local $x) (i32.add (get_local $x) (i32.const 29)))
+    (get_local $x)
+  )
+  (func $hot (param $x i32)
+    (i32.store (get_local $x) (i32.const 0))
+    (i32.store (get_local $x) (i32.const 1))
+    (i32.store (get_local $x) (i32.const 2))
+    (i32.store (get_local $x) (i32.const 3))
+  )
+  (func $calls (param $x i32) (result i32)
+    (loop $l
+      (drop (call $split-partly-inlined (get_local $x)))
+      (call $hot (get_local $x))
+      (call $hot (get_local $x))
+      (call $hot (get_local $x))
+      (call $hot (get_local $x))
+      (call $hot (get_local $x))
+      (call $hot (get_local $x))
+      (call $hot (get_local $x))
+      (call $hot (get_local $x))
+      (call $hot (get_local $x))
+      (call $hot (get_local $x))
+      (call $hot (get_local $x))
+      (call $hot (get_local $x))
+      (br_if $l (get_local $x))
+    )
+    (drop (call $split-partly-inlined (i32.const 1)))
+    (drop (call $split-partly-inlined (i32.const 2)))
+    (drop (call $split-not-inlined (get_local $x)))
+    (call $split-not-inlined (i32.const 1))
+  )
+)
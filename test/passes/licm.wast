@@ -0,0 +1,101 @@
+(module
+  (memory 100 100)
+  (global $g (mut i32) (i32.const 0))
+  (func $basics (param $x i32) (param $y i32)
+    (loop $loop
+      (drop ;; x is not changed in the loop
+        (i32.add (get_local $x) (i32.mul (get_local $x) (i32.const 4)))
+      )
+      (drop ;; y is
+        (i32.add (get_local $y) (i32.const 1))
+      )
+      (set_local $y (i32.sub (get_local $y) (i32.const 1)))
+      (br_if $loop (get_local $y))
+    )
+  )
+  (func $sets-before-the-loop (param $x i32)
+    (local $y i32)
+    (set_local $y (i32.shl (get_local $x) (i32.const 2)))
+    (loop $loop
+      (i32.store
+        (i32.add (get_local $y) (i32.const 8)) ;; only set before the loop
+        (i32.const 0)
+      )
+      (set_local $x (i32.sub (get_local $x) (i32.const 1)))
+      (br_if $loop (get_local $x))
+    )
+  )
+  (func $nested (param $x i32) (param $y i32)
+    (loop $outer
+      (loop $inner
+        (drop ;; invariant in both loops
+          (i32.xor (get_local $x) (i32.const 7))
+        )
+        (drop ;; only invariant in the inner loop
+          (i32.xor (get_local $y) (i32.const 7))
+        )
+        (br_if $inner (get_local $x))
+      )
+      (set_local $y (i32.add (get_local $y) (i32.const 1)))
+      (br_if $outer (get_local $y))
+    )
+  )
+  (func $loads (param $x i32)
+    (loop $loop
+      (drop ;; memory is not written in the loop, and this runs first
+        (i32.load offset=4 (get_local $x))
+      )
+      (br_if $loop (get_global $g))
+    )
+    (loop $loop
+      (drop ;; memory is written in the loop
+        (i32.load offset=4 (get_local $x))
+      )
+      (i32.store (get_local $x) (i32.const 1))
+      (br_if $loop (get_global $g))
+    )
+    (loop $loop
+      (if (get_global $g)
+        (drop ;; may trap, and might not run
+          (i32.load offset=4 (get_local $x))
+        )
+      )
+      (if (get_global $g)
+        (drop ;; may not run, but cannot trap
+          (i32.add (get_local $x) (i32.const 4))
+        )
+      )
+      (br_if $loop (get_global $g))
+    )
+  )
+  (func $globals (param $x i32)
+    (loop $loop
+      (drop
+        (i32.add (get_global $g) (get_local $x))
+      )
+      (br_if $loop (get_local $x))
+    )
+    (loop $loop
+      (drop ;; the call may write the global
+        (i32.add (get_global $g) (get_local $x))
+      )
+      (call $globals (i32.const 0))
+      (br_if $loop (get_local $x))
+    )
+  )
+  (func $hoist-inner-loop (param $x i32) (result i32)
+    (local $s i32)
+    (loop $outer
+      (set_local $s
+        (i32.add
+          (get_local $s)
+          (loop $inner (result i32) ;; invariant as a whole, so it is hoisted
+            (i32.mul (i32.const 3) (i32.const 5))
+          )
+        )
+      )
+      (br_if $outer (i32.lt_u (get_local $s) (get_local $x)))
+    )
+    (get_local $s)
+  )
+)
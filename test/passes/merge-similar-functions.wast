@@ -0,0 +1,90 @@
+(module
+  (memory 1 1)
+  (table 2 2 anyfunc)
+  (elem (i32.const 0) $a $c)
+  (export "b" (func $b))
+  (import "env" "log" (func $log (param i32 i32)))
+  ;; these differ in constants, two of which always differ together
+  (func $a (param $x i32) (result i32)
+    (local $y i32)
+    (set_local $y (i32.load offset=8 (get_local $x)))
+    (call $log (get_local $y) (i32.const 10))
+    (i32.store offset=4 (get_local $x) (i32.add (get_local $y) (i32.const 100)))
+    (call $log (get_local $y) (i32.const 10))
+    (i32.mul (get_local $y) (i32.const 3))
+  )
+  (func $b (param $x i32) (result i32)
+    (local $y i32)
+    (set_local $y (i32.load offset=8 (get_local $x)))
+    (call $log (get_local $y) (i32.const 20))
+    (i32.store offset=4 (get_local $x) (i32.add (get_local $y) (i32.const 200)))
+    (call $log (get_local $y) (i32.const 20))
+    (i32.mul (get_local $y) (i32.const 3))
+  )
+  (func $c (param $x i32) (result i32)
+    (local $y i32)
+    (set_local $y (i32.load offset=8 (get_local $x)))
+    (call $log (get_local $y) (i32.const 30))
+    (i32.store offset=4 (get_local $x) (i32.add (get_local $y) (i32.const 300)))
+    (call $log (get_local $y) (i32.const 30))
+    (i32.mul (get_local $y) (i32.const 3))
+  )
+  ;; a constant of a different type
+  (func $d (param $x i32) (result i32)
+    (local $y i32)
+    (set_local $y (i32.load offset=8 (get_local $x)))
+    (call $log (get_local $y) (i32.const 30))
+    (i64.store offset=4 (get_local $x) (i64.extend_u/i32 (get_local $y)))
+    (call $log (get_local $y) (i32.const 30))
+    (i32.mul (get_local $y) (i32.const 3))
+  )
+  ;; identical functions are left for duplicate-function-elimination
+  (func $same-1 (param $x i32)
+    (i32.store offset=4 (get_local $x) (i32.add (i32.load (get_local $x)) (i32.const 1)))
+    (i32.store offset=8 (get_local $x) (i32.add (i32.load (get_local $x)) (i32.const 2)))
+  )
+  (func $same-2 (param $x i32)
+    (i32.store offset=4 (get_local $x) (i32.add (i32.load (get_local $x)) (i32.const 1)))
+    (i32.store offset=8 (get_local $x) (i32.add (i32.load (get_local $x)) (i32.const 2)))
+  )
+  ;; too small to be worth it
+  (func $small-1 (param $x i32) (result i32)
+    (i32.add (get_local $x) (i32.const 1))
+  )
+  (func $small-2 (param $x i32) (result i32)
+    (i32.add (get_local $x) (i32.const 2))
+  )
+  ;; different call targets are not merged
+  (func $calls-1 (param $x i32)
+    (call $log (i32.load offset=4 (get_local $x)) (i32.load offset=8 (get_local $x)))
+    (drop (call $small-1 (i32.load offset=12 (get_local $x))))
+    (drop (call $small-1 (i32.load offset=16 (get_local $x))))
+  )
+  (func $calls-2 (param $x i32)
+    (call $log (i32.load offset=4 (get_local $x)) (i32.load offset=8 (get_local $x)))
+    (drop (call $small-2 (i32.load offset=12 (get_local $x))))
+    (drop (call $small-2 (i32.load offset=16 (get_local $x))))
+  )
+  ;; many differing constants, in functions with no params or vars
+  (func $many-1
+    (i32.store (i32.const 0) (i32.const 1))
+    (i32.store (i32.const 4) (i32.const 2))
+    (i32.store (i32.const 8) (i32.const 3))
+    (i32.store (i32.const 12) (i32.const 4))
+    (f64.store (i32.const 16) (f64.const 5))
+  )
+  (func $many-2
+    (i32.store (i32.const 0) (i32.const 10))
+    (i32.store (i32.const 4) (i32.const 20))
+    (i32.store (i32.const 8) (i32.const 30))
+    (i32.store (i32.const 12) (i32.const 40))
+    (f64.store (i32.const 16) (f64.const 50))
+  )
+  (func $many-3
+    (i32.store (i32.const 0) (i32.const 100))
+    (i32.store (i32.const 4) (i32.const 200))
+    (i32.store (i32.const 8) (i32.const 300))
+    (i32.store (i32.const 12) (i32.const 400))
+    (f64.store (i32.const 16) (f64.const 500))
+  )
+)
@@ -2663,6 +2663,36 @@
       (i32.and (i32.wrap/i64 (i64.const 1)) (i32.eqz (get_local $y)))
     )
   )
+  (func $patterns (param $x i32) (param $y i64)
+    ;; operations that do nothing
+    (drop (i64.and (get_local $y) (i64.const -1)))
+    (drop (i64.or (get_local $y) (i64.const 0)))
+    (drop (i32.xor (get_local $x) (i32.const 0)))
+    (drop (i64.shr_u (get_local $y) (i64.const 0)))
+    (drop (i32.rotl (get_local $x) (i32.const 0)))
+    (drop (i64.mul (get_local $y) (i64.const 1)))
+    (drop (i32.div_s (get_local $x) (i32.const 1)))
+    (drop (i64.div_u (get_local $y) (i64.const 1)))
+    (drop (i64.sub (get_local $y) (i64.const 0)))
+    (drop (i32.div_u (get_local $x) (i32.const 2))) ;; not this
+    (drop (i32.rem_u (get_local $x) (i32.const 1))) ;; or this
+    (drop (i64.eq (get_local $y) (i64.const 0)))
+    ;; results that do not depend on an expression, if it has no side effects
+    (drop (i32.and (get_local $x) (i32.const 0)))
+    (drop (i64.mul (get_local $y) (i64.const 0)))
+    (drop (i32.and (tee_local $x (i32.const 1)) (i32.const 0)))
+    (drop (i32.mul (i32.load (get_local $x)) (i32.const 0)))
+    ;; operations on an expression and itself
+    (drop (i32.sub (get_local $x) (get_local $x)))
+    (drop (i64.xor (get_local $y) (get_local $y)))
+    (drop (i32.eq (get_local $x) (get_local $x)))
+    (drop (i64.ne (get_local $y) (get_local $y)))
+    (drop (i32.and (get_local $x) (get_local $x)))
+    (drop (i64.or (i64.add (get_local $y) (i64.const 1)) (i64.add (get_local $y) (i64.const 1))))
+    (drop (i32.sub (get_local $x) (i32.add (get_local $x) (i32.const 1)))) ;; not the same
+    (drop (i32.sub (tee_local $x (i32.const 1)) (tee_local $x (i32.const 1)))) ;; side effects
+    (drop (i32.xor (i32.load (get_local $x)) (i32.load (get_local $x)))) ;; may trap
+  )
 )
 (module
   (import "env" "memory" (memory $0 (shared 256 256)))
@@ -0,0 +1,98 @@
+(module
+  (memory 1 1)
+  (global $g (mut i32) (i32.const 0))
+  (import "env" "log" (func $log (param i32)))
+  ;; the same stores appear in three functions, reading a local that
+  ;; becomes a parameter
+  (func $a (param $x i32)
+    (call $log (i32.const 1))
+    (i32.store offset=4 (get_local $x) (i32.add (i32.load offset=8 (get_local $x)) (i32.const 10)))
+    (i32.store offset=12 (get_local $x) (i32.mul (i32.load offset=16 (get_local $x)) (i32.const 20)))
+    (call $log (i32.const 2))
+  )
+  (func $b (param $y f64) (param $x i32)
+    (i32.store offset=4 (get_local $x) (i32.add (i32.load offset=8 (get_local $x)) (i32.const 10)))
+    (i32.store offset=12 (get_local $x) (i32.mul (i32.load offset=16 (get_local $x)) (i32.const 20)))
+    (call $log (i32.const 3))
+  )
+  (func $c (param $y f64) (param $x i32) (result i32)
+    (if (get_local $x)
+      (block
+        (i32.store offset=4 (get_local $x) (i32.add (i32.load offset=8 (get_local $x)) (i32.const 10)))
+        (i32.store offset=12 (get_local $x) (i32.mul (i32.load offset=16 (get_local $x)) (i32.const 20)))
+      )
+    )
+    (get_local $x)
+  )
+  ;; the same code, but local 1 is an i64 here, so it is different
+  (func $different-type (param $y f64) (param $x i64)
+    (i64.store offset=4 (i32.const 0) (i64.add (i64.load offset=8 (i32.const 0)) (get_local $x)))
+    (i64.store offset=12 (i32.const 0) (i64.mul (i64.load offset=16 (i32.const 0)) (get_local $x)))
+  )
+  ;; repeats inside one function, with no locals and internal labels
+  (func $in-one-function
+    (block $out
+      (br_if $out (i32.load (i32.const 100)))
+      (set_global $g (i32.add (get_global $g) (i32.const 1)))
+      (i32.store (i32.const 104) (get_global $g))
+    )
+    (call $log (i32.const 4))
+    (block $other-name
+      (br_if $other-name (i32.load (i32.const 100)))
+      (set_global $g (i32.add (get_global $g) (i32.const 1)))
+      (i32.store (i32.const 104) (get_global $g))
+    )
+    (call $log (i32.const 5))
+    (block $out
+      (br_if $out (i32.load (i32.const 100)))
+      (set_global $g (i32.add (get_global $g) (i32.const 1)))
+      (i32.store (i32.const 104) (get_global $g))
+    )
+  )
+  ;; code that writes locals, branches out, or returns can't be moved
+  (func $writes-locals (param $x i32)
+    (set_local $x (i32.add (i32.load offset=8 (get_local $x)) (i32.const 10)))
+    (i32.store offset=12 (get_local $x) (i32.mul (i32.load offset=16 (get_local $x)) (i32.const 20)))
+    (set_local $x (i32.add (i32.load offset=8 (get_local $x)) (i32.const 10)))
+    (i32.store offset=12 (get_local $x) (i32.mul (i32.load offset=16 (get_local $x)) (i32.const 20)))
+  )
+  (func $branches-out
+    (block $out
+      (if (i32.load (i32.const 200)) (br $out))
+      (i32.store offset=12 (i32.const 300) (i32.mul (i32.load offset=16 (i32.const 300)) (i32.const 20)))
+      (call $log (i32.const 6))
+      (if (i32.load (i32.const 200)) (br $out))
+      (i32.store offset=12 (i32.const 300) (i32.mul (i32.load offset=16 (i32.const 300)) (i32.const 20)))
+    )
+  )
+  (func $returns
+    (if (i32.load (i32.const 200)) (return))
+    (i32.store offset=12 (i32.const 300) (i32.mul (i32.load offset=16 (i32.const 300)) (i32.const 20)))
+    (call $log (i32.const 7))
+    (if (i32.load (i32.const 200)) (return))
+    (i32.store offset=12 (i32.const 300) (i32.mul (i32.load offset=16 (i32.const 300)) (i32.const 20)))
+  )
+  ;; too small to be worth it
+  (func $small (param $x i32)
+    (i32.store (get_local $x) (i32.const 1))
+    (call $log (i32.const 8))
+    (i32.store (get_local $x) (i32.const 1))
+  )
+  ;; a repeat inside a repeat: we outline the bigger one
+  (func $nested-1
+    (loop $l
+      (i32.store offset=20 (i32.const 400) (i32.sub (i32.load offset=24 (i32.const 400)) (i32.const 30)))
+      (i32.store offset=28 (i32.const 400) (i32.sub (i32.load offset=32 (i32.const 400)) (i32.const 40)))
+      (br_if $l (i32.load (i32.const 400)))
+    )
+    (call $log (i32.const 9))
+  )
+  (func $nested-2
+    (loop $l
+      (i32.store offset=20 (i32.const 400) (i32.sub (i32.load offset=24 (i32.const 400)) (i32.const 30)))
+      (i32.store offset=28 (i32.const 400) (i32.sub (i32.load offset=32 (i32.const 400)) (i32.const 40)))
+      (br_if $l (i32.load (i32.const 400)))
+    )
+    (call $log (i32.const 9))
+  )
+)
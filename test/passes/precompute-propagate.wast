@@ -109,5 +109,11 @@
       (br $loop)
     )
   )
+  (func $known-later (result i32)
+    (local $x i32)
+    (local $y i32)
+    (set_local $x (i32.const 1))
+    (set_local $y (i32.add (i32.mul (get_local $x) (i32.const 2)) (i32.const 3)))
+    (i32.add (get_local $y) (i32.const 1))
+  )
 )
-
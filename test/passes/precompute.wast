@@ -280,4 +280,52 @@
     )
    )
   )
+  (func $traps
+   (drop
+    (i32.div_s
+     (i32.const -2147483648)
+     (i32.const -1)
+    )
+   )
+   (drop
+    (i64.rem_u
+     (i64.const 1)
+     (i64.const 0)
+    )
+   )
+   (drop
+    (i32.trunc_s/f32
+     (f32.const nan)
+    )
+   )
+   (drop
+    (i32.rem_s
+     (i32.const -2147483648)
+     (i32.const -1)
+    )
+   )
+  )
+  (func $nonconstant-in-a-constant-parent (param $x i32) (result i32)
+   (drop
+    (i32.add
+     (i32.mul
+      (get_local $x)
+      (i32.const 2)
+     )
+     (i32.const 3)
+    )
+   )
+   (block $out (result i32)
+    (br $out
+     (i32.const 1)
+    )
+    (i32.add
+     (i32.mul
+      (get_local $x)
+      (i32.const 2)
+     )
+     (i32.const 3)
+    )
+   )
+  )
 )
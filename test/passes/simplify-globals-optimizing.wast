@@ -0,0 +1,27 @@
+(module
+  (global $base (mut i32) (i32.const 1024))
+  (global $limit (mut i32) (i32.const 4096))
+  (global $top (mut i32) (i32.const 2048))
+  (func $hot (param $x i32) (result i32)
+    (local $i i32)
+    (loop $l
+      (i32.store
+        (i32.add (get_global $base) (i32.shl (get_local $i) (i32.const 2)))
+        (get_local $x)
+      )
+      (br_if $l
+        (i32.lt_u
+          (tee_local $i (i32.add (get_local $i) (i32.const 1)))
+          (i32.sub (get_global $limit) (get_global $base))
+        )
+      )
+    )
+    (get_global $top)
+  )
+  (func $stack (param $x i32)
+    (set_global $top (i32.add (get_global $top) (get_local $x)))
+  )
+  (func $untouched (result i32)
+    (get_global $top)
+  )
+)
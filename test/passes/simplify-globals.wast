@@ -0,0 +1,24 @@
+(module
+  (import "env" "imported" (global $imported i32))
+  (global $immutable i32 (i32.const 1))
+  (global $never-written (mut i32) (i32.const 2))
+  (global $written (mut i32) (i32.const 3))
+  (global $exported i32 (i32.const 4))
+  (global $from-import (mut i32) (get_global $imported))
+  (global $from-constant i32 (get_global $immutable))
+  (global $float (mut f64) (f64.const 5.5))
+  (export "exported" (global $exported))
+  (func $reads (result i32)
+    (drop (get_global $immutable))
+    (drop (get_global $never-written))
+    (drop (get_global $written))
+    (drop (get_global $exported))
+    (drop (get_global $from-import))
+    (drop (get_global $from-constant))
+    (drop (get_global $float))
+    (get_global $imported)
+  )
+  (func $writes
+    (set_global $written (i32.const 30))
+  )
+)
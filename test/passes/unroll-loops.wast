@@ -0,0 +1,260 @@
+(module
+  (memory 1 1)
+  (import "env" "f" (func $f (param i32)))
+  (func $full (param $x i32)
+    (local $i i32)
+    (loop $loop ;; the counter starts at 0, and runs 4 times
+      (i32.store
+        (i32.shl (get_local $i) (i32.const 2))
+        (get_local $x)
+      )
+      (br_if $loop
+        (i32.lt_s
+          (tee_local $i (i32.add (get_local $i) (i32.const 1)))
+          (i32.const 4)
+        )
+      )
+    )
+  )
+  (func $count-down
+    (local $n i32)
+    (set_local $n (i32.const 3))
+    (loop $loop
+      (call $f (get_local $n))
+      (set_local $n (i32.sub (get_local $n) (i32.const 1)))
+      (br_if $loop (get_local $n))
+    )
+  )
+  (func $constant-on-the-left-i64
+    (local $i i64)
+    (set_local $i (i64.const 10))
+    (loop $loop
+      (call $f (i32.wrap/i64 (get_local $i)))
+      (br_if $loop
+        (i64.gt_u
+          (i64.const 12)
+          (tee_local $i (i64.add (get_local $i) (i64.const 1)))
+        )
+      )
+    )
+  )
+  (func $labels-and-breaks (param $x i32)
+    (local $i i32)
+    (block $out
+      (loop $loop
+        (block $skip
+          (br_if $skip (get_local $x))
+          (br_if $out (i32.eq (get_local $x) (i32.const 100)))
+          (call $f (get_local $i))
+        )
+        (br_if $loop
+          (i32.ne
+            (tee_local $i (i32.add (get_local $i) (i32.const 1)))
+            (i32.const 2)
+          )
+        )
+      )
+    )
+  )
+  (func $partial
+    (local $i i32)
+    (loop $loop ;; too many iterations to unroll fully. 102 is 2 more than a multiple of 4
+      (call $f (get_local $i))
+      (br_if $loop
+        (i32.lt_u
+          (tee_local $i (i32.add (get_local $i) (i32.const 1)))
+          (i32.const 102)
+        )
+      )
+    )
+  )
+  (func $too-big
+    (local $i i32)
+    (loop $loop
+      (call $f (i32.add (i32.mul (get_local $i) (get_local $i)) (i32.const 1)))
+      (call $f (i32.add (i32.mul (get_local $i) (get_local $i)) (i32.const 2)))
+      (call $f (i32.add (i32.mul (get_local $i) (get_local $i)) (i32.const 3)))
+      (call $f (i32.add (i32.mul (get_local $i) (get_local $i)) (i32.const 4)))
+      (call $f (i32.add (i32.mul (get_local $i) (get_local $i)) (i32.const 5)))
+      (call $f (i32.add (i32.mul (get_local $i) (get_local $i)) (i32.const 6)))
+      (br_if $loop
+        (i32.lt_u
+          (tee_local $i (i32.add (get_local $i) (i32.const 1)))
+          (i32.const 100)
+        )
+      )
+    )
+  )
+  (func $unknown-start (param $i i32)
+    (loop $loop
+      (call $f (get_local $i))
+      (br_if $loop
+        (i32.lt_u
+          (tee_local $i (i32.add (get_local $i) (i32.const 1)))
+          (i32.const 4)
+        )
+      )
+    )
+  )
+  (func $never-ends
+    (local $i i32)
+    (loop $loop
+      (call $f (get_local $i))
+      (br_if $loop
+        (i32.ne
+          (tee_local $i (i32.add (get_local $i) (i32.const 2)))
+          (i32.const 5)
+        )
+      )
+    )
+  )
+  (func $counter-set-twice (param $x i32)
+    (local $i i32)
+    (loop $loop
+      (if (get_local $x)
+        (set_local $i (i32.const 1))
+      )
+      (br_if $loop
+        (i32.lt_u
+          (tee_local $i (i32.add (get_local $i) (i32.const 1)))
+          (i32.const 4)
+        )
+      )
+    )
+  )
+  (func $conditional-update (param $x i32)
+    (local $i i32)
+    (loop $loop
+      (if (get_local $x)
+        (set_local $i (i32.add (get_local $i) (i32.const 1)))
+      )
+      (br_if $loop (i32.lt_u (get_local $i) (i32.const 4)))
+    )
+  )
+  (func $continue (param $x i32)
+    (local $i i32)
+    (loop $loop
+      (br_if $loop (get_local $x))
+      (br_if $loop
+        (i32.lt_u
+          (tee_local $i (i32.add (get_local $i) (i32.const 1)))
+          (i32.const 4)
+        )
+      )
+    )
+  )
+  (func $nested
+    (local $i i32)
+    (local $j i32)
+    (loop $outer
+      (set_local $j (i32.const 0))
+      (loop $inner ;; only this is unrolled
+        (call $f (i32.add (get_local $i) (get_local $j)))
+        (br_if $inner
+          (i32.lt_u
+            (tee_local $j (i32.add (get_local $j) (i32.const 1)))
+            (i32.const 2)
+          )
+        )
+      )
+      (br_if $outer
+        (i32.lt_u
+          (tee_local $i (i32.add (get_local $i) (i32.const 1)))
+          (i32.const 2)
+        )
+      )
+    )
+  )
+  (func $nested-not-reset (result i32)
+    (local $i i32)
+    (local $j i32)
+    (local $sum i32)
+    (loop $outer
+      (loop $inner ;; $i is not reset, so later runs of this loop start from where the last ended
+        (set_local $sum (i32.add (get_local $sum) (i32.const 1)))
+        (br_if $inner
+          (i32.lt_u
+            (tee_local $i (i32.add (get_local $i) (i32.const 1)))
+            (i32.const 3)
+          )
+        )
+      )
+      (br_if $outer
+        (i32.lt_u
+          (tee_local $j (i32.add (get_local $j) (i32.const 1)))
+          (i32.const 4)
+        )
+      )
+    )
+    (get_local $sum)
+  )
+  (func $nested-set-outside (result i32)
+    (local $i i32)
+    (local $j i32)
+    (local $sum i32)
+    (set_local $i (i32.const 0))
+    (loop $outer
+      (loop $inner ;; the set before the outer loop only runs once
+        (set_local $sum (i32.add (get_local $sum) (i32.const 1)))
+        (br_if $inner
+          (i32.lt_u
+            (tee_local $i (i32.add (get_local $i) (i32.const 1)))
+            (i32.const 3)
+          )
+        )
+      )
+      (br_if $outer
+        (i32.lt_u
+          (tee_local $j (i32.add (get_local $j) (i32.const 1)))
+          (i32.const 4)
+        )
+      )
+    )
+    (get_local $sum)
+  )
+  (func $set-conditionally (param $x i32)
+    (local $i i32)
+    (if (get_local $x)
+      (set_local $i (i32.const 1)) ;; does not run every time before the loop
+    )
+    (loop $loop
+      (call $f (get_local $i))
+      (br_if $loop
+        (i32.lt_u
+          (tee_local $i (i32.add (get_local $i) (i32.const 1)))
+          (i32.const 3)
+        )
+      )
+    )
+  )
+  (func $peel (param $x i32)
+    (local $first i32)
+    (set_local $first (i32.const 1))
+    (loop $loop
+      (if (get_local $first) ;; constant in the first iteration
+        (call $f (i32.const 0))
+      )
+      (set_local $first (i32.const 0))
+      (br_if $loop (get_local $x))
+    )
+  )
+  (func $no-peel (param $x i32) (param $first i32)
+    (loop $loop
+      (if (get_local $first) ;; unknown in the first iteration
+        (call $f (i32.const 0))
+      )
+      (set_local $first (i32.const 0))
+      (br_if $loop (get_local $x))
+    )
+  )
+  (func $no-peel-invariant (param $x i32)
+    (local $first i32)
+    (set_local $first (i32.const 1))
+    (loop $loop
+      (if (get_local $first) ;; constant in every iteration
+        (call $f (i32.const 0))
+      )
+      (br_if $loop (get_local $x))
+    )
+  )
+)
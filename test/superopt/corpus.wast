@@ -0,0 +1,35 @@
+(module
+  (memory $0 1)
+  (func $f (param $x i32) (param $y i32) (param $z i64) (result i32)
+    ;; double negation
+    (drop (i32.sub (i32.const 0) (i32.sub (i32.const 0) (get_local $x))))
+    (drop (i32.sub (i32.const 0) (i32.sub (i32.const 0) (get_local $y))))
+    ;; a mask that optimize-instructions already removes
+    (drop (i32.and (i32.shr_u (get_local $x) (i32.const 31)) (i32.const 1)))
+    (drop (i32.and (i32.shr_u (get_local $y) (i32.const 31)) (i32.const 1)))
+    ;; a division by a power of 2
+    (drop (i32.div_u (get_local $x) (i32.const 16)))
+    (drop (i32.div_u (i32.load (get_local $y)) (i32.const 16)))
+    ;; a multiplication by a power of 2
+    (drop (i32.mul (get_local $x) (i32.const 8)))
+    (drop (i32.mul (get_local $y) (i32.const 8)))
+    ;; wrapping an extension
+    (drop (i32.wrap/i64 (i64.extend_u/i32 (get_local $x))))
+    (drop (i32.wrap/i64 (i64.extend_u/i32 (get_local $y))))
+    ;; a masked extension
+    (drop (i64.and (i64.extend_u/i32 (get_local $x)) (i64.const 4294967295)))
+    (drop (i64.and (i64.extend_u/i32 (get_local $y)) (i64.const 4294967295)))
+    ;; an expression without side effects that appears twice
+    (drop (i32.or (i32.and (get_local $x) (get_local $y)) (get_local $x)))
+    (drop (i32.or (i32.and (get_local $y) (get_local $x)) (get_local $y)))
+    ;; with side effects, it is two different inputs
+    (drop (i32.sub (call $f (get_local $x) (get_local $y) (get_local $z)) (call $f (get_local $x) (get_local $y) (get_local $z))))
+    (drop (i32.sub (call $f (get_local $y) (get_local $y) (get_local $z)) (call $f (get_local $y) (get_local $y) (get_local $z))))
+    ;; something there is nothing cheaper for
+    (drop (i32.add (i32.mul (get_local $x) (get_local $y)) (i32.const 1)))
+    (drop (i32.add (i32.mul (get_local $y) (get_local $x)) (i32.const 1)))
+    ;; seen only once
+    (drop (i32.xor (i32.xor (get_local $x) (i32.const -1)) (i32.const -1)))
+    (i32.const 0)
+  )
+)
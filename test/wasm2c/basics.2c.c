@@ -0,0 +1,697 @@
+/* generated by wasm2c */
+
+#include <math.h>
+#include <setjmp.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef uint8_t u8;
+typedef int8_t s8;
+typedef uint16_t u16;
+typedef int16_t s16;
+typedef uint32_t u32;
+typedef int32_t s32;
+typedef uint64_t u64;
+typedef int64_t s64;
+typedef float f32;
+typedef double f64;
+
+#if defined(__GNUC__)
+#define WASM_NORETURN __attribute__((noreturn))
+#define WASM_UNUSED __attribute__((unused))
+#else
+#define WASM_NORETURN
+#define WASM_UNUSED
+#endif
+
+#ifndef WASM_MAX_CALL_DEPTH
+#define WASM_MAX_CALL_DEPTH 10000
+#endif
+
+#define WASM_PAGE_SIZE 65536
+
+jmp_buf* wasm_trap_handler = NULL;
+const char* wasm_trap_reason = NULL;
+static u32 wasm_call_depth = 0;
+
+static WASM_NORETURN void wasm_trap(const char* reason) {
+  wasm_trap_reason = reason;
+  if (wasm_trap_handler) longjmp(*wasm_trap_handler, 1);
+  fprintf(stderr, "wasm trap: %s\n", reason);
+  abort();
+}
+
+u8* wasm_memory = NULL;
+u32 wasm_memory_pages = 0;
+static u32 wasm_memory_max_pages = 0;
+static u64 wasm_memory_size = 0;
+
+static WASM_UNUSED u32 wasm_grow_memory(u32 delta) {
+  u32 old = wasm_memory_pages;
+  if (delta > wasm_memory_max_pages - old) return (u32)-1;
+  u64 size = (u64)(old + delta) * WASM_PAGE_SIZE;
+  u8* memory = (u8*)realloc(wasm_memory, size ? size : 1);
+  if (!memory) return (u32)-1;
+  memset(memory + wasm_memory_size, 0, size - wasm_memory_size);
+  wasm_memory = memory;
+  wasm_memory_pages = old + delta;
+  wasm_memory_size = size;
+  return old;
+}
+
+typedef void (*wasm_funcref)(void);
+
+typedef struct {
+  u32 type;
+  wasm_funcref func;
+} wasm_table_entry;
+
+#define WASM_MEMCHECK(addr, t) \
+  if ((addr) + sizeof(t) > wasm_memory_size) wasm_trap("out of bounds memory access")
+
+#define WASM_DEFINE_LOAD(name, t1, t2, t3) \
+  static WASM_UNUSED inline t3 name(u64 addr) { \
+    WASM_MEMCHECK(addr, t1); \
+    t1 result; \
+    memcpy(&result, &wasm_memory[addr], sizeof(t1)); \
+    return (t3)(t2)result; \
+  }
+
+#define WASM_DEFINE_STORE(name, t1, t2) \
+  static WASM_UNUSED inline void name(u64 addr, t2 value) { \
+    WASM_MEMCHECK(addr, t1); \
+    t1 wrapped = (t1)value; \
+    memcpy(&wasm_memory[addr], &wrapped, sizeof(t1)); \
+  }
+
+WASM_DEFINE_LOAD(i32_load, u32, u32, u32)
+WASM_DEFINE_LOAD(i64_load, u64, u64, u64)
+WASM_DEFINE_LOAD(f32_load, f32, f32, f32)
+WASM_DEFINE_LOAD(f64_load, f64, f64, f64)
+WASM_DEFINE_LOAD(i32_load8_s, s8, s32, u32)
+WASM_DEFINE_LOAD(i64_load8_s, s8, s64, u64)
+WASM_DEFINE_LOAD(i32_load8_u, u8, u32, u32)
+WASM_DEFINE_LOAD(i64_load8_u, u8, u64, u64)
+WASM_DEFINE_LOAD(i32_load16_s, s16, s32, u32)
+WASM_DEFINE_LOAD(i64_load16_s, s16, s64, u64)
+WASM_DEFINE_LOAD(i32_load16_u, u16, u32, u32)
+WASM_DEFINE_LOAD(i64_load16_u, u16, u64, u64)
+WASM_DEFINE_LOAD(i64_load32_s, s32, s64, u64)
+WASM_DEFINE_LOAD(i64_load32_u, u32, u64, u64)
+WASM_DEFINE_STORE(i32_store, u32, u32)
+WASM_DEFINE_STORE(i64_store, u64, u64)
+WASM_DEFINE_STORE(f32_store, f32, f32)
+WASM_DEFINE_STORE(f64_store, f64, f64)
+WASM_DEFINE_STORE(i32_store8, u8, u32)
+WASM_DEFINE_STORE(i32_store16, u16, u32)
+WASM_DEFINE_STORE(i64_store8, u8, u64)
+WASM_DEFINE_STORE(i64_store16, u16, u64)
+WASM_DEFINE_STORE(i64_store32, u32, u64)
+
+#define WASM_DEFINE_DIV(name, t, st, min) \
+  static WASM_UNUSED inline t name##_div_s(t a, t b) { \
+    if (b == 0) wasm_trap("integer divide by zero"); \
+    if (a == (t)(min) && b == (t)-1) wasm_trap("integer overflow"); \
+    return (t)((st)a / (st)b); \
+  } \
+  static WASM_UNUSED inline t name##_div_u(t a, t b) { \
+    if (b == 0) wasm_trap("integer divide by zero"); \
+    return a / b; \
+  } \
+  static WASM_UNUSED inline t name##_rem_s(t a, t b) { \
+    if (b == 0) wasm_trap("integer divide by zero"); \
+    if (b == (t)-1) return 0; \
+    return (t)((st)a % (st)b); \
+  } \
+  static WASM_UNUSED inline t name##_rem_u(t a, t b) { \
+    if (b == 0) wasm_trap("integer divide by zero"); \
+    return a % b; \
+  }
+
+WASM_DEFINE_DIV(i32, u32, s32, 0x80000000u)
+WASM_DEFINE_DIV(i64, u64, s64, 0x8000000000000000ull)
+
+static WASM_UNUSED inline u32 i32_rotl(u32 x, u32 n) { n &= 31; return n ? (x << n) | (x >> (32 - n)) : x; }
+static WASM_UNUSED inline u32 i32_rotr(u32 x, u32 n) { n &= 31; return n ? (x >> n) | (x << (32 - n)) : x; }
+static WASM_UNUSED inline u64 i64_rotl(u64 x, u64 n) { n &= 63; return n ? (x << n) | (x >> (64 - n)) : x; }
+static WASM_UNUSED inline u64 i64_rotr(u64 x, u64 n) { n &= 63; return n ? (x >> n) | (x << (64 - n)) : x; }
+
+#if defined(__GNUC__)
+static WASM_UNUSED inline u32 i32_clz(u32 x) { return x ? __builtin_clz(x) : 32; }
+static WASM_UNUSED inline u32 i32_ctz(u32 x) { return x ? __builtin_ctz(x) : 32; }
+static WASM_UNUSED inline u32 i32_popcnt(u32 x) { return __builtin_popcount(x); }
+static WASM_UNUSED inline u64 i64_clz(u64 x) { return x ? __builtin_clzll(x) : 64; }
+static WASM_UNUSED inline u64 i64_ctz(u64 x) { return x ? __builtin_ctzll(x) : 64; }
+static WASM_UNUSED inline u64 i64_popcnt(u64 x) { return __builtin_popcountll(x); }
+#else
+static WASM_UNUSED u32 i32_clz(u32 x) { u32 n = 0; while (n < 32 && !(x & (0x80000000u >> n))) n++; return n; }
+static WASM_UNUSED u32 i32_ctz(u32 x) { u32 n = 0; while (n < 32 && !(x & (1u << n))) n++; return n; }
+static WASM_UNUSED u32 i32_popcnt(u32 x) { u32 n = 0; while (x) { n += x & 1; x >>= 1; } return n; }
+static WASM_UNUSED u64 i64_clz(u64 x) { u64 n = 0; while (n < 64 && !(x & (0x8000000000000000ull >> n))) n++; return n; }
+static WASM_UNUSED u64 i64_ctz(u64 x) { u64 n = 0; while (n < 64 && !(x & (1ull << n))) n++; return n; }
+static WASM_UNUSED u64 i64_popcnt(u64 x) { u64 n = 0; while (x) { n += x & 1; x >>= 1; } return n; }
+#endif
+
+static WASM_UNUSED inline u32 i32_reinterpret_f32(f32 x) { u32 r; memcpy(&r, &x, 4); return r; }
+static WASM_UNUSED inline u64 i64_reinterpret_f64(f64 x) { u64 r; memcpy(&r, &x, 8); return r; }
+static WASM_UNUSED inline f32 f32_reinterpret_i32(u32 x) { f32 r; memcpy(&r, &x, 4); return r; }
+static WASM_UNUSED inline f64 f64_reinterpret_i64(u64 x) { f64 r; memcpy(&r, &x, 8); return r; }
+
+#define WASM_DEFINE_MIN_MAX(t, it, reinterpret, back, quiet) \
+  static WASM_UNUSED inline t t##_min(t a, t b) { \
+    if (isnan(a)) return back(reinterpret(a) | quiet); \
+    if (isnan(b)) return back(reinterpret(b) | quiet); \
+    if (a == 0 && b == 0) return signbit(a) ? a : b; \
+    return a < b ? a : b; \
+  } \
+  static WASM_UNUSED inline t t##_max(t a, t b) { \
+    if (isnan(a)) return back(reinterpret(a) | quiet); \
+    if (isnan(b)) return back(reinterpret(b) | quiet); \
+    if (a == 0 && b == 0) return signbit(a) ? b : a; \
+    return a > b ? a : b; \
+  }
+
+WASM_DEFINE_MIN_MAX(f32, u32, i32_reinterpret_f32, f32_reinterpret_i32, 0x400000u)
+WASM_DEFINE_MIN_MAX(f64, u64, i64_reinterpret_f64, f64_reinterpret_i64, 0x8000000000000ull)
+
+// valid ranges are exclusive on both ends
+#define WASM_DEFINE_TRUNC(name, ft, it, min, max) \
+  static WASM_UNUSED inline it name(ft x) { \
+    if (isnan(x)) wasm_trap("invalid conversion to integer"); \
+    if (!(x > (min) && x < (max))) wasm_trap("integer overflow"); \
+    return (it)x; \
+  }
+
+WASM_DEFINE_TRUNC(i32_trunc_s_f32_, f32, s32, -2147483904.0f, 2147483648.0f)
+WASM_DEFINE_TRUNC(i32_trunc_u_f32, f32, u32, -1.0f, 4294967296.0f)
+WASM_DEFINE_TRUNC(i32_trunc_s_f64_, f64, s32, -2147483649.0, 2147483648.0)
+WASM_DEFINE_TRUNC(i32_trunc_u_f64, f64, u32, -1.0, 4294967296.0)
+WASM_DEFINE_TRUNC(i64_trunc_s_f32_, f32, s64, -9223373136366403584.0f, 9223372036854775808.0f)
+WASM_DEFINE_TRUNC(i64_trunc_u_f32, f32, u64, -1.0f, 18446744073709551616.0f)
+WASM_DEFINE_TRUNC(i64_trunc_s_f64_, f64, s64, -9223372036854777856.0, 9223372036854775808.0)
+WASM_DEFINE_TRUNC(i64_trunc_u_f64, f64, u64, -1.0, 18446744073709551616.0)
+
+#define i32_trunc_s_f32(x) ((u32)i32_trunc_s_f32_(x))
+#define i32_trunc_s_f64(x) ((u32)i32_trunc_s_f64_(x))
+#define i64_trunc_s_f32(x) ((u64)i64_trunc_s_f32_(x))
+#define i64_trunc_s_f64(x) ((u64)i64_trunc_s_f64_(x))
+
+// run a function, returning whether it trapped
+static WASM_UNUSED int wasm_run_guarded(void (*func)(void)) {
+  jmp_buf buf;
+  jmp_buf* previousHandler = wasm_trap_handler;
+  u32 previousDepth = wasm_call_depth;
+  int trapped;
+  wasm_trap_handler = &buf;
+  trapped = setjmp(buf);
+  if (!trapped) func();
+  wasm_trap_handler = previousHandler;
+  wasm_call_depth = previousDepth;
+  return trapped;
+}
+
+static const u32 wasm_memory_initial_pages = 1u;
+static const u32 wasm_memory_declared_max_pages = 2u;
+static const u32 wasm_table_size = 3u;
+static wasm_table_entry wasm_table[3];
+
+void (*import_spectest_print)(u32) = NULL;
+u32 import_spectest_global = 0;
+static u32 g_counter;
+static u32 g_base;
+
+static void f_print(u32 l0) {
+  if (!import_spectest_print) wasm_trap("missing import");
+  import_spectest_print(l0);
+}
+static u32 f_double(u32 l0);
+static u32 f_square(u32 l0);
+static u32 f_2(u32 l0, u32 l1);
+static void f_3(u32 l0);
+static u32 f_4(void);
+static u32 f_5(void);
+static u32 f_6(u32 l0);
+static u32 f_7(u32 l0);
+static u64 f_8(u32 l0);
+static u64 f_9(u32 l0, u64 l1);
+static u32 f_10(u32 l0);
+static u32 f_11(void);
+static f32 f_12(f32 l0, f32 l1);
+static f64 f_13(f64 l0, f64 l1);
+static f32 f_14(f32 l0);
+static f64 f_15(f64 l0, f64 l1);
+static u32 f_16(f32 l0);
+static u64 f_17(f64 l0);
+static f32 f_18(u64 l0);
+static f64 f_19(f64 l0, f64 l1);
+static u64 f_20(u64 l0, u64 l1);
+static u32 f_21(u32 l0);
+static u64 f_22(u64 l0);
+static u32 f_23(u32 l0, u32 l1);
+static u64 f_24(u64 l0, u64 l1);
+static u32 f_25(u32 l0, u32 l1);
+static u32 f_26(u32 l0);
+static u32 f_27(u32 l0);
+static u64 f_fac(u64 l0);
+static void f_runaway(void);
+static u32 f_30(void);
+
+static u32 f_double(u32 l0) {
+  u32 t0, t1, t2;
+  if (++wasm_call_depth > WASM_MAX_CALL_DEPTH) wasm_trap("call stack exhausted");
+  t0 = l0;
+  t1 = l0;
+  t2 = t0 + t1;
+  wasm_call_depth--; return t2;
+}
+
+static u32 f_square(u32 l0) {
+  u32 t0, t1, t2;
+  if (++wasm_call_depth > WASM_MAX_CALL_DEPTH) wasm_trap("call stack exhausted");
+  t0 = l0;
+  t1 = l0;
+  t2 = t0 * t1;
+  wasm_call_depth--; return t2;
+}
+
+static u32 f_2(u32 l0, u32 l1) {
+  u32 t0, t1, t2;
+  if (++wasm_call_depth > WASM_MAX_CALL_DEPTH) wasm_trap("call stack exhausted");
+  t0 = l1;
+  t1 = l0;
+  if (t1 >= wasm_table_size || !wasm_table[t1].func) wasm_trap("undefined element");
+  if (wasm_table[t1].type != 0) wasm_trap("indirect call type mismatch");
+  t2 = ((u32 (*)(u32))wasm_table[t1].func)(t0);
+  wasm_call_depth--; return t2;
+}
+
+static void f_3(u32 l0) {
+  u32 t0;
+  if (++wasm_call_depth > WASM_MAX_CALL_DEPTH) wasm_trap("call stack exhausted");
+  t0 = l0;
+  f_print(t0);
+  wasm_call_depth--; return;
+}
+
+static u32 f_4(void) {
+  u32 t0, t1, t2, t3;
+  if (++wasm_call_depth > WASM_MAX_CALL_DEPTH) wasm_trap("call stack exhausted");
+  t1 = g_counter;
+  t2 = t1 + 1u;
+  g_counter = t2;
+  t3 = g_counter;
+  t0 = t3;
+  wasm_call_depth--; return t0;
+}
+
+static u32 f_5(void) {
+  u32 t0;
+  if (++wasm_call_depth > WASM_MAX_CALL_DEPTH) wasm_trap("call stack exhausted");
+  t0 = g_base;
+  wasm_call_depth--; return t0;
+}
+
+static u32 f_6(u32 l0) {
+  u32 t0, t1;
+  if (++wasm_call_depth > WASM_MAX_CALL_DEPTH) wasm_trap("call stack exhausted");
+  t0 = l0;
+  t1 = i32_load8_s((u64)t0 + 0u);
+  wasm_call_depth--; return t1;
+}
+
+static u32 f_7(u32 l0) {
+  u32 t0, t1;
+  if (++wasm_call_depth > WASM_MAX_CALL_DEPTH) wasm_trap("call stack exhausted");
+  t0 = l0;
+  t1 = i32_load8_u((u64)t0 + 1u);
+  wasm_call_depth--; return t1;
+}
+
+static u64 f_8(u32 l0) {
+  u32 t0;
+  u64 t1;
+  if (++wasm_call_depth > WASM_MAX_CALL_DEPTH) wasm_trap("call stack exhausted");
+  t0 = l0;
+  t1 = i64_load((u64)t0 + 0u);
+  wasm_call_depth--; return t1;
+}
+
+static u64 f_9(u32 l0, u64 l1) {
+  u32 t1, t3;
+  u64 t0, t2, t4;
+  if (++wasm_call_depth > WASM_MAX_CALL_DEPTH) wasm_trap("call stack exhausted");
+  t1 = l0;
+  t2 = l1;
+  i64_store32((u64)t1 + 0u, t2);
+  t3 = l0;
+  t4 = i64_load32_s((u64)t3 + 0u);
+  t0 = t4;
+  wasm_call_depth--; return t0;
+}
+
+static u32 f_10(u32 l0) {
+  u32 t0, t1;
+  if (++wasm_call_depth > WASM_MAX_CALL_DEPTH) wasm_trap("call stack exhausted");
+  t0 = l0;
+  t1 = wasm_grow_memory(t0);
+  wasm_call_depth--; return t1;
+}
+
+static u32 f_11(void) {
+  u32 t0;
+  if (++wasm_call_depth > WASM_MAX_CALL_DEPTH) wasm_trap("call stack exhausted");
+  t0 = wasm_memory_pages;
+  wasm_call_depth--; return t0;
+}
+
+static f32 f_12(f32 l0, f32 l1) {
+  f32 t0, t1, t2;
+  if (++wasm_call_depth > WASM_MAX_CALL_DEPTH) wasm_trap("call stack exhausted");
+  t0 = l0;
+  t1 = l1;
+  t2 = f32_min(t0, t1);
+  wasm_call_depth--; return t2;
+}
+
+static f64 f_13(f64 l0, f64 l1) {
+  f64 t0, t1, t2;
+  if (++wasm_call_depth > WASM_MAX_CALL_DEPTH) wasm_trap("call stack exhausted");
+  t0 = l0;
+  t1 = l1;
+  t2 = f64_max(t0, t1);
+  wasm_call_depth--; return t2;
+}
+
+static f32 f_14(f32 l0) {
+  f32 t0, t1;
+  if (++wasm_call_depth > WASM_MAX_CALL_DEPTH) wasm_trap("call stack exhausted");
+  t0 = l0;
+  t1 = nearbyintf(t0);
+  wasm_call_depth--; return t1;
+}
+
+static f64 f_15(f64 l0, f64 l1) {
+  f64 t0, t1, t2;
+  if (++wasm_call_depth > WASM_MAX_CALL_DEPTH) wasm_trap("call stack exhausted");
+  t0 = l0;
+  t1 = l1;
+  t2 = t0 / t1;
+  wasm_call_depth--; return t2;
+}
+
+static u32 f_16(f32 l0) {
+  u32 t1;
+  f32 t0;
+  if (++wasm_call_depth > WASM_MAX_CALL_DEPTH) wasm_trap("call stack exhausted");
+  t0 = l0;
+  t1 = i32_trunc_s_f32(t0);
+  wasm_call_depth--; return t1;
+}
+
+static u64 f_17(f64 l0) {
+  u64 t1;
+  f64 t0;
+  if (++wasm_call_depth > WASM_MAX_CALL_DEPTH) wasm_trap("call stack exhausted");
+  t0 = l0;
+  t1 = i64_trunc_u_f64(t0);
+  wasm_call_depth--; return t1;
+}
+
+static f32 f_18(u64 l0) {
+  u64 t0;
+  f32 t1;
+  if (++wasm_call_depth > WASM_MAX_CALL_DEPTH) wasm_trap("call stack exhausted");
+  t0 = l0;
+  t1 = (f32)t0;
+  wasm_call_depth--; return t1;
+}
+
+static f64 f_19(f64 l0, f64 l1) {
+  f64 t0, t1, t2;
+  if (++wasm_call_depth > WASM_MAX_CALL_DEPTH) wasm_trap("call stack exhausted");
+  t0 = l0;
+  t1 = l1;
+  t2 = copysign(t0, t1);
+  wasm_call_depth--; return t2;
+}
+
+static u64 f_20(u64 l0, u64 l1) {
+  u64 t0, t1, t2;
+  if (++wasm_call_depth > WASM_MAX_CALL_DEPTH) wasm_trap("call stack exhausted");
+  t0 = l0;
+  t1 = l1;
+  t2 = i64_rotr(t0, t1);
+  wasm_call_depth--; return t2;
+}
+
+static u32 f_21(u32 l0) {
+  u32 t0, t1;
+  if (++wasm_call_depth > WASM_MAX_CALL_DEPTH) wasm_trap("call stack exhausted");
+  t0 = l0;
+  t1 = i32_clz(t0);
+  wasm_call_depth--; return t1;
+}
+
+static u64 f_22(u64 l0) {
+  u64 t0, t1;
+  if (++wasm_call_depth > WASM_MAX_CALL_DEPTH) wasm_trap("call stack exhausted");
+  t0 = l0;
+  t1 = i64_popcnt(t0);
+  wasm_call_depth--; return t1;
+}
+
+static u32 f_23(u32 l0, u32 l1) {
+  u32 t0, t1, t2;
+  if (++wasm_call_depth > WASM_MAX_CALL_DEPTH) wasm_trap("call stack exhausted");
+  t0 = l0;
+  t1 = l1;
+  t2 = i32_rem_s(t0, t1);
+  wasm_call_depth--; return t2;
+}
+
+static u64 f_24(u64 l0, u64 l1) {
+  u64 t0, t1, t2;
+  if (++wasm_call_depth > WASM_MAX_CALL_DEPTH) wasm_trap("call stack exhausted");
+  t0 = l0;
+  t1 = l1;
+  t2 = i64_div_s(t0, t1);
+  wasm_call_depth--; return t2;
+}
+
+static u32 f_25(u32 l0, u32 l1) {
+  u32 t0, t1, t2;
+  if (++wasm_call_depth > WASM_MAX_CALL_DEPTH) wasm_trap("call stack exhausted");
+  t0 = l0;
+  t1 = l1;
+  t2 = (u32)((s32)t0 >> (t1 & 31));
+  wasm_call_depth--; return t2;
+}
+
+static u32 f_26(u32 l0) {
+  u32 t0, t1, t2, t3;
+  if (++wasm_call_depth > WASM_MAX_CALL_DEPTH) wasm_trap("call stack exhausted");
+  t3 = l0;
+  switch (t3) {
+    case 0: t2 = 10u; goto B2;
+    case 1: t1 = 10u; goto B1;
+    default: t0 = 10u; goto B0;
+  }
+  B2:;
+  wasm_call_depth--; return 100u;
+  B1:;
+  wasm_call_depth--; return 200u;
+  B0:;
+  wasm_call_depth--; return t0;
+}
+
+static u32 f_27(u32 l0) {
+  u32 t0, t1, t2, t3, t4;
+  if (++wasm_call_depth > WASM_MAX_CALL_DEPTH) wasm_trap("call stack exhausted");
+  t1 = l0;
+  if (t1) { t0 = 1u; goto B0; }
+  t0 = 2u;
+  B0:;
+  t2 = l0;
+  if (t2) {
+    t3 = 10u;
+  } else {
+    t3 = 20u;
+  }
+  t4 = t0 + t3;
+  wasm_call_depth--; return t4;
+}
+
+static u64 f_fac(u64 l0) {
+  u64 l1 = 0;
+  u32 t2;
+  u64 t0, t1, t3, t4, t5, t6, t7, t8;
+  if (++wasm_call_depth > WASM_MAX_CALL_DEPTH) wasm_trap("call stack exhausted");
+  l1 = 1ull;
+  L0:;
+  t1 = l0;
+  t2 = (u32)(t1 > 1ull);
+  if (t2) {
+    t3 = l1;
+    t4 = l0;
+    t5 = t3 * t4;
+    l1 = t5;
+    t6 = l0;
+    t7 = t6 - 1ull;
+    l0 = t7;
+    goto L0;
+  }
+  t8 = l1;
+  t0 = t8;
+  wasm_call_depth--; return t0;
+}
+
+static void f_runaway(void) {
+  if (++wasm_call_depth > WASM_MAX_CALL_DEPTH) wasm_trap("call stack exhausted");
+  f_runaway();
+  wasm_call_depth--; return;
+}
+
+static u32 f_30(void) {
+  if (++wasm_call_depth > WASM_MAX_CALL_DEPTH) wasm_trap("call stack exhausted");
+  wasm_trap("unreachable");
+}
+
+u32 export_call_2Dindirect(u32 l0, u32 l1) {
+  return f_2(l0, l1);
+}
+
+void export_call_2Dimport(u32 l0) {
+  f_3(l0);
+}
+
+u32 export_bump(void) {
+  return f_4();
+}
+
+u32 export_base(void) {
+  return f_5();
+}
+
+u32 export_load8_5Fs(u32 l0) {
+  return f_6(l0);
+}
+
+u32 export_load8_5Fu(u32 l0) {
+  return f_7(l0);
+}
+
+u64 export_load64(u32 l0) {
+  return f_8(l0);
+}
+
+u64 export_store_2Dload(u32 l0, u64 l1) {
+  return f_9(l0, l1);
+}
+
+u32 export_grow(u32 l0) {
+  return f_10(l0);
+}
+
+u32 export_size(void) {
+  return f_11();
+}
+
+f32 export_f32_2Emin(f32 l0, f32 l1) {
+  return f_12(l0, l1);
+}
+
+f64 export_f64_2Emax(f64 l0, f64 l1) {
+  return f_13(l0, l1);
+}
+
+f32 export_f32_2Enearest(f32 l0) {
+  return f_14(l0);
+}
+
+f64 export_f64_2Ediv(f64 l0, f64 l1) {
+  return f_15(l0, l1);
+}
+
+u32 export_i32_2Etrunc_5Fs_2Ff32(f32 l0) {
+  return f_16(l0);
+}
+
+u64 export_i64_2Etrunc_5Fu_2Ff64(f64 l0) {
+  return f_17(l0);
+}
+
+f32 export_f32_2Econvert_5Fu_2Fi64(u64 l0) {
+  return f_18(l0);
+}
+
+f64 export_copysign(f64 l0, f64 l1) {
+  return f_19(l0, l1);
+}
+
+u64 export_i64_2Erotr(u64 l0, u64 l1) {
+  return f_20(l0, l1);
+}
+
+u32 export_i32_2Eclz(u32 l0) {
+  return f_21(l0);
+}
+
+u64 export_i64_2Epopcnt(u64 l0) {
+  return f_22(l0);
+}
+
+u32 export_i32_2Erem_5Fs(u32 l0, u32 l1) {
+  return f_23(l0, l1);
+}
+
+u64 export_i64_2Ediv_5Fs(u64 l0, u64 l1) {
+  return f_24(l0, l1);
+}
+
+u32 export_i32_2Eshr_5Fs(u32 l0, u32 l1) {
+  return f_25(l0, l1);
+}
+
+u32 export_switch(u32 l0) {
+  return f_26(l0);
+}
+
+u32 export_value_2Dblock(u32 l0) {
+  return f_27(l0);
+}
+
+u64 export_fac(u64 l0) {
+  return f_fac(l0);
+}
+
+void export_runaway(void) {
+  f_runaway();
+}
+
+u32 export_unreachable(void) {
+  return f_30();
+}
+
+void wasm_init(void) {
+  u64 offset;
+  g_counter = 0u;
+  g_base = import_spectest_global;
+  free(wasm_memory);
+  wasm_memory = NULL;
+  wasm_memory_pages = wasm_memory_size = 0;
+  wasm_memory_max_pages = wasm_memory_declared_max_pages;
+  if (wasm_grow_memory(wasm_memory_initial_pages) == (u32)-1) wasm_trap("out of memory");
+  offset = 8u;
+  if (offset + 9u > wasm_memory_size) wasm_trap("data segment does not fit");
+  memcpy(wasm_memory + offset, "hello\000\377\042\134", 9u);
+  offset = 0u;
+  if (offset + 3u > wasm_table_size) wasm_trap("elements segment does not fit");
+  wasm_table[offset + 0u].type = 0;
+  wasm_table[offset + 0u].func = (wasm_funcref)f_double;
+  wasm_table[offset + 1u].type = 0;
+  wasm_table[offset + 1u].func = (wasm_funcref)f_square;
+  wasm_table[offset + 2u].type = 1;
+  wasm_table[offset + 2u].func = (wasm_funcref)f_print;
+}
@@ -0,0 +1,124 @@
+(module
+  (type $ii (func (param i32) (result i32)))
+  (import "spectest" "print" (func $print (param i32)))
+  (import "spectest" "global" (global $imported i32))
+  (global $counter (mut i32) (i32.const 0))
+  (global $base i32 (get_global $imported))
+  (memory 1 2)
+  (data (i32.const 8) "hello\00\ff\"\\")
+  (table 3 anyfunc)
+  (elem (i32.const 0) $double $square $print)
+
+  (func $double (type $ii) (i32.add (get_local 0) (get_local 0)))
+  (func $square (type $ii) (i32.mul (get_local 0) (get_local 0)))
+
+  (func (export "call-indirect") (param $i i32) (param $x i32) (result i32)
+    (call_indirect (type $ii) (get_local $x) (get_local $i)))
+  (func (export "call-import") (param $x i32)
+    (call $print (get_local $x)))
+  (func (export "bump") (result i32)
+    (set_global $counter (i32.add (get_global $counter) (i32.const 1)))
+    (get_global $counter))
+  (func (export "base") (result i32) (get_global $base))
+
+  (func (export "load8_s") (param $p i32) (result i32) (i32.load8_s (get_local $p)))
+  (func (export "load8_u") (param $p i32) (result i32) (i32.load8_u offset=1 (get_local $p)))
+  (func (export "load64") (param $p i32) (result i64) (i64.load (get_local $p)))
+  (func (export "store-load") (param $p i32) (param $v i64) (result i64)
+    (i64.store32 (get_local $p) (get_local $v))
+    (i64.load32_s (get_local $p)))
+  (func (export "grow") (param $d i32) (result i32) (grow_memory (get_local $d)))
+  (func (export "size") (result i32) (current_memory))
+
+  (func (export "f32.min") (param f32 f32) (result f32) (f32.min (get_local 0) (get_local 1)))
+  (func (export "f64.max") (param f64 f64) (result f64) (f64.max (get_local 0) (get_local 1)))
+  (func (export "f32.nearest") (param f32) (result f32) (f32.nearest (get_local 0)))
+  (func (export "f64.div") (param f64 f64) (result f64) (f64.div (get_local 0) (get_local 1)))
+  (func (export "i32.trunc_s/f32") (param f32) (result i32) (i32.trunc_s/f32 (get_local 0)))
+  (func (export "i64.trunc_u/f64") (param f64) (result i64) (i64.trunc_u/f64 (get_local 0)))
+  (func (export "f32.convert_u/i64") (param i64) (result f32) (f32.convert_u/i64 (get_local 0)))
+  (func (export "copysign") (param f64 f64) (result f64) (f64.copysign (get_local 0) (get_local 1)))
+
+  (func (export "i64.rotr") (param i64 i64) (result i64) (i64.rotr (get_local 0) (get_local 1)))
+  (func (export "i32.clz") (param i32) (result i32) (i32.clz (get_local 0)))
+  (func (export "i64.popcnt") (param i64) (result i64) (i64.popcnt (get_local 0)))
+  (func (export "i32.rem_s") (param i32 i32) (result i32) (i32.rem_s (get_local 0) (get_local 1)))
+  (func (export "i64.div_s") (param i64 i64) (result i64) (i64.div_s (get_local 0) (get_local 1)))
+  (func (export "i32.shr_s") (param i32 i32) (result i32) (i32.shr_s (get_local 0) (get_local 1)))
+
+  (func (export "switch") (param $i i32) (result i32)
+    (block $2 (result i32)
+      (drop (block $1 (result i32)
+        (drop (block $0 (result i32)
+          (br_table $0 $1 $2 (i32.const 10) (get_local $i))))
+        (return (i32.const 100))))
+      (return (i32.const 200))))
+  (func (export "value-block") (param $x i32) (result i32)
+    (i32.add
+      (block $b (result i32)
+        (drop (br_if $b (i32.const 1) (get_local $x)))
+        (i32.const 2))
+      (if (result i32) (get_local $x) (i32.const 10) (i32.const 20))))
+  (func $fac (export "fac") (param $n i64) (result i64)
+    (local $r i64)
+    (set_local $r (i64.const 1))
+    (loop $l
+      (if (i64.gt_u (get_local $n) (i64.const 1))
+        (then
+          (set_local $r (i64.mul (get_local $r) (get_local $n)))
+          (set_local $n (i64.sub (get_local $n) (i64.const 1)))
+          (br $l))))
+    (get_local $r))
+  (func $runaway (export "runaway") (call $runaway))
+  (func (export "unreachable") (result i32) (i32.add (unreachable) (i32.const 1)))
+)
+
+(invoke "call-import" (i32.const 42))
+(assert_return (invoke "call-indirect" (i32.const 0) (i32.const 21)) (i32.const 42))
+(assert_return (invoke "call-indirect" (i32.const 1) (i32.const 12)) (i32.const 144))
+(assert_trap (invoke "call-indirect" (i32.const 2) (i32.const 0)) "indirect call type mismatch")
+(assert_trap (invoke "call-indirect" (i32.const 3) (i32.const 0)) "undefined element")
+(assert_return (invoke "bump") (i32.const 1))
+(assert_return (invoke "bump") (i32.const 2))
+(assert_return (invoke "base") (i32.const 666))
+(assert_return (invoke "load8_s" (i32.const 14)) (i32.const -1))
+(assert_return (invoke "load8_u" (i32.const 13)) (i32.const 255))
+(assert_return (invoke "load64" (i32.const 8)) (i64.const 0x22ff006f6c6c6568))
+(assert_trap (invoke "load64" (i32.const 65529)) "out of bounds memory access")
+(assert_trap (invoke "load8_u" (i32.const -1)) "out of bounds memory access")
+(assert_return (invoke "store-load" (i32.const 100) (i64.const 0x1ffffffff)) (i64.const -1))
+(assert_return (invoke "size") (i32.const 1))
+(assert_return (invoke "grow" (i32.const 1)) (i32.const 1))
+(assert_return (invoke "grow" (i32.const 1)) (i32.const -1))
+(assert_return (invoke "load64" (i32.const 65536)) (i64.const 0))
+(assert_return (invoke "f32.min" (f32.const 0) (f32.const -0)) (f32.const -0))
+(assert_return (invoke "f64.max" (f64.const -0) (f64.const 0)) (f64.const 0))
+(assert_return (invoke "f64.max" (f64.const 1) (f64.const 2.5)) (f64.const 2.5))
+(assert_return (invoke "f32.nearest" (f32.const 2.5)) (f32.const 2))
+(assert_return (invoke "f32.nearest" (f32.const -3.5)) (f32.const -4))
+(assert_return (invoke "f64.div" (f64.const 1) (f64.const 0)) (f64.const infinity))
+(assert_return (invoke "f64.div" (f64.const 0.1) (f64.const 3)) (f64.const 0x1.1111111111111p-5))
+(assert_return (invoke "i32.trunc_s/f32" (f32.const -2147483648)) (i32.const -2147483648))
+(assert_trap (invoke "i32.trunc_s/f32" (f32.const 2147483648)) "integer overflow")
+(assert_trap (invoke "i32.trunc_s/f32" (f32.const nan)) "invalid conversion to integer")
+(assert_return (invoke "i64.trunc_u/f64" (f64.const 18446744073709549568)) (i64.const -2048))
+(assert_trap (invoke "i64.trunc_u/f64" (f64.const -1)) "integer overflow")
+(assert_return (invoke "f32.convert_u/i64" (i64.const -1)) (f32.const 18446744073709551616))
+(assert_return (invoke "copysign" (f64.const 3) (f64.const -0)) (f64.const -3))
+(assert_return (invoke "i64.rotr" (i64.const 1) (i64.const 65)) (i64.const 0x8000000000000000))
+(assert_return (invoke "i32.clz" (i32.const 0)) (i32.const 32))
+(assert_return (invoke "i32.clz" (i32.const 0x00008000)) (i32.const 16))
+(assert_return (invoke "i64.popcnt" (i64.const -1)) (i64.const 64))
+(assert_return (invoke "i32.rem_s" (i32.const 0x80000000) (i32.const -1)) (i32.const 0))
+(assert_trap (invoke "i32.rem_s" (i32.const 1) (i32.const 0)) "integer divide by zero")
+(assert_trap (invoke "i64.div_s" (i64.const 0x8000000000000000) (i64.const -1)) "integer overflow")
+(assert_return (invoke "i32.shr_s" (i32.const -16) (i32.const 34)) (i32.const -4))
+(assert_return (invoke "switch" (i32.const 0)) (i32.const 100))
+(assert_return (invoke "switch" (i32.const 1)) (i32.const 200))
+(assert_return (invoke "switch" (i32.const 2)) (i32.const 10))
+(assert_return (invoke "switch" (i32.const 7)) (i32.const 10))
+(assert_return (invoke "value-block" (i32.const 1)) (i32.const 11))
+(assert_return (invoke "value-block" (i32.const 0)) (i32.const 22))
+(assert_return (invoke "fac" (i64.const 20)) (i64.const 2432902008176640000))
+(assert_trap (invoke "runaway") "call stack exhausted")
+(assert_trap (invoke "unreachable") "unreachable")